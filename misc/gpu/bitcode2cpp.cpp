@@ -11,14 +11,17 @@
 
 
 int main(int argc, const char **argv) {
-    assert(argc == 2 && "Requires target name as an argument (e.g. compute_35)");
+    assert((argc == 2 || argc == 3) &&
+           "Requires target name as an argument (e.g. compute_35), "
+           "optionally followed by a symbol prefix (default simit_gpu)");
 #ifdef _WIN32
     setmode(fileno(stdin), O_BINARY); // On windows bad things will happen unless we read stdin in binary mode
 #endif
     std::string target(argv[1]);
     std::replace(target.begin(), target.end(), '.', '_'); // replace illegal characters
+    std::string prefix = (argc == 3) ? argv[2] : "simit_gpu";
     printf("extern \"C\" {\n");
-    printf("unsigned char simit_gpu_%s[] = {\n", target.c_str());
+    printf("unsigned char %s_%s[] = {\n", prefix.c_str(), target.c_str());
     int count = 0;
     while (1) {
         int c = getchar();
@@ -27,7 +30,7 @@ int main(int argc, const char **argv) {
         count++;
     }
     printf("0};\n");
-    printf("int simit_gpu_%s_length = %d;\n", target.c_str(), count);
+    printf("int %s_%s_length = %d;\n", prefix.c_str(), target.c_str(), count);
     printf("}\n"); // extern "C"
     return 0;
 }
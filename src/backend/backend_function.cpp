@@ -7,6 +7,8 @@ using namespace std;
 
 #include "ir.h"
 #include "ir_visitor.h"
+#include "ir_queries.h"
+#include "intrinsics.h"
 #include "error.h"
 #include "util/collections.h"
 
@@ -61,6 +63,29 @@ Function::Function(const ir::Func& func)
     }
   };
   literals = GatherLiteralsVisitor().gather(func);
+
+  // Gather the ids of the profiled regions (see profiler.h)
+  class GatherProfileRegions : public simit::ir::IRVisitorCallGraph {
+  public:
+    vector<int> regions;
+    using simit::ir::IRVisitorCallGraph::visit;
+    void visit(const simit::ir::CallStmt *op) {
+      if (op->callee == simit::ir::intrinsics::profileBegin()) {
+        iassert(simit::ir::isa<simit::ir::Literal>(op->actuals[0]));
+        regions.push_back(
+            simit::ir::to<simit::ir::Literal>(op->actuals[0])->getIntVal(0));
+      }
+      simit::ir::IRVisitorCallGraph::visit(op);
+    }
+  };
+  GatherProfileRegions gatherProfileRegions;
+  func.accept(&gatherProfileRegions);
+  profileRegions = gatherProfileRegions.regions;
+  if (!profileRegions.empty()) {
+    loopTraffic = ir::analyzeLoopTraffic(func);
+  }
+
+  writtenFields = ir::getWrittenFields(func);
 }
 
 Function::~Function() {
@@ -107,4 +132,37 @@ const ir::Environment& Function::getEnvironment() const {
   return *environment;
 }
 
+const FieldLayouts& Function::getFieldLayouts() const {
+  return environment->getFieldLayouts();
+}
+
+void Function::checkFieldLayouts(const std::string& name, Set* set) const {
+  const ir::ElementType* elementType =
+      getBindableType(name).toSet()->elementType.toElement();
+  for (const ir::Field& field : elementType->fields) {
+    const Set::FieldData* fieldData =
+        set->getFields()[set->getFieldIndex(field.name)];
+    FieldLayout layout = getFieldLayouts().get(elementType->name, field.name);
+    size_t blockSize = fieldData->type->getSize();
+    uassert(fieldData->layout == layout ||
+            (fieldData->layout.isAoS(blockSize) && layout.isAoS(blockSize)))
+        << "Field " << field.name << " of the set bound to " << name
+        << " has layout " << fieldData->layout << ", but the function was "
+        << "compiled for layout " << layout;
+  }
+}
+
+const std::map<std::string,std::set<std::string>>&
+Function::getWrittenFields() const {
+  return writtenFields;
+}
+
+const std::vector<int>& Function::getProfileRegions() const {
+  return profileRegions;
+}
+
+const std::vector<ir::LoopTraffic>& Function::getLoopTraffic() const {
+  return loopTraffic;
+}
+
 }}
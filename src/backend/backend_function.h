@@ -6,9 +6,14 @@
 #include <map>
 #include <functional>
 #include <set>
+#include <string>
 
 #include "interfaces/printable.h"
 #include "interfaces/uncopyable.h"
+#include "memory_report.h"
+#include "codegen_report.h"
+#include "field_layout.h"
+#include "loop_traffic.h"
 
 namespace simit {
 class Set;
@@ -28,6 +33,10 @@ class Function : public interfaces::Printable, interfaces::Uncopyable {
 protected:
     Function(const ir::Func &func);
 
+  /// Check that the fields of a set bound to the named argument or global
+  /// have the layouts the function was compiled for.
+  void checkFieldLayouts(const std::string& name, Set* set) const;
+
 public:
   typedef std::function<void()> FuncType;
   virtual ~Function();
@@ -44,14 +53,18 @@ public:
   /// Initialize the function.
   virtual FuncType init() = 0;
 
-  /// Query whether the function requires intialization.
+  /// Query whether the function is initialized. It must be initialized again
+  /// after arguments are bound, and after the elements of a bound set change.
   virtual bool isInitialized() = 0;
 
-  // TODO Should these really be an extension to the bind interface?
-  //      Per-argument updates/copies.
-  //      Don't always write in a new pointer (requires re-JIT), just alert to
-  //      updates in pointed-to data.
+  /// Make the results of the last run visible to the host, and mark the
+  /// fields of the bound sets that the function writes (getWrittenFields) as
+  /// written, so that other functions bound to the sets see the change.
   virtual void mapArgs() {}
+
+  /// Make the host's changes to the arguments visible to the function.
+  /// Backends that keep copies of the arguments only copy the fields whose
+  /// version changed since they were last copied.
   virtual void unmapArgs(bool updated=true) {}
 
   /// Write the function to the stream. The output depends on the backend,
@@ -61,6 +74,19 @@ public:
   /// Print the function as machine assembly code to the stream.
   virtual void printMachine(std::ostream &os) const = 0;
 
+  /// The memory used by the function's temporaries, tensors, indices and
+  /// machine code, and by the sets bound to it.
+  virtual MemoryReport memoryReport() const {return MemoryReport();}
+
+  /// A summary of the generated code, that is empty if the backend does not
+  /// produce one.
+  virtual CodegenReport getCodegenReport() const {return CodegenReport();}
+
+  /// The sizes of the bound sets and the number of nonzeros of the tensor
+  /// indices, by name, that the trip counts of loop traffic estimates are
+  /// evaluated with.
+  virtual std::map<std::string,size_t> getSizes() const {return {};}
+
   bool hasArg(std::string arg) const;
   const std::vector<std::string>& getArgs() const;
   const ir::Type& getArgType(std::string arg) const;
@@ -74,12 +100,28 @@ public:
 
   const ir::Environment& getEnvironment() const;
 
+  /// The fields of the bound sets that the function may write, by set name.
+  const std::map<std::string,std::set<std::string>>& getWrittenFields() const;
+
+  /// Ids of the profiled regions in the function and the functions it calls.
+  const std::vector<int>& getProfileRegions() const;
+
+  /// Traffic estimates of the loops of a profiled function (see
+  /// loop_traffic.h), or nothing if the function is not profiled.
+  const std::vector<ir::LoopTraffic>& getLoopTraffic() const;
+
+  /// The layouts of the set fields the function was compiled for.
+  const FieldLayouts& getFieldLayouts() const;
+
 private:
   ir::Environment* environment;
 
   std::vector<std::string> arguments;
   std::map<std::string, ir::Type> argumentTypes;
   std::set<std::string> results;
+  std::map<std::string,std::set<std::string>> writtenFields;
+  std::vector<int> profileRegions;
+  std::vector<ir::LoopTraffic> loopTraffic;
 
   /// We store the Simit Function's literals to prevent their memory from being
   /// reclaimed if the IR is deleted, as compiled functions are allowed to
@@ -127,9 +127,17 @@ GPUFunction::~GPUFunction() {
 }
 
 void GPUFunction::mapArgs() {
+  // Mark the written fields first, so that pulling them leaves them in sync
+  LLVMFunction::mapArgs();
+
   // Pull args back from GPU -> CPU
   for (DeviceDataHandle *handle : pushedBufs) {
-    if (handle->devDirty) pullArg(handle);
+    if (handle->devDirty) {
+      pullArg(handle);
+      if (handle->hostVersion) {
+        handle->pushedVersion = *handle->hostVersion;
+      }
+    }
   }
 }
 
@@ -138,13 +146,18 @@ void GPUFunction::unmapArgs(bool updated) {
   if (!updated) return;
 
   for (DeviceDataHandle *handle : pushedBufs) {
-    // Push non-null args from CPU -> GPU
+    // Push non-null args from CPU -> GPU, unless they did not change
     if (handle->hostBuffer) {
       // Short-circuit on size-zero buffer, because the CUDA API
       // doesn't like size-zero copies
-      if (handle->size == 0) return;
+      if (handle->size == 0) continue;
+      if (handle->hostVersion &&
+          *handle->hostVersion == handle->pushedVersion) continue;
       checkCudaErrors(cuMemcpyHtoD(
           *handle->devBuffer, handle->hostBuffer, handle->size));
+      if (handle->hostVersion) {
+        handle->pushedVersion = *handle->hostVersion;
+      }
     }
   }
 }
@@ -262,6 +275,10 @@ GPUFunction::SetData GPUFunction::pushSetData(
     checkCudaErrors(cuMemAlloc(devBuffer, size));
     checkCudaErrors(cuMemcpyHtoD(*devBuffer, fieldData, size));
     DeviceDataHandle* handle = new DeviceDataHandle(fieldData, devBuffer, size);
+    const Set::FieldData* setField =
+        set->getFields()[set->getFieldIndex(field.name)];
+    handle->hostVersion = &setField->version;
+    handle->pushedVersion = setField->version;
     pushedBufs.push_back(handle);
     // std::cout << "Push field: " << field.name << std::endl;
     // std::cout << "[";
@@ -544,14 +561,13 @@ GPUFunction::init() {
   CUlinkState linker;
   CUfunction cudaFunction;
 
-  pe::PathIndexBuilder piBuilder;
-
   // Free any old device data
   for (DeviceDataHandle *handle : pushedBufs) {
     freeArg(handle);
   }
   pushedBufs.clear();
   argBufMap.clear();
+  recordBoundSets();
 
   const ir::Environment& env = getEnvironment();
 
@@ -564,12 +580,12 @@ GPUFunction::init() {
     args.push_back(pushArg(name, argType, actual));
     if (isa<SetActual>(actual)) {
       Set* set = to<SetActual>(actual)->getSet();
-      piBuilder.bind(name, set);
+      pathIndexBuilder.bind(name, set);
     }
   }
 
   // Initialize indices
-  initIndices(piBuilder, env);
+  initIndices(pathIndexBuilder, env);
 
   // Create harnesses for kernel args
   llvm::Function *harness = createHarness(args, llvmFunc, module);
@@ -805,12 +821,26 @@ GPUFunction::init() {
                                    1, 1, 1, // block size
                                    0, NULL,
                                    kernelParamsArr, NULL));
-    // Set device dirty bit for all output arg buffers
+    // Set device dirty bit for all output arg buffers. Only the fields of
+    // set arguments that the function writes are dirtied.
     for (auto& pair : arguments) {
       std::string name = pair.first;
       if (isResult(name)) {
         // std::cout << "Dirtying " << formal << std::endl;
-        for (auto &handle : argBufMap[name]) {
+        std::vector<DeviceDataHandle*>& handles = argBufMap[name];
+        if (getArgType(name).isSet()) {
+          const auto& fields =
+              getArgType(name).toSet()->elementType.toElement()->fields;
+          const auto& written = getWrittenFields();
+          for (size_t i = 0; i < handles.size(); ++i) {
+            if (util::contains(written, name) &&
+                util::contains(written.at(name), fields[i].name)) {
+              handles[i]->devDirty = true;
+            }
+          }
+          continue;
+        }
+        for (auto &handle : handles) {
           handle->devDirty = true;
         }
       }
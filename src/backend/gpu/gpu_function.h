@@ -47,15 +47,17 @@ class GPUFunction : public LLVMFunction {
     void *hostBuffer;
     size_t size;
     bool devDirty;
-    // TODO: Potentially support dirtying specific host buffers and
-    // pushing only those
-    // bool hostDirty;
+    // The version of the host data (a set field's version), and the version
+    // that was last copied to or from the device. Host buffers without a
+    // version are always pushed.
+    const size_t *hostVersion;
+    size_t pushedVersion;
 
     static size_t total_allocations;
 
     DeviceDataHandle(void *hostBuffer, CUdeviceptr *devBuffer, size_t size)
         : devBuffer(devBuffer), hostBuffer(hostBuffer), size(size),
-          devDirty(false) {
+          devDirty(false), hostVersion(nullptr), pushedVersion(0) {
       total_allocations += size;
     }
 
@@ -11,6 +11,7 @@
 #include "llvm/IR/Value.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Intrinsics.h"
+#include "llvm/IR/MDBuilder.h"
 #include "llvm/IR/Type.h"
 #include "llvm/IR/Function.h"
 #include "llvm/Support/raw_ostream.h"
@@ -19,19 +20,35 @@
 #include "llvm/Analysis/Verifier.h"
 #else
 #include "llvm/IR/Verifier.h"
+#include "llvm/IR/DiagnosticInfo.h"
+#include "llvm/IR/DiagnosticPrinter.h"
 #endif
 
 #include "llvm/ADT/SmallVector.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/CodeGen.h"
 #include "llvm/Support/TargetSelect.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Target/TargetOptions.h"
 #include "llvm/ExecutionEngine/MCJIT.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Bitcode/ReaderWriter.h"
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+#include "llvm/Linker.h"
+#else
+#include "llvm/Linker/Linker.h"
+#endif
 
 #include "llvm/Analysis/Passes.h"
 #include "llvm/Transforms/Scalar.h"
 #include "llvm/Transforms/IPO/PassManagerBuilder.h"
+#include "llvm/Transforms/Utils/Cloning.h"
 #if LLVM_MAJOR_VERSION <=3 && LLVM_MINOR_VERSION <= 6
 #include "llvm/PassManager.h"
 #else
 #include "llvm/IR/LegacyPassManager.h"
+#include "llvm/Analysis/TargetTransformInfo.h"
 #endif
 
 #include "llvm_types.h"
@@ -39,6 +56,7 @@
 #include "llvm_util.h"
 #include "llvm_data_layouts.h"
 
+#include "init.h"
 #include "macros.h"
 #include "types.h"
 #include "func.h"
@@ -53,8 +71,15 @@
 #include "llvm_function.h"
 #include "macros.h"
 #include "path_expressions.h"
+#include "pass_timer.h"
 #include "util/collections.h"
 
+#ifdef SIMIT_RUNTIME_BITCODE
+// Runtime helpers compiled to bitcode (see src/CMakeLists.txt)
+extern "C" unsigned char simit_cpu_runtime[];
+extern "C" int simit_cpu_runtime_length;
+#endif
+
 using namespace std;
 using namespace simit::ir;
 
@@ -68,6 +93,98 @@ const std::string LEN_SUFFIX(".len");
 // class LLVMBackend
 bool LLVMBackend::llvmInitialized = false;
 
+/// Returns the target attributes (e.g. "+avx2") to generate code for. If the
+/// target CPU is "native" the host CPU's features are included.
+static vector<string> getTargetAttributes() {
+  vector<string> attrs;
+  if (kTargetCPU == "native") {
+    llvm::StringMap<bool> hostFeatures;
+    if (llvm::sys::getHostCPUFeatures(hostFeatures)) {
+      for (auto& feature : hostFeatures) {
+        attrs.push_back((feature.second ? "+" : "-") + feature.first().str());
+      }
+    }
+  }
+  for (const string& feature : util::split(kTargetFeatures, ",")) {
+    string attr = util::trim(feature);
+    if (attr.empty()) {
+      continue;
+    }
+    uassert(attr[0] == '+' || attr[0] == '-')
+        << "Target features must be prefixed by + or -: " << attr;
+    attrs.push_back(attr);
+  }
+  return attrs;
+}
+
+static llvm::CodeGenOpt::Level getCodeGenOptLevel() {
+  switch (kOptLevel) {
+    case 0:  return llvm::CodeGenOpt::None;
+    case 1:  return llvm::CodeGenOpt::Less;
+    case 2:  return llvm::CodeGenOpt::Default;
+    default: return llvm::CodeGenOpt::Aggressive;
+  }
+}
+
+/// Links the runtime helper bitcode into the module, so that calls to helpers
+/// such as det3_f64 and loc can be inlined and vectorized. The helpers get
+/// internal linkage so that the ones that are not used are removed.
+static void linkRuntime(llvm::Module *module) {
+#ifdef SIMIT_RUNTIME_BITCODE
+  llvm::StringRef bitcode(reinterpret_cast<const char*>(simit_cpu_runtime),
+                          simit_cpu_runtime_length);
+  unique_ptr<llvm::MemoryBuffer> buffer(
+      llvm::MemoryBuffer::getMemBuffer(bitcode, "simit_runtime", false));
+
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+  string error;
+  llvm::Module *runtime = llvm::ParseBitcodeFile(buffer.get(), LLVM_CTX,
+                                                 &error);
+  iassert(runtime != nullptr) << "Could not parse runtime bitcode: " << error;
+#elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+#if LLVM_MINOR_VERSION <= 5
+  auto parsed = llvm::parseBitcodeFile(buffer.get(), LLVM_CTX);
+#else
+  auto parsed = llvm::parseBitcodeFile(buffer->getMemBufferRef(), LLVM_CTX);
+#endif
+  iassert(parsed) << "Could not parse runtime bitcode: "
+                  << parsed.getError().message();
+  llvm::Module *runtime = parsed.get();
+#else
+  auto parsed = llvm::parseBitcodeFile(buffer->getMemBufferRef(), LLVM_CTX);
+  iassert(parsed) << "Could not parse runtime bitcode: "
+                  << parsed.getError().message();
+  llvm::Module *runtime = parsed.get().release();
+#endif
+
+  vector<string> helpers;
+  for (llvm::Function &helper : *runtime) {
+    if (!helper.isDeclaration()) {
+      helpers.push_back(helper.getName());
+    }
+  }
+
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  string linkError;
+  bool failed = llvm::Linker::LinkModules(module, runtime,
+                                          llvm::Linker::DestroySource,
+                                          &linkError);
+  iassert(!failed) << "Could not link runtime bitcode: " << linkError;
+#else
+  bool failed = llvm::Linker::LinkModules(module, runtime);
+  iassert(!failed) << "Could not link runtime bitcode";
+#endif
+  delete runtime;
+
+  for (const string &name : helpers) {
+    llvm::Function *helper = module->getFunction(name);
+    if (helper != nullptr && !helper->isDeclaration()) {
+      helper->setLinkage(llvm::GlobalValue::InternalLinkage);
+    }
+  }
+#endif
+}
+
 shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module) {
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
   shared_ptr<llvm::EngineBuilder> engineBuilder(new llvm::EngineBuilder(module));
@@ -75,10 +192,155 @@ shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module) {
   shared_ptr<llvm::EngineBuilder> engineBuilder(new llvm::EngineBuilder(
       unique_ptr<llvm::Module>(module)));
 #endif
+
+  // Target the host CPU (or the CPU chosen in the settings) so that MCJIT
+  // emits code for the vector extensions that are actually available.
+  string cpu = (kTargetCPU == "native") ? llvm::sys::getHostCPUName().str()
+                                        : kTargetCPU;
+  engineBuilder->setMCPU(cpu);
+  engineBuilder->setMAttrs(getTargetAttributes());
+  engineBuilder->setOptLevel(getCodeGenOptLevel());
+
+  llvm::TargetOptions options;
+  options.UnsafeFPMath = kFastMath;
+  options.NoInfsFPMath = kFastMath;
+  options.NoNaNsFPMath = kFastMath;
+  options.AllowFPOpFusion = kFastMath   ? llvm::FPOpFusion::Fast
+                          : kFPContract ? llvm::FPOpFusion::Standard
+                                        : llvm::FPOpFusion::Strict;
+  engineBuilder->setTargetOptions(options);
   return engineBuilder;
 }
 
-LLVMBackend::LLVMBackend() : builder(new SimitIRBuilder(LLVM_CTX)) {
+/// Collects the optimization remarks that LLVM passes emit while it is in
+/// scope, such as the loops the vectorizers transformed and the reasons they
+/// did not. Other diagnostics go to the previous handler.
+class RemarkCollector {
+public:
+  RemarkCollector(vector<CodegenRemark>* remarks) : remarks(remarks) {
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4)
+    if (remarks != nullptr) {
+      oldHandler = LLVM_CTX.getDiagnosticHandler();
+      oldContext = LLVM_CTX.getDiagnosticContext();
+      LLVM_CTX.setDiagnosticHandler(handle, this);
+    }
+#endif
+  }
+
+  ~RemarkCollector() {
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4)
+    if (remarks != nullptr) {
+      LLVM_CTX.setDiagnosticHandler(oldHandler, oldContext);
+    }
+#endif
+  }
+
+private:
+  vector<CodegenRemark>* remarks;
+
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4)
+  llvm::LLVMContext::DiagnosticHandlerTy oldHandler;
+  void* oldContext;
+
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  typedef llvm::DiagnosticInfoOptimizationRemarkBase RemarkInfo;
+#else
+  typedef llvm::DiagnosticInfoOptimizationBase RemarkInfo;
+#endif
+
+  static void handle(const llvm::DiagnosticInfo& info, void* context) {
+    RemarkCollector* collector = static_cast<RemarkCollector*>(context);
+    string kind;
+    switch (info.getKind()) {
+      case llvm::DK_OptimizationRemark:         kind = "passed";   break;
+      case llvm::DK_OptimizationRemarkMissed:   kind = "missed";   break;
+      case llvm::DK_OptimizationRemarkAnalysis: kind = "analysis"; break;
+      default: {
+        if (collector->oldHandler != nullptr) {
+          collector->oldHandler(info, collector->oldContext);
+          return;
+        }
+        string message;
+        llvm::raw_string_ostream os(message);
+        llvm::DiagnosticPrinterRawOStream printer(os);
+        info.print(printer);
+        os.flush();
+        if (info.getSeverity() == llvm::DS_Error) {
+          ierror << message;
+        }
+        cerr << message << endl;
+        return;
+      }
+    }
+    const RemarkInfo& remarkInfo = static_cast<const RemarkInfo&>(info);
+    CodegenRemark remark;
+    remark.kind = kind;
+    remark.pass = remarkInfo.getPassName();
+    remark.function = remarkInfo.getFunction().getName().str();
+    remark.message = remarkInfo.getMsg().str();
+    collector->remarks->push_back(remark);
+  }
+#endif
+};
+
+// Run LLVM optimization passes on func and module. We use the built-in
+// PassManagerBuilder to build a set of passes similar to clang's -O<level>.
+void optimizeModule(llvm::Module *module, llvm::Function *func,
+                    llvm::EngineBuilder *engineBuilder,
+                    std::vector<CodegenRemark>* remarks) {
+  if (kOptLevel == 0) {
+    return;
+  }
+  RemarkCollector remarkCollector(remarks);
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  llvm::FunctionPassManager fpm(module);
+  llvm::PassManager mpm;
+#else
+  llvm::legacy::FunctionPassManager fpm(module);
+  llvm::legacy::PassManager mpm;
+#endif
+  llvm::PassManagerBuilder pmBuilder;
+
+  pmBuilder.OptLevel = kOptLevel;
+
+  pmBuilder.BBVectorize = (kOptLevel >= 3);
+  pmBuilder.LoopVectorize = (kOptLevel >= 2);
+//    pmBuilder.LoadCombine = 1;
+  pmBuilder.SLPVectorize = (kOptLevel >= 2);
+
+  llvm::DataLayout dataLayout(module);
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+  fpm.add(new llvm::DataLayout(dataLayout));
+#elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  fpm.add(new llvm::DataLayoutPass(dataLayout));
+#else
+  module->setDataLayout(dataLayout);
+#endif
+
+  // Give the vectorizers the cost model of the target CPU
+  unique_ptr<llvm::TargetMachine> target(engineBuilder->selectTarget());
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  target->addAnalysisPasses(fpm);
+  target->addAnalysisPasses(mpm);
+#else
+  fpm.add(llvm::createTargetTransformInfoWrapperPass(
+      target->getTargetIRAnalysis()));
+  mpm.add(llvm::createTargetTransformInfoWrapperPass(
+      target->getTargetIRAnalysis()));
+#endif
+
+  pmBuilder.populateFunctionPassManager(fpm);
+  pmBuilder.populateModulePassManager(mpm);
+
+  fpm.doInitialization();
+  fpm.run(*func);
+  fpm.doFinalization();
+
+  mpm.run(*module);
+}
+
+LLVMBackend::LLVMBackend() : builder(new SimitIRBuilder(LLVM_CTX)),
+                             tbaaRoot(nullptr) {
   if (!llvmInitialized) {
     llvm::InitializeNativeTarget();
     llvm::InitializeNativeTargetAsmPrinter();
@@ -124,13 +386,31 @@ Func LLVMBackend::makeSystemTensorsGlobal(Func func) {
   return MakeSystemTensorsGlobalRewriter().rewrite(func);
 }
 
+/// Number of LLVM instructions in the module.
+static size_t countInstructions(const llvm::Module* module) {
+  size_t instructions = 0;
+  for (const llvm::Function& function : *module) {
+    for (const llvm::BasicBlock& block : function) {
+      instructions += block.size();
+    }
+  }
+  return instructions;
+}
+
 Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
+  internal::PassTimer emitTimer("Emit LLVM IR");
   this->module = new llvm::Module("simit", LLVM_CTX);
 
   iassert(func.getBody().defined()) << "cannot compile an undefined function";
 
   this->dataLayout.reset(new llvm::DataLayout(module));
 
+  llvm::FastMathFlags fastMathFlags;
+  if (kFastMath) {
+    fastMathFlags.setUnsafeAlgebra();
+  }
+  builder->SetFastMathFlags(fastMathFlags);
+
   this->symtable.clear();
   this->buffers.clear();
   this->globals.clear();
@@ -158,6 +438,7 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
 
     // Emit function
     symtable.scope(); // put function arguments in new scope
+    beginAliasInfo(f.getName());
 
     bool exported = (f == func);
     llvmFunc = emitEmptyFunction(f.getName(), f.getArguments(),
@@ -175,20 +456,21 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
 
     compile(body);
     builder->CreateRetVoid();
+    emitAliasScopes();
 
     symtable.unscope();
   }
   iassert(llvmFunc);
 
-  // Declare malloc and free if necessary
+  // Global tensors are allocated on the runtime's counted heap (see heap.h)
   llvm::FunctionType *m =
-      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT}, false);
+      llvm::FunctionType::get(LLVM_INT8_PTR, {LLVM_INT64}, false);
   llvm::Function *malloc =
-      llvm::cast<llvm::Function>(module->getOrInsertFunction("malloc", m));
+      llvm::cast<llvm::Function>(module->getOrInsertFunction("simitMalloc",m));
   llvm::FunctionType *f =
       llvm::FunctionType::get(LLVM_VOID, {LLVM_INT8_PTR}, false);
   llvm::Function *free =
-      llvm::cast<llvm::Function>(module->getOrInsertFunction("free", f));
+      llvm::cast<llvm::Function>(module->getOrInsertFunction("simitFree", f));
 
   // Create initialization function
   emitEmptyFunction(func.getName()+"_init", func.getArguments(),
@@ -204,9 +486,16 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
     const TensorType *ttype = type.toTensor();
     llvm::Value *len= emitComputeLen(ttype,this->storage.getStorage(bufferVar));
     unsigned compSize = ttype->getComponentType().bytes();
-    llvm::Value *size = builder->CreateMul(len, llvmInt(compSize));
-    llvm::Value *mem = builder->CreateCall(malloc, size);
+    llvm::Value *size = builder->CreateMul(builder->CreateZExt(len,LLVM_INT64),
+                                           llvmInt(compSize, 64));
+
+    // Free the buffer of a previous init
+    llvm::Value *oldMem = builder->CreateLoad(bufferVal);
+    oldMem = builder->CreateCast(llvm::Instruction::CastOps::BitCast,
+                                 oldMem, LLVM_INT8_PTR);
+    builder->CreateCall(free, oldMem);
 
+    llvm::Value *mem = builder->CreateCall(malloc, size);
     mem = builder->CreateCast(llvm::Instruction::CastOps::BitCast, mem, ltype);
     builder->CreateStore(mem, bufferVal);
   }
@@ -225,55 +514,48 @@ Function* LLVMBackend::compile(ir::Func func, const ir::Storage& storage) {
     tmpPtr = builder->CreateCast(llvm::Instruction::CastOps::BitCast,
                                  tmpPtr, LLVM_INT8_PTR);
     builder->CreateCall(free, tmpPtr);
+    builder->CreateStore(llvm::Constant::getNullValue(
+        bufferVal->getType()->getPointerElementType()), bufferVal);
   }
   builder->CreateRetVoid();
   symtable.clear();
 
+  linkRuntime(module);
+
   iassert(!llvm::verifyModule(*module))
       << "LLVM module does not pass verification";
+  emitTimer.stop();
+  if (emitTimer.isActive()) {
+    emitTimer.setSizes(0, countInstructions(module));
+  }
 
-  auto engineBuilder = createEngineBuilder(module);
-
-#ifndef SIMIT_DEBUG
-  // Run LLVM optimization passes on the function
-  // We use the built-in PassManagerBuilder to build
-  // the set of passes that are similar to clang's -O3
-#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
-  llvm::FunctionPassManager fpm(module);
-  llvm::PassManager mpm;
-#else
-  llvm::legacy::FunctionPassManager fpm(module);
-  llvm::legacy::PassManager mpm;
-#endif
-  llvm::PassManagerBuilder pmBuilder;
-  
-  pmBuilder.OptLevel = 3;
-
-  pmBuilder.BBVectorize = 1;
-  pmBuilder.LoopVectorize = 1;
-//  pmBuilder.LoadCombine = 1;
-  pmBuilder.SLPVectorize = 1;
+  // Keep an unoptimized copy of the module to specialize to set sizes at init
+  llvm::Module *genericModule = kSpecialize ? llvm::CloneModule(module)
+                                            : nullptr;
 
-  llvm::DataLayout dataLayout(module);
-#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
-  fpm.add(new llvm::DataLayout(dataLayout));
-#elif LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
-  fpm.add(new llvm::DataLayoutPass(dataLayout));
-#else
-  module->setDataLayout(dataLayout);
-#endif
+  auto engineBuilder = createEngineBuilder(module);
 
-  pmBuilder.populateFunctionPassManager(fpm);
-  pmBuilder.populateModulePassManager(mpm);
+  vector<CodegenRemark> remarks;
+  {
+    internal::PassTimer optimizeTimer("Optimize LLVM IR");
+    size_t sizeBefore = optimizeTimer.isActive() ? countInstructions(module)
+                                                 : 0;
+    optimizeModule(module, llvmFunc, engineBuilder.get(), &remarks);
+    optimizeTimer.stop();
+    if (optimizeTimer.isActive()) {
+      optimizeTimer.setSizes(sizeBefore, countInstructions(module));
+    }
+  }
 
-  fpm.doInitialization();
-  fpm.run(*llvmFunc);
-  fpm.doFinalization();
-  
-  mpm.run(*module);
-#endif
+  vector<string> bufferNames;
+  for (auto& buffer : buffers) {
+    bufferNames.push_back(buffer.second->getName());
+  }
 
-  return new LLVMFunction(func, storage, llvmFunc, module, engineBuilder);
+  // The function creates the MCJIT engine, which generates machine code
+  internal::PassTimer codegenTimer("Generate Machine Code");
+  return new LLVMFunction(func, storage, llvmFunc, module, engineBuilder,
+                          genericModule, bufferNames, remarks);
 }
 
 void LLVMBackend::compile(const ir::Literal& literal) {
@@ -367,7 +649,9 @@ void LLVMBackend::compile(const ir::Load& load) {
   llvm::Value *bufferLoc = builder->CreateInBoundsGEP(buffer, index, locName);
 
   string valName = string(buffer->getName()) + VAL_SUFFIX;
-  val = builder->CreateLoad(bufferLoc, valName);
+  llvm::LoadInst *llvmLoad = builder->CreateLoad(bufferLoc, valName);
+  addAliasInfo(llvmLoad, load.buffer);
+  val = llvmLoad;
 }
 
 void LLVMBackend::compile(const ir::FieldRead& fieldRead) {
@@ -927,6 +1211,12 @@ void LLVMBackend::emitExternCall(const ir::CallStmt& callStmt) {
 }
 
 void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
+  if (callStmt.callee == ir::intrinsics::profileBegin() ||
+      callStmt.callee == ir::intrinsics::profileEnd()) {
+    emitProfileCall(callStmt);
+    return;
+  }
+
   auto args = emitArguments(callStmt.actuals, true);
 
   llvm::Function *fun = nullptr;
@@ -945,11 +1235,28 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
 
   std::string floatTypeName = ir::ScalarType::singleFloat() ? "_f32" : "_f64";
 
+  // Functions with vectorizable approximations (see runtime_math.h), used
+  // instead of libm in the fast math accuracy mode
+  std::set<Func> fastMathFuncs =
+      {ir::intrinsics::sin(), ir::intrinsics::cos(),
+       ir::intrinsics::exp(), ir::intrinsics::log()};
+  if (ir::ScalarType::singleFloat()) {
+    fastMathFuncs.insert(ir::intrinsics::atan2());
+    fastMathFuncs.insert(ir::intrinsics::pow());
+  }
+
   llvm::Value *call = nullptr;
 
-  // is it an LLVM intrinsic?
   auto foundIntrinsic = llvmIntrinsicByName.find(callStmt.callee);
-  if (foundIntrinsic != llvmIntrinsicByName.end()) {
+
+  // is it a function with a fast approximation?
+  if (kMathAccuracy == "fast" &&
+      fastMathFuncs.find(callee) != fastMathFuncs.end()) {
+    std::string fname = "fast_" + callee.getName() + floatTypeName;
+    call = emitCall(fname, args, llvmFloatType());
+  }
+  // is it an LLVM intrinsic?
+  else if (foundIntrinsic != llvmIntrinsicByName.end()) {
     iassert(callStmt.results.size() == 1);
     auto ctype = callStmt.results[0].getType().toTensor()->getComponentType();
     llvm::Type *overloadType = llvmType(ctype);
@@ -995,10 +1302,23 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
     call = emitCall("strcat", args, LLVM_INT8_PTR);
   }
   else if (callStmt.callee == ir::intrinsics::clock()) {
-    call = emitCall("clock", args, llvmFloatType());
+    call = emitCall("simitClock", args, LLVM_DOUBLE);
+    if (ir::ScalarType::singleFloat()) {
+      call = builder->CreateFPTrunc(call, llvmFloatType());
+    }
   }
   else if (callStmt.callee == ir::intrinsics::storeTime()) {
-    call = emitCall("storeTime", args);
+    iassert(args.size() == 2);
+    if (ir::ScalarType::singleFloat()) {
+      args[1] = builder->CreateFPExt(args[1], LLVM_DOUBLE);
+    }
+    call = emitCall("simitStoreTime", args);
+  }
+  else if (callStmt.callee == ir::intrinsics::startCounters()) {
+    call = emitCall("simitStartCounters", args);
+  }
+  else if (callStmt.callee == ir::intrinsics::storeCounters()) {
+    call = emitCall("simitStoreCounters", args);
   }
   else if (callee == ir::intrinsics::det()) {
     iassert(args.size() == 1);
@@ -1051,6 +1371,36 @@ void LLVMBackend::emitIntrinsicCall(const ir::CallStmt& callStmt) {
   }
 }
 
+void LLVMBackend::emitProfileCall(const ir::CallStmt& callStmt) {
+  iassert(callStmt.actuals.size() == 1 && isa<Literal>(callStmt.actuals[0]))
+      << "Profiled regions must be identified by a literal id";
+  int id = to<Literal>(callStmt.actuals[0])->getIntVal(0);
+
+  // The code runs on the host, so on x86 the cycle counter is the TSC that
+  // the profiler calibrates. Elsewhere ask the runtime for a timestamp.
+  llvm::Value *timestamp;
+#if defined(__x86_64__) || defined(__i386__)
+  llvm::Function *readCycleCounter =
+      llvm::Intrinsic::getDeclaration(module,llvm::Intrinsic::readcyclecounter);
+  timestamp = builder->CreateCall(readCycleCounter);
+#else
+  timestamp = emitCall("simitProfileTimestamp", {}, LLVM_INT64);
+#endif
+
+  if (callStmt.callee == ir::intrinsics::profileBegin()) {
+    profileStarts[id] = timestamp;
+  }
+  else {
+    // The begin call precedes the region in the same block, so its timestamp
+    // dominates the end of the region.
+    iassert(util::contains(profileStarts, id))
+        << "Profiled region " << id << " ends before it begins";
+    emitCall("simitProfileRecord",
+             {llvmInt(id), profileStarts.at(id), timestamp});
+    profileStarts.erase(id);
+  }
+}
+
 void LLVMBackend::compile(const ir::CallStmt& callStmt) {
   switch (callStmt.callee.getKind()) {
     case Func::Internal:
@@ -1084,7 +1434,8 @@ void LLVMBackend::compile(const ir::Store& store) {
 
   string locName = string(buffer->getName()) + PTR_SUFFIX;
   llvm::Value *bufferLoc = builder->CreateInBoundsGEP(buffer, index, locName);
-  builder->CreateStore(value, bufferLoc);
+  llvm::StoreInst *llvmStore = builder->CreateStore(value, bufferLoc);
+  addAliasInfo(llvmStore, store.buffer);
 }
 
 void LLVMBackend::compile(const ir::FieldWrite& fieldWrite) {
@@ -1396,8 +1747,13 @@ llvm::Value *LLVMBackend::emitFieldRead(const Expr &elemOrSet,
   
   assert(elemType->hasField(fieldName));
   unsigned fieldLoc = fieldsOffset + elemType->fieldNames.at(fieldName);
-  return builder->CreateExtractValue(setOrElemValue, {fieldLoc},
-                                     setOrElemValue->getName()+"."+fieldName);
+  llvm::Value *fieldPtr =
+      builder->CreateExtractValue(setOrElemValue, {fieldLoc},
+                                  setOrElemValue->getName()+"."+fieldName);
+  if (elemOrSet.type().isSet()) {
+    assumeSetDataAlignment(fieldPtr, builder.get());
+  }
+  return fieldPtr;
 }
 
 llvm::Value *LLVMBackend::emitComputeLen(const TensorType *tensorType,
@@ -1745,6 +2101,104 @@ void LLVMBackend::emitMemSet(llvm::Value *dst, llvm::Value *val,
   builder->CreateMemSet(dst, val, size, align);
 }
 
+// Simit guarantees that distinct fields, and the tensors a function allocates,
+// never overlap. Function arguments and externally bound globals may alias each
+// other and any field (a field can be passed as a tensor argument), so their
+// alias class is the parent of the field classes. Each function gets its own
+// TBAA root, because accesses from different roots are never considered
+// disjoint, which keeps the information valid after inlining.
+static const std::string ARGUMENTS_ALIAS_KEY = "arguments";
+static const std::string FIELD_ALIAS_PREFIX = "field.";
+
+void LLVMBackend::beginAliasInfo(const std::string &funcName) {
+  llvm::MDBuilder mdBuilder(LLVM_CTX);
+  tbaaRoot = mdBuilder.createTBAARoot("simit." + funcName);
+  tbaaTypes.clear();
+  memoryAccesses.clear();
+}
+
+std::string LLVMBackend::getAliasKey(const ir::Expr &buffer) {
+  if (isa<FieldRead>(buffer)) {
+    return FIELD_ALIAS_PREFIX + to<FieldRead>(buffer)->fieldName;
+  }
+  else if (isa<IndexRead>(buffer) &&
+           to<IndexRead>(buffer)->kind == IndexRead::Endpoints) {
+    return "endpoints";
+  }
+  else if (isa<VarExpr>(buffer)) {
+    const Var &var = to<VarExpr>(buffer)->var;
+    return util::contains(buffers, var) ? "tensor." + var.getName()
+                                        : ARGUMENTS_ALIAS_KEY;
+  }
+  return "";
+}
+
+llvm::MDNode *LLVMBackend::getTBAAType(const std::string &aliasKey) {
+  iassert(tbaaRoot != nullptr);
+  if (!util::contains(tbaaTypes, aliasKey)) {
+    llvm::MDNode *parent =
+        (aliasKey.compare(0, FIELD_ALIAS_PREFIX.size(), FIELD_ALIAS_PREFIX)==0)
+        ? getTBAAType(ARGUMENTS_ALIAS_KEY) : tbaaRoot;
+    llvm::MDBuilder mdBuilder(LLVM_CTX);
+    tbaaTypes[aliasKey] = mdBuilder.createTBAAScalarTypeNode(aliasKey, parent);
+  }
+  return tbaaTypes.at(aliasKey);
+}
+
+void LLVMBackend::addAliasInfo(llvm::Instruction *access,
+                               const ir::Expr &buffer) {
+  std::string aliasKey = getAliasKey(buffer);
+  if (aliasKey.empty() || tbaaRoot == nullptr) {
+    return;
+  }
+  llvm::MDNode *type = getTBAAType(aliasKey);
+  llvm::MDBuilder mdBuilder(LLVM_CTX);
+  access->setMetadata(llvm::LLVMContext::MD_tbaa,
+                      mdBuilder.createTBAAStructTagNode(type, type, 0));
+  memoryAccesses.push_back(make_pair(access, aliasKey));
+}
+
+void LLVMBackend::emitAliasScopes() {
+#if !(LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5)
+  // Every alias class except the arguments, which may alias fields, gets a
+  // scope, and its accesses are marked as not aliasing the other scopes.
+  llvm::MDBuilder mdBuilder(LLVM_CTX);
+  llvm::MDNode *domain = nullptr;
+  map<string, llvm::MDNode*> scopes;
+  for (auto &access : memoryAccesses) {
+    const string &aliasKey = access.second;
+    if (aliasKey == ARGUMENTS_ALIAS_KEY || util::contains(scopes, aliasKey)) {
+      continue;
+    }
+    if (domain == nullptr) {
+      domain = mdBuilder.createAnonymousAliasScopeDomain(
+          access.first->getParent()->getParent()->getName());
+    }
+    scopes[aliasKey] = mdBuilder.createAnonymousAliasScope(domain, aliasKey);
+  }
+
+  if (scopes.size() > 1) {
+    for (auto &access : memoryAccesses) {
+      if (!util::contains(scopes, access.second)) {
+        continue;
+      }
+      vector<llvm::Metadata*> scope = {scopes.at(access.second)};
+      vector<llvm::Metadata*> noalias;
+      for (auto &other : scopes) {
+        if (other.first != access.second) {
+          noalias.push_back(other.second);
+        }
+      }
+      access.first->setMetadata(llvm::LLVMContext::MD_alias_scope,
+                                llvm::MDNode::get(LLVM_CTX, scope));
+      access.first->setMetadata(llvm::LLVMContext::MD_noalias,
+                                llvm::MDNode::get(LLVM_CTX, noalias));
+    }
+  }
+#endif
+  memoryAccesses.clear();
+}
+
 llvm::Value *LLVMBackend::makeGlobalTensor(ir::Var var) {
   // Allocate buffer for local variable in global storage.
   // TODO: We should allocate small local dense tensors on the stack
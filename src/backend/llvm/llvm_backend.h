@@ -8,6 +8,7 @@
 #include <map>
 
 #include "backend/backend_impl.h"
+#include "codegen_report.h"
 
 #include "storage.h"
 #include "var.h"
@@ -28,6 +29,7 @@ class Value;
 class Instruction;
 class Function;
 class DataLayout;
+class MDNode;
 }
 
 
@@ -47,6 +49,13 @@ extern const std::string LEN_SUFFIX;
 
 std::shared_ptr<llvm::EngineBuilder> createEngineBuilder(llvm::Module *module);
 
+/// Run the optimization pipeline selected by the settings on func and the rest
+/// of module, using the target chosen by engineBuilder. The passes'
+/// optimization remarks are appended to remarks, if it is not null.
+void optimizeModule(llvm::Module *module, llvm::Function *func,
+                    llvm::EngineBuilder *engineBuilder,
+                    std::vector<CodegenRemark>* remarks=nullptr);
+
 /// Code generator that uses LLVM to compile Simit IR.
 class LLVMBackend : public BackendImpl, protected BackendVisitor<llvm::Value*> {
 public:
@@ -69,6 +78,14 @@ protected:
   std::unique_ptr<llvm::DataLayout> dataLayout;
   std::unique_ptr<SimitIRBuilder> builder;
 
+  // Alias information of the function being compiled (see addAliasInfo)
+  llvm::MDNode *tbaaRoot;
+  std::map<std::string, llvm::MDNode*> tbaaTypes;
+  std::vector<std::pair<llvm::Instruction*, std::string>> memoryAccesses;
+
+  // Start timestamps of the profiled regions, by region id
+  std::map<int, llvm::Value*> profileStarts;
+
   using BackendImpl::compile;
   virtual Function* compile(ir::Func func, const ir::Storage& storage);
 
@@ -196,6 +213,27 @@ protected:
   /// Emit a call to an intrinsic
   void emitIntrinsicCall(const ir::CallStmt& callStmt);
 
+  /// Emit the start or end of a profiled region (see profiler.h)
+  void emitProfileCall(const ir::CallStmt& callStmt);
+
+  /// Start collecting alias information for a new function.
+  void beginAliasInfo(const std::string &funcName);
+
+  /// Get the alias class of the memory a buffer expression points to, or the
+  /// empty string if nothing is known about it.
+  std::string getAliasKey(const ir::Expr &buffer);
+
+  /// Get the TBAA type node of an alias class.
+  llvm::MDNode *getTBAAType(const std::string &aliasKey);
+
+  /// Attach TBAA metadata to a load or store through `buffer`, and record it
+  /// so that emitAliasScopes can add noalias scopes.
+  void addAliasInfo(llvm::Instruction *access, const ir::Expr &buffer);
+
+  /// Add noalias scope metadata to the recorded loads and stores of the
+  /// function that was just compiled.
+  void emitAliasScopes();
+
   // TODO: Remove this function, once the old init system has been removed
   ir::Func makeSystemTensorsGlobal(ir::Func func);
 
@@ -0,0 +1,370 @@
+#include "llvm_codegen_report.h"
+
+#include <algorithm>
+#include <cctype>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/DerivedTypes.h"
+#include "llvm/Support/FormattedStream.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Target/TargetMachine.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+#include "llvm/Analysis/Dominators.h"
+#else
+#include "llvm/IR/Dominators.h"
+#endif
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+#include "llvm/PassManager.h"
+#else
+#include "llvm/ADT/SmallString.h"
+#include "llvm/IR/LegacyPassManager.h"
+#endif
+
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace backend {
+
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+typedef llvm::PassManager PassManager;
+#else
+typedef llvm::legacy::PassManager PassManager;
+#endif
+
+typedef llvm::LoopInfoBase<llvm::BasicBlock, llvm::Loop> LoopInfo;
+
+/// Machine instructions, spills and reloads of a function.
+struct MachineCode {
+  size_t instructions = 0;
+  size_t spills = 0;
+  size_t reloads = 0;
+};
+
+/// Returns the loop variable of a loop header emitted for a For or ForRange
+/// statement (e.g. "e" for "e_loop_body", or "e_loop_body3" if LLVM made the
+/// name unique), or "" for other blocks.
+static string loopVariable(const llvm::BasicBlock* header) {
+  const string suffix = "_loop_body";
+  string name = header->getName().str();
+  size_t pos = name.rfind(suffix);
+  if (pos == string::npos || pos == 0) {
+    return "";
+  }
+  for (size_t i = pos + suffix.size(); i < name.size(); ++i) {
+    if (!isdigit((unsigned char)name[i])) {
+      return "";
+    }
+  }
+  return name.substr(0, pos);
+}
+
+/// True if the loop is the vector copy the loop vectorizer made of a loop.
+static bool isVectorLoop(const llvm::Loop* loop) {
+  return loop->getHeader()->getName().startswith("vector.body");
+}
+
+/// Returns the number of lanes of the vector an instruction computes or
+/// stores, or 1 if it is scalar.
+static int vectorLanes(const llvm::Instruction& inst) {
+  llvm::Type* type = inst.getType();
+  if (const llvm::StoreInst* store = llvm::dyn_cast<llvm::StoreInst>(&inst)) {
+    type = store->getValueOperand()->getType();
+  }
+  if (llvm::VectorType* vectorType = llvm::dyn_cast<llvm::VectorType>(type)) {
+    return vectorType->getNumElements();
+  }
+  return 1;
+}
+
+/// Returns the function an instruction calls out-of-line, or "" if it is not
+/// a call. Calls of intrinsics are instructions, except for the math functions
+/// that are lowered to calls to the math library.
+static string outOfLineCallee(const llvm::Instruction& inst) {
+  const llvm::CallInst* call = llvm::dyn_cast<llvm::CallInst>(&inst);
+  if (call == nullptr) {
+    return "";
+  }
+  const llvm::Function* callee = call->getCalledFunction();
+  if (callee == nullptr) {
+    return "(indirect)";
+  }
+  string name = callee->getName().str();
+  if (callee->isIntrinsic()) {
+    static const set<string> libraryIntrinsics = {
+      "llvm.sin", "llvm.cos", "llvm.exp", "llvm.exp2", "llvm.log", "llvm.log2",
+      "llvm.log10", "llvm.pow"
+    };
+    // Strip the suffix of overloaded intrinsics (e.g. llvm.sin.f64)
+    string intrinsic = name.substr(0, name.find('.', 5));
+    return util::contains(libraryIntrinsics, intrinsic) ? intrinsic.substr(5)
+                                                        : "";
+  }
+  return name;
+}
+
+static void collectLoops(llvm::Loop* loop, vector<llvm::Loop*>* loops) {
+  loops->push_back(loop);
+  for (llvm::Loop* subloop : loop->getSubLoops()) {
+    collectLoops(subloop, loops);
+  }
+}
+
+/// Add the instructions of a loop's blocks to its summary.
+static void addBlocks(const llvm::Loop* loop, LoopCodegen* summary) {
+  for (const llvm::BasicBlock* block : loop->getBlocks()) {
+    for (const llvm::Instruction& inst : *block) {
+      summary->instructions++;
+      if (vectorLanes(inst) > 1) {
+        summary->vectorInstructions++;
+      }
+      string callee = outOfLineCallee(inst);
+      if (callee != "") {
+        summary->calls[callee]++;
+      }
+    }
+  }
+}
+
+/// Returns the loop the loop vectorizer copied a vector loop from. The vector
+/// loop exits through a middle block to the loop's remainder, which runs the
+/// iterations that do not fill a vector. Returns null if the remainder was
+/// removed because the trip count is a multiple of the vector width.
+static llvm::Loop* findScalarLoop(llvm::Loop* vectorLoop,
+                                  const LoopInfo& loopInfo) {
+  llvm::Loop* parent = vectorLoop->getParentLoop();
+  llvm::SmallVector<llvm::BasicBlock*,4> exits;
+  vectorLoop->getExitBlocks(exits);
+  vector<llvm::BasicBlock*> worklist(exits.begin(), exits.end());
+  set<llvm::BasicBlock*> visited;
+  for (int step = 0; step < 4 && !worklist.empty(); ++step) {
+    vector<llvm::BasicBlock*> next;
+    for (llvm::BasicBlock* block : worklist) {
+      if (!visited.insert(block).second) {
+        continue;
+      }
+      llvm::Loop* loop = loopInfo.getLoopFor(block);
+      if (loop != nullptr && loop != parent) {
+        if (loop->getHeader() == block && loop->getParentLoop() == parent &&
+            !isVectorLoop(loop)) {
+          return loop;
+        }
+        continue;
+      }
+      llvm::TerminatorInst* terminator = block->getTerminator();
+      for (unsigned i = 0; i < terminator->getNumSuccessors(); ++i) {
+        next.push_back(terminator->getSuccessor(i));
+      }
+    }
+    worklist = next;
+  }
+  return nullptr;
+}
+
+static void analyzeFunction(llvm::Function& func,
+                            const MachineCode& machineCode,
+                            CodegenReport* report) {
+  FunctionCodegen function;
+  function.name = func.getName().str();
+  function.machineInstructions = machineCode.instructions;
+  function.spills = machineCode.spills;
+  function.reloads = machineCode.reloads;
+  map<const llvm::BasicBlock*, size_t> blockOrder;
+  for (const llvm::BasicBlock& block : func) {
+    blockOrder.insert({&block, blockOrder.size()});
+    for (const llvm::Instruction& inst : block) {
+      function.instructions++;
+      string callee = outOfLineCallee(inst);
+      if (callee != "") {
+        function.calls[callee]++;
+      }
+    }
+  }
+  report->add(function);
+
+  llvm::DominatorTreeBase<llvm::BasicBlock> domTree(false);
+  domTree.recalculate(func);
+  LoopInfo loopInfo;
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  loopInfo.Analyze(domTree);
+#else
+  loopInfo.analyze(domTree);
+#endif
+
+  vector<llvm::Loop*> loops;
+  for (llvm::Loop* loop : loopInfo) {
+    collectLoops(loop, &loops);
+  }
+  sort(loops.begin(), loops.end(),
+       [&blockOrder](const llvm::Loop* a, const llvm::Loop* b) {
+         return blockOrder.at(a->getHeader()) < blockOrder.at(b->getHeader());
+       });
+
+  map<const llvm::Loop*, LoopCodegen> summaries;
+  for (llvm::Loop* loop : loops) {
+    LoopCodegen summary;
+    summary.function = function.name;
+    summary.loop = loopVariable(loop->getHeader());
+    if (summary.loop == "") {
+      summary.loop = loop->getHeader()->getName().str();
+    }
+    summary.depth = loop->getLoopDepth() - 1;
+    addBlocks(loop, &summary);
+    summaries.insert({loop, summary});
+  }
+
+  // Attribute vector loops to the loops they were vectorized from
+  for (llvm::Loop* loop : loops) {
+    if (!isVectorLoop(loop)) {
+      continue;
+    }
+    llvm::Loop* scalarLoop = findScalarLoop(loop, loopInfo);
+    if (scalarLoop == nullptr) {
+      continue;
+    }
+    LoopCodegen& vectorSummary = summaries.at(loop);
+    LoopCodegen& summary = summaries.at(scalarLoop);
+    for (const llvm::BasicBlock* block : loop->getBlocks()) {
+      for (const llvm::Instruction& inst : *block) {
+        summary.vectorWidth = max(summary.vectorWidth, vectorLanes(inst));
+      }
+    }
+    summary.instructions += vectorSummary.instructions;
+    summary.vectorInstructions += vectorSummary.vectorInstructions;
+    for (auto& call : vectorSummary.calls) {
+      summary.calls[call.first] += call.second;
+    }
+    summaries.erase(loop);
+  }
+
+  for (llvm::Loop* loop : loops) {
+    if (util::contains(summaries, (const llvm::Loop*)loop)) {
+      LoopCodegen& summary = summaries.at(loop);
+      // Vector loops whose remainder was removed
+      if (isVectorLoop(loop)) {
+        for (const llvm::BasicBlock* block : loop->getBlocks()) {
+          for (const llvm::Instruction& inst : *block) {
+            summary.vectorWidth = max(summary.vectorWidth, vectorLanes(inst));
+          }
+        }
+      }
+      report->add(summary);
+    }
+  }
+}
+
+/// Generate verbose assembly for a copy of the module, whose comments mark
+/// spills and reloads. Returns "" if the target cannot emit assembly.
+static string emitAssembly(llvm::Module* module, llvm::TargetMachine* target) {
+  unique_ptr<llvm::Module> copy(llvm::CloneModule(module));
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  llvm::TargetMachine::setAsmVerbosityDefault(true);
+#else
+  target->Options.MCOptions.AsmVerbose = true;
+#endif
+
+  PassManager passes;
+  string assembly;
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 6
+  llvm::raw_string_ostream os(assembly);
+  llvm::formatted_raw_ostream formattedOS(os);
+  if (target->addPassesToEmitFile(passes, formattedOS,
+                                  llvm::TargetMachine::CGFT_AssemblyFile)) {
+    return "";
+  }
+  passes.run(*copy);
+  formattedOS.flush();
+  os.flush();
+#else
+  llvm::SmallString<0> buffer;
+  llvm::raw_svector_ostream os(buffer);
+  if (target->addPassesToEmitFile(passes, os,
+                                  llvm::TargetMachine::CGFT_AssemblyFile)) {
+    return "";
+  }
+  passes.run(*copy);
+  assembly = os.str().str();
+#endif
+  return assembly;
+}
+
+/// Count the instructions, spills and reloads of each function in assembly.
+static map<string,MachineCode> countMachineCode(const string& assembly,
+                                                const llvm::Module* module) {
+  set<string> functions;
+  for (const llvm::Function& func : *module) {
+    if (!func.isDeclaration()) {
+      functions.insert(func.getName().str());
+    }
+  }
+
+  map<string,MachineCode> result;
+  MachineCode* current = nullptr;
+  istringstream lines(assembly);
+  string line;
+  while (getline(lines, line)) {
+    if (line.empty()) {
+      continue;
+    }
+    // Function labels start in the first column
+    if (!isspace((unsigned char)line[0])) {
+      if (line[line.size()-1] == ':') {
+        string label = line.substr(0, line.size()-1);
+        // Darwin prefixes symbols with an underscore
+        if (!util::contains(functions, label) && label[0] == '_') {
+          label = label.substr(1);
+        }
+        if (util::contains(functions, label)) {
+          current = &result[label];
+        }
+      }
+      continue;
+    }
+    string text = util::trim(line);
+    if (current == nullptr || text.empty() || text[0] == '.' ||
+        text[0] == '#' || text[0] == ';' || text[0] == '@' ||
+        text[text.size()-1] == ':') {
+      continue;
+    }
+    current->instructions++;
+    if (text.find(" Spill") != string::npos) {
+      current->spills++;
+    }
+    else if (text.find(" Reload") != string::npos) {
+      current->reloads++;
+    }
+  }
+  return result;
+}
+
+CodegenReport createCodegenReport(llvm::Module* module,
+                                  llvm::TargetMachine* target) {
+  map<string,MachineCode> machineCode;
+  if (target != nullptr) {
+    machineCode = countMachineCode(emitAssembly(module, target), module);
+  }
+
+  CodegenReport report;
+  for (llvm::Function& func : *module) {
+    if (func.isDeclaration()) {
+      continue;
+    }
+    analyzeFunction(func, machineCode[func.getName().str()], &report);
+  }
+  return report;
+}
+
+}}
@@ -0,0 +1,23 @@
+#ifndef SIMIT_LLVM_CODEGEN_REPORT_H
+#define SIMIT_LLVM_CODEGEN_REPORT_H
+
+#include "codegen_report.h"
+
+namespace llvm {
+class Module;
+class TargetMachine;
+}
+
+namespace simit {
+namespace backend {
+
+/// Summarize the code of the functions defined in an optimized module: their
+/// instruction counts, the loops emitted for Simit loops and whether they were
+/// vectorized, and the calls that were not inlined. If target is not null, the
+/// spills and reloads are counted in the assembly it generates for a copy of
+/// the module.
+CodegenReport createCodegenReport(llvm::Module* module,
+                                  llvm::TargetMachine* target);
+
+}}
+#endif
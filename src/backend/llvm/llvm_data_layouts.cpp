@@ -9,10 +9,37 @@
 
 #include "llvm/IR/Value.h"
 #include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/DataLayout.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IR/Module.h"
 
 namespace simit {
 namespace backend {
 
+/// Check that the data of a runtime set is aligned as the generated code
+/// assumes (see assumeSetDataAlignment).
+static void checkAlignment(Set *actual, const void *data,
+                           const std::string &name) {
+  uassert((uintptr_t)data % kFieldAlignment == 0)
+      << "The " << name << " of set " << actual->getName() << " are not "
+      << "aligned to " << kFieldAlignment << " bytes (Settings::fieldAlignment)"
+      << ". The set was created with an alignment of "
+      << actual->getAlignment() << " bytes.";
+}
+
+static void* getFieldData(Set *actual, const std::string &fieldName) {
+  void *data = actual->getFieldData(fieldName);
+  checkAlignment(actual, data, fieldName + " values");
+  return data;
+}
+
+static int* getEndpointsData(Set *actual) {
+  int *endpoints = actual->getEndpointsData();
+  checkAlignment(actual, endpoints, "endpoints");
+  return endpoints;
+}
+
 llvm::Value* UnstructuredSetLayout::getSize(unsigned i) {
   iassert(i == 0) << "Only 1 explicit dimension for unstructured sets";
   return builder->CreateExtractValue(
@@ -43,7 +70,7 @@ llvm::Value* UnstructuredSetLayout::makeSet(Set *actual, ir::Type type) {
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
     setData.push_back(llvmPtr(*field.type.toTensor(),
-                              actual->getFieldData(field.name)));
+                              getFieldData(actual, field.name)));
   }
   return llvm::ConstantStruct::get(llvmSetType, setData);
 }
@@ -61,14 +88,16 @@ void UnstructuredSetLayout::writeSet(
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
-    *externPtrCast = actual->getFieldData(field.name);
+    *externPtrCast = getFieldData(actual, field.name);
     externPtrCast++;
   }
 }
 
 llvm::Value* UnstructuredEdgeSetLayout::getEpsArray() {
-  return builder->CreateExtractValue(
+  llvm::Value *eps = builder->CreateExtractValue(
       value, {1}, util::toString(set)+".eps()");
+  assumeSetDataAlignment(eps, builder);
+  return eps;
 }
 
 int UnstructuredEdgeSetLayout::getFieldsOffset() {
@@ -87,13 +116,13 @@ llvm::Value* UnstructuredEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
   setData.push_back(llvmInt(actual->getSize()));
 
   // Endpoints index
-  setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getEndpointsData()));
+  setData.push_back(llvmPtr(LLVM_INT_PTR, getEndpointsData(actual)));
 
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     iassert(field.type.isTensor());
     setData.push_back(llvmPtr(*field.type.toTensor(),
-                              actual->getFieldData(field.name)));
+                              getFieldData(actual, field.name)));
   }
   return llvm::ConstantStruct::get(llvmSetType, setData);
 }
@@ -109,13 +138,13 @@ void UnstructuredEdgeSetLayout::writeSet(Set *actual, ir::Type type,
   int **externPtrCast = (int**)(((int*)externPtr)+1);
 
   // Endpoints index
-  externPtrCast[0] = actual->getEndpointsData();
+  externPtrCast[0] = getEndpointsData(actual);
 
   // Fields
   void **externPtrFieldCast = (void**)(externPtrCast+3);
   for (auto &field : setType->elementType.toElement()->fields) {
     iassert(field.type.isTensor());
-    *externPtrFieldCast = actual->getFieldData(field.name);
+    *externPtrFieldCast = getFieldData(actual, field.name);
     externPtrFieldCast++;
   }
 }
@@ -141,10 +170,9 @@ llvm::Value* LatticeEdgeSetLayout::getTotalSize() {
 }
 
 llvm::Value* LatticeEdgeSetLayout::getEpsArray() {
-  iassert(!kIndexlessStencils)
-      << "Endpoints array undefined when in indexless mode";
-  return builder->CreateExtractValue(
-      value, {1}, util::toString(set)+".eps()");
+  ierror << "The endpoints of lattice links are computed from their "
+         << "coordinates (see getLatticeLinkEndpoint)";
+  return nullptr;
 }
 
 int LatticeEdgeSetLayout::getFieldsOffset() {
@@ -168,22 +196,15 @@ llvm::Value* LatticeEdgeSetLayout::makeSet(Set *actual, ir::Type type) {
       << " required";
   setData.push_back(llvmPtr(LLVM_INT_PTR, dimensions.data()));
     
-  // CSR data: only set if kIndexlessStencils is false, otherwise
-  // we set these to NULL.
-  if (kIndexlessStencils) {
-    // NULL pointers for endpoints
-    setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
-  }
-  else {
-    // Endpoints index
-    setData.push_back(llvmPtr(LLVM_INT_PTR, actual->getEndpointsData()));
-  }
+  // The endpoints are computed from the link coordinates, so the lattice does
+  // not materialize them
+  setData.push_back(llvmPtr(LLVM_INT_PTR, NULL));
     
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
     setData.push_back(llvmPtr(*field.type.toTensor(),
-                              actual->getFieldData(field.name)));
+                              getFieldData(actual, field.name)));
   }
   return llvm::ConstantStruct::get(llvmSetType, setData);
 }
@@ -198,25 +219,19 @@ void LatticeEdgeSetLayout::writeSet(Set *actual, ir::Type type, void *externPtr)
   const vector<int> &dimensions = actual->getDimensions();
   ((const int**)externPtrCast)[0] = dimensions.data();
     
-  // CSR data: only set if kIndexlessStencils is false, otherwise
-  // we set these to NULL.
-  if (kIndexlessStencils) {
-    // Three NULL pointers for endpoints, nbrs_start, and nbrs
-    externPtrCast[1] = NULL;
-    externPtrCast[2] = NULL;
-    externPtrCast[3] = NULL;
-  }
-  else {
-    // Endpoints index
-    externPtrCast[1] = actual->getEndpointsData();
-  }
+  // The endpoints are computed from the link coordinates, so the lattice does
+  // not materialize them. Three NULL pointers for endpoints, nbrs_start, and
+  // nbrs.
+  externPtrCast[1] = NULL;
+  externPtrCast[2] = NULL;
+  externPtrCast[3] = NULL;
 
   void **externPtrFieldCast = (void**)(externPtrCast+4);
   // Fields
   for (auto &field : setType->elementType.toElement()->fields) {
     assert(field.type.isTensor());
 
-    *externPtrFieldCast = actual->getFieldData(field.name);
+    *externPtrFieldCast = getFieldData(actual, field.name);
     externPtrFieldCast++;
   }
 }
@@ -244,9 +259,24 @@ std::shared_ptr<SetLayout> getSetLayout(
   }
 }
 
+void assumeSetDataAlignment(llvm::Value *ptr, SimitIRBuilder *builder) {
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  // The llvm.assume intrinsic was added in LLVM 3.6
+#else
+  // Pointers in constant set structs are already known
+  if (llvm::isa<llvm::Constant>(ptr)) {
+    return;
+  }
+  llvm::Module *module = builder->GetInsertBlock()->getParent()->getParent();
+  llvm::DataLayout dataLayout(module);
+  builder->CreateAlignmentAssumption(dataLayout, ptr, kFieldAlignment);
+#endif
+}
+
 /// Build llvm set struct from runtime Set object
 llvm::Value* makeSet(Set *actual, ir::Type type) {
   iassert(type.isSet());
+  actual->packFields();
   if (type.isUnstructuredSet()) {
     if (type.toUnstructuredSet()->getCardinality() == 0) {
       return UnstructuredSetLayout::makeSet(actual, type);
@@ -267,6 +297,7 @@ llvm::Value* makeSet(Set *actual, ir::Type type) {
 /// Write set pointers to extern pointer structure
 void writeSet(Set *actual, ir::Type type, void *externPtr) {
   iassert(type.isSet());
+  actual->packFields();
   if (type.isUnstructuredSet()) {
     if (type.toUnstructuredSet()->getCardinality() == 0) {
       return UnstructuredSetLayout::writeSet(actual, type, externPtr);
@@ -283,4 +314,31 @@ void writeSet(Set *actual, ir::Type type, void *externPtr) {
   }
 }
 
+llvm::Value* specializeSetSizes(llvm::Value *value, Set *actual, ir::Type type,
+                                llvm::Instruction *insertBefore) {
+  iassert(type.isSet());
+  // The sizes are the first element of every set layout
+  llvm::Constant *sizes;
+  if (type.isLatticeLinkSet()) {
+    iassert(actual->getKind() == Set::LatticeLink);
+    // Point the sizes at a constant copy of the lattice dimensions, so that
+    // the loads in LatticeEdgeSetLayout::getSize fold to constants.
+    const vector<int> &dimensions = actual->getDimensions();
+    vector<uint32_t> dims(dimensions.begin(), dimensions.end());
+    llvm::Constant *dimsArray = llvm::ConstantDataArray::get(LLVM_CTX, dims);
+    llvm::Module *module = insertBefore->getParent()->getParent()->getParent();
+    llvm::GlobalVariable *dimsGlobal =
+        new llvm::GlobalVariable(*module, dimsArray->getType(), true,
+                                 llvm::GlobalValue::InternalLinkage, dimsArray,
+                                 value->getName() + ".sizes");
+    sizes = llvm::ConstantExpr::getBitCast(dimsGlobal, LLVM_INT_PTR);
+  }
+  else {
+    sizes = llvmInt(actual->getSize());
+  }
+  return llvm::InsertValueInst::Create(value, sizes, {0},
+                                       value->getName() + ".specialized",
+                                       insertBefore);
+}
+
 }} // namespace simit::backend
@@ -8,6 +8,7 @@
 
 namespace llvm {
 class Value;
+class Instruction;
 }
 
 namespace simit {
@@ -104,12 +105,22 @@ private:
 std::shared_ptr<SetLayout> getSetLayout(
     ir::Expr set, llvm::Value *value, SimitIRBuilder *builder);
 
+/// Tell LLVM that a pointer to the data of a set field or to the endpoints of
+/// a set is aligned to Settings::fieldAlignment, so that it can emit aligned
+/// vector loads and stores. Does nothing before LLVM 3.6.
+void assumeSetDataAlignment(llvm::Value *ptr, SimitIRBuilder *builder);
+
 /// Build llvm set struct from runtime Set object
 llvm::Value* makeSet(Set *actual, ir::Type type);
 
 /// Write set pointers to extern pointer structure
 void writeSet(Set *actual, ir::Type type, void *externPtr);
 
+/// Insert a copy of the set struct value, whose sizes are replaced with the
+/// sizes of the runtime Set object as constants, before insertBefore.
+llvm::Value* specializeSetSizes(llvm::Value *value, Set *actual, ir::Type type,
+                                llvm::Instruction *insertBefore);
+
 }} // namespace simit::backend
 
 #endif // SIMIT_LLVM_DATA_LAYOUTS
@@ -9,6 +9,10 @@
 #include "llvm/IR/DataLayout.h"
 #include "llvm/Support/raw_ostream.h"
 #include "llvm/Support/DynamicLibrary.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/ExecutionEngine/SectionMemoryManager.h"
+#include "llvm/Target/TargetMachine.h"
 
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
 #include "llvm/Analysis/Verifier.h"
@@ -19,9 +23,14 @@
 #include "llvm_types.h"
 #include "llvm_codegen.h"
 #include "llvm_data_layouts.h"
+#include "llvm_backend.h"
+#include "llvm_codegen_report.h"
 
 #include "backend/actual.h"
+#include "init.h"
 #include "graph.h"
+#include "heap.h"
+#include "placement.h"
 #include "tensor_index.h"
 #include "path_indices.h"
 #include "util/collections.h"
@@ -36,27 +45,77 @@ namespace backend {
 
 typedef void (*FuncPtrType)();
 
+/// Specializations kept per function. Each holds a copy of the module and its
+/// machine code, so a function bound to sets whose sizes keep changing (e.g.
+/// under adaptive refinement) would otherwise grow without bound.
+static const size_t kMaxSpecializations = 4;
+
+/// A section memory manager that counts the bytes MCJIT allocates for code and
+/// data sections.
+class CountingMemoryManager : public llvm::SectionMemoryManager {
+public:
+  CountingMemoryManager(LLVMFunction::JITMemoryUsage* usage) : usage(usage) {}
+
+  uint8_t *allocateCodeSection(uintptr_t size, unsigned alignment,
+                               unsigned sectionID,
+                               llvm::StringRef sectionName) override {
+    usage->codeBytes += size;
+    return SectionMemoryManager::allocateCodeSection(size, alignment,
+                                                     sectionID, sectionName);
+  }
+
+  uint8_t *allocateDataSection(uintptr_t size, unsigned alignment,
+                               unsigned sectionID, llvm::StringRef sectionName,
+                               bool isReadOnly) override {
+    usage->dataBytes += size;
+    return SectionMemoryManager::allocateDataSection(size, alignment,
+                                                     sectionID, sectionName,
+                                                     isReadOnly);
+  }
+
+private:
+  LLVMFunction::JITMemoryUsage* usage;
+};
+
+/// Create an MCJIT execution engine whose sections are counted in usage.
+static llvm::ExecutionEngine*
+createCountingEngine(llvm::EngineBuilder* engineBuilder,
+                     LLVMFunction::JITMemoryUsage* usage) {
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  engineBuilder->setUseMCJIT(true);
+  engineBuilder->setMCJITMemoryManager(new CountingMemoryManager(usage));
+  llvm::ExecutionEngine* engine = engineBuilder->create();
+  // The engine owns the memory manager, so later engines need their own
+  engineBuilder->setMCJITMemoryManager(nullptr);
+  return engine;
+#else
+  engineBuilder->setMCJITMemoryManager(
+      unique_ptr<llvm::RTDyldMemoryManager>(new CountingMemoryManager(usage)));
+  return engineBuilder->create();
+#endif
+}
+
 LLVMFunction::LLVMFunction(ir::Func func, const ir::Storage &storage,
                            llvm::Function* llvmFunc, llvm::Module* module,
-                           std::shared_ptr<llvm::EngineBuilder> engineBuilder)
+                           std::shared_ptr<llvm::EngineBuilder> engineBuilder,
+                           llvm::Module* genericModule,
+                           const std::vector<std::string>& bufferNames,
+                           const std::vector<CodegenRemark>& remarks)
     : Function(func), initialized(false), llvmFunc(llvmFunc), module(module),
       harnessModule(new llvm::Module("simit_harness", LLVM_CTX)),
       storage(storage),
       engineBuilder(engineBuilder),
-#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
-      executionEngine(engineBuilder->setUseMCJIT(true).create()), // MCJIT EE
-#else
-      executionEngine(engineBuilder->create()),
-#endif
+      executionEngine(createCountingEngine(engineBuilder.get(), &jitMemory)),
 #if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
       harnessEngineBuilder(new llvm::EngineBuilder(harnessModule)),
-      harnessExecEngine(harnessEngineBuilder->setUseMCJIT(true).create()), // MCJIT EE
 #else
       harnessEngineBuilder(new llvm::EngineBuilder(
           unique_ptr<llvm::Module>(harnessModule))),
-      harnessExecEngine(harnessEngineBuilder->create()),
 #endif
-      deinit(nullptr) {
+      harnessExecEngine(createCountingEngine(harnessEngineBuilder.get(),
+                                             &harnessJitMemory)),
+      bufferNames(bufferNames), deinit(nullptr), remarks(remarks),
+      genericModule(genericModule) {
 
   // Finalize existing module so we can get global pointer hooks
   // from the LLVM memory manager.
@@ -123,7 +182,7 @@ LLVMFunction::~LLVMFunction() {
     deinit();
   }
   for (auto& tmpPtr : temporaryPtrs) {
-    free(*tmpPtr.second);
+    internal::heapFree(*tmpPtr.second);
     *tmpPtr.second = nullptr;
   }
 }
@@ -131,6 +190,7 @@ LLVMFunction::~LLVMFunction() {
 void LLVMFunction::bind(const std::string& name, simit::Set* set) {
   iassert(hasBindable(name));
   iassert(getBindableType(name).isSet());
+  checkFieldLayouts(name, set);
 
   if (hasArg(name)) {
     // Check set kinds match
@@ -175,6 +235,11 @@ void LLVMFunction::bind(const std::string& name, simit::Set* set) {
     iassert(util::contains(externPtrs, name) && externPtrs.at(name).size()==1);
     void *externPtr = externPtrs.at(name)[0];
     writeSet(set, globalType, externPtr);
+
+    // The compute function must be specialized to the new set sizes
+    if (genericModule != nullptr) {
+      initialized = false;
+    }
   }
 }
 
@@ -242,27 +307,98 @@ size_t LLVMFunction::size(const ir::IndexDomain& dimension) {
   return result;
 }
 
+bool LLVMFunction::isInitialized() {
+  if (!initialized) {
+    return false;
+  }
+  // The indices, temporaries and set pointers are stale if elements were
+  // added, removed or reordered
+  for (auto& pair : topologyVersions) {
+    if (pair.first->getTopologyVersion() != pair.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void LLVMFunction::mapArgs() {
+  for (auto& pair : writtenFieldIndices) {
+    vector<Set::FieldData*>& fields = pair.first->getFields();
+    for (int field : pair.second) {
+      fields[field]->markWritten();
+    }
+  }
+}
+
+void LLVMFunction::recordBoundSets() {
+  topologyVersions.clear();
+  writtenFieldIndices.clear();
+  const map<string,set<string>>& writtenFields = getWrittenFields();
+  for (auto* actuals : {&arguments, &globals}) {
+    for (auto& pair : *actuals) {
+      if (!isa<SetActual>(pair.second.get())) {
+        continue;
+      }
+      Set* boundSet = to<SetActual>(pair.second.get())->getSet();
+      topologyVersions[boundSet] = boundSet->getTopologyVersion();
+      if (util::contains(writtenFields, pair.first)) {
+        for (const string& field : writtenFields.at(pair.first)) {
+          writtenFieldIndices[boundSet].push_back(
+              boundSet->getFieldIndex(field));
+        }
+      }
+    }
+  }
+}
+
 Function::FuncType LLVMFunction::init() {
-  pe::PathIndexBuilder piBuilder;
+  recordBoundSets();
+
+  // The elements of global sets may have changed since they were bound
+  for (auto& pair : globals) {
+    if (isa<SetActual>(pair.second.get())) {
+      iassert(util::contains(externPtrs, pair.first));
+      writeSet(to<SetActual>(pair.second.get())->getSet(),
+               getGlobalType(pair.first), externPtrs.at(pair.first)[0]);
+    }
+  }
 
   for (auto& pair : arguments) {
     string name = pair.first;
     Actual* actual = pair.second.get();
     if (isa<SetActual>(actual)) {
       Set* set = to<SetActual>(actual)->getSet();
-      piBuilder.bind(name,set);
+      pathIndexBuilder.bind(name,set);
     }
   }
 
   const Environment& environment = getEnvironment();
 
-  // Initialize indices
-  initIndices(piBuilder, environment);
-
-  // Allocate memory for temporaries
+  // Initialize indices. The builder keeps the indices of earlier inits, and
+  // only rebuilds or updates those whose sets changed.
+  initIndices(pathIndexBuilder, environment);
+
+  // Allocate memory for temporaries. Temporaries are kept across inits, and
+  // only reallocated when they must grow, with some slack so that a few more
+  // elements or neighbors do not reallocate them again.
+  auto allocateTemporary = [](void** tmpPtr, size_t bytes, bool zeroed) {
+    if (*tmpPtr != nullptr && internal::heapAllocationSize(*tmpPtr) >= bytes) {
+      if (zeroed) {
+        memset(*tmpPtr, 0, bytes);
+      }
+      return;
+    }
+    if (*tmpPtr != nullptr) {
+      internal::heapFree(*tmpPtr);
+      bytes += bytes/8;
+    }
+    *tmpPtr = zeroed ? internal::heapAllocateZeroed(bytes)
+                     : internal::heapAllocate(bytes);
+  };
   for (const Var& tmp : environment.getTemporaries()) {
     iassert(util::contains(temporaryPtrs, tmp.getName()));
     const Type& type = tmp.getType();
+    void** tmpPtr = temporaryPtrs.at(tmp.getName());
 
     if (type.isTensor()) {
       const ir::TensorType* tensorType = type.toTensor();
@@ -275,8 +411,8 @@ Function::FuncType LLVMFunction::init() {
         Type blockType = tensorType->getBlockType();
         size_t blockSize = blockType.toTensor()->size();
         size_t componentSize = tensorType->getComponentType().bytes();
-        *temporaryPtrs.at(tmp.getName()) =
-            calloc(size(vecDimension) *blockSize, componentSize);
+        allocateTemporary(tmpPtr, size(vecDimension) * blockSize *
+                          componentSize, true);
       }
       else if (order == 2) {
         Type blockType = tensorType->getBlockType();
@@ -291,7 +427,7 @@ Function::FuncType LLVMFunction::init() {
           iassert(util::contains(pathIndices, pexpr));
           size_t matSize = pathIndices.at(pexpr).numNeighbors() *
               blockSize * componentSize;
-          *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
+          allocateTemporary(tmpPtr, matSize, false);
         }
         else if (ti.getKind() == TensorIndex::Sten) {
           auto iss = tensorType->getOuterDimensions();
@@ -302,7 +438,7 @@ Function::FuncType LLVMFunction::init() {
           const StencilLayout& stencil = ti.getStencilLayout();
           size_t stensize = stencil.getLayout().size();
           size_t matSize = stensize * latticeSize * blockSize * componentSize;
-          *temporaryPtrs.at(tmp.getName()) = malloc(matSize);
+          allocateTemporary(tmpPtr, matSize, false);
         }
         else {
           not_supported_yet;
@@ -330,7 +466,7 @@ Function::FuncType LLVMFunction::init() {
     addr = executionEngine->getFunctionAddress(deinitFunc->getName());
     FuncPtrType deinitPtr = reinterpret_cast<decltype(deinitPtr)>(addr);
     deinit = deinitPtr;
-    addr = executionEngine->getFunctionAddress(llvmFunc->getName());
+    addr = getComputeFunctionAddress();
     FuncPtrType funcPtr = reinterpret_cast<decltype(funcPtr)>(addr);
     func = funcPtr;
   }
@@ -379,6 +515,13 @@ Function::FuncType LLVMFunction::init() {
     const std::string deinitFuncName = string(llvmFunc->getName())+"_deinit";
     const std::string funcName = llvmFunc->getName();
 
+    // The harness of an earlier init calls the functions with the actuals it
+    // was built with, which are stale, and MCJIT cannot change a finalized
+    // module, so build the harness again in a new module
+    if (harnessModule->getFunction(funcName + "_harness") != nullptr) {
+      resetHarness();
+    }
+
     // Calling main module functions from the harness requires the
     // symbols to be loaded into the memory manager ahead of finalization
     llvm::sys::DynamicLibrary::AddSymbol(
@@ -389,7 +532,7 @@ Function::FuncType LLVMFunction::init() {
         (void*) executionEngine->getFunctionAddress(deinitFuncName));
     llvm::sys::DynamicLibrary::AddSymbol(
         funcName,
-        (void*) executionEngine->getFunctionAddress(funcName));
+        (void*) getComputeFunctionAddress(true));
 
     // Create Init/deinit function harnesses
     createHarness(initFuncName, args);
@@ -430,6 +573,108 @@ void LLVMFunction::printMachine(std::ostream &os) const {
   target->Options.PrintMachineCode = false;
 }
 
+CodegenReport LLVMFunction::getCodegenReport() const {
+  unique_ptr<llvm::TargetMachine> target(engineBuilder->selectTarget());
+  CodegenReport report = createCodegenReport(module, target.get());
+  for (const CodegenRemark& remark : remarks) {
+    report.add(remark);
+  }
+  return report;
+}
+
+MemoryReport LLVMFunction::memoryReport() const {
+  MemoryReport report;
+  internal::HugePageMap hugePages;
+  for (auto& pair : arguments) {
+    if (isa<SetActual>(pair.second.get())) {
+      Set* set = to<SetActual>(pair.second.get())->getSet();
+      report.add(set->memoryReport(hugePages));
+    }
+  }
+  for (auto& pair : globals) {
+    if (isa<SetActual>(pair.second.get())) {
+      Set* set = to<SetActual>(pair.second.get())->getSet();
+      report.add(set->memoryReport(hugePages));
+    }
+  }
+
+  for (auto& pair : pathIndices) {
+    const pe::PathIndex& pidx = pair.second;
+    if (!isa<pe::SegmentedPathIndex>(pidx)) {
+      continue;
+    }
+    const pe::SegmentedPathIndex* spidx = to<pe::SegmentedPathIndex>(pidx);
+    size_t bytes = (spidx->numElements()+1 + spidx->numNeighbors()) *
+                   sizeof(uint32_t);
+    size_t coordBytes = internal::heapAllocationSize(spidx->getCoordData());
+    size_t sinkBytes = internal::heapAllocationSize(spidx->getSinkData());
+    vector<size_t> pageNodes;
+    internal::countPageNodes(spidx->getCoordData(), coordBytes, &pageNodes);
+    internal::countPageNodes(spidx->getSinkData(), sinkBytes, &pageNodes);
+    report.add("path index", util::toString(pair.first), bytes,
+               coordBytes + sinkBytes, pageNodes,
+               hugePages.getBytes(spidx->getCoordData(), coordBytes) +
+               hugePages.getBytes(spidx->getSinkData(), sinkBytes));
+  }
+
+  for (auto& pair : temporaryPtrs) {
+    size_t bytes = internal::heapAllocationSize(*pair.second);
+    vector<size_t> pageNodes;
+    internal::countPageNodes(*pair.second, bytes, &pageNodes);
+    report.add("temporary", pair.first, bytes, bytes, pageNodes,
+               hugePages.getBytes(*pair.second, bytes));
+  }
+
+  for (const string& name : bufferNames) {
+    void** bufferPtr = (void**)executionEngine->getGlobalValueAddress(name);
+    size_t bytes = (bufferPtr != nullptr)
+                   ? internal::heapAllocationSize(*bufferPtr) : 0;
+    vector<size_t> pageNodes;
+    size_t hugePageBytes = 0;
+    if (bufferPtr != nullptr) {
+      internal::countPageNodes(*bufferPtr, bytes, &pageNodes);
+      hugePageBytes = hugePages.getBytes(*bufferPtr, bytes);
+    }
+    report.add("tensor", name, bytes, bytes, pageNodes, hugePageBytes);
+  }
+
+  // Evicted specializations no longer count, since their sections are freed
+  JITMemoryUsage jit = jitMemory;
+  jit.codeBytes += harnessJitMemory.codeBytes;
+  jit.dataBytes += harnessJitMemory.dataBytes;
+  for (auto& specialization : specializations) {
+    jit.codeBytes += specialization.second.jitMemory.codeBytes;
+    jit.dataBytes += specialization.second.jitMemory.dataBytes;
+  }
+  report.add("jit code", string(llvmFunc->getName()), jit.codeBytes,
+             jit.codeBytes);
+  report.add("jit data", string(llvmFunc->getName()), jit.dataBytes,
+             jit.dataBytes);
+  return report;
+}
+
+map<string,size_t> LLVMFunction::getSizes() const {
+  map<string,size_t> sizes;
+  for (auto& pair : arguments) {
+    if (isa<SetActual>(pair.second.get())) {
+      sizes[pair.first] = to<SetActual>(pair.second.get())->getSet()->getSize();
+    }
+  }
+  for (auto& pair : globals) {
+    if (isa<SetActual>(pair.second.get())) {
+      sizes[pair.first] = to<SetActual>(pair.second.get())->getSet()->getSize();
+    }
+  }
+  for (const TensorIndex& index : getEnvironment().getTensorIndices()) {
+    if (index.getKind() == TensorIndex::PExpr &&
+        util::contains(pathIndices, index.getPathExpression())) {
+      sizes[index.getName()] =
+          pathIndices.at(index.getPathExpression()).numNeighbors();
+    }
+  }
+  return sizes;
+}
+
 void LLVMFunction::initIndices(pe::PathIndexBuilder& piBuilder,
                                const Environment& environment) {
   // Initialize indices
@@ -437,7 +682,7 @@ void LLVMFunction::initIndices(pe::PathIndexBuilder& piBuilder,
     if (tensorIndex.getKind() == TensorIndex::PExpr) {
       pe::PathExpression pexpr = tensorIndex.getPathExpression();
       pe::PathIndex pidx = piBuilder.buildSegmented(pexpr, 0);
-      pathIndices.insert({pexpr, pidx});
+      pathIndices[pexpr] = pidx;
 
       pair<const uint32_t**,const uint32_t**> ptrPair=tensorIndexPtrs.at(pexpr);
 
@@ -495,6 +740,188 @@ LLVMFunction::getHarnessFunctionAddress(const std::string &name) {
   return funcPtr;
 }
 
+void LLVMFunction::resetHarness() {
+  // The engine owns the harness module, so this frees its machine code too
+  harnessExecEngine.reset();
+  harnessJitMemory = JITMemoryUsage();
+  harnessModule = new llvm::Module("simit_harness", LLVM_CTX);
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 5
+  harnessEngineBuilder.reset(new llvm::EngineBuilder(harnessModule));
+#else
+  harnessEngineBuilder.reset(new llvm::EngineBuilder(
+      unique_ptr<llvm::Module>(harnessModule)));
+#endif
+  harnessExecEngine.reset(createCountingEngine(harnessEngineBuilder.get(),
+                                               &harnessJitMemory));
+}
+
+uint64_t LLVMFunction::getComputeFunctionAddress(bool pin) {
+  const std::string funcName = llvmFunc->getName();
+  if (genericModule == nullptr) {
+    return executionEngine->getFunctionAddress(funcName);
+  }
+
+  // Collect the bound sets, and the signature of their sizes
+  string signature;
+  auto sizeSignature = [&signature](const string& name, Set* set) {
+    signature += name + "=" + ((set->getKind() == simit::Set::LatticeLink)
+                               ? util::join(set->getDimensions(), "x")
+                               : to_string(set->getSize())) + ";";
+  };
+  vector<Set*> argSets;
+  for (const string& formal : getArgs()) {
+    Actual* actual = arguments.at(formal).get();
+    if (!isa<SetActual>(actual)) {
+      argSets.push_back(nullptr);
+      continue;
+    }
+    Set* set = to<SetActual>(actual)->getSet();
+    argSets.push_back(set);
+    sizeSignature(formal, set);
+  }
+  map<string,Set*> globalSets;
+  for (auto& global : globals) {
+    if (isa<SetActual>(global.second.get())) {
+      Set* set = to<SetActual>(global.second.get())->getSet();
+      globalSets.insert({global.first, set});
+      sizeSignature(global.first, set);
+    }
+  }
+  if (signature.empty()) {
+    return executionEngine->getFunctionAddress(funcName);
+  }
+
+  // Each init builds a new harness, so only the specialization that it calls
+  // must be kept
+  if (pin) {
+    for (auto& specialization : specializations) {
+      specialization.second.pinned = false;
+    }
+  }
+
+  // An entry without an engine is left by a specialization that failed
+  if (!util::contains(specializations, signature) ||
+      specializations.at(signature).engine == nullptr) {
+    // Evict the least recently used specialization, which frees its module
+    // and machine code. The function that was run last was specialized to
+    // other sizes, so its address is no longer used.
+    while (specializations.size() >= kMaxSpecializations) {
+      auto evicted = specializations.end();
+      for (auto it = specializations.begin(); it != specializations.end();
+           ++it) {
+        if (!it->second.pinned && (evicted == specializations.end() ||
+                                   it->second.lastUse <
+                                       evicted->second.lastUse)) {
+          evicted = it;
+        }
+      }
+      if (evicted == specializations.end()) {
+        break;
+      }
+      specializations.erase(evicted);
+    }
+    Specialization& specialization = specializations[signature];
+    specialization.engine = specialize(argSets, globalSets,
+                                       &specialization.jitMemory);
+  }
+  Specialization& specialization = specializations.at(signature);
+  specialization.lastUse = ++specializationUses;
+  specialization.pinned = specialization.pinned || pin;
+  return specialization.engine->getFunctionAddress(funcName);
+}
+
+unique_ptr<llvm::ExecutionEngine>
+LLVMFunction::specialize(const vector<Set*>& argSets,
+                         const map<string,Set*>& globalSets,
+                         JITMemoryUsage* usage) {
+  llvm::Module *specialized = llvm::CloneModule(genericModule.get());
+  const std::string funcName = llvmFunc->getName();
+  llvm::Function *func = specialized->getFunction(funcName);
+
+  // Substitute the sizes of the bound sets for the sizes in the set arguments
+  vector<string> formals = getArgs();
+  iassert(formals.size() == argSets.size());
+  llvm::Instruction *entry = &*func->getEntryBlock().getFirstInsertionPt();
+  auto argIt = func->arg_begin();
+  for (size_t i = 0; i < formals.size(); ++i, ++argIt) {
+    if (argSets[i] == nullptr) {
+      continue;
+    }
+    llvm::Argument *arg = &*argIt;
+    llvm::Value *sizedArg = specializeSetSizes(arg, argSets[i],
+                                               getArgType(formals[i]), entry);
+    arg->replaceAllUsesWith(sizedArg);
+    // The specialized set is built from the argument itself
+    llvm::cast<llvm::InsertValueInst>(sizedArg)->setOperand(0, arg);
+  }
+
+  // ... and for the sizes in the set structs loaded from global sets
+  const Environment& env = getEnvironment();
+  for (const VarMapping& externMapping : env.getExterns()) {
+    const string& name = externMapping.getVar().getName();
+    if (!util::contains(globalSets, name)) {
+      continue;
+    }
+    iassert(externMapping.getMappings().size() == 1);
+    const string& externName = externMapping.getMappings()[0].getName();
+    llvm::GlobalVariable *global = specialized->getNamedGlobal(externName);
+    iassert(global != nullptr) << "No global for extern set " << externName;
+
+    vector<llvm::LoadInst*> loads;
+    for (auto user = global->use_begin(); user != global->use_end(); ++user) {
+#if LLVM_MAJOR_VERSION <= 3 && LLVM_MINOR_VERSION <= 4
+      llvm::User *globalUser = *user;
+#else
+      llvm::User *globalUser = user->getUser();
+#endif
+      if (llvm::isa<llvm::LoadInst>(globalUser) &&
+          globalUser->getType()->isStructTy()) {
+        loads.push_back(llvm::cast<llvm::LoadInst>(globalUser));
+      }
+    }
+    for (llvm::LoadInst *load : loads) {
+      llvm::Instruction *next = &*++llvm::BasicBlock::iterator(load);
+      llvm::Value *sizedSet = specializeSetSizes(load, globalSets.at(name),
+                                                 getGlobalType(name), next);
+      load->replaceAllUsesWith(sizedSet);
+      llvm::cast<llvm::InsertValueInst>(sizedSet)->setOperand(0, load);
+    }
+  }
+
+  // Only the compute function is called in the specialized module
+  for (const string& name : {funcName + "_init", funcName + "_deinit"}) {
+    llvm::Function *unused = specialized->getFunction(name);
+    if (unused != nullptr && unused->use_empty()) {
+      unused->eraseFromParent();
+    }
+  }
+
+  // Share the globals (externs, temporaries and indices) of the generic
+  // module, whose storage is bound and initialized by the init function.
+  for (auto global = specialized->global_begin();
+       global != specialized->global_end(); ++global) {
+    if (global->isDeclaration() || global->hasLocalLinkage() ||
+        global->isConstant()) {
+      continue;
+    }
+    uint64_t addr = executionEngine->getGlobalValueAddress(global->getName());
+    iassert(addr != 0) << "No storage for global " << global->getName().str();
+    llvm::sys::DynamicLibrary::AddSymbol(global->getName(), (void*)addr);
+    global->setInitializer(nullptr);
+    global->setLinkage(llvm::GlobalValue::ExternalLinkage);
+  }
+
+  iassert(!llvm::verifyModule(*specialized))
+      << "Specialized LLVM module does not pass verification";
+
+  auto specializedEngineBuilder = createEngineBuilder(specialized);
+  optimizeModule(specialized, func, specializedEngineBuilder.get());
+  unique_ptr<llvm::ExecutionEngine> specializedEngine(
+      createCountingEngine(specializedEngineBuilder.get(), usage));
+  specializedEngine->finalizeObject();
+  return specializedEngine;
+}
+
 llvm::Function *LLVMFunction::getInitFunc() const {
   return module->getFunction(string(llvmFunc->getName()) + "_init");
 }
@@ -11,6 +11,7 @@
 
 #include "backend/backend_function.h"
 #include "ir.h"
+#include "path_indices.h"
 #include "storage.h"
 #include "tensor_data.h"
 
@@ -20,11 +21,6 @@ class ExecutionEngine;
 
 namespace simit {
 
-namespace pe {
-class PathExpression;
-class PathIndex;
-class PathIndexBuilder;
-}
 namespace backend {
 class Actual;
 
@@ -33,7 +29,10 @@ class LLVMFunction : public backend::Function {
  public:
   LLVMFunction(ir::Func func, const ir::Storage &storage,
                llvm::Function* llvmFunc, llvm::Module* module,
-               std::shared_ptr<llvm::EngineBuilder> engineBuilder);
+               std::shared_ptr<llvm::EngineBuilder> engineBuilder,
+               llvm::Module* genericModule=nullptr,
+               const std::vector<std::string>& bufferNames={},
+               const std::vector<CodegenRemark>& remarks={});
   virtual ~LLVMFunction();
 
   virtual void bind(const std::string& name, simit::Set* set);
@@ -42,13 +41,25 @@ class LLVMFunction : public backend::Function {
 
   virtual FuncType init();
 
-  virtual bool isInitialized() {
-    return initialized;
-  }
+  virtual bool isInitialized();
+
+  virtual void mapArgs();
 
   virtual void print(std::ostream &os) const;
   virtual void printMachine(std::ostream &os) const;
 
+  virtual MemoryReport memoryReport() const;
+
+  virtual CodegenReport getCodegenReport() const;
+
+  virtual std::map<std::string,size_t> getSizes() const;
+
+  /// Bytes the MCJIT memory managers allocated for code and data sections.
+  struct JITMemoryUsage {
+    size_t codeBytes = 0;
+    size_t dataBytes = 0;
+  };
+
  protected:
   /// Get the number of elements in the index domains.
   size_t size(const ir::IndexDomain &dimension);
@@ -56,6 +67,10 @@ class LLVMFunction : public backend::Function {
   void initIndices(pe::PathIndexBuilder& piBuilder,
                    const ir::Environment& environment);
 
+  /// Record the topology versions of the bound sets, and which of their fields
+  /// the function writes, for isInitialized and mapArgs.
+  void recordBoundSets();
+
   bool initialized;
 
   llvm::Function*                        llvmFunc;
@@ -75,7 +90,15 @@ class LLVMFunction : public backend::Function {
            std::pair<const uint32_t**,const uint32_t**>> tensorIndexPtrs;
   std::map<pe::PathExpression, pe::PathIndex>            pathIndices;
 
+  /// Builds the path indices, and keeps them so that later inits only rebuild
+  /// or update the indices of the sets that changed.
+  pe::PathIndexBuilder pathIndexBuilder;
+
  private:
+  /// Declared before the engines, whose memory managers update them.
+  JITMemoryUsage jitMemory;
+  JITMemoryUsage harnessJitMemory;
+
   std::shared_ptr<llvm::EngineBuilder>   engineBuilder;
   std::shared_ptr<llvm::ExecutionEngine> executionEngine;
   std::unique_ptr<llvm::EngineBuilder>   harnessEngineBuilder;
@@ -84,14 +107,59 @@ class LLVMFunction : public backend::Function {
   /// Temporaries
   std::map<std::string, void**> temporaryPtrs;
 
+  /// The topology versions of the bound sets when the function was
+  /// initialized, and the indices of the fields of each set that it writes.
+  std::map<Set*, size_t> topologyVersions;
+  std::map<Set*, std::vector<int>> writtenFieldIndices;
+
+  /// Names of the globals that hold the tensors allocated by the init function
+  std::vector<std::string> bufferNames;
+
   FuncType deinit;
 
+  /// Optimization remarks collected while the module was optimized
+  std::vector<CodegenRemark> remarks;
+
+  /// Unoptimized copy of the module, that init clones and specializes to the
+  /// sizes of the bound sets (only set if kSpecialize).
+  std::unique_ptr<llvm::Module> genericModule;
+
+  /// A compute function specialized to the sizes of the bound sets.
+  struct Specialization {
+    std::unique_ptr<llvm::ExecutionEngine> engine;
+    JITMemoryUsage jitMemory;
+    /// The value of specializationUses when the function was last used.
+    size_t lastUse = 0;
+    /// Called by the current harness, so it must not be evicted.
+    bool pinned = false;
+  };
+
+  /// Specialized compute functions, keyed by the sizes of the bound sets. At
+  /// most kMaxSpecializations are kept, evicting the least recently used.
+  std::map<std::string, Specialization> specializations;
+  size_t specializationUses = 0;
+
   // MCJIT does not allow module modification after code generation. Instead,
   // create all harness functions in the harness module first, then fetch
   // generated addresses using getHarnessFunctionAddress.
   void createHarness(const std::string& name,
                      const llvm::SmallVector<llvm::Value*,8>& args);
   FuncType getHarnessFunctionAddress(const std::string& name);
+  /// Replace the harness module and engine by empty ones, freeing the
+  /// harness functions of an earlier init.
+  void resetHarness();
+
+  /// Get the address of the compute function, specialized to the sizes of the
+  /// bound sets if kSpecialize is set. The harness calls the pinned
+  /// specialization, so it is kept until the harness is built again.
+  uint64_t getComputeFunctionAddress(bool pin=false);
+  /// Compile a copy of the compute function with the sizes of the sets in
+  /// argSets (nullptr for non-set arguments) and of the bound global sets
+  /// substituted as constants. Its sections are counted in usage.
+  std::unique_ptr<llvm::ExecutionEngine>
+  specialize(const std::vector<Set*>& argSets,
+             const std::map<std::string,Set*>& globalSets,
+             JITMemoryUsage* usage);
 
   llvm::Function* getInitFunc() const;
   llvm::Function* getDeinitFunc() const;
@@ -0,0 +1,73 @@
+#include "codegen_report.h"
+
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace simit {
+
+static string callsString(const map<string,int>& calls) {
+  stringstream ss;
+  for (auto it = calls.begin(); it != calls.end(); ++it) {
+    ss << (it != calls.begin() ? ", " : "") << it->first;
+    if (it->second > 1) {
+      ss << " (" << it->second << ")";
+    }
+  }
+  return ss.str();
+}
+
+// class CodegenReport
+std::vector<LoopCodegen>
+CodegenReport::getLoops(const std::string& function,
+                        const std::string& loop) const {
+  vector<LoopCodegen> result;
+  for (const LoopCodegen& loopCodegen : loops) {
+    if (loopCodegen.function == function && loopCodegen.loop == loop) {
+      result.push_back(loopCodegen);
+    }
+  }
+  return result;
+}
+
+void CodegenReport::print(std::ostream& os) const {
+  os << left << setw(24) << "function" << right << setw(10) << "instrs"
+     << setw(10) << "machine" << setw(8) << "spills" << setw(8) << "reloads"
+     << "  " << "calls" << endl;
+  for (const FunctionCodegen& function : functions) {
+    os << left << setw(24) << function.name << right
+       << setw(10) << function.instructions
+       << setw(10) << function.machineInstructions
+       << setw(8) << function.spills << setw(8) << function.reloads
+       << "  " << callsString(function.calls) << endl;
+  }
+
+  if (!loops.empty()) {
+    os << endl << left << setw(24) << "loop" << right << setw(10) << "instrs"
+       << setw(8) << "width" << setw(10) << "vector" << "  " << "calls"
+       << endl;
+    for (const LoopCodegen& loop : loops) {
+      string name = string(2*loop.depth, ' ') + loop.function + ": " +
+                    loop.loop;
+      os << left << setw(24) << name << right << setw(10) << loop.instructions
+         << setw(8) << loop.vectorWidth << setw(10) << loop.vectorInstructions
+         << "  " << callsString(loop.calls) << endl;
+    }
+  }
+
+  if (!remarks.empty()) {
+    os << endl << "remarks" << endl;
+    for (const CodegenRemark& remark : remarks) {
+      os << "  " << left << setw(10) << remark.kind << setw(16) << remark.pass
+         << remark.function << ": " << remark.message << endl;
+    }
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const CodegenReport& report) {
+  report.print(os);
+  return os;
+}
+
+}
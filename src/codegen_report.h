@@ -0,0 +1,85 @@
+#ifndef SIMIT_CODEGEN_REPORT_H
+#define SIMIT_CODEGEN_REPORT_H
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// An optimization remark of a backend pass, such as a loop that was
+/// vectorized or the reason it was not.
+struct CodegenRemark {
+  /// "passed", "missed" or "analysis".
+  std::string kind;
+  /// The pass that emitted the remark (e.g. "loop-vectorize").
+  std::string pass;
+  std::string function;
+  std::string message;
+};
+
+/// The code generated for a loop of a map or a loop statement.
+struct LoopCodegen {
+  std::string function;
+  /// The loop variable (e.g. "e" for a map over the edge set E).
+  std::string loop;
+  /// Number of enclosing loops.
+  int depth = 0;
+
+  /// Instructions in the loop and its vectorized copy, including nested
+  /// loops.
+  size_t instructions = 0;
+  /// Number of lanes of the vectorized loop, or 1 if it was not vectorized.
+  int vectorWidth = 1;
+  /// Instructions that operate on vectors, from loop or SLP vectorization.
+  size_t vectorInstructions = 0;
+  /// Calls in the loop to functions that were not inlined, by callee.
+  std::map<std::string,int> calls;
+};
+
+/// The code generated for a function.
+struct FunctionCodegen {
+  std::string name;
+  /// Backend (e.g. LLVM) instructions after optimization.
+  size_t instructions = 0;
+  /// Machine instructions, and register spills and reloads.
+  size_t machineInstructions = 0;
+  size_t spills = 0;
+  size_t reloads = 0;
+  /// Calls to functions that were not inlined, by callee.
+  std::map<std::string,int> calls;
+};
+
+/// A summary of the code generated for a function and the functions it calls
+/// (Function::getCodegenReport), that is easier to read than the backend IR or
+/// assembly of large programs.
+class CodegenReport {
+public:
+  const std::vector<FunctionCodegen>& getFunctions() const {return functions;}
+  const std::vector<LoopCodegen>& getLoops() const {return loops;}
+  const std::vector<CodegenRemark>& getRemarks() const {return remarks;}
+
+  void add(const FunctionCodegen& function) {functions.push_back(function);}
+  void add(const LoopCodegen& loop) {loops.push_back(loop);}
+  void add(const CodegenRemark& remark) {remarks.push_back(remark);}
+
+  /// Returns the loops of a function with the given loop variable.
+  std::vector<LoopCodegen> getLoops(const std::string& function,
+                                    const std::string& loop) const;
+
+  /// Print a table of the functions and of their loops, followed by the
+  /// remarks of the passes that vectorize and inline code.
+  void print(std::ostream& os) const;
+
+private:
+  std::vector<FunctionCodegen> functions;
+  std::vector<LoopCodegen> loops;
+  std::vector<CodegenRemark> remarks;
+};
+
+std::ostream& operator<<(std::ostream& os, const CodegenReport& report);
+
+}
+#endif
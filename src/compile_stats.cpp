@@ -0,0 +1,46 @@
+#include "compile_stats.h"
+
+#include <iomanip>
+
+using namespace std;
+
+namespace simit {
+
+// class CompileStats
+double CompileStats::getTotalSeconds() const {
+  double seconds = 0.0;
+  for (const CompilePass& pass : passes) {
+    seconds += pass.seconds;
+  }
+  return seconds;
+}
+
+void CompileStats::print(std::ostream& os) const {
+  double totalSeconds = getTotalSeconds();
+  os << right << setw(12) << "time (ms)" << setw(8) << "%"
+     << setw(12) << "IR before" << setw(12) << "IR after"
+     << "  " << "pass" << endl;
+  for (const CompilePass& pass : passes) {
+    double percentage = (totalSeconds > 0.0)
+                        ? pass.seconds * 100.0 / totalSeconds : 0.0;
+    os << fixed << setprecision(3) << setw(12) << pass.seconds * 1e3
+       << setprecision(1) << setw(8) << percentage;
+    if (pass.sizeBefore > 0 || pass.sizeAfter > 0) {
+      os << setw(12) << pass.sizeBefore << setw(12) << pass.sizeAfter;
+    }
+    else {
+      os << setw(12) << "-" << setw(12) << "-";
+    }
+    os << "  " << pass.name << endl;
+  }
+  os << fixed << setprecision(3) << setw(12) << totalSeconds * 1e3
+     << setprecision(1) << setw(8) << 100.0 << setw(12) << "" << setw(12) << ""
+     << "  " << "Total" << endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const CompileStats& stats) {
+  stats.print(os);
+  return os;
+}
+
+}
@@ -0,0 +1,46 @@
+#ifndef SIMIT_COMPILE_STATS_H
+#define SIMIT_COMPILE_STATS_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// The time and IR size of one compiler pass.
+struct CompilePass {
+  std::string name;
+  double seconds = 0.0;
+
+  /// Size of the IR before and after the pass: Simit IR nodes for lowering
+  /// passes and LLVM instructions for LLVM passes. Zero if the pass does not
+  /// transform IR.
+  size_t sizeBefore = 0;
+  size_t sizeAfter = 0;
+};
+
+/// Where the time went when compiling a function, as returned by
+/// Program::getCompileStats.
+class CompileStats {
+public:
+  /// The passes in the order they ran.
+  const std::vector<CompilePass>& getPasses() const {return passes;}
+
+  /// Sum of the pass times in seconds.
+  double getTotalSeconds() const;
+
+  void addPass(const CompilePass& pass) {passes.push_back(pass);}
+  void clear() {passes.clear();}
+
+  /// Print a table of the passes in the order they ran.
+  void print(std::ostream& os) const;
+
+private:
+  std::vector<CompilePass> passes;
+};
+
+std::ostream& operator<<(std::ostream& os, const CompileStats& stats);
+
+}
+#endif
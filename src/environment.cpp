@@ -2,6 +2,7 @@
 
 #include "var.h"
 #include "ir.h"
+#include "field_layout.h"
 #include "path_expressions.h"
 #include "stencils.h"
 #include "tensor_index.h"
@@ -36,6 +37,8 @@ struct Environment::Content {
   map<StencilLayout,size_t>      locationOfTensorIndexStencil;
 
   map<Var,TensorIndex>           tensorIndexOfVar;
+
+  FieldLayouts                   fieldLayouts;
 };
 
 Environment::Environment() : content(new Content) {
@@ -160,6 +163,14 @@ const TensorIndex& Environment::getTensorIndex(
       content->locationOfTensorIndexStencil.at(stencil)];
 }
 
+const FieldLayouts& Environment::getFieldLayouts() const {
+  return content->fieldLayouts;
+}
+
+void Environment::setFieldLayouts(const FieldLayouts& layouts) {
+  content->fieldLayouts = layouts;
+}
+
 void Environment::addConstant(const Var& var, const Expr& initializer) {
   content->constants.push_back({var, initializer});
 }
@@ -9,6 +9,7 @@
 #include "util/name_generator.h"
 
 namespace simit {
+class FieldLayouts;
 namespace pe {
 class PathExpression;
 }
@@ -102,6 +103,13 @@ public:
   /// Retrieve the tensor index of the given stencil.
   const TensorIndex& getTensorIndex(const StencilLayout& stencil) const;
 
+  /// The layouts of the set fields that the function accesses, and of the
+  /// fields of the sets bound to it.
+  const FieldLayouts& getFieldLayouts() const;
+
+  /// Set the layouts of the set fields (see Program::setFieldLayout).
+  void setFieldLayouts(const FieldLayouts& layouts);
+
   /// Insert a constant into the environment.
   void addConstant(const Var& var, const Expr& initializer);
 
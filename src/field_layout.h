@@ -0,0 +1,130 @@
+#ifndef SIMIT_FIELD_LAYOUT_H
+#define SIMIT_FIELD_LAYOUT_H
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+#include <string>
+#include <utility>
+
+#include "error.h"
+
+namespace simit {
+
+/// The memory layout of the tensors of a set field. AoS (the default) stores
+/// the components of each element together. SoA stores each component of all
+/// the elements together. AoSoA stores tiles of tileWidth elements as SoA, so
+/// that loops over the elements load a component of consecutive elements with
+/// contiguous vector loads, while the components of an element stay close.
+///
+/// The layouts only differ for fields with more than one component.
+class FieldLayout {
+public:
+  enum Kind {AoS, SoA, AoSoA};
+
+  FieldLayout() : kind(AoS), tileWidth(1) {}
+
+  static FieldLayout aos() {return FieldLayout();}
+  static FieldLayout soa() {return FieldLayout(SoA, 1);}
+  static FieldLayout aosoa(int tileWidth) {
+    uassert(tileWidth >= 1) << "Invalid AoSoA tile width: " << tileWidth;
+    return FieldLayout(AoSoA, tileWidth);
+  }
+
+  Kind getKind() const {return kind;}
+
+  /// The number of elements in a tile of an AoSoA layout.
+  int getTileWidth() const {return tileWidth;}
+
+  /// True if the components of each element of a field with blockSize
+  /// components are stored together, as in AoS.
+  bool isAoS(size_t blockSize) const {return kind == AoS || blockSize == 1;}
+
+  /// The position of the first component of an element of a field with
+  /// blockSize components, counted in components.
+  size_t getElementOffset(size_t element, size_t blockSize) const {
+    switch (kind) {
+      case AoS:
+        return element * blockSize;
+      case SoA:
+        return element;
+      case AoSoA:
+        return (element / tileWidth) * tileWidth * blockSize +
+               element % tileWidth;
+    }
+    unreachable;
+    return 0;
+  }
+
+  /// The distance, counted in components, between the components of an
+  /// element. soaStride is the distance of the SoA layout, that is kept by
+  /// the field.
+  size_t getComponentStride(size_t soaStride) const {
+    switch (kind) {
+      case AoS:
+        return 1;
+      case SoA:
+        return soaStride;
+      case AoSoA:
+        return tileWidth;
+    }
+    unreachable;
+    return 0;
+  }
+
+  /// The number of elements to allocate to hold capacity elements.
+  size_t getAllocatedElements(size_t capacity) const {
+    if (kind == AoSoA) {
+      return (capacity + tileWidth-1) / tileWidth * tileWidth;
+    }
+    return capacity;
+  }
+
+  friend bool operator==(const FieldLayout& l, const FieldLayout& r) {
+    return l.kind == r.kind && l.tileWidth == r.tileWidth;
+  }
+
+  friend bool operator!=(const FieldLayout& l, const FieldLayout& r) {
+    return !(l == r);
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const FieldLayout& l) {
+    switch (l.kind) {
+      case AoS:
+        return os << "AoS";
+      case SoA:
+        return os << "SoA";
+      case AoSoA:
+        return os << "AoSoA(" << l.tileWidth << ")";
+    }
+    return os;
+  }
+
+private:
+  FieldLayout(Kind kind, int tileWidth) : kind(kind), tileWidth(tileWidth) {}
+
+  Kind kind;
+  int tileWidth;
+};
+
+/// The layouts of the set fields of a program, by element type and field.
+/// Fields without a layout are AoS.
+class FieldLayouts {
+public:
+  void set(const std::string& elementType, const std::string& field,
+           FieldLayout layout) {
+    layouts[{elementType, field}] = layout;
+  }
+
+  FieldLayout get(const std::string& elementType,
+                  const std::string& field) const {
+    auto layout = layouts.find({elementType, field});
+    return (layout != layouts.end()) ? layout->second : FieldLayout();
+  }
+
+private:
+  std::map<std::pair<std::string,std::string>, FieldLayout> layouts;
+};
+
+}
+#endif
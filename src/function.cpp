@@ -3,6 +3,8 @@
 #include "backend/backend_function.h"
 #include "types_convert.h"
 #include "graph.h"  // TODO: should not need this include
+#include "profiler.h"
+#include "heap.h"
 
 using namespace std;
 
@@ -117,7 +119,11 @@ void Function::bind(const string& name, TensorData& data) {
 
 void Function::init() {
   uassert(defined()) << "undefined function";
+  internal::resetHeapPeak();
   funcPtr = impl->init();
+  if (!impl->getProfileRegions().empty()) {
+    internal::Profiler::getInstance().reserveThreadBuffer();
+  }
 }
 
 void Function::runSafe() {
@@ -140,6 +146,68 @@ void Function::unmapArgs(bool updated) {
   impl->unmapArgs(updated);
 }
 
+Profile Function::getProfile() const {
+  uassert(defined()) << "undefined function";
+  const vector<int>& ids = impl->getProfileRegions();
+  Profile profile = internal::Profiler::getInstance().getProfile(ids);
+  if (impl->getLoopTraffic().empty()) {
+    return profile;
+  }
+
+  // Scale the per-iteration loop traffic estimates by the iteration counts,
+  // given the sizes of the bound sets, and by the region execution counts
+  map<int,size_t> indices;
+  for (size_t i = 0; i < ids.size(); ++i) {
+    indices[ids[i]] = i;
+  }
+  map<string,size_t> sizes = impl->getSizes();
+  vector<ProfileRegion> regions = profile.getRegions();
+  vector<ProfileLoop> loops;
+  for (const ir::LoopTraffic& traffic : impl->getLoopTraffic()) {
+    if (traffic.regions.empty()) {
+      continue;
+    }
+    ProfileLoop loop;
+    loop.region = indices.at(traffic.regions[0]);
+    loop.name = traffic.name;
+    loop.depth = traffic.depth;
+    loop.tripCount = util::toString(traffic.iterations);
+    loop.iterations = traffic.iterations.evaluate(sizes);
+    loop.loadedBytes = traffic.perIteration.loadedBytes;
+    loop.storedBytes = traffic.perIteration.storedBytes;
+    loop.flops = traffic.perIteration.flops;
+    loops.push_back(loop);
+
+    if (loop.iterations >= 0.0) {
+      double iterations = loop.iterations * regions[loop.region].count;
+      for (int id : traffic.regions) {
+        ProfileRegion& region = regions[indices.at(id)];
+        region.bytes += iterations * traffic.perIteration.bytes();
+        region.flops += iterations * traffic.perIteration.flops;
+      }
+    }
+  }
+  return Profile(regions, profile.getEvents(), profile.getCyclesPerSecond(),
+                 profile.getDroppedEvents(), loops);
+}
+
+void Function::resetProfile() {
+  uassert(defined()) << "undefined function";
+  internal::Profiler::getInstance().reset(impl->getProfileRegions());
+}
+
+MemoryReport Function::memoryReport() const {
+  uassert(defined()) << "undefined function";
+  MemoryReport report = impl->memoryReport();
+  report.setPeakHeapBytes(internal::heapPeakBytes());
+  return report;
+}
+
+CodegenReport Function::getCodegenReport() const {
+  uassert(defined()) << "undefined function";
+  return impl->getCodegenReport();
+}
+
 void Function::print(std::ostream& os) const {
   if (defined()) {
     os << *impl;
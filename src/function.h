@@ -4,6 +4,9 @@
 #include <string>
 #include <functional>
 #include "tensor.h"
+#include "profile.h"
+#include "memory_report.h"
+#include "codegen_report.h"
 
 namespace simit {
 class Set;
@@ -71,12 +74,35 @@ public:
 
   /// Run the function. This method will automatically map/unmap arguments and
   /// initialize the function as necessary. However, it will incur additional
-  /// overhead over manually initializing and mapping arguments.
+  /// overhead over manually initializing and mapping arguments. The function
+  /// is only initialized again when arguments were bound or the elements of a
+  /// bound set changed, and backends with a separate memory only copy the set
+  /// fields that the host or the function wrote.
   void runSafe();
 
   void mapArgs();
   void unmapArgs(bool updated=true);
 
+  /// Get the time spent in the maps, loops and solver calls of a function
+  /// compiled with Program::compileWithProfiling, since it was compiled or
+  /// the profile was last reset. The profile is empty for other functions.
+  /// Regions include memory traffic and flop estimates, evaluated with the
+  /// sizes of the currently bound sets (see Profile::printRoofline).
+  Profile getProfile() const;
+
+  /// Clear the function's profile.
+  void resetProfile();
+
+  /// Get the memory used by the function's temporaries, tensors, path indices
+  /// and machine code, and by the sets bound to it. The peak heap is the most
+  /// memory Simit allocated for function state since the last init.
+  MemoryReport memoryReport() const;
+
+  /// Get a summary of the generated code: for each loop whether the backend
+  /// vectorized it and with which width, instruction counts, register spills,
+  /// calls that were not inlined, and the backend's optimization remarks.
+  CodegenReport getCodegenReport() const;
+
   /// True if the function has been defined, false otherwise.
   bool defined() const {return impl != nullptr;}
 
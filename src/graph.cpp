@@ -1,117 +1,703 @@
 #include "graph.h"
 
+#include <cstdlib>
 #include <iostream>
 
+#include "heap.h"
+#include "init.h"
+#include "placement.h"
+
 using namespace std;
 
 namespace simit {
 
 Set::~Set() {
+  // Detach the set from its endpoint sets, and from edge sets that outlive it
+  for (const Set* endpointSet : endpointSets) {
+    if (endpointSet != nullptr) {
+      endpointSet->edgeSets.erase(this);
+    }
+  }
+  for (Set* edgeSet : edgeSets) {
+    for (const Set*& endpointSet : edgeSet->endpointSets) {
+      if (endpointSet == this) {
+        endpointSet = nullptr;
+      }
+    }
+  }
+
   for (auto f: fields) {
     delete f;
   }
-  free(endpoints);
-  free(latticePoints);
-  free(latticeLinks);
+  if (!externalEndpoints) {
+    internal::freeAligned(endpoints);
+  }
 }
 
-void Set::increaseCapacity() {
+void Set::increaseCapacity(size_t newCapacity) {
+  iassert(newCapacity > (size_t)capacity);
+  uassert(newCapacity <= (size_t)std::numeric_limits<int>::max())
+      << "Set capacity overflow";
+  if (newCapacity > externalCapacity) {
+    for (auto f : fields) {
+      uassert(!f->external)
+          << "Set " << name << " cannot hold " << newCapacity
+          << " elements, since its external field " << f->name << " holds "
+          << externalCapacity;
+    }
+    uerror << "Set " << name << " cannot hold " << newCapacity
+           << " edges, since its external endpoints hold " << externalCapacity;
+  }
+  // realloc does not preserve alignment, so copy into new aligned buffers
   for (auto f : fields) {
-    int typeSize = f->sizeOfType;
-    f->data = realloc(f->data, (capacity+capacityIncrement) * typeSize);
-    memset((char*)(f->data)+capacity*typeSize, 0, capacityIncrement*typeSize);
+    if (f->external) {
+      continue;
+    }
+    size_t typeSize = f->sizeOfType;
+    void* data = allocate(f->layout.getAllocatedElements(newCapacity) *
+                          typeSize);
+    if (!f->isSoA()) {
+      memcpy(data, f->data, f->layout.getAllocatedElements(capacity)*typeSize);
+    }
+    else {
+      // Copy each component to its new distance
+      size_t componentBytes = componentSize(f->type->getComponentType());
+      for (size_t k = 0; k < f->type->getSize(); ++k) {
+        memcpy((char*)data + k*newCapacity*componentBytes,
+               (char*)f->data + k*f->stride*componentBytes,
+               numElements*componentBytes);
+      }
+    }
+    internal::freeAligned(f->data);
+    f->data = data;
+    f->stride = newCapacity;
 
     for (FieldRefBase *fieldRef : f->fieldReferences) {
       fieldRef->data = f->data;
     }
   }
-  capacity += capacityIncrement;
+  if (getCardinality() > 0 && kind != LatticeLink && !externalEndpoints) {
+    size_t endpointSize = getCardinality() * sizeof(int);
+    int* newEndpoints = (int*)allocate(newCapacity * endpointSize);
+    memcpy(newEndpoints, endpoints, capacity * endpointSize);
+    internal::freeAligned(endpoints);
+    endpoints = newEndpoints;
+  }
+  capacity = newCapacity;
+  packed = false;
+  // Functions bound to the set must pick up the new buffers
+  logTopologyChange();
 }
 
+void Set::limitCapacity(size_t newCapacity) {
+  externalCapacity = std::min(externalCapacity, newCapacity);
+  if (newCapacity < (size_t)capacity) {
+    // Owned buffers keep their size, and SoA fields move their components
+    // to the smaller capacity
+    capacity = newCapacity;
+    if (!packed) {
+      unpackFields();
+    }
+  }
+}
 
-// Graph generators
-void createElements(Set *elements, unsigned num) {
-  for (size_t i=0; i < num; ++i) {
-    elements->add();
+Set::ElementRange Set::addExternalEdges(int* endpoints, size_t numEdges,
+                                        size_t capacity) {
+  uassert(getCardinality() > 0 && kind == Unstructured)
+      << "Only unstructured edge sets can have external endpoints";
+  uassert(numElements == 0)
+      << "External endpoints must be added to the empty set " << name;
+  uassert(endpoints != nullptr && numEdges <= capacity)
+      << "External endpoints of " << numEdges << " edges do not fit in "
+      << capacity;
+  for (size_t i = 0; i < numEdges * getCardinality(); ++i) {
+    const Set* endpointSet = endpointSets[i % getCardinality()];
+    uassert(endpoints[i] >= 0 &&
+            (endpointSet == nullptr || endpoints[i] < endpointSet->getSize()))
+        << "Invalid endpoint " << endpoints[i] << " of edge "
+        << i / getCardinality() << " of " << name;
   }
+  limitCapacity(capacity);
+  if (!externalEndpoints) {
+    internal::freeAligned(this->endpoints);
+  }
+  this->endpoints = endpoints;
+  externalEndpoints = true;
+  return addElements(numEdges);
 }
 
-#define node0(x,y,z)  x*numY*numZ + y*numZ + z      // node at x,y,z
-#define node1X(x,y,z) (x+1)*numY*numZ + y*numZ + z  // x's neighbor
-#define node1Y(x,y,z) x*numY*numZ + (y+1)*numZ + z  // y's neighbor
-#define node1Z(x,y,z) x*numY*numZ + y*numZ + (z+1)  // z's neighbor
+void Set::restrideField(FieldData* field, size_t stride) {
+  iassert(field->isSoA());
+  iassert(stride >= (size_t)numElements && stride <= (size_t)capacity);
+  if (stride == field->stride) {
+    return;
+  }
+  const size_t numComponents = field->type->getSize();
+  const size_t componentBytes = componentSize(field->type->getComponentType());
+  const size_t elementsBytes = numElements * componentBytes;
+  char* data = static_cast<char*>(field->data);
+
+  // Move the components in the order that does not overwrite the components
+  // that have not moved yet
+  if (stride > field->stride) {
+    for (size_t k = numComponents-1; k > 0; --k) {
+      memmove(data + k*stride*componentBytes,
+              data + k*field->stride*componentBytes, elementsBytes);
+    }
+  }
+  else {
+    for (size_t k = 1; k < numComponents; ++k) {
+      memmove(data + k*stride*componentBytes,
+              data + k*field->stride*componentBytes, elementsBytes);
+    }
+  }
+
+  // Clear the space between and after the components
+  for (size_t k = 0; k < numComponents; ++k) {
+    size_t begin = k*stride + numElements;
+    size_t end = (k+1 < numComponents) ? (k+1)*stride
+                                       : numComponents*capacity;
+    memset(data + begin*componentBytes, 0, (end-begin)*componentBytes);
+  }
+  field->stride = stride;
+  field->markWritten();
+}
 
-Box::Box(unsigned nX, unsigned nY, unsigned nZ,
-    std::vector<ElementRef> refs, std::map<Box::Coord, ElementRef> coords2edges)
-    : nX(nX), nY(nY), nZ(nZ), refs(refs), coords2edges(coords2edges) {
+void Set::packFields() {
+  for (FieldData* field : fields) {
+    if (field->isSoA()) {
+      restrideField(field, numElements);
+      packed = true;
+    }
+  }
+}
+
+void Set::unpackFields() {
+  for (FieldData* field : fields) {
+    if (field->isSoA()) {
+      restrideField(field, capacity);
+    }
+  }
+  packed = false;
+}
+
+// Move each element i of an array of elements of elementBytes to remap[i],
+// moving runs of elements that stay together at once, and clear the elements
+// after the first size.
+static void moveElements(char* data, size_t elementBytes,
+                         const vector<int>& remap, int size) {
+  const size_t n = remap.size();
+  size_t i = 0;
+  while (i < n) {
+    if (remap[i] == -1) {
+      ++i;
+      continue;
+    }
+    size_t begin = i++;
+    while (i < n && remap[i] == remap[begin] + (int)(i-begin)) {
+      ++i;
+    }
+    if (remap[begin] != (int)begin) {
+      memmove(data + remap[begin]*elementBytes, data + begin*elementBytes,
+              (i-begin)*elementBytes);
+    }
+  }
+  memset(data + size*elementBytes, 0, (n-size)*elementBytes);
+}
+
+vector<int> Set::removeMany(const vector<ElementRef>& elements) {
+  vector<int> remap(numElements, 0);
+  for (ElementRef element : elements) {
+    uassert(element.ident >= 0 && element.ident < numElements)
+        << "Cannot remove element " << element << " from a set of size "
+        << numElements;
+    remap[element.ident] = -1;
+  }
+  int size = 0;
+  for (int& ident : remap) {
+    if (ident != -1) {
+      ident = size++;
+    }
+  }
+  if (size < numElements) {
+    removeElements(remap, size);
+  }
+  return remap;
+}
+
+void Set::removeElements(const vector<int>& remap, int size) {
+  uassert(kind != LatticeLink)
+      << "Element removal disallowed for lattice link edge sets";
+  for (const Set* edgeSet : edgeSets) {
+    uassert(edgeSet->kind != LatticeLink)
+        << "Element removal disallowed for the points of lattice link sets";
+  }
+  iassert(remap.size() == (size_t)numElements);
+
+  for (FieldData* field : fields) {
+    char* data = static_cast<char*>(field->data);
+    const FieldLayout& layout = field->layout;
+    const size_t numComponents = field->type->getSize();
+    const size_t componentBytes = componentSize(field->type->getComponentType());
+    if (layout.isAoS(numComponents)) {
+      moveElements(data, field->sizeOfType, remap, size);
+    }
+    else if (field->isSoA()) {
+      for (size_t k = 0; k < numComponents; ++k) {
+        moveElements(data + k*field->stride*componentBytes, componentBytes,
+                     remap, size);
+      }
+    }
+    else {
+      // The components of an AoSoA element are a tile width apart
+      const size_t width = layout.getTileWidth();
+      auto component = [&](size_t element, size_t k) {
+        return data + (layout.getElementOffset(element, numComponents) +
+                       k*width) * componentBytes;
+      };
+      for (size_t i = 0; i < remap.size(); ++i) {
+        if (remap[i] != -1 && remap[i] != (int)i) {
+          for (size_t k = 0; k < numComponents; ++k) {
+            memcpy(component(remap[i], k), component(i, k), componentBytes);
+          }
+        }
+      }
+      for (size_t i = size; i < remap.size(); ++i) {
+        for (size_t k = 0; k < numComponents; ++k) {
+          memset(component(i, k), 0, componentBytes);
+        }
+      }
+    }
+    field->markWritten();
+  }
+  if (getCardinality() > 0) {
+    moveElements(reinterpret_cast<char*>(endpoints),
+                 getCardinality()*sizeof(int), remap, size);
+  }
+  numElements = size;
+  logTopologyChange(remap);
+
+  for (Set* edgeSet : edgeSets) {
+    edgeSet->remapEndpoints(this, remap);
+  }
+}
+
+void Set::remapEndpoints(const Set* set, const vector<int>& remap) {
+  const int cardinality = getCardinality();
+  vector<ElementRef> removed;
+  for (int e = 0; e < numElements; ++e) {
+    bool connectsRemoved = false;
+    for (int k = 0; k < cardinality; ++k) {
+      if (endpointSets[k] == set) {
+        int& endpoint = endpoints[e*cardinality + k];
+        endpoint = remap[endpoint];
+        connectsRemoved |= (endpoint == -1);
+      }
+    }
+    if (connectsRemoved) {
+      removed.push_back(ElementRef(e));
+    }
+  }
+  markTopologyChanged();
+  removeMany(removed);
+}
+
+void Set::logTopologyChange(vector<int> remap, int removed) {
+  ++topologyVersion;
+  // Appends need no remap, so consecutive appends are logged as one change
+  const bool append = remap.empty() && removed == -1;
+  if (append && !topologyLog.empty() && topologyLog.back().remap.empty() &&
+      topologyLog.back().removed == -1) {
+    topologyLog.back().version = topologyVersion;
+    return;
+  }
+  numLoggedRemaps += !remap.empty();
+  while (!topologyLog.empty() && (numLoggedRemaps > maxLoggedRemaps ||
+                                  topologyLog.size() >= maxLoggedChanges)) {
+    loggedSinceVersion = topologyLog.front().version;
+    numLoggedRemaps -= !topologyLog.front().remap.empty();
+    topologyLog.erase(topologyLog.begin());
+  }
+  // A removal moves the last element, that is at numElements after it
+  topologyLog.push_back({topologyVersion, std::move(remap), removed,
+                         (removed == -1) ? -1 : numElements});
+}
+
+bool Set::getRemapSince(size_t sinceVersion, int oldSize,
+                        vector<int>* remap) const {
+  if (sinceVersion < loggedSinceVersion || sinceVersion > topologyVersion) {
+    return false;
+  }
+  remap->resize(oldSize);
+  std::iota(remap->begin(), remap->end(), 0);
+  // The old element at each current index, or -1, so that a removal that
+  // moves the last element is applied in constant time
+  vector<int> oldIdents(remap->begin(), remap->end());
+  auto oldIdent = [&oldIdents](int ident) -> int& {
+    if ((size_t)ident >= oldIdents.size()) {
+      oldIdents.resize(ident+1, -1);
+    }
+    return oldIdents[ident];
+  };
+  for (const TopologyChange& change : topologyLog) {
+    if (change.version <= sinceVersion) {
+      continue;
+    }
+    if (change.removed != -1) {
+      int removed = oldIdent(change.removed);
+      int moved = oldIdent(change.last);
+      if (removed != -1) {
+        (*remap)[removed] = -1;
+      }
+      if (moved != -1 && change.last != change.removed) {
+        (*remap)[moved] = change.removed;
+      }
+      oldIdent(change.removed) = (change.last != change.removed) ? moved : -1;
+      oldIdent(change.last) = -1;
+    }
+    else if (!change.remap.empty()) {
+      std::fill(oldIdents.begin(), oldIdents.end(), -1);
+      for (int i = 0; i < oldSize; ++i) {
+        int& ident = (*remap)[i];
+        if (ident != -1) {
+          iassert((size_t)ident < change.remap.size());
+          ident = change.remap[ident];
+          if (ident != -1) {
+            oldIdent(ident) = i;
+          }
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void Set::swapRemove(int ident) {
+  uassert(kind != LatticeLink)
+      << "Element removal disallowed for lattice link edge sets";
+  iassert(edgeSets.empty());
+  const int last = numElements-1;
+  for (FieldData* field : fields) {
+    // Move the components of the last element, wherever the layout puts them
+    char* data = static_cast<char*>(field->data);
+    const size_t numComponents = field->type->getSize();
+    const size_t componentBytes =
+        componentSize(field->type->getComponentType());
+    const size_t componentStride =
+        field->layout.getComponentStride(field->stride);
+    auto component = [&](size_t element, size_t k) {
+      return data + (field->layout.getElementOffset(element, numComponents) +
+                     k*componentStride) * componentBytes;
+    };
+    for (size_t k = 0; k < numComponents; ++k) {
+      if (ident != last) {
+        memcpy(component(ident, k), component(last, k), componentBytes);
+      }
+      memset(component(last, k), 0, componentBytes);
+    }
+    field->markWritten();
+  }
+  if (getCardinality() > 0) {
+    const int cardinality = getCardinality();
+    if (ident != last) {
+      memcpy(endpoints + ident*cardinality, endpoints + last*cardinality,
+             cardinality*sizeof(int));
+    }
+    memset(endpoints + last*cardinality, 0, cardinality*sizeof(int));
+  }
+  numElements = last;
+  logTopologyChange(vector<int>(), ident);
+}
+
+int* Set::getEndpointsData() {
+  if (kind == LatticeLink && endpoints == nullptr) {
+    endpoints = (int*)allocate(numElements * getCardinality() * sizeof(int));
+    for (int link = 0; link < numElements; ++link) {
+      for (int i = 0; i < getCardinality(); ++i) {
+        endpoints[link*getCardinality() + i] = getLatticeLinkEndpoint(link, i);
+      }
+    }
+  }
+  return endpoints;
+}
+
+size_t Set::defaultAlignment() {
+  return kFieldAlignment;
+}
+
+void* Set::allocate(size_t size) const {
+  // Round the size up to whole alignment units so that vector loads that
+  // start in the last unit stay inside the buffer
+  size_t alignedSize = (std::max(size, (size_t)1) + alignment-1) &
+                       ~(alignment-1);
+  void* data = internal::allocateAligned(alignedSize, alignment);
+  uassert(data != nullptr)
+      << "Could not allocate " << size << " bytes for set " << name;
+  internal::placeZeroed(data, alignedSize);
+  return data;
+}
+
+MemoryReport Set::memoryReport() const {
+  return memoryReport(internal::HugePageMap());
+}
+
+MemoryReport Set::memoryReport(const internal::HugePageMap& hugePages) const {
+  MemoryReport report;
+  string prefix = name.empty() ? "" : name + ".";
+  for (const FieldData* field : fields) {
+    size_t bufferBytes =
+        field->layout.getAllocatedElements(capacity) * field->sizeOfType;
+    vector<size_t> pageNodes;
+    internal::countPageNodes(field->data, bufferBytes, &pageNodes);
+    // External fields are not allocated by Simit
+    report.add(field->external ? "external field" : "field",
+               prefix + field->name, numElements * field->sizeOfType,
+               field->external ? 0 : bufferBytes, pageNodes,
+               hugePages.getBytes(field->data, bufferBytes));
+  }
+  if (getCardinality() > 0 && kind != LatticeLink) {
+    size_t endpointSize = getCardinality() * sizeof(int);
+    vector<size_t> pageNodes;
+    internal::countPageNodes(endpoints, capacity * endpointSize, &pageNodes);
+    report.add(externalEndpoints ? "external endpoints" : "endpoints",
+               prefix + "endpoints", numElements * endpointSize,
+               externalEndpoints ? 0 : capacity * endpointSize, pageNodes,
+               hugePages.getBytes(endpoints, capacity * endpointSize));
+  }
+  else if (kind == LatticeLink && endpoints != nullptr) {
+    size_t endpointsSize = numElements * getCardinality() * sizeof(int);
+    vector<size_t> pageNodes;
+    internal::countPageNodes(endpoints, endpointsSize, &pageNodes);
+    report.add("endpoints", prefix + "endpoints", endpointsSize,
+               endpointsSize, pageNodes,
+               hugePages.getBytes(endpoints, endpointsSize));
+  }
+  return report;
+}
+
+
+// Graph generators
+void createElements(Set *elements, unsigned num) {
+  elements->addMany(num);
+}
+
+Box::Box(unsigned nX, unsigned nY, unsigned nZ, std::vector<ElementRef> refs,
+         std::vector<ElementRef> edgesX, std::vector<ElementRef> edgesY,
+         std::vector<ElementRef> edgesZ)
+    : nX(nX), nY(nY), nZ(nZ), refs(refs), edgesX(edgesX), edgesY(edgesY),
+      edgesZ(edgesZ) {
   iassert(refs.size() == nX*nY*nZ);
+  iassert(edgesX.size() == refs.size() && edgesY.size() == refs.size() &&
+          edgesZ.size() == refs.size());
 }
 
 ElementRef Box::getEdge(ElementRef p1, ElementRef p2) const {
-  Coord coord(p1,p2);
-  if (coords2edges.find(coord) == coords2edges.end()) {
+  // The vertices are added consecutively
+  int i = p1.getIdent() - refs[0].getIdent();
+  if (i < 0 || (size_t)i >= refs.size()) {
     return ElementRef();
   }
-  return coords2edges.at(coord);
+  unsigned z = i % nZ;
+  unsigned y = (i / nZ) % nY;
+  unsigned x = i / (nZ*nY);
+  if (x+1 < nX && refs[i + nY*nZ] == p2) {
+    return edgesX[i];
+  }
+  if (y+1 < nY && refs[i + nZ] == p2) {
+    return edgesY[i];
+  }
+  if (z+1 < nZ && refs[i + 1] == p2) {
+    return edgesZ[i];
+  }
+  return ElementRef();
 }
 
 std::vector<ElementRef> Box::getEdges() {
   std::vector<ElementRef> edges;
-  for (auto &coord2edge : coords2edges) {
-    edges.push_back(coord2edge.second);
+  for (auto axisEdges : {&edgesX, &edgesY, &edgesZ}) {
+    for (ElementRef edge : *axisEdges) {
+      if (edge.defined()) {
+        edges.push_back(edge);
+      }
+    }
   }
   return edges;
 }
 
-Box createBox(Set *vertices, Set *edges,
-              unsigned numX, unsigned numY, unsigned numZ) {
+/// Add a numX x numY x numZ grid of vertices, numbered with z fastest.
+static vector<ElementRef> createGridVertices(Set *vertices, unsigned numX,
+                                             unsigned numY, unsigned numZ) {
   uassert(numX >= 1 && numY >= 1 && numZ >= 1);
-  vector<ElementRef> points(numX*numY*numZ);
-
-  for(unsigned x = 0; x < numX; ++x) {
-    for(unsigned y = 0; y < numY; ++y) {
-      for(unsigned z = 0; z < numZ; ++z) {
-        points[node0(x,y,z)] = vertices->add();
-      }
-    }
+  size_t numVertices = (size_t)numX * numY * numZ;
+  Set::ElementRange range = vertices->addMany(numVertices);
+  vector<ElementRef> refs(numVertices);
+  for (size_t i = 0; i < numVertices; ++i) {
+    refs[i] = range[i];
   }
+  return refs;
+}
 
-  map<Box::Coord, ElementRef> coords2edges;
+Box createBox(Set *vertices, Set *edges,
+              unsigned numX, unsigned numY, unsigned numZ) {
+  vector<ElementRef> points = createGridVertices(vertices, numX, numY, numZ);
+  auto node = [&](unsigned x, unsigned y, unsigned z) {
+    return (x*numY + y)*numZ + z;
+  };
 
-  // x edges
+  vector<ElementRef> edgesX(points.size());
+  vector<ElementRef> edgesY(points.size());
+  vector<ElementRef> edgesZ(points.size());
+  edges->reserve(edges->getSize() + 3*points.size());
   for(unsigned x = 0; x < numX-1; ++x) {
     for(unsigned y = 0; y < numY; ++y) {
       for(unsigned z = 0; z < numZ; ++z) {
-        Box::Coord coord(points[node0(x,y,z)], points[node1X(x,y,z)]);
-        simit::ElementRef edge = edges->add(coord.first, coord.second);
-        coords2edges[coord] = edge;
+        edgesX[node(x,y,z)] = edges->add(points[node(x,y,z)],
+                                         points[node(x+1,y,z)]);
       }
     }
   }
-
-  // y edges
   for(unsigned x = 0; x < numX; ++x) {
     for(unsigned y = 0; y < numY - 1; ++y) {
       for(unsigned z = 0; z < numZ; ++z) {
-        Box::Coord coord(points[node0(x,y,z)], points[node1Y(x,y,z)]);
-        simit::ElementRef edge = edges->add(coord.first, coord.second);
-        coords2edges[coord] = edge;
+        edgesY[node(x,y,z)] = edges->add(points[node(x,y,z)],
+                                         points[node(x,y+1,z)]);
       }
     }
   }
-
-  // z edges
   for(unsigned x = 0; x < numX; ++x) {
     for(unsigned y = 0; y < numY; ++y) {
       for(unsigned z = 0; z < numZ-1; ++z) {
-        Box::Coord coord(points[node0(x,y,z)], points[node1Z(x,y,z)]);
-        simit::ElementRef edge = edges->add(coord.first, coord.second);
-        coords2edges[coord] = edge;
+        edgesZ[node(x,y,z)] = edges->add(points[node(x,y,z)],
+                                         points[node(x,y,z+1)]);
+      }
+    }
+  }
+
+  return Box(numX, numY, numZ, points, edgesX, edgesY, edgesZ);
+}
+
+vector<ElementRef> createTetGrid(Set *vertices, Set *tets,
+                                 unsigned numX, unsigned numY, unsigned numZ) {
+  uassert(tets->getCardinality() == 4)
+      << "createTetGrid requires a tetrahedron set with four endpoints";
+  vector<ElementRef> refs = createGridVertices(vertices, numX, numY, numZ);
+
+  // Each tetrahedron walks from a cell's first to its last corner along the
+  // three axes in one of the six orders. The odd permutations swap their last
+  // two vertices to be positively oriented.
+  const size_t strides[3] = {(size_t)numY*numZ, numZ, 1};
+  const int orders[6][3] = {{0,1,2}, {1,2,0}, {2,0,1},
+                            {0,2,1}, {1,0,2}, {2,1,0}};
+  tets->reserve(tets->getSize() + (size_t)6*(numX-1)*(numY-1)*(numZ-1));
+  for (unsigned x = 0; x+1 < numX; ++x) {
+    for (unsigned y = 0; y+1 < numY; ++y) {
+      for (unsigned z = 0; z+1 < numZ; ++z) {
+        size_t corner = (x*numY + y)*numZ + z;
+        for (int t = 0; t < 6; ++t) {
+          size_t v1 = corner + strides[orders[t][0]];
+          size_t v2 = v1 + strides[orders[t][1]];
+          size_t v3 = v2 + strides[orders[t][2]];
+          if (t < 3) {
+            tets->add(refs[corner], refs[v1], refs[v2], refs[v3]);
+          }
+          else {
+            tets->add(refs[corner], refs[v1], refs[v3], refs[v2]);
+          }
+        }
       }
     }
   }
+  return refs;
+}
 
-  return Box(numX, numY, numZ, points, coords2edges);
+vector<ElementRef> createSpringNetwork(Set *points, Set *springs,
+                                       unsigned numX, unsigned numY,
+                                       unsigned numZ) {
+  uassert(springs->getCardinality() == 2)
+      << "createSpringNetwork requires a spring set with two endpoints";
+  vector<ElementRef> refs = createGridVertices(points, numX, numY, numZ);
+
+  // Two vertices of the tetrahedral grid share an edge iff one is reached
+  // from the other by stepping +1 along a non-empty subset of the axes
+  for (unsigned x = 0; x < numX; ++x) {
+    for (unsigned y = 0; y < numY; ++y) {
+      for (unsigned z = 0; z < numZ; ++z) {
+        size_t vertex = (x*numY + y)*numZ + z;
+        for (int step = 1; step < 8; ++step) {
+          unsigned dx = (step >> 2) & 1, dy = (step >> 1) & 1, dz = step & 1;
+          if (x+dx >= numX || y+dy >= numY || z+dz >= numZ) {
+            continue;
+          }
+          size_t neighbor = ((x+dx)*numY + (y+dy))*numZ + (z+dz);
+          springs->add(refs[vertex], refs[neighbor]);
+        }
+      }
+    }
+  }
+  return refs;
+}
+
+vector<ElementRef> createRMATGraph(Set *vertices, Set *edges, unsigned scale,
+                                   size_t numEdges, double a, double b,
+                                   double c, unsigned seed) {
+  uassert(edges->getCardinality() == 2)
+      << "createRMATGraph requires an edge set with two endpoints";
+  uassert(scale >= 1 && scale <= 30) << "R-MAT scale must be in [1,30]";
+  uassert(a >= 0.0 && b >= 0.0 && c >= 0.0 && a+b+c <= 1.0)
+      << "Invalid R-MAT quadrant probabilities";
+
+  // Each level of the recursion picks a quadrant with a 32-bit random number,
+  // compared without branches to the cumulative quadrant probabilities
+  const uint64_t thresholdA = (uint64_t)(a * 4294967296.0);
+  const uint64_t thresholdAB = (uint64_t)((a+b) * 4294967296.0);
+  const uint64_t thresholdABC = (uint64_t)((a+b+c) * 4294967296.0);
+  // Edges off the diagonal need an off-diagonal quadrant at some level
+  uassert(thresholdABC - thresholdA > 0)
+      << "R-MAT quadrant probabilities b=" << b << " and c=" << c
+      << " only produce self-loops";
+
+  size_t numVertices = (size_t)1 << scale;
+  Set::ElementRange range = vertices->addMany(numVertices);
+  vector<ElementRef> refs(numVertices);
+  for (size_t i = 0; i < numVertices; ++i) {
+    refs[i] = range[i];
+  }
+  edges->reserve(edges->getSize() + numEdges);
+
+  // Fisher-Yates shuffle of the vertex numbers
+  std::mt19937_64 rng(seed);
+  vector<ElementRef> permuted = refs;
+  for (size_t i = numVertices-1; i > 0; --i) {
+    std::swap(permuted[i], permuted[internal::uniformIndex(rng, i+1)]);
+  }
+
+  // Self-loops are redrawn, up to a limit for probabilities that make them
+  // nearly certain
+  const int maxDraws = 1000;
+  for (size_t e = 0; e < numEdges; ++e) {
+    size_t source, sink;
+    int draws = 0;
+    do {
+      uassert(draws++ < maxDraws)
+          << "R-MAT quadrant probabilities a=" << a << ", b=" << b
+          << ", c=" << c << " draw too many self-loops at scale " << scale;
+      source = 0;
+      sink = 0;
+      uint64_t bits = 0;
+      for (unsigned level = 0; level < scale; ++level) {
+        if (level % 2 == 0) {
+          bits = rng();
+        }
+        uint64_t r = (level % 2 == 0) ? (bits & 0xFFFFFFFFu) : (bits >> 32);
+        size_t right = (r >= thresholdA && r < thresholdAB) | (r >= thresholdABC);
+        size_t bottom = (r >= thresholdAB);
+        sink |= right << level;
+        source |= bottom << level;
+      }
+    } while (source == sink);
+    edges->add(permuted[source], permuted[sink]);
+  }
+  return refs;
 }
 
 } // namespace simit
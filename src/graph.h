@@ -2,15 +2,23 @@
 #define SIMIT_GRAPH_H
 
 #include <cstddef>
+#include <cstdint>
 #include <cstring>
+#include <algorithm>
+#include <limits>
+#include <random>
 #include <vector>
 #include <string>
 #include <map>
+#include <numeric>
 #include <set>
 #include <ostream>
 
+#include "field_layout.h"
 #include "tensor_type.h"
+#include "memory_report.h"
 #include "error.h"
+#include "heap.h"
 #include "types.h"
 #include "util/variadic.h"
 #include "interfaces/comparable.h"
@@ -102,7 +110,8 @@ public:
     static_assert(util::areSame<Set, Sets...>{},
         "Set constructor takes an optional name followed by zero or more Sets");
     this->endpointSets = {&endpoints...};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
+    this->endpoints    = (int*)allocate(sizeof(int)*capacity*getCardinality());
+    registerWithEndpointSets();
   }
 
   /// Construct a named edge set with n endpoints.
@@ -127,46 +136,24 @@ public:
         << "Lattice link Set constructor must be passed an empty underlying "
         << "point set, which it will then proceed to initialize.";
     this->endpointSets = {&points, &points};
-    this->endpoints    = (int*)calloc(sizeof(int), capacity * getCardinality());
+    registerWithEndpointSets();
     this->dimensions = dims;
     this->latticePointSet = &points;
 
-    int totalPoints = 1;
-    std::vector<int> cumDims;
+    // The points and links are numbered by their coordinates (see
+    // getLatticePoint and getLatticeLink), and the endpoints of the links are
+    // computed from the numbering on demand, so the lattice only takes memory
+    // for the fields.
+    size_t totalPoints = 1;
     for (int d : dims) {
+      uassert(d > 0) << "Lattice dimensions must be positive";
       totalPoints *= d;
-      cumDims.push_back(totalPoints);
+      uassert(totalPoints * dims.size() <=
+              (size_t)std::numeric_limits<int>::max())
+          << "Lattice with more links than a set can hold";
     }
-
-    this->latticePoints = (ElementRef*)calloc(sizeof(ElementRef), totalPoints);
-    this->latticeLinks = (ElementRef*)calloc(
-        sizeof(ElementRef), totalPoints*dims.size());
-    
-    std::vector<int> indices(dims.size());
-    // Pad underlying set to have N_1 x N_2 x ... N_d elements, storing their
-    // references in latticePoints.
-    int count = 0;
-    util::variableLoop(dims.begin(), dims.end(),
-                       indices.begin(), indices.end(), [&](){
-        this->latticePoints[count] = points.add();
-        count++;
-      });
-
-    // Generate N_1 x N_2 x ... N_d x d elements for this set, linking the
-    // underlying points in a lattice structure, and store their references in
-    // the canonically ordered latticeLinks.
-    count = 0;
-    dims.push_back(dims.size()); // dimension index runs outermost
-    indices.push_back(0);
-    util::variableLoop(dims.begin(), dims.end(),
-                       indices.begin(), indices.end(), [&](){
-        int off = cumDims[indices.back()];
-        // Assumes periodic boundary conditions
-        this->latticeLinks[count] = add(
-            this->latticePoints[count%totalPoints],
-            this->latticePoints[(count+off)%totalPoints]);
-        count++;
-      });
+    points.addMany(totalPoints);
+    addElements(totalPoints * dims.size());
   }
 
   Set(Set& points, std::vector<int> dims) : Set("", points, dims) {}
@@ -207,7 +194,7 @@ public:
     uassert(index >= 0 && index < totalSize)
         << "Coordinates must not be negative and must fall within the "
         << "lattice dimensions";
-    return latticePoints[index];
+    return ElementRef(index);
   }
 
   /// Return the lattice link at the given location and direction.
@@ -230,7 +217,7 @@ public:
     uassert(index >= 0 && index < totalSize)
         << "Coordinates must not be negative and must fall within the "
         << "lattice dimensions";
-    return latticeLinks[index];
+    return ElementRef(index);
   }
 
   inline std::vector<int> getLatticePointCoords(ElementRef elt) const {
@@ -251,17 +238,57 @@ public:
   /// component type and dimension sizes of the tensors.  For example, define a
   /// field of 2x3 matrices containing doubles as follows:
   /// Field<double,2,3> matrix = addField<double,2,3>("mat");
+  /// The layout must match the layout of the field in the programs the set is
+  /// bound to (see Program::setFieldLayout).
   template <typename T, int... dimensions>
-  FieldRef<T, dimensions...> addField(const std::string &name) {
+  FieldRef<T, dimensions...> addField(const std::string &name,
+                                      FieldLayout layout=FieldLayout()) {
     FieldData::TensorType *type =
         new FieldData::TensorType(typeOf<T>(), {dimensions...});
-    FieldData *fieldData = new FieldData(name, type, this);
-    fieldData->data = calloc(capacity, fieldData->sizeOfType);
+    FieldData *fieldData = new FieldData(name, type, this, layout);
+    allocateField(fieldData);
     fields.push_back(fieldData);
     fieldNames[name] = fields.size()-1;
     return FieldRef<T, dimensions...>(fieldData);
   }
- 
+
+  /// Add a tensor field whose tensors are stored in an array owned by the
+  /// caller, instead of in memory the set allocates. The array holds capacity
+  /// elements in the given layout (AoS or AoSoA), and its first getSize()
+  /// elements are the values of the set's elements, so nothing is copied. An
+  /// AoSoA array must hold whole tiles, layout.getAllocatedElements(capacity)
+  /// elements. The set and the functions it is bound to read and write the
+  /// array directly, so it must outlive them, and it must be aligned to the
+  /// set's alignment (Settings::fieldAlignment). The set cannot grow beyond
+  /// capacity elements while it has the field.
+  template <typename T, int... dimensions>
+  FieldRef<T, dimensions...>
+  addExternalField(const std::string &name, T* data, size_t capacity,
+                   FieldLayout layout=FieldLayout()) {
+    uassert(data != nullptr) << "External field " << name << " has no data";
+    uassert(capacity >= (size_t)numElements)
+        << "External field " << name << " holds " << capacity
+        << " elements, but set " << this->name << " has " << numElements;
+    uassert(reinterpret_cast<uintptr_t>(data) % alignment == 0)
+        << "External field " << name << " is not aligned to " << alignment
+        << " bytes";
+    FieldData::TensorType *type =
+        new FieldData::TensorType(typeOf<T>(), {dimensions...});
+    FieldData *fieldData = new FieldData(name, type, this, layout);
+    if (fieldData->isSoA()) {
+      // Packing moves the components of SoA fields within their buffers
+      delete fieldData;
+      uerror << "External field " << name << " cannot have the SoA layout";
+    }
+    limitCapacity(capacity);
+    fieldData->data = data;
+    fieldData->stride = capacity;
+    fieldData->external = true;
+    fields.push_back(fieldData);
+    fieldNames[name] = fields.size()-1;
+    return FieldRef<T, dimensions...>(fieldData);
+  }
+
   // Added for reordering
   void setSpatialField(const std::string& name) {
     uassert(fieldNames.find(name) != fieldNames.end())
@@ -293,58 +320,56 @@ public:
   ElementRef add(Endpoints... endpoints) {
     iassert(sizeof...(endpoints) == getCardinality()) <<"Wrong number of \
       endpoints.";
-    if (numElements > capacity-1) {
-      increaseEdgeCapacity();
+    uassert(kind != LatticeLink)
+        << "Cannot add edges to a lattice link edge set";
+    if (numElements == capacity) {
+      growCapacity(numElements+1);
+    }
+    if (packed) {
+      unpackFields();
     }
     addEndpoints(0, endpoints...);
+    logTopologyChange();
+    return ElementRef(numElements++);
+  }
 
-    if (numElements > capacity-1) {
-      increaseCapacity();
+  /// Allocate room for at least n elements, so that adding up to n elements
+  /// does not reallocate the fields and endpoints.
+  void reserve(size_t n) {
+    uassert(n <= (size_t)std::numeric_limits<int>::max())
+        << "Cannot reserve " << n << " elements";
+    if ((int)n > capacity) {
+      increaseCapacity(n);
     }
-    return ElementRef(numElements++);
   }
 
-  /// Remove an element from the Set
+  /// Remove an element from the Set. The last element takes its place. The
+  /// edges of the sets whose endpoints are in the set are renumbered, and
+  /// removed if they connect the element. This takes constant time if no
+  /// edge set has endpoints in the set, and otherwise time linear in the
+  /// sizes of the set and of those edge sets. Use removeMany to remove many
+  /// elements at once.
   void remove(ElementRef element) {
-    uassert(kind != LatticeLink)
-        << "Element removal disallowed for lattice link edge sets";
-    for (auto f : fields){
-      switch (f->type->getComponentType()) {
-        case ComponentType::Float: {
-          float* data = (float*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Double: {
-          double* data = (double*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Int: {
-          int* data = (int*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::Boolean: {
-          bool* data = (bool*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::FloatComplex: {
-          float_complex* data = (float_complex*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-        case ComponentType::DoubleComplex: {
-          double_complex* data = (double_complex*)f->data;
-          data[element.ident] = data[numElements-1];
-          break;
-        }
-      }
+    uassert(element.ident >= 0 && element.ident < numElements)
+        << "Cannot remove element " << element << " from a set of size "
+        << numElements;
+    if (edgeSets.empty()) {
+      swapRemove(element.ident);
+      return;
     }
-    numElements--;
+    std::vector<int> remap(numElements);
+    std::iota(remap.begin(), remap.end(), 0);
+    remap[element.ident] = -1;
+    remap[numElements-1] = (element.ident < numElements-1) ? element.ident : -1;
+    removeElements(remap, numElements-1);
   }
 
+  /// Remove the elements from the Set, keeping the order of the others, which
+  /// move down to fill the holes. The edges of the sets whose endpoints are in
+  /// the set are renumbered, and removed if they connect removed elements.
+  /// Returns the new index of each old element, or -1 if it was removed.
+  std::vector<int> removeMany(const std::vector<ElementRef>& elements);
+
   /// Iterator that iterates over the elements in a Set
   ///
   /// This iterator is an input_iterator, and thus can only be
@@ -403,6 +428,75 @@ public:
   /// Create an ElementIterator for terminating iteration over this Set
   ElementIterator end() const { return ElementIterator(this, getSize()); }
 
+  /// A contiguous range of elements, such as the elements added by addMany.
+  class ElementRange {
+  public:
+    ElementRange() : set(nullptr), first(0), size(0) {}
+
+    /// The number of elements in the range.
+    int getSize() const { return size; }
+
+    /// The i'th element of the range.
+    ElementRef operator[](int i) const {
+      iassert(i >= 0 && i < size);
+      return ElementRef(first + i);
+    }
+
+    ElementIterator begin() const { return ElementIterator(set, first); }
+    ElementIterator end() const { return ElementIterator(set, first+size); }
+
+  private:
+    ElementRange(const Set* set, int first, int size)
+        : set(set), first(first), size(size) {}
+
+    const Set* set;
+    int first;
+    int size;
+
+    friend class Set;
+  };
+
+  /// Add n elements with no endpoints, returning their (contiguous) handles.
+  ElementRange addMany(size_t n) {
+    uassert(getCardinality() == 0)
+        << "Use addEdges to add elements with endpoints";
+    return addElements(n);
+  }
+
+  /// Add n edges, returning their (contiguous) handles. The endpoints array
+  /// holds the endpoints of the edges in the order they are added, with the
+  /// getCardinality() endpoints of each edge stored consecutively.
+  ElementRange addEdges(const int* endpoints, size_t n) {
+    uassert(getCardinality() > 0) << "Use addMany to add elements";
+    uassert(kind != LatticeLink)
+        << "Cannot add edges to a lattice link edge set";
+    const int cardinality = getCardinality();
+    for (size_t i = 0; i < n; ++i) {
+      for (int j = 0; j < cardinality; ++j) {
+        int endpoint = endpoints[i*cardinality + j];
+        uassert(endpoint >= 0 && endpoint < endpointSets[j]->getSize())
+            << "Invalid member of set in addEdges";
+      }
+    }
+    int first = numElements;
+    ElementRange edges = addElements(n);
+    if (n > 0) {
+      memcpy(this->endpoints + (size_t)first*cardinality, endpoints,
+             n*cardinality*sizeof(int));
+    }
+    return edges;
+  }
+
+  /// Make the endpoints of an empty unstructured edge set an array owned by
+  /// the caller, and add the edges whose endpoints it holds. The array holds
+  /// the endpoints of capacity edges (getCardinality() per edge), of which
+  /// the first numEdges are added. Edges added later are written to the
+  /// array, and removed edges are compacted in it. The array must outlive the
+  /// set and the functions it is bound to, and the set cannot grow beyond
+  /// capacity edges.
+  ElementRange addExternalEdges(int* endpoints, size_t numEdges,
+                                size_t capacity);
+
   /// Get the endpoint set at the given location.
   const Set *getEndpointSet(int loc) const {
     return endpointSets[loc];
@@ -425,6 +519,9 @@ public:
 
   /// Get an endpoint of an edge
   ElementRef getEndpoint(ElementRef edge, int endpointNum) const {
+    if (kind == LatticeLink) {
+      return ElementRef(getLatticeLinkEndpoint(edge.ident, endpointNum));
+    }
     return ElementRef(endpoints[edge.ident*getCardinality() + endpointNum]);
   }
   
@@ -453,10 +550,10 @@ public:
       Iterator& operator++() {
         const int cardinality = set->getCardinality();
         endpointNum++;
-        if (endpointNum > set->getCardinality()-1)
+        if (endpointNum > cardinality-1)
           retElem.ident = -1;   // return invalid element
         else
-          retElem.ident = set->endpoints[curElem.ident*cardinality+endpointNum];
+          retElem = set->getEndpoint(curElem, endpointNum);
         return *this;
       }
 
@@ -466,7 +563,7 @@ public:
         if (endpointNum > cardinality-1)
           retElem.ident = -1;   // return invalid element
         else
-          retElem.ident = set->endpoints[curElem.ident*cardinality+endpointNum];
+          retElem = set->getEndpoint(curElem, endpointNum);
         return *this;
       }
 
@@ -517,14 +614,59 @@ public:
     return Endpoints(this, edge);
   }
 
+  /// Get a field's data. The field is assumed to be written through it.
   void* getFieldData(const std::string &fieldName) {
     uassert(fieldNames.find(fieldName) != fieldNames.end())
         << "Cannot find " << fieldName;
-    return fields[fieldNames.at(fieldName)]->data;
-  }
+    FieldData* field = fields[fieldNames.at(fieldName)];
+    field->markWritten();
+    return field->data;
+  }
+
+  /// Counts the changes to the elements and endpoints of the set, so that
+  /// functions bound to the set can tell when the indices and temporaries
+  /// they derived from it are stale.
+  size_t getTopologyVersion() const { return topologyVersion; }
+
+  /// Record that the elements or endpoints were changed in place, other than
+  /// through the set's methods (e.g. by reordering them). Such changes are not
+  /// logged, so getRemapSince fails for earlier versions.
+  void markTopologyChanged() {
+    ++topologyVersion;
+    topologyLog.clear();
+    numLoggedRemaps = 0;
+    loggedSinceVersion = topologyVersion;
+  }
+
+  /// Where the oldSize elements the set had at topology version sinceVersion
+  /// are now: (*remap)[i] is the current index of old element i, or -1 if it
+  /// was removed. The current elements that no old element maps to were added
+  /// since. This lets indices derived from the set be updated instead of
+  /// rebuilt. Returns false if the changes since the version were not logged,
+  /// because the set was changed in place or was changed too often since.
+  bool getRemapSince(size_t sinceVersion, int oldSize,
+                     std::vector<int>* remap) const;
+
+  /// The alignment in bytes of the field and endpoint arrays.
+  size_t getAlignment() const { return alignment; }
+
+  /// Store the components of each SoA field getSize() apart, which is how
+  /// compiled functions index them. The set does this when it is bound to a
+  /// function, and spreads them out again when elements are added.
+  void packFields();
 
   /// Get an array containing, for each edge in a set, the elements it connects.
-  int *getEndpointsData() { return endpoints; }
+  /// The endpoints of lattice link sets are computed from the coordinates of
+  /// the links, so the array is only built the first time it is requested.
+  int *getEndpointsData();
+
+  /// The bytes used and allocated by the set's fields, endpoints and lattice
+  /// indices.
+  MemoryReport memoryReport() const;
+
+  /// The memory report of the set, with the huge pages of its buffers looked
+  /// up in hugePages, e.g. to share it with other reports.
+  MemoryReport memoryReport(const internal::HugePageMap& hugePages) const;
 
   void setName(const std::string &name) { this->name = name; }
   std::string getName() const { return name; }
@@ -564,13 +706,39 @@ public:
       size_t size;
     };
 
-    FieldData(const std::string &name, const TensorType *type, Set *set)
-        : name(name), type(type), set(set), data(nullptr) {
+    FieldData(const std::string &name, const TensorType *type, Set *set,
+              FieldLayout layout=FieldLayout())
+        : name(name), type(type), set(set), data(nullptr), layout(layout),
+          stride(0), version(0), external(false) {
       sizeOfType = componentSize(type->getComponentType()) * type->getSize();
     }
 
+    /// Record that the host may have written the field, or that a function
+    /// run wrote it.
+    void markWritten() { ++version; }
+
+    /// True if the field has several components stored SoA.
+    bool isSoA() const {
+      return layout.getKind() == FieldLayout::SoA && type->getSize() > 1;
+    }
+
+    /// The bytes from the start of the data that hold the first numElements
+    /// elements.
+    size_t getBytes(size_t numElements) const {
+      if (numElements == 0 || layout.isAoS(type->getSize())) {
+        return numElements * sizeOfType;
+      }
+      size_t componentBytes = componentSize(type->getComponentType());
+      if (isSoA()) {
+        return ((type->getSize()-1) * stride + numElements) * componentBytes;
+      }
+      return layout.getAllocatedElements(numElements) * sizeOfType;
+    }
+
     ~FieldData() {
-      free(data);
+      if (!external) {
+        internal::freeAligned(data);
+      }
       delete type;
     }
 
@@ -585,6 +753,19 @@ public:
     /// Buffer for the field data
     void* data;
 
+    /// The layout of the tensors in data, and for SoA layouts the number of
+    /// components between the components of an element.
+    FieldLayout layout;
+    size_t stride;
+
+    /// Counts the writes to the field (see markWritten), so that functions
+    /// bound to the set can skip copying fields that did not change.
+    size_t version;
+
+    /// True if data is owned by the caller (see Set::addExternalField), so
+    /// the set never reallocates or frees it.
+    bool external;
+
     /// Field references so that we can update their data pointers if we realloc
     /// field data. Avoids two loads on field get/set.
     std::set<FieldRefBase*> fieldReferences;
@@ -596,7 +777,7 @@ public:
   };
 
   // Added getters for reordering
-  inline int* getEndpointsPtr() { return endpoints; }
+  inline int* getEndpointsPtr() { return getEndpointsData(); }
   inline int getFieldIndex(std::string name) { return fieldNames[name]; } inline 
     std::vector<FieldData*>& getFields() { return fields; } inline std::string 
     getSpatialFieldName() const { return spatialFieldName; }
@@ -607,8 +788,11 @@ private:
   // Private constructor for delegation
   Set(const std::string &name, Kind kind)
       : kind(kind), name(name), numElements(0), endpoints(nullptr),
-        latticePoints(nullptr), latticeLinks(nullptr),
-        capacity(capacityIncrement), neighbors(nullptr) {}
+        latticePointSet(nullptr), capacity(initialCapacity),
+        externalCapacity(std::numeric_limits<int>::max()),
+        externalEndpoints(false), alignment(defaultAlignment()),
+        packed(false), topologyVersion(0), loggedSinceVersion(0),
+        numLoggedRemaps(0), neighbors(nullptr) {}
 
   // Set data
   Kind kind;
@@ -616,16 +800,35 @@ private:
   std::string spatialFieldName;
   int numElements;                           // number of elements in the set
   std::vector<const Set*> endpointSets;      // the sets the endpoints belong to
+  mutable std::set<Set*> edgeSets;           // the sets with endpoints in this
   int* endpoints;                            // the endpoints of edge elements
 
   // Lattice link set data
   std::vector<int> dimensions;               // the lattice dimensions
   const Set* latticePointSet;                // the underlying point set
-  ElementRef* latticePoints;                 // ordered refs to lattice points
-  ElementRef* latticeLinks;                  // ordered refs to lattice links
 
   int capacity;                              // current capacity of the set
-  static const int capacityIncrement = 1024; // increment for capacity increases
+  static const int initialCapacity = 1024;   // capacity of new sets
+  size_t externalCapacity;                   // capacity of external arrays
+  bool externalEndpoints;                    // endpoints owned by the caller
+  size_t alignment;                          // alignment of fields, endpoints
+  bool packed;                               // SoA fields were packed
+  size_t topologyVersion;                    // see getTopologyVersion
+
+  /// A logged topology change: elements were appended (an empty remap and no
+  /// removed element), element removed was removed and element last took its
+  /// place, or each element i moved to remap[i] (-1 if it was removed).
+  struct TopologyChange {
+    size_t version;                          // the version after the change
+    std::vector<int> remap;
+    int removed;
+    int last;
+  };
+  std::vector<TopologyChange> topologyLog;   // the latest changes, in order
+  size_t loggedSinceVersion;                 // the log starts at this version
+  size_t numLoggedRemaps;                    // changes in the log with a remap
+  static const size_t maxLoggedRemaps = 8;   // remaps hold an int per element
+  static const size_t maxLoggedChanges = 1024;
 
   mutable internal::NeighborIndex *neighbors;// neighbor index (lazily created)
   std::map<std::string, int> fieldNames;     // name to field lookups
@@ -634,8 +837,93 @@ private:
   /// disable copy
   Set& operator=(const Set& s);
 
-  /// increase capacity of all fields
-  void increaseCapacity();
+  /// the alignment of new sets (Settings::fieldAlignment)
+  static size_t defaultAlignment();
+
+  /// allocate zeroed memory with the set's alignment, to be released with
+  /// internal::freeAligned
+  void* allocate(size_t size) const;
+
+  /// allocate the data of a new field for the set's capacity
+  void allocateField(FieldData* field) const {
+    field->data = allocate(field->layout.getAllocatedElements(capacity) *
+                           field->sizeOfType);
+    field->stride = capacity;
+  }
+
+  /// move the components of a SoA field to be stride components apart
+  void restrideField(FieldData* field, size_t stride);
+
+  /// spread the components of SoA fields out to the capacity again
+  void unpackFields();
+
+  /// increase capacity of all fields and of the endpoints to newCapacity
+  void increaseCapacity(size_t newCapacity);
+
+  /// limit the capacity to that of a new external array
+  void limitCapacity(size_t newCapacity);
+
+  /// add the set to the edge sets of its endpoint sets
+  void registerWithEndpointSets() {
+    for (const Set* endpointSet : endpointSets) {
+      endpointSet->edgeSets.insert(this);
+    }
+  }
+
+  /// move each element i to remap[i], or remove it if remap[i] is -1, leaving
+  /// size elements. Elements must move to removed or already moved slots.
+  void removeElements(const std::vector<int>& remap, int size);
+
+  /// renumber the endpoints in set by remap, and remove the edges that connect
+  /// removed elements
+  void remapEndpoints(const Set* set, const std::vector<int>& remap);
+
+  /// the endpoint of a lattice link, that connects the point at its
+  /// coordinates to the next point in its direction (with periodic boundaries)
+  int getLatticeLinkEndpoint(int link, int endpointNum) const {
+    const int ndims = dimensions.size();
+    const int point = link / ndims;
+    if (endpointNum == 0) {
+      return point;
+    }
+    const int dir = link % ndims;
+    int stride = 1;
+    for (int i = 0; i < dir; ++i) {
+      stride *= dimensions[i];
+    }
+    const int coord = (point / stride) % dimensions[dir];
+    return (coord+1 < dimensions[dir]) ? point + stride : point - coord*stride;
+  }
+
+  /// bump the topology version and log the change (see TopologyChange)
+  void logTopologyChange(std::vector<int> remap=std::vector<int>(),
+                         int removed=-1);
+
+  /// remove an element by moving the last element into its place, when no
+  /// edge set has endpoints in the set
+  void swapRemove(int ident);
+
+  /// increase capacity geometrically to hold at least minCapacity elements
+  void growCapacity(size_t minCapacity) {
+    increaseCapacity(std::min(std::max(minCapacity, 2*(size_t)capacity),
+                              std::max(minCapacity, externalCapacity)));
+  }
+
+  /// add n elements, leaving their endpoints to the caller
+  ElementRange addElements(size_t n) {
+    uassert(n <= (size_t)(std::numeric_limits<int>::max() - numElements))
+        << "Cannot add " << n << " elements to a set of " << numElements;
+    if (numElements + (int)n > capacity) {
+      growCapacity(numElements + n);
+    }
+    if (packed) {
+      unpackFields();
+    }
+    ElementRange elements(this, numElements, n);
+    numElements += n;
+    logTopologyChange();
+    return elements;
+  }
 
   /// helpers for constructing endpoint sets
   template <typename F, typename ...T> std::vector<const Set*>
@@ -651,11 +939,6 @@ private:
   std::vector<const Set*>
   epsMaker(std::vector<const Set*> sofar) {return sofar;}
 
-  void increaseEdgeCapacity() {
-    size_t newSize = (capacity+capacityIncrement)*getCardinality()*sizeof(int);
-    endpoints = (int*)realloc(endpoints, newSize);
-  }
-
   // helper for adding edges
   template <typename F, typename ...T>
   void addEndpoints(int which, F f, T ... eps) {
@@ -701,7 +984,7 @@ private:
       FieldData::TensorType *type =
           new FieldData::TensorType(ctype, dims);
       FieldData *fieldData = new FieldData(field.name, type, this);
-      fieldData->data = calloc(capacity, fieldData->sizeOfType);
+      allocateField(fieldData);
       fields.push_back(fieldData);
       fieldNames[field.name] = fields.size()-1;
     }
@@ -715,9 +998,9 @@ private:
       os << it->ident;
       if (getCardinality() > 0) {
         os << ":(";
-        os << endpoints[0];
+        os << getEndpoint(*it, 0);
         for (int i=1; i<getCardinality(); ++i) {
-          os << "," << endpoints[i];
+          os << "," << getEndpoint(*it, i);
         }
         os << ")";
       }
@@ -727,9 +1010,9 @@ private:
       os << ", " << it->ident;
       if (getCardinality() > 0) {
         os << ":(";
-        os << endpoints[it->ident*getCardinality() + 0];
+        os << getEndpoint(*it, 0);
         for (int i=1; i<getCardinality(); ++i) {
-          os << "," << endpoints[it->ident*getCardinality() + i];
+          os << "," << getEndpoint(*it, i);
         }
         os << ")";
       }
@@ -785,13 +1068,19 @@ public:
     return *this;
   }
 
-  // Return the field's data.  The data is a contigues sequence containing the
-  // tensor of each element in no particular order.  The tensors are currently
-  // laid out in row-major order, but this may change in the future.
+  // Return the field's data.  The data contains the tensor of each element in
+  // no particular order, laid out as the field's layout (by default AoS, with
+  // the tensors in row-major order). The field is assumed to be written.
   inline void *getData() {
+    fieldData->markWritten();
     return static_cast<void*>(data);
   }
 
+  /// The layout of the field's data.
+  const FieldLayout& getLayout() const {
+    return fieldData->layout;
+  }
+
 protected:
   FieldRefBase(void *fieldData)
       : fieldData(static_cast<Set::FieldData*>(fieldData)),
@@ -802,7 +1091,14 @@ protected:
   template <typename T>
   inline T *getElemDataPtr(ElementRef element, size_t elementFieldSize) const {
     iassert(sizeof(T) == componentSize(fieldData->type->getComponentType()));
-    return &static_cast<T*>(data)[element.ident * elementFieldSize];
+    const FieldLayout& layout = fieldData->layout;
+    return &static_cast<T*>(data)[layout.getElementOffset(element.ident,
+                                                          elementFieldSize)];
+  }
+
+  /// The distance between the components of an element.
+  inline size_t getComponentStride() const {
+    return fieldData->layout.getComponentStride(fieldData->stride);
   }
 
   Set::FieldData *fieldData;
@@ -816,12 +1112,18 @@ private:
 template <typename T, int... dimensions>
 class FieldRefBaseParameterized : public FieldRefBase {
  public:
+  /// Get a reference to an element's tensor. Since it can be written through
+  /// the reference, the field is marked written (use a const FieldRef to read
+  /// a field without doing so).
   TensorRef<T, dimensions...> get(ElementRef element) {
-    return TensorRef<T, dimensions...>(getElemDataPtr(element));
+    this->fieldData->markWritten();
+    return TensorRef<T, dimensions...>(getElemDataPtr(element),
+                                       this->getComponentStride());
   }
 
   const TensorRef<T, dimensions...> get(ElementRef element) const {
-    return TensorRef<T, dimensions...>(getElemDataPtr(element));
+    return TensorRef<T, dimensions...>(getElemDataPtr(element),
+                                       this->getComponentStride());
   }
 
   TensorRef<T, dimensions...> operator()(ElementRef element) {
@@ -835,10 +1137,12 @@ class FieldRefBaseParameterized : public FieldRefBase {
   void set(ElementRef element, std::initializer_list<T> values) {
     iassert(values.size() == (TensorRef<T,dimensions...>::getSize()))
         << "Incorrect number of init values";
+    this->fieldData->markWritten();
     T *elemData = this->getElemDataPtr(element);
+    size_t stride = this->getComponentStride();
     size_t i=0;
     for (T val : values) {
-      elemData[i++] = val;
+      elemData[stride * i++] = val;
     }
   }
 
@@ -847,10 +1151,12 @@ class FieldRefBaseParameterized : public FieldRefBase {
     iassert(values.size() == (TensorRef<T,dimensions...>::getSize()))
         << "Incorrect number of init values : " << 
         (TensorRef<T,dimensions...>::getSize());
+    this->fieldData->markWritten();
     T *elemData = this->getElemDataPtr(element);
+    size_t stride = this->getComponentStride();
     size_t i=0;
     for (T val : values) {
-      elemData[i++] = val;
+      elemData[stride * i++] = val;
     }
   }
 
@@ -894,6 +1200,7 @@ template <typename T>
 class FieldRef<T> : public FieldRefBaseParameterized<T> {
  public:
   void set(ElementRef element, T val) {
+    this->fieldData->markWritten();
     (*this->getElemDataPtr(element)) = val;
   }
 
@@ -947,7 +1254,7 @@ public:
     iassert(vals.size() == util::product<Dimensions...>::value);
     size_t i=0;
     for (ComponentType val : vals) {
-      data[i++] = val;
+      data[stride * i++] = val;
     }
     return *this;
   }
@@ -956,14 +1263,16 @@ public:
   inline ComponentType& operator()(Indices... index) {
     static_assert(sizeof...(index) == sizeof...(Dimensions),
                   "Incorrect number of indices used to index tensor");
-    return data[util::computeOffset(util::seq<Dimensions...>(), index...)];
+    return data[stride *
+                util::computeOffset(util::seq<Dimensions...>(), index...)];
   }
 
   template <typename... Indices> inline
   const ComponentType& operator()(Indices... index) const {
     static_assert(sizeof...(index) == sizeof...(Dimensions),
                   "Incorrect number of indices used to index tensor");
-    return data[util::computeOffset(util::seq<Dimensions...>(), index...)];
+    return data[stride *
+                util::computeOffset(util::seq<Dimensions...>(), index...)];
   }
 
   friend bool operator==(const TensorRef& l, const TensorRef& r){
@@ -975,8 +1284,10 @@ public:
   }
 
 private:
-  inline TensorRef(ComponentType *data) : data(data) {}
+  inline TensorRef(ComponentType *data, size_t stride)
+      : data(data), stride(stride) {}
   ComponentType *data;
+  size_t stride;  // distance between the components
 
   friend class FieldRefBaseParameterized<ComponentType, Dimensions...>;
 };
@@ -1013,7 +1324,7 @@ public:
   }
 
 private:
-  inline TensorRef(ComponentType *data) : data(data) {}
+  inline TensorRef(ComponentType *data, size_t) : data(data) {}
   ComponentType* data;
 
   friend class FieldRefBaseParameterized<ComponentType>;
@@ -1073,21 +1384,24 @@ std::ostream &operator<<(std::ostream &os, const TensorRef<T, size> &t) {
 // Graph generators
 void createElements(Set *elements, unsigned num);
 
+/// A grid of vertices, numbered with z fastest, connected by edges between
+/// the axis neighbors.
 class Box {
 public:
-  typedef std::pair<ElementRef,ElementRef> Coord;
-
   Box(unsigned nX, unsigned nY, unsigned nZ, std::vector<ElementRef> refs,
-      std::map<Box::Coord, ElementRef> coords2edges);
+      std::vector<ElementRef> edgesX, std::vector<ElementRef> edgesY,
+      std::vector<ElementRef> edgesZ);
 
   unsigned numX() const {return nX;}
   unsigned numY() const {return nY;}
   unsigned numZ() const {return nZ;}
 
   ElementRef operator()(unsigned x, unsigned y, unsigned z) {
-    return refs[z*nY*nX + y*nX + x];
+    return refs[(x*nY + y)*nZ + z];
   }
 
+  /// The edge from p1 to its neighbor p2 along an axis, or an undefined
+  /// ElementRef if there is none.
   ElementRef getEdge(ElementRef p1, ElementRef p2) const;
 
   std::vector<ElementRef> getEdges();
@@ -1095,12 +1409,94 @@ public:
 private:
   unsigned nX, nY, nZ;
   std::vector<ElementRef> refs;
-  std::map<Coord, ElementRef> coords2edges;
+  /// The edge from each vertex to its neighbor along each axis
+  std::vector<ElementRef> edgesX, edgesY, edgesZ;
 };
 
 Box createBox(Set *vertices, Set *edges,
               unsigned numX, unsigned numY, unsigned numZ);
 
+/// Add a numX x numY x numZ grid of vertices, and split every grid cell into
+/// six positively oriented tetrahedra around its main diagonal, so that the
+/// tetrahedra of neighboring cells share faces. Returns the vertices, numbered
+/// with z fastest like Box.
+std::vector<ElementRef> createTetGrid(Set *vertices, Set *tets,
+                                      unsigned numX, unsigned numY,
+                                      unsigned numZ);
+
+/// Add a numX x numY x numZ grid of vertices connected by springs along the
+/// edges of createTetGrid's tetrahedra: axis, face-diagonal and cell-diagonal
+/// springs. Returns the vertices, numbered with z fastest.
+std::vector<ElementRef> createSpringNetwork(Set *points, Set *springs,
+                                            unsigned numX, unsigned numY,
+                                            unsigned numZ);
+
+/// Add 2^scale vertices and numEdges directed edges drawn with the R-MAT
+/// recursive matrix model, where each edge falls in the top-left, top-right
+/// and bottom-left quadrant of the adjacency matrix with probabilities a, b
+/// and c. The result has the skewed degree distribution of a Kronecker graph.
+/// Vertex numbers are permuted so that the high-degree vertices are spread
+/// out, and self-loops are redrawn. Probabilities that only or almost only
+/// draw self-loops (b+c near 0) are rejected. Returns the vertices.
+std::vector<ElementRef> createRMATGraph(Set *vertices, Set *edges,
+                                        unsigned scale, size_t numEdges,
+                                        double a=0.57, double b=0.19,
+                                        double c=0.19, unsigned seed=0);
+
+namespace internal {
+/// A uniformly distributed double in [0,1) drawn from rng, which unlike the
+/// standard distributions gives the same sequence with every standard library.
+template <typename RNG>
+double uniformDouble(RNG& rng) {
+  return (rng() & 0xFFFFFFFFu) * (1.0 / 4294967296.0);
+}
+
+/// A uniformly distributed integer in [0,bound), for bound in [1,2^32], drawn
+/// from rng like uniformDouble. Uses Lemire's multiply-shift, and redraws the
+/// few numbers that would make the result biased.
+template <typename RNG>
+uint64_t uniformIndex(RNG& rng, uint64_t bound) {
+  uint64_t product = (rng() & 0xFFFFFFFFu) * bound;
+  if ((product & 0xFFFFFFFFu) < bound) {
+    const uint64_t threshold = (((uint64_t)1 << 32) - bound) % bound;
+    while ((product & 0xFFFFFFFFu) < threshold) {
+      product = (rng() & 0xFFFFFFFFu) * bound;
+    }
+  }
+  return product >> 32;
+}
+}
+
+/// Store the grid coordinates of the vertices of createTetGrid,
+/// createSpringNetwork or createBox in positions, spaced spacing apart and
+/// each coordinate moved by a random offset of up to perturbation times the
+/// spacing. The offsets only depend on the seed.
+template <typename T>
+void setGridPositions(const std::vector<ElementRef>& vertices,
+                      unsigned numX, unsigned numY, unsigned numZ,
+                      FieldRef<T,3> positions, double spacing=1.0,
+                      double perturbation=0.0, unsigned seed=0) {
+  uassert(vertices.size() == (size_t)numX*numY*numZ)
+      << "Wrong number of grid vertices";
+  std::mt19937 rng(seed);
+  auto coordinate = [&](unsigned i) {
+    double offset = (perturbation == 0.0)
+        ? 0.0 : (2.0*internal::uniformDouble(rng) - 1.0) * perturbation;
+    return (T)((i + offset) * spacing);
+  };
+  size_t i = 0;
+  for (unsigned x = 0; x < numX; ++x) {
+    for (unsigned y = 0; y < numY; ++y) {
+      for (unsigned z = 0; z < numZ; ++z) {
+        T px = coordinate(x);
+        T py = coordinate(y);
+        T pz = coordinate(z);
+        positions.set(vertices[i++], {px, py, pz});
+      }
+    }
+  }
+}
+
 } // namespace simit
 
 #endif
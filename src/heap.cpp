@@ -0,0 +1,216 @@
+#include "heap.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "error.h"
+#include "init.h"
+#include "placement.h"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+// Each allocation is prefixed by a header holding its size. The header is
+// padded to 16 bytes, so the memory after it keeps malloc's alignment for
+// tensor components and vector loads.
+struct alignas(16) AllocationHeader {
+  size_t size;
+};
+
+// The size of the huge pages that back large buffers (see allocateAligned)
+static const size_t kHugePageSize = 2 << 20;
+
+#ifdef __linux__
+// The mappings from the huge page pool, that are released with munmap
+static mutex hugetlbMutex;
+static map<void*,size_t> hugetlbMappings;
+static atomic<size_t> numHugetlbMappings(0);
+
+static size_t roundUp(size_t size, size_t multiple) {
+  return (size + multiple-1) / multiple * multiple;
+}
+#endif
+
+bool usesHugePages(size_t size) {
+  return size >= (size_t)kHugePageThreshold && kHugePages != "none";
+}
+
+void* allocateAligned(size_t size, size_t alignment) {
+  size = max(size, (size_t)1);
+#ifdef __linux__
+  if (usesHugePages(size)) {
+    if (kHugePages == "hugetlbfs") {
+      size_t mappedSize = roundUp(size, kHugePageSize);
+      void* data = mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+      if (data != MAP_FAILED) {
+        lock_guard<mutex> lock(hugetlbMutex);
+        hugetlbMappings[data] = mappedSize;
+        ++numHugetlbMappings;
+        return data;
+      }
+      // The pool has too few free huge pages, so use transparent ones
+    }
+    alignment = max(alignment, kHugePageSize);
+  }
+#endif
+
+  void* data = nullptr;
+  if (posix_memalign(&data, alignment, size) != 0) {
+    return nullptr;
+  }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+  if (usesHugePages(size)) {
+    // The kernel backs the whole 2 MB ranges of the buffer by huge pages
+    madvise(data, roundUp(size, sysconf(_SC_PAGESIZE)), MADV_HUGEPAGE);
+  }
+#endif
+  return data;
+}
+
+void freeAligned(void* ptr) {
+#ifdef __linux__
+  if (numHugetlbMappings.load() > 0) {
+    lock_guard<mutex> lock(hugetlbMutex);
+    auto mapping = hugetlbMappings.find(ptr);
+    if (mapping != hugetlbMappings.end()) {
+      munmap(mapping->first, mapping->second);
+      hugetlbMappings.erase(mapping);
+      --numHugetlbMappings;
+      return;
+    }
+  }
+#endif
+  free(ptr);
+}
+
+size_t HugePageMap::getBytes(const void* data, size_t size) const {
+  size_t bytes = 0;
+#ifdef __linux__
+  if (data == nullptr || size < kHugePageSize) {
+    return 0;
+  }
+  if (!read) {
+    read = true;
+    ifstream smaps("/proc/self/smaps");
+    string line;
+    while (getline(smaps, line)) {
+      uintptr_t mappingBegin, mappingEnd;
+      size_t kilobytes;
+      char field[32];
+      if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR " ",
+                 &mappingBegin, &mappingEnd) == 2) {
+        mappings.push_back({mappingBegin, mappingEnd, 0});
+      }
+      else if (!mappings.empty() &&
+               sscanf(line.c_str(), "%31[^:]: %zu kB", field, &kilobytes) == 2 &&
+               (string(field) == "AnonHugePages" ||
+                string(field) == "Private_Hugetlb" ||
+                string(field) == "Shared_Hugetlb")) {
+        mappings.back().hugePageBytes += kilobytes*1024;
+      }
+    }
+  }
+
+  // Sum the huge pages of the mappings the buffer overlaps, up to the bytes
+  // of the buffer in each mapping
+  const uintptr_t begin = (uintptr_t)data;
+  const uintptr_t end = begin + size;
+  for (const Mapping& mapping : mappings) {
+    if (mapping.begin < end && begin < mapping.end) {
+      size_t overlap = min(end, mapping.end) - max(begin, mapping.begin);
+      bytes += min(mapping.hugePageBytes, overlap);
+    }
+  }
+#endif
+  return bytes;
+}
+
+static atomic<size_t> currentBytes(0);
+static atomic<size_t> peakBytes(0);
+
+static void* track(AllocationHeader* header, size_t size) {
+  if (header == nullptr) {
+    return nullptr;
+  }
+  header->size = size;
+  size_t bytes = currentBytes.fetch_add(size) + size;
+  size_t peak = peakBytes.load();
+  while (bytes > peak && !peakBytes.compare_exchange_weak(peak, bytes)) {}
+  return header + 1;
+}
+
+// Large buffers come from allocateAligned, to back them by huge pages. Placed
+// buffers are zeroed when they are allocated, to place their pages on NUMA
+// nodes before the thread that first uses them touches them all.
+static AllocationHeader* allocateLarge(size_t bytes, bool zeroed) {
+  AllocationHeader* header =
+      (AllocationHeader*)allocateAligned(bytes, alignof(AllocationHeader));
+  if (header != nullptr && (zeroed || isPlaced(bytes))) {
+    placeZeroed(header, bytes);
+  }
+  return header;
+}
+
+void* heapAllocate(size_t size) {
+  const size_t bytes = sizeof(AllocationHeader) + size;
+  if (isPlaced(bytes) || usesHugePages(bytes)) {
+    return track(allocateLarge(bytes, false), size);
+  }
+  return track((AllocationHeader*)malloc(bytes), size);
+}
+
+void* heapAllocateZeroed(size_t size) {
+  const size_t bytes = sizeof(AllocationHeader) + size;
+  if (isPlaced(bytes) || usesHugePages(bytes)) {
+    return track(allocateLarge(bytes, true), size);
+  }
+  return track((AllocationHeader*)calloc(1, bytes), size);
+}
+
+void heapFree(void* ptr) {
+  if (ptr == nullptr) {
+    return;
+  }
+  AllocationHeader* header = (AllocationHeader*)ptr - 1;
+  iassert(currentBytes.load() >= header->size)
+      << "Freeing memory that was not allocated with heapAllocate";
+  currentBytes.fetch_sub(header->size);
+  freeAligned(header);
+}
+
+size_t heapAllocationSize(const void* ptr) {
+  if (ptr == nullptr) {
+    return 0;
+  }
+  return ((const AllocationHeader*)ptr - 1)->size;
+}
+
+size_t heapBytes() {
+  return currentBytes.load();
+}
+
+size_t heapPeakBytes() {
+  return peakBytes.load();
+}
+
+void resetHeapPeak() {
+  peakBytes.store(currentBytes.load());
+}
+
+}}
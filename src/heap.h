@@ -0,0 +1,71 @@
+#ifndef SIMIT_HEAP_H
+#define SIMIT_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace simit {
+namespace internal {
+
+/// Allocate memory for the state of compiled functions: temporaries, tensors
+/// allocated by generated init functions and path indices. The bytes
+/// allocated through these functions are counted, so that
+/// Function::memoryReport can report them and their peak. Large buffers are
+/// placed on NUMA nodes by Settings::memoryPlacement (see placeZeroed), and
+/// backed by huge pages (see allocateAligned).
+void* heapAllocate(size_t size);
+
+/// Allocate zero-initialized memory, like heapAllocate.
+void* heapAllocateZeroed(size_t size);
+
+/// Free memory allocated with heapAllocate or heapAllocateZeroed.
+void heapFree(void* ptr);
+
+/// Allocate size bytes aligned to alignment (a power of two), to be released
+/// with freeAligned. Buffers of at least Settings::hugePageThreshold bytes are
+/// aligned to 2 MB and backed by huge pages, as Settings::hugePages selects.
+/// Unlike heapAllocate, the bytes are not counted and not zeroed. Returns null
+/// if the memory could not be allocated.
+void* allocateAligned(size_t size, size_t alignment);
+
+/// Free memory allocated with allocateAligned.
+void freeAligned(void* ptr);
+
+/// True if buffers of size bytes are backed by huge pages.
+bool usesHugePages(size_t size);
+
+/// The huge pages of the mappings of the process, as reported by the kernel
+/// in /proc/self/smaps. The file is read once, when the first large buffer is
+/// looked up, so a memory report attributes the huge pages of all its
+/// buffers from a single pass.
+class HugePageMap {
+public:
+  /// The bytes of a buffer that are backed by huge pages, or 0 if unknown.
+  size_t getBytes(const void* data, size_t size) const;
+
+private:
+  struct Mapping {
+    uintptr_t begin;
+    uintptr_t end;
+    size_t hugePageBytes;
+  };
+  mutable std::vector<Mapping> mappings;
+  mutable bool read = false;
+};
+
+/// The size requested when ptr was allocated, or 0 if ptr is null.
+size_t heapAllocationSize(const void* ptr);
+
+/// Bytes currently allocated through heapAllocate.
+size_t heapBytes();
+
+/// Most bytes allocated through heapAllocate at any time since the last call
+/// to resetHeapPeak.
+size_t heapPeakBytes();
+
+/// Reset the peak to the bytes currently allocated.
+void resetHeapPeak();
+
+}}
+#endif
@@ -2,4 +2,20 @@
 
 namespace simit {
 bool kIndexlessStencils;
+std::string kTargetCPU = "native";
+std::string kTargetFeatures;
+#ifdef SIMIT_DEBUG
+int kOptLevel = 0;
+#else
+int kOptLevel = 3;
+#endif
+bool kFastMath = false;
+bool kFPContract = true;
+std::string kMathAccuracy = "precise";
+bool kSpecialize = false;
+int kFieldAlignment = 64;
+std::string kMemoryPlacement = "default";
+int kPlacementThreads = 0;
+std::string kHugePages = "transparent";
+int kHugePageThreshold = 4 << 20;
 }
@@ -13,12 +13,67 @@ namespace simit {
 extern const std::vector<std::string> VALID_BACKENDS;
 extern std::string kBackend;
 extern bool kIndexlessStencils;
+extern std::string kTargetCPU;
+extern std::string kTargetFeatures;
+extern int kOptLevel;
+extern bool kFastMath;
+extern bool kFPContract;
+extern std::string kMathAccuracy;
+extern bool kSpecialize;
+extern int kFieldAlignment;
+extern std::string kMemoryPlacement;
+extern int kPlacementThreads;
+extern std::string kHugePages;
+extern int kHugePageThreshold;
 
 // Settings struct with default values
 struct Settings {
   std::string backend="cpu";
   int floatSize = 8;
   bool indexlessStencils = false;
+
+  /// CPU to generate code for. "native" selects the host CPU and its features.
+  std::string targetCPU = "native";
+  /// Comma-separated target features added on top of the CPU's, e.g. "+avx2".
+  std::string targetFeatures = "";
+  /// Optimization level (0-3) of the LLVM pass pipeline and code generator.
+#ifdef SIMIT_DEBUG
+  int optLevel = 0;
+#else
+  int optLevel = 3;
+#endif
+  /// Allow floating-point optimizations that ignore IEEE semantics.
+  bool fastMath = false;
+  /// Allow fusing floating-point multiplies and adds into FMA instructions.
+  bool fpContract = true;
+  /// Transcendental functions: "precise" calls libm, "fast" uses the
+  /// vectorizable approximations in runtime_math.h.
+  std::string mathAccuracy = "precise";
+  /// Recompile functions at init with the sizes of the sets bound to them
+  /// substituted as constants. One version is cached per set-size signature.
+  bool specialize = false;
+  /// Alignment in bytes of the field and endpoint arrays of sets created after
+  /// init: a power of two of at least 8. Generated code assumes the fields of
+  /// the sets bound to it are aligned.
+  int fieldAlignment = 64;
+  /// How the pages of large set and function buffers are placed on NUMA
+  /// nodes: "default" leaves them on the node of the allocating thread,
+  /// "firsttouch" zeroes them in parallel, spreading each buffer over the
+  /// nodes in contiguous blocks like a statically scheduled parallel loop,
+  /// and "interleave" spreads them round-robin over the nodes. Memory reports
+  /// show the nodes the pages ended up on.
+  std::string memoryPlacement = "default";
+  /// Threads that zero buffers with "firsttouch", or 0 for one per CPU.
+  int placementThreads = 0;
+  /// How buffers of at least hugePageThreshold bytes (set fields, endpoints
+  /// and function state) are backed by 2 MB huge pages, which reduces the TLB
+  /// misses of indirect accesses: "none"; "transparent" aligns them to huge
+  /// pages and asks the kernel to back them with transparent huge pages; and
+  /// "hugetlbfs" maps them from the reserved huge page pool, and falls back
+  /// to "transparent" when the pool runs out. Memory reports show the bytes
+  /// backed by huge pages.
+  std::string hugePages = "transparent";
+  int hugePageThreshold = 4 << 20;
 };
 
 inline void init(const Settings& settings) {
@@ -36,6 +91,60 @@ inline void init(const Settings& settings) {
 
   // indexlessStencils
   kIndexlessStencils = settings.indexlessStencils;
+
+  // code generation
+  uassert(settings.optLevel >= 0 && settings.optLevel <= 3)
+      << "Invalid optimization level: " << settings.optLevel;
+  kTargetCPU = settings.targetCPU;
+  kTargetFeatures = settings.targetFeatures;
+  kOptLevel = settings.optLevel;
+  kFastMath = settings.fastMath;
+  kFPContract = settings.fpContract;
+  uassert(settings.mathAccuracy == "precise" || settings.mathAccuracy == "fast")
+      << "Invalid math accuracy: " << settings.mathAccuracy;
+  kMathAccuracy = settings.mathAccuracy;
+  kSpecialize = settings.specialize;
+  uassert(settings.fieldAlignment >= 8 &&
+          (settings.fieldAlignment & (settings.fieldAlignment-1)) == 0)
+      << "Invalid field alignment: " << settings.fieldAlignment;
+  kFieldAlignment = settings.fieldAlignment;
+  uassert(settings.memoryPlacement == "default" ||
+          settings.memoryPlacement == "firsttouch" ||
+          settings.memoryPlacement == "interleave")
+      << "Invalid memory placement: " << settings.memoryPlacement;
+  kMemoryPlacement = settings.memoryPlacement;
+  uassert(settings.placementThreads >= 0)
+      << "Invalid placement threads: " << settings.placementThreads;
+  kPlacementThreads = settings.placementThreads;
+  uassert(settings.hugePages == "none" ||
+          settings.hugePages == "transparent" ||
+          settings.hugePages == "hugetlbfs")
+      << "Invalid huge pages: " << settings.hugePages;
+  uassert(settings.hugePageThreshold > 0)
+      << "Invalid huge page threshold: " << settings.hugePageThreshold;
+  kHugePages = settings.hugePages;
+  kHugePageThreshold = settings.hugePageThreshold;
+}
+
+/// The settings of the last init.
+inline Settings getSettings() {
+  Settings settings;
+  settings.backend = kBackend;
+  settings.floatSize = ir::ScalarType::floatBytes;
+  settings.indexlessStencils = kIndexlessStencils;
+  settings.targetCPU = kTargetCPU;
+  settings.targetFeatures = kTargetFeatures;
+  settings.optLevel = kOptLevel;
+  settings.fastMath = kFastMath;
+  settings.fpContract = kFPContract;
+  settings.mathAccuracy = kMathAccuracy;
+  settings.specialize = kSpecialize;
+  settings.fieldAlignment = kFieldAlignment;
+  settings.memoryPlacement = kMemoryPlacement;
+  settings.placementThreads = kPlacementThreads;
+  settings.hugePages = kHugePages;
+  settings.hugePageThreshold = kHugePageThreshold;
+  return settings;
 }
 
 inline void init(std::string backend="cpu", int floatSize=8) {
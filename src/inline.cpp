@@ -164,10 +164,15 @@ void MapFunctionRewriter::visit(const TupleRead *op) {
     const TupleType *tupleType = op->tuple.type().toTuple();
     int cardinality = tupleType->size;
 
-    Expr endpoints = IndexRead::make(targetSet, IndexRead::Endpoints);
-    Expr indexExpr = Add::make(Mul::make(targetLoopVar, cardinality),
-                               op->index);
-    expr = Load::make(endpoints, indexExpr);
+    if (targetSet.type().isLatticeLinkSet()) {
+      expr = getLatticeLinkEndpoint(targetLoopVar, op->index, targetSet);
+    }
+    else {
+      Expr endpoints = IndexRead::make(targetSet, IndexRead::Endpoints);
+      Expr indexExpr = Add::make(Mul::make(targetLoopVar, cardinality),
+                                 op->index);
+      expr = Load::make(endpoints, indexExpr);
+    }
   }
   else {
     ierror << "Assumes tuples are only used for neighbor lists";
@@ -274,9 +279,15 @@ static Stmt gatherEps(Expr target, int cardinality, Var lv, Var* eps) {
   Type type      = TensorType::make(ScalarType::Int,{IndexDomain(cardinality)});
   *eps           = Var(INTERNAL_PREFIX("eps"), type);
   Stmt epsDelc   = VarDecl::make(*eps);
-  Expr epsRead   = IndexRead::make(target, IndexRead::Endpoints);
-  Expr epLoc     = Add::make(Mul::make(lv, cardinality), i);
-  Expr ep        = Load::make(epsRead, epLoc);
+  Expr ep;
+  if (target.type().isLatticeLinkSet()) {
+    ep = getLatticeLinkEndpoint(lv, i, target);
+  }
+  else {
+    Expr epsRead = IndexRead::make(target, IndexRead::Endpoints);
+    Expr epLoc   = Add::make(Mul::make(lv, cardinality), i);
+    ep           = Load::make(epsRead, epLoc);
+  }
   Stmt gatherEp  = TensorWrite::make(*eps, {i}, ep);
   Stmt loop      = ForRange::make(i, 0, cardinality, gatherEp);
   Stmt gatherEps = Block::make(epsDelc, loop);
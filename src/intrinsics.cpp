@@ -445,6 +445,62 @@ const Func& storeTime() {
   return storeTimeVar;
 }
 
+static Func startCountersVar;
+void startCountersInit() {
+  startCountersVar = Func("startCounters",
+                          {Var("i", Int)},
+                          {},
+                          Func::Intrinsic);
+}
+const Func& startCounters() {
+  if (!startCountersVar.defined()) {
+    startCountersInit();
+  }
+  return startCountersVar;
+}
+
+static Func storeCountersVar;
+void storeCountersInit() {
+  storeCountersVar = Func("storeCounters",
+                          {Var("i", Int)},
+                          {},
+                          Func::Intrinsic);
+}
+const Func& storeCounters() {
+  if (!storeCountersVar.defined()) {
+    storeCountersInit();
+  }
+  return storeCountersVar;
+}
+
+static Func profileBeginVar;
+void profileBeginInit() {
+  profileBeginVar = Func("profileBegin",
+                         {Var("id", Int)},
+                         {},
+                         Func::Intrinsic);
+}
+const Func& profileBegin() {
+  if (!profileBeginVar.defined()) {
+    profileBeginInit();
+  }
+  return profileBeginVar;
+}
+
+static Func profileEndVar;
+void profileEndInit() {
+  profileEndVar = Func("profileEnd",
+                       {Var("id", Int)},
+                       {},
+                       Func::Intrinsic);
+}
+const Func& profileEnd() {
+  if (!profileEndVar.defined()) {
+    profileEndInit();
+  }
+  return profileEndVar;
+}
+
 static Func mallocVar;
 void mallocInit() {
   mallocVar = Func("malloc",
@@ -522,6 +578,10 @@ const std::map<std::string,Func> &byNames() {
     strcatInit();
     clockInit();
     storeTimeInit();
+    startCountersInit();
+    storeCountersInit();
+    profileBeginInit();
+    profileEndInit();
     mallocInit();
     freeInit();
     locInit();
@@ -556,6 +616,10 @@ const std::map<std::string,Func> &byNames() {
                       {"strcat", strcatVar},
                       {"clock",clockVar},
                       {"storeTime",storeTimeVar},
+                      {"startCounters",startCountersVar},
+                      {"storeCounters",storeCountersVar},
+                      {"profileBegin",profileBeginVar},
+                      {"profileEnd",profileEndVar},
                       {"malloc", mallocVar},
                       {"free", freeVar},
                       {"__loc", locVar}});
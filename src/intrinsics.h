@@ -57,6 +57,14 @@ const Func& strcat();
 const Func& clock();
 const Func& storeTime();
 
+// Hardware counters of timed statements (see perf_counters.h)
+const Func& startCounters();
+const Func& storeCounters();
+
+// Profiling (see profiler.h)
+const Func& profileBegin();
+const Func& profileEnd();
+
 // Internal functions
 const Func& malloc();
 const Func& free();
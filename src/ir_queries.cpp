@@ -172,6 +172,55 @@ size_t countIndexVars(Expr expr) {
   return CountIndexVarsVisitor().count(expr);
 }
 
+size_t countNodes(Func func) {
+  class CountNodesVisitor : public IRVisitorCallGraph {
+  public:
+    size_t nodes = 0;
+
+    using IRVisitorCallGraph::visit;
+
+#define COUNT_NODE(Node, Base)                                                 \
+    void visit(const Node *op) {                                               \
+      ++nodes;                                                                 \
+      Base::visit(op);                                                         \
+    }
+    COUNT_NODE(Literal, IRVisitor)
+    COUNT_NODE(VarExpr, IRVisitor)
+    COUNT_NODE(Load, IRVisitor)
+    COUNT_NODE(FieldRead, IRVisitor)
+    COUNT_NODE(Length, IRVisitor)
+    COUNT_NODE(IndexRead, IRVisitor)
+    COUNT_NODE(UnaryExpr, IRVisitor)
+    COUNT_NODE(BinaryExpr, IRVisitor)
+    COUNT_NODE(VarDecl, IRVisitor)
+    COUNT_NODE(AssignStmt, IRVisitor)
+    COUNT_NODE(CallStmt, IRVisitorCallGraph)
+    COUNT_NODE(Store, IRVisitor)
+    COUNT_NODE(FieldWrite, IRVisitor)
+    COUNT_NODE(Scope, IRVisitor)
+    COUNT_NODE(IfThenElse, IRVisitor)
+    COUNT_NODE(ForRange, IRVisitor)
+    COUNT_NODE(For, IRVisitor)
+    COUNT_NODE(While, IRVisitor)
+    COUNT_NODE(Kernel, IRVisitor)
+    COUNT_NODE(Block, IRVisitor)
+    COUNT_NODE(Print, IRVisitor)
+    COUNT_NODE(Comment, IRVisitor)
+    COUNT_NODE(Pass, IRVisitor)
+    COUNT_NODE(TupleRead, IRVisitor)
+    COUNT_NODE(SetRead, IRVisitor)
+    COUNT_NODE(TensorRead, IRVisitor)
+    COUNT_NODE(TensorWrite, IRVisitor)
+    COUNT_NODE(IndexedTensor, IRVisitor)
+    COUNT_NODE(IndexExpr, IRVisitor)
+    COUNT_NODE(Map, IRVisitorCallGraph)
+#undef COUNT_NODE
+  };
+  CountNodesVisitor visitor;
+  func.accept(&visitor);
+  return visitor.nodes;
+}
+
 bool isFlattened(Stmt stmt) {
   return CheckIsFlattened().check(stmt);
 }
@@ -288,4 +337,87 @@ std::vector<Func> getCallTree(Func func) {
   return GetCallTree().get(func);
 }
 
+std::map<std::string,std::set<std::string>> getWrittenFields(Func func) {
+  class WrittenFieldsVisitor : public IRVisitor {
+  public:
+    map<string,set<string>> written;
+
+    using IRVisitor::visit;
+
+  private:
+    static bool isSetVar(Expr expr) {
+      return expr.defined() && isa<VarExpr>(expr) && expr.type().isSet();
+    }
+
+    void addField(Expr set, const string& field) {
+      if (isSetVar(set)) {
+        written[to<VarExpr>(set)->var.getName()].insert(field);
+      }
+    }
+
+    void addFields(Expr set) {
+      if (isSetVar(set)) {
+        const ElementType* elemType =
+            set.type().toSet()->elementType.toElement();
+        for (const Field& field : elemType->fields) {
+          addField(set, field.name);
+        }
+      }
+    }
+
+    void visit(const FieldRead *op) {
+      // The field's buffer escapes
+      addField(op->elementOrSet, op->fieldName);
+      IRVisitor::visit(op);
+    }
+
+    void visit(const FieldWrite *op) {
+      addField(op->elementOrSet, op->fieldName);
+      IRVisitor::visit(op);
+    }
+
+    void visit(const Load *op) {
+      if (isa<FieldRead>(op->buffer)) {
+        to<FieldRead>(op->buffer)->elementOrSet.accept(this);
+      }
+      else {
+        op->buffer.accept(this);
+      }
+      op->index.accept(this);
+    }
+
+    void visit(const Store *op) {
+      op->buffer.accept(this);
+      op->index.accept(this);
+      op->value.accept(this);
+    }
+
+    void visit(const CallStmt *op) {
+      for (const Expr& actual : op->actuals) {
+        addFields(actual);
+      }
+      IRVisitor::visit(op);
+    }
+
+    void visit(const Map *op) {
+      addFields(op->target);
+      addFields(op->neighbors);
+      addFields(op->through);
+      for (const Expr& actual : op->partial_actuals) {
+        addFields(actual);
+      }
+      IRVisitor::visit(op);
+    }
+  };
+
+  // Callees may write the fields of extern sets
+  WrittenFieldsVisitor visitor;
+  for (const Func& f : getCallTree(func)) {
+    if (f.getBody().defined()) {
+      f.getBody().accept(&visitor);
+    }
+  }
+  return visitor.written;
+}
+
 }}
@@ -1,6 +1,10 @@
 #ifndef SIMIT_EXPR_QUERIES_H
 #define SIMIT_EXPR_QUERIES_H
 
+#include <map>
+#include <set>
+#include <string>
+
 #include "ir.h"
 #include "indexvar.h"
 
@@ -20,6 +24,9 @@ bool containsIndexedTensor(Expr expr);
 
 size_t countIndexVars(Expr expr);
 
+/// Returns the number of IR nodes in `func` and the functions it calls.
+size_t countNodes(Func func);
+
 /// Returns true if the statement has been flattened (only contains one index
 /// expression), and false otherwise.
 bool isFlattened(Stmt stmt);
@@ -32,6 +39,11 @@ bool isBlocked(Stmt stmt);
 /// (transitively) called from `func`.
 std::vector<Func> getCallTree(Func func);
 
+/// Returns the fields of sets that `func` may write, by set name. Sets that are
+/// passed to calls or mapped over, and fields whose buffers are used other
+/// than to load from them, are conservatively assumed to be written.
+std::map<std::string,std::set<std::string>> getWrittenFields(Func func);
+
 }}
 
 #endif
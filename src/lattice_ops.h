@@ -144,6 +144,32 @@ inline vector<Expr> getLatticeLinkOffsetIndices(
   return indices;
 }
 
+/// Compute an endpoint of a linearized lattice link from its coordinates, so
+/// that the endpoints of lattice link sets need not be stored. Endpoint 0 of a
+/// link is the point at the link's coordinates, and endpoint 1 is the next
+/// point in the link's direction.
+inline Expr getLatticeLinkEndpoint(Expr link, Expr endpoint, Expr latticeSet) {
+  iassert(latticeSet.type().isLatticeLinkSet());
+
+  const LatticeLinkSetType *setType = latticeSet.type().toLatticeLinkSet();
+  int ndims = setType->dimensions;
+
+  vector<Expr> linkIndices = getLatticeLinkIndices(link, latticeSet);
+  Expr dir = linkIndices[0];
+  vector<Expr> base(linkIndices.begin()+1, linkIndices.end());
+
+  // Offset the dimension of the link's direction by the endpoint (0 or 1).
+  // For 0 <= k < ndims, (k + ndims-1) / ndims is 0 if k is 0 and 1 otherwise.
+  vector<Expr> offset;
+  for (int i = 0; i < ndims; ++i) {
+    Expr k = (dir - i + ndims) % ndims;
+    Expr isDir = 1 - (k + (ndims-1)) / ndims;
+    offset.push_back(isDir * endpoint);
+  }
+  return getLatticeCoord(getLatticeOffsetIndices(base, offset, latticeSet),
+                         latticeSet);
+}
+
 }} // namespace simit::ir
 
 #endif // SIMIT_LATTICE_OPS
@@ -0,0 +1,441 @@
+#include "loop_traffic.h"
+
+#include <set>
+
+#include "ir.h"
+#include "ir_visitor.h"
+#include "ir_queries.h"
+#include "intrinsics.h"
+#include "tensor_index.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+// struct Traffic
+Traffic& Traffic::operator+=(const Traffic& other) {
+  loadedBytes += other.loadedBytes;
+  storedBytes += other.storedBytes;
+  flops += other.flops;
+  return *this;
+}
+
+// class TripCount
+TripCount TripCount::size(const string& name) {
+  TripCount trips(1.0);
+  trips.sizes[name] = 1;
+  return trips;
+}
+
+TripCount TripCount::operator*(const TripCount& other) const {
+  if (!known || !other.known) {
+    return TripCount();
+  }
+  TripCount result(constant * other.constant);
+  result.sizes = sizes;
+  for (auto& size : other.sizes) {
+    result.sizes[size.first] += size.second;
+    if (result.sizes[size.first] == 0) {
+      result.sizes.erase(size.first);
+    }
+  }
+  return result;
+}
+
+TripCount TripCount::operator/(const TripCount& other) const {
+  if (!other.known || other.constant == 0.0) {
+    return TripCount();
+  }
+  TripCount inverse(1.0 / other.constant);
+  for (auto& size : other.sizes) {
+    inverse.sizes[size.first] = -size.second;
+  }
+  return *this * inverse;
+}
+
+double TripCount::evaluate(const map<string,size_t>& sizes) const {
+  if (!known) {
+    return -1.0;
+  }
+  double result = constant;
+  for (auto& size : this->sizes) {
+    auto it = sizes.find(size.first);
+    if (it == sizes.end()) {
+      return -1.0;
+    }
+    for (int i = 0; i < size.second; ++i) {
+      result *= it->second;
+    }
+    for (int i = 0; i > size.second; --i) {
+      result = (it->second > 0) ? result / it->second : 0.0;
+    }
+  }
+  return result;
+}
+
+ostream& operator<<(ostream& os, const TripCount& trips) {
+  if (!trips.known) {
+    return os << "?";
+  }
+  bool first = true;
+  if (trips.constant != 1.0 || trips.sizes.empty()) {
+    os << trips.constant;
+    first = false;
+  }
+  for (auto& size : trips.sizes) {
+    if (size.second > 0) {
+      for (int i = 0; i < size.second; ++i) {
+        os << (first ? "" : "*") << size.first;
+        first = false;
+      }
+    }
+  }
+  if (first) {
+    os << "1";
+  }
+  for (auto& size : trips.sizes) {
+    for (int i = 0; i > size.second; --i) {
+      os << "/" << size.first;
+    }
+  }
+  return os;
+}
+
+// analyzeLoopTraffic
+static string firstLine(const Stmt& stmt) {
+  string line = util::toString(stmt);
+  return util::trim(line.substr(0, line.find('\n')));
+}
+
+static unsigned componentBytes(const Type& type) {
+  return type.isTensor() ? type.toTensor()->getComponentType().bytes() : 0;
+}
+
+static bool isFloat(const Type& type) {
+  return type.isTensor() && type.toTensor()->getComponentType().isFloat();
+}
+
+static set<Var> getVars(const Expr& expr) {
+  class GetVars : public IRVisitor {
+  public:
+    set<Var> vars;
+    using IRVisitor::visit;
+    void visit(const VarExpr *op) {
+      vars.insert(op->var);
+    }
+  };
+  GetVars getVars;
+  expr.accept(&getVars);
+  return getVars.vars;
+}
+
+class LoopTrafficAnalysis : public IRVisitor {
+public:
+  LoopTrafficAnalysis(const map<Var,string>& rowptrs) : rowptrs(rowptrs) {}
+
+  vector<LoopTraffic> analyze(Func func) {
+    function = func.getName();
+    loops.clear();
+    accessed.clear();
+    contexts = {Context()};
+    func.getBody().accept(this);
+    return loops;
+  }
+
+private:
+  /// The loop that traffic is attributed to at a point in the code.
+  struct Context {
+    /// Index of the loop in `loops`, or -1 outside loops.
+    int loop = -1;
+    /// Product of the trip counts of the folded loops between that loop and
+    /// the current point.
+    double multiplier = 1.0;
+    /// Trip counts of the folded loops by their variables.
+    map<Var,double> folded;
+    /// Iterations of the current point per execution of the enclosing region.
+    TripCount iterations = TripCount(1.0);
+  };
+
+  /// Rowptr arrays of the tensor indices, and the names of the indices.
+  const map<Var,string>& rowptrs;
+
+  string function;
+  vector<LoopTraffic> loops;
+  /// The memory accesses already counted in each loop.
+  vector<set<string>> accessed;
+  vector<Context> contexts;
+  vector<int> regions;
+  map<Var,TripCount> loopTrips;
+
+  using IRVisitor::visit;
+
+  void countFlop() {
+    const Context& context = contexts.back();
+    if (context.loop != -1) {
+      loops[context.loop].perIteration.flops += context.multiplier;
+    }
+  }
+
+  /// Count an access of buffer[index] once per iteration. It touches as many
+  /// locations as the product of the trip counts of the folded loops whose
+  /// variables the index uses.
+  void countAccess(const Expr& buffer, const Expr& index, unsigned bytes,
+                   bool load, bool store) {
+    const Context& context = contexts.back();
+    if (context.loop == -1 || !isMemory(buffer)) {
+      return;
+    }
+    string access = string(store ? "store " : "load ") +
+                    util::toString(buffer) + "[" + util::toString(index) + "]";
+    if (!accessed[context.loop].insert(access).second) {
+      return;
+    }
+
+    double locations = 1.0;
+    for (const Var& var : getVars(index)) {
+      if (util::contains(context.folded, var)) {
+        locations *= context.folded.at(var);
+      }
+    }
+    Traffic& traffic = loops[context.loop].perIteration;
+    traffic.loadedBytes += load ? bytes * locations : 0.0;
+    traffic.storedBytes += store ? bytes * locations : 0.0;
+  }
+
+  /// Buffers in memory, as opposed to the small dense tensors of a loop body
+  /// that are kept in registers or L1.
+  static bool isMemory(const Expr& buffer) {
+    if (isa<FieldRead>(buffer) || isa<IndexRead>(buffer)) {
+      return true;
+    }
+    if (isa<VarExpr>(buffer)) {
+      const Type& type = to<VarExpr>(buffer)->var.getType();
+      return type.isArray() ||
+             (type.isTensor() && type.toTensor()->hasSystemDimensions());
+    }
+    return false;
+  }
+
+  TripCount tripCount(const IndexSet& indexSet) {
+    switch (indexSet.getKind()) {
+      case IndexSet::Range:
+        return TripCount(indexSet.getSize());
+      case IndexSet::Set:
+        if (isa<VarExpr>(indexSet.getSet())) {
+          const Var& set = to<VarExpr>(indexSet.getSet())->var;
+          return TripCount::size(set.getName());
+        }
+        return TripCount();
+      case IndexSet::Single:
+        return TripCount(1.0);
+      case IndexSet::Dynamic:
+        return TripCount();
+    }
+    return TripCount();
+  }
+
+  static bool isIntLiteral(const Expr& expr) {
+    return isa<Literal>(expr) && expr.type().isTensor() &&
+           expr.type().toTensor()->getComponentType().isInt();
+  }
+
+  TripCount tripCount(const Expr& start, const Expr& end) {
+    if (isIntLiteral(start) && isIntLiteral(end)) {
+      return TripCount(to<Literal>(end)->getIntVal(0) -
+                       to<Literal>(start)->getIntVal(0));
+    }
+    if (isIntLiteral(start) && to<Literal>(start)->getIntVal(0) == 0 &&
+        isa<Length>(end)) {
+      return tripCount(to<Length>(end)->indexSet);
+    }
+
+    // A row of a sparse matrix, from rowptr[i] to rowptr[i+1]. On average
+    // each row has nonzeros/rows iterations.
+    if (isa<Load>(start) && isa<Load>(end)) {
+      const Load* startLoad = to<Load>(start);
+      const Load* endLoad = to<Load>(end);
+      if (isa<VarExpr>(startLoad->buffer) && isa<VarExpr>(startLoad->index)) {
+        const Var& rowptr = to<VarExpr>(startLoad->buffer)->var;
+        const Var& row = to<VarExpr>(startLoad->index)->var;
+        Expr nextRow = Add::make(startLoad->index, Literal::make(1));
+        if (util::contains(rowptrs, rowptr) && util::contains(loopTrips, row)
+            && util::toString(endLoad->buffer) == rowptr.getName()
+            && util::toString(endLoad->index) == util::toString(nextRow)) {
+          return TripCount::size(rowptrs.at(rowptr)) / loopTrips.at(row);
+        }
+      }
+    }
+    return TripCount();
+  }
+
+  void loop(const Stmt& stmt, const Var& var, const TripCount& trips,
+            const Stmt& body, const Expr& condition=Expr()) {
+    Context inner;
+    const Context& outer = contexts.back();
+    inner.iterations = outer.iterations * trips;
+    if (trips.isConstant() && outer.loop != -1) {
+      inner.loop = outer.loop;
+      inner.multiplier = outer.multiplier * trips.getConstant();
+      inner.folded = outer.folded;
+      if (var.defined()) {
+        inner.folded[var] = trips.getConstant();
+      }
+    }
+    else {
+      LoopTraffic traffic;
+      traffic.function = function;
+      traffic.name = firstLine(stmt);
+      traffic.depth = (outer.loop != -1) ? loops[outer.loop].depth + 1 : 0;
+      traffic.trips = trips;
+      traffic.iterations = inner.iterations;
+      traffic.regions = vector<int>(regions.rbegin(), regions.rend());
+      inner.loop = (int)loops.size();
+      loops.push_back(traffic);
+      accessed.push_back(set<string>());
+    }
+
+    if (var.defined()) {
+      loopTrips[var] = trips;
+    }
+    contexts.push_back(inner);
+    if (condition.defined()) {
+      condition.accept(this);
+    }
+    body.accept(this);
+    contexts.pop_back();
+  }
+
+  void visit(const For *op) {
+    TripCount trips;
+    if (op->domain.kind == ForDomain::IndexSet) {
+      trips = tripCount(op->domain.indexSet);
+    }
+    loop(op, op->var, trips, op->body);
+  }
+
+  void visit(const ForRange *op) {
+    op->start.accept(this);
+    op->end.accept(this);
+    loop(op, op->var, tripCount(op->start, op->end), op->body);
+  }
+
+  void visit(const While *op) {
+    loop(op, Var(), TripCount(), op->body, op->condition);
+  }
+
+  void visit(const IfThenElse *op) {
+    op->condition.accept(this);
+    int loop = contexts.back().loop;
+    if (loop == -1) {
+      op->thenBody.accept(this);
+      if (op->elseBody.defined()) {
+        op->elseBody.accept(this);
+      }
+      return;
+    }
+
+    Traffic before = loops[loop].perIteration;
+    set<string> accessedBefore = accessed[loop];
+    op->thenBody.accept(this);
+    Traffic thenTraffic = loops[loop].perIteration;
+    set<string> thenAccessed = accessed[loop];
+
+    loops[loop].perIteration = before;
+    accessed[loop] = accessedBefore;
+    if (op->elseBody.defined()) {
+      op->elseBody.accept(this);
+    }
+    const Traffic& elseTraffic = loops[loop].perIteration;
+    if (thenTraffic.bytes() > elseTraffic.bytes() ||
+        (thenTraffic.bytes() == elseTraffic.bytes() &&
+         thenTraffic.flops > elseTraffic.flops)) {
+      loops[loop].perIteration = thenTraffic;
+    }
+    accessed[loop].insert(thenAccessed.begin(), thenAccessed.end());
+  }
+
+  void visit(const Load *op) {
+    IRVisitor::visit(op);
+    countAccess(op->buffer, op->index, componentBytes(op->type), true, false);
+  }
+
+  void visit(const Store *op) {
+    IRVisitor::visit(op);
+    bool compound = (op->cop == CompoundOperator::Add);
+    countAccess(op->buffer, op->index, componentBytes(op->value.type()),
+                compound, true);
+    if (compound && isFloat(op->value.type())) {
+      countFlop();
+    }
+  }
+
+  void visit(const AssignStmt *op) {
+    IRVisitor::visit(op);
+    if (op->cop == CompoundOperator::Add && isFloat(op->var.getType())) {
+      countFlop();
+    }
+  }
+
+  void visit(const CallStmt *op) {
+    if (op->callee == intrinsics::profileBegin()) {
+      iassert(isa<Literal>(op->actuals[0]));
+      regions.push_back(to<Literal>(op->actuals[0])->getIntVal(0));
+      contexts.push_back(Context());
+      return;
+    }
+    if (op->callee == intrinsics::profileEnd()) {
+      iassert(!regions.empty() && contexts.size() > 1);
+      regions.pop_back();
+      contexts.pop_back();
+      return;
+    }
+
+    IRVisitor::visit(op);
+    static const set<Func> mathFunctions = {
+      intrinsics::sin(), intrinsics::cos(), intrinsics::tan(),
+      intrinsics::asin(), intrinsics::acos(), intrinsics::atan2(),
+      intrinsics::sqrt(), intrinsics::log(), intrinsics::exp(),
+      intrinsics::pow()
+    };
+    if (util::contains(mathFunctions, op->callee)) {
+      countFlop();
+    }
+  }
+
+#define COUNT_FLOP(Node)                                                       \
+  void visit(const Node *op) {                                                 \
+    IRVisitor::visit(op);                                                      \
+    if (isFloat(op->type)) {                                                   \
+      countFlop();                                                             \
+    }                                                                          \
+  }
+  COUNT_FLOP(Add)
+  COUNT_FLOP(Sub)
+  COUNT_FLOP(Mul)
+  COUNT_FLOP(Div)
+#undef COUNT_FLOP
+};
+
+vector<LoopTraffic> analyzeLoopTraffic(Func func) {
+  map<Var,string> rowptrs;
+  for (const TensorIndex& index : func.getEnvironment().getTensorIndices()) {
+    if (index.getKind() == TensorIndex::PExpr) {
+      rowptrs[index.getRowptrArray()] = index.getName();
+    }
+  }
+
+  vector<LoopTraffic> loops;
+  LoopTrafficAnalysis analysis(rowptrs);
+  for (const Func& f : getCallTree(func)) {
+    if (f.getKind() != Func::Internal || !f.getBody().defined()) {
+      continue;
+    }
+    vector<LoopTraffic> functionLoops = analysis.analyze(f);
+    loops.insert(loops.end(), functionLoops.begin(), functionLoops.end());
+  }
+  return loops;
+}
+
+}}
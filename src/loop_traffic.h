@@ -0,0 +1,94 @@
+#ifndef SIMIT_LOOP_TRAFFIC_H
+#define SIMIT_LOOP_TRAFFIC_H
+
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+namespace ir {
+class Func;
+
+/// Bytes moved to and from memory and floating-point operations.
+struct Traffic {
+  double loadedBytes = 0.0;
+  double storedBytes = 0.0;
+  double flops = 0.0;
+
+  double bytes() const {return loadedBytes + storedBytes;}
+
+  Traffic& operator+=(const Traffic& other);
+};
+
+/// A symbolic iteration count: a constant times a product of named sizes,
+/// that are the cardinalities of sets and the number of nonzeros of tensor
+/// indices. Counts that cannot be expressed this way, such as those of while
+/// loops, are unknown.
+class TripCount {
+public:
+  /// Create an unknown trip count.
+  TripCount() : known(false), constant(0.0) {}
+
+  /// Create a constant trip count.
+  TripCount(double constant) : known(true), constant(constant) {}
+
+  /// Create the trip count of a loop over the named set or index.
+  static TripCount size(const std::string& name);
+
+  bool isKnown() const {return known;}
+  bool isConstant() const {return known && sizes.empty();}
+  double getConstant() const {return constant;}
+
+  TripCount operator*(const TripCount& other) const;
+  TripCount operator/(const TripCount& other) const;
+
+  /// Evaluate the trip count with the given sizes. Returns -1 if the count is
+  /// unknown or one of its sizes is missing.
+  double evaluate(const std::map<std::string,size_t>& sizes) const;
+
+  friend std::ostream& operator<<(std::ostream&, const TripCount&);
+
+private:
+  bool known;
+  double constant;
+  /// Exponent of each size in the count
+  std::map<std::string,int> sizes;
+};
+
+/// The estimated memory traffic and floating-point work of a loop.
+///
+/// Nested loops with constant trip counts, such as the loops over the
+/// components of a block, are folded into the loop they are nested in. Only
+/// loads and stores of set fields, edge endpoints, index arrays and system
+/// tensors are counted as memory traffic, and each distinct load is counted
+/// once per iteration. Conditional code is estimated by its most expensive
+/// branch.
+struct LoopTraffic {
+  /// Name of the function the loop is in.
+  std::string function;
+  /// The loop statement (first line of its IR).
+  std::string name;
+  /// Number of enclosing loops that are not folded.
+  int depth = 0;
+
+  /// Average number of iterations each time the loop is entered.
+  TripCount trips;
+  /// Number of iterations per execution of the innermost enclosing profiled
+  /// region, or per call of the function if there is none.
+  TripCount iterations;
+
+  /// Traffic of one iteration, excluding the loops that are not folded.
+  Traffic perIteration;
+
+  /// Ids of the enclosing profiled regions, innermost first (see profiler.h).
+  std::vector<int> regions;
+};
+
+/// Estimate the memory traffic and floating-point work per iteration of the
+/// loops of a lowered function and the functions it calls.
+std::vector<LoopTraffic> analyzeLoopTraffic(Func func);
+
+}}
+
+#endif
@@ -1,6 +1,7 @@
 #include "lower.h"
 
 #include <map>
+#include <set>
 #include <fstream>
 
 #include "lower_maps.h"
@@ -13,13 +14,18 @@
 
 #include "storage.h"
 #include "timers.h"
+#include "profiler.h"
 #include "temps.h"
 #include "flatten.h"
 #include "insert_frees.h"
 #include "ir_rewriter.h"
 #include "ir_transforms.h"
 #include "ir_printer.h"
+#include "ir_visitor.h"
+#include "ir_queries.h"
+#include "pass_timer.h"
 #include "path_expressions.h"
+#include "util/collections.h"
 
 #ifdef GPU
 #include "backend/gpu/gpu_backend.h"
@@ -52,6 +58,24 @@ Func rewriteCallGraph(const Func& func, const function<Func(Func)>& rewriter) {
   return Rewriter(rewriter).rewrite(func);
 }
 
+/// Rewrite the call graph with `rewriter`, recording the pass time and the IR
+/// sizes before and after in the current compile stats.
+static
+Func runPass(const string& name, const Func& func,
+             const function<Func(Func)>& rewriter) {
+  bool recording = internal::CompileStatsScope::current() != nullptr;
+  size_t sizeBefore = recording ? countNodes(func) : 0;
+
+  internal::PassTimer timer(name);
+  Func result = rewriteCallGraph(func, rewriter);
+  timer.stop();
+
+  if (recording) {
+    timer.setSizes(sizeBefore, countNodes(result));
+  }
+  return result;
+}
+
 void visitCallGraph(Func func, const function<void(Func)>& visitRule) {
   class Visitor : public simit::ir::IRVisitorCallGraph {
   public:
@@ -88,22 +112,24 @@ void printCallGraph(string headerText, Func func, ostream* os) {
   }
 }
 
-Func lower(Func func, std::ostream* os, bool time) {
+Func lower(Func func, std::ostream* os, bool time, bool profile,
+           const FieldLayouts& layouts) {
 #ifdef GPU
   // Rewrite system assignments
   if (kBackend == "gpu") {
-    func = rewriteCallGraph(func, rewriteSystemAssigns);
+    func = runPass("Rewrite System Assigns", func, rewriteSystemAssigns);
     printCallGraph("Rewrite System Assigns (GPU)", func, print);
   }
 #endif
 
   // Flatten index expressions and insert temporaries
-  func = rewriteCallGraph(func, (Func(*)(Func))flattenIndexExpressions);
-  func = rewriteCallGraph(func, insertTemporaries);
+  func = runPass("Flatten Index Expressions", func,
+                 (Func(*)(Func))flattenIndexExpressions);
+  func = runPass("Insert Temporaries", func, insertTemporaries);
   printCallGraph("Insert Temporaries and Flatten Index Expressions", func, os);
 
   // Determine Storage
-  func = rewriteCallGraph(func, [](Func func) -> Func {
+  func = runPass("Determine Storage", func, [](Func func) -> Func {
     updateStorage(func, &func.getStorage(), &func.getEnvironment());
     return func;
   });
@@ -119,53 +145,77 @@ Func lower(Func func, std::ostream* os, bool time) {
     *os << endl;
   }
 
-  func = rewriteCallGraph(func, insertFrees);
+  func = runPass("Insert Frees", func, insertFrees);
   printCallGraph("Insert Frees", func, os);
 
-  func = rewriteCallGraph(func, lowerStringOps);
-  func = rewriteCallGraph(func, lowerPrints);
+  func = runPass("Lower String Operations", func, lowerStringOps);
+  func = runPass("Lower Prints", func, lowerPrints);
   printCallGraph("Lower String Operations and Prints", func, os);
 
-  func = rewriteCallGraph(func, lowerFieldAccesses);
+  func = runPass("Lower Field Accesses", func, lowerFieldAccesses);
   printCallGraph("Lower Field Accesses", func, os);
 
   // Lower stencil assemblies
-  func = rewriteCallGraph(func, lowerStencilAssemblies);
+  func = runPass("Lower Stencil Assemblies", func, lowerStencilAssemblies);
   printCallGraph("Normalize Row Indices", func, os);
 
+  // Instrument procedures for profiling, but not the functions applied by
+  // maps, as these run once per element
+  if (profile) {
+    tassert(kBackend == "cpu") << "Profiling is only supported by the cpu "
+                               << "backend";
+    set<string> mapped;
+    visitCallGraph(func, [&mapped](Func func) {
+      match(func, function<void(const Map*)>([&mapped](const Map* op) {
+        mapped.insert(op->function.getName());
+      }));
+    });
+    func = runPass("Insert Profiling", func, [&mapped](Func func) {
+      return util::contains(mapped, func.getName()) ? func
+                                                    : insertProfiling(func);
+    });
+    printCallGraph("Insert Profiling", func, os);
+  }
+
   // Lower maps
-  func = rewriteCallGraph(func, lowerMaps);
+  func = runPass("Lower Maps", func, lowerMaps);
   printCallGraph("Lower Maps", func, os);
 
   // Lower Index Expressions
-  func = rewriteCallGraph(func, lowerIndexExpressions);
+  func = runPass("Lower Index Expressions", func, lowerIndexExpressions);
   printCallGraph("Lower Index Expressions", func, os);
 
   // Lower Tensor Reads and Writes
-  func = rewriteCallGraph(func, lowerTensorAccesses);
+  func = runPass("Lower Tensor Reads and Writes", func,
+                 [&layouts](Func func) -> Func {
+    return lowerTensorAccesses(func, layouts);
+  });
   printCallGraph("Lower Tensor Reads and Writes", func, os);
 
   if (time) {
     printTimedCallGraph("Insert Timers", func, os);
-    func = rewriteCallGraph(func, insertTimers);
+    func = runPass("Insert Timers", func, insertTimers);
     printCallGraph("Insert Timers", func, os);
   }
 
   // Lower to GPU Kernels
 #if GPU
   if (kBackend == "gpu") {
-    func = rewriteCallGraph(func, shardLoops);
+    func = runPass("Shard Loops", func, shardLoops);
     printCallGraph("Shard Loops", func, os);
-    func = rewriteCallGraph(func, rewriteVarDecls);
+    func = runPass("Rewrite Var Decls", func, rewriteVarDecls);
     printCallGraph("Rewritten Var Decls", func, os);
-    func = rewriteCallGraph(func, localizeTemps);
+    func = runPass("Localize Temps", func, localizeTemps);
     printCallGraph("Localize Temps", func, os);
-    func = rewriteCallGraph(func, kernelRWAnalysis);
+    func = runPass("Kernel RW Analysis", func, kernelRWAnalysis);
     printCallGraph("Kernel RW Analysis", func, os);
-    func = rewriteCallGraph(func, fuseKernels);
+    func = runPass("Fuse Kernels", func, fuseKernels);
     printCallGraph("Fuse Kernels", func, os);
   }
 #endif
+
+  // The passes rewrote func, so this does not change the caller's environment
+  func.getEnvironment().setFieldLayouts(layouts);
   return func;
 }
 
@@ -2,14 +2,19 @@
 #define SIMIT_LOWER_H
 
 #include "ir.h"
+#include "field_layout.h"
 
 namespace simit {
 namespace ir {
 
 /// Optimize and lower `func` into the low level part of the Simit IR, that is
 /// is supported by backends. If `print` is true, then the IR will be printed
-/// to stdout between each lowering step.
-Func lower(Func func, std::ostream* os=nullptr, bool time=false);
+/// to stdout between each lowering step. If `profile` is true, then maps,
+/// loops and solver calls are instrumented for Function::getProfile. Set
+/// fields are accessed in the given layouts, which are stored in the
+/// environment of the lowered function.
+Func lower(Func func, std::ostream* os=nullptr, bool time=false,
+           bool profile=false, const FieldLayouts& layouts=FieldLayouts());
 
 }}
 #endif
@@ -3,6 +3,7 @@
 #include <algorithm>
 #include <map>
 
+#include "field_layout.h"
 #include "ir_rewriter.h"
 #include "intrinsics.h"
 #include "path_expressions.h"
@@ -80,10 +81,12 @@ static Stmt createStoreStmt(Expr tensor, Expr index, Expr value,
 
 class LowerTensorAccesses : public IRRewriter {
 public:
-  LowerTensorAccesses(const Storage &storage) : storage(storage) {}
+  LowerTensorAccesses(const Storage &storage, const FieldLayouts &layouts)
+      : storage(storage), layouts(layouts) {}
 
 private:
   Storage storage;
+  const FieldLayouts &layouts;
   Environment environment;
   
   using IRRewriter::visit;
@@ -228,35 +231,183 @@ private:
 
     // Multiply in inner block size
     Type blockType = tensor.type().toTensor()->getBlockType();
-    Expr blockSize = Literal::make(1);
-    if (blockType.toTensor()->getDimensions().size() > 0) {
-      blockSize = createLengthComputation(
-          blockType.toTensor()->getDimensions());
+    FieldLayout layout = getFieldLayout(tensor);
+    int numComponents = blockType.toTensor()->size();
+    if (!layout.isAoS(numComponents)) {
+      // The components of the element are interleaved with those of the
+      // other elements, so the index is the offset of its first component
+      if (layout.getKind() == FieldLayout::AoSoA) {
+        Expr width = Literal::make(layout.getTileWidth());
+        Expr tile = Mul::make(Div::make(index, width),
+                              Literal::make(layout.getTileWidth() *
+                                            numComponents));
+        index = Add::make(tile, Rem::make(index, width));
+      }
+    }
+    else {
+      Expr blockSize = Literal::make(1);
+      if (blockType.toTensor()->getDimensions().size() > 0) {
+        blockSize = createLengthComputation(
+            blockType.toTensor()->getDimensions());
+      }
+      index = Mul::make(index, blockSize);
     }
-    index = Mul::make(index, blockSize);
-        
+
     iassert(index.defined());
     return index;
   }
 
-  void visit(const TensorRead *op) {
+  /// The layout of a set field in the program being compiled, or AoS if the
+  /// tensor is not a set field.
+  FieldLayout getFieldLayout(Expr tensor) const {
+    if (isa<FieldRead>(tensor)) {
+      const FieldRead *fieldRead = to<FieldRead>(tensor);
+      Type type = fieldRead->elementOrSet.type();
+      if (type.isSet()) {
+        const ElementType *elemType = type.toSet()->elementType.toElement();
+        return layouts.get(elemType->name, fieldRead->fieldName);
+      }
+    }
+    return FieldLayout();
+  }
+
+  bool isInterleavedField(Expr tensor) const {
+    Type blockType = tensor.type().toTensor()->getBlockType();
+    return !getFieldLayout(tensor).isAoS(blockType.toTensor()->size());
+  }
+
+  /// The distance between the components of an element, if the tensor reads
+  /// an element from a set field with an SoA or AoSoA layout.
+  Expr getComponentStride(Expr tensor) const {
+    if (!isa<TensorRead>(tensor)) {
+      return Expr();
+    }
+    while (isa<TensorRead>(tensor)) {
+      tensor = to<TensorRead>(tensor)->tensor;
+    }
+    if (!isInterleavedField(tensor)) {
+      return Expr();
+    }
+    FieldLayout layout = getFieldLayout(tensor);
+    if (layout.getKind() == FieldLayout::AoSoA) {
+      return Literal::make(layout.getTileWidth());
+    }
+    // SoA fields are packed to the size of the set when they are bound
+    return Length::make(IndexSet(to<FieldRead>(tensor)->elementOrSet));
+  }
+
+  /// True if the access reads or writes a whole element of a set field with
+  /// an SoA or AoSoA layout, whose components are not contiguous.
+  bool isInterleavedElement(Expr tensor) const {
+    return isa<FieldRead>(tensor) && isInterleavedField(tensor);
+  }
+
+  /// Rewrite the tensor of a tensor access. Set fields may only be read
+  /// whole, and their elements may only be read as a block, as the tensor of
+  /// an access.
+  Expr rewriteTensor(Expr tensor) {
+    if (isa<FieldRead>(tensor)) {
+      const FieldRead *op = to<FieldRead>(tensor);
+      Expr elementOrSet = rewrite(op->elementOrSet);
+      return (elementOrSet == op->elementOrSet)
+             ? tensor : FieldRead::make(elementOrSet, op->fieldName);
+    }
+    if (isa<TensorRead>(tensor)) {
+      return lowerRead(to<TensorRead>(tensor));
+    }
+    return rewrite(tensor);
+  }
+
+  Expr flattenComponentIndices(Expr tensor, std::vector<Expr> indices) {
+    Expr index = flattenIndices(tensor, indices);
+    Expr stride = getComponentStride(tensor);
+    if (stride.defined()) {
+      index = Mul::make(index, stride);
+    }
+    return index;
+  }
+
+  Expr lowerRead(const TensorRead *op) {
     iassert(op->type.isTensor() && op->tensor.type().toTensor());
-    Expr tensor = rewrite(op->tensor);
-    Expr index = flattenIndices(op->tensor, op->indices);
-    expr = createLoadExpr(tensor, index);
+    Expr tensor = rewriteTensor(op->tensor);
+    Expr index = flattenComponentIndices(op->tensor, op->indices);
+    return createLoadExpr(tensor, index);
+  }
+
+  /// Copy the components of an element of an SoA or AoSoA field to or from a
+  /// dense tensor one at a time, since they are not contiguous. element is
+  /// the load of the element's first component.
+  Stmt copyComponents(const TensorRead *read, Expr element, Var dense,
+                      bool toDense, CompoundOperator cop) {
+    iassert(isa<Load>(element));
+    const Load *first = to<Load>(element);
+    Var component(INTERNAL_PREFIX("component"), Int);
+    Expr offset = Add::make(first->index,
+                            Mul::make(component, getComponentStride(read)));
+    Stmt copy = toDense
+        ? Store::make(dense, component, Load::make(first->buffer, offset), cop)
+        : Store::make(first->buffer, offset, Load::make(dense, component), cop);
+    int numComponents = read->type.toTensor()->size();
+    return ForRange::make(component, 0, numComponents, copy);
+  }
+
+  void visit(const FieldRead *op) {
+    uassert(!isInterleavedField(op))
+        << "the " << getFieldLayout(op) << " field " << quote(Expr(op))
+        << " can only be accessed one element at a time";
+    IRRewriter::visit(op);
+  }
+
+  void visit(const FieldWrite *op) {
+    Expr field = FieldRead::make(op->elementOrSet, op->fieldName);
+    uassert(!field.type().isTensor() || !isInterleavedField(field))
+        << "the " << getFieldLayout(field) << " field " << quote(field)
+        << " can only be accessed one element at a time";
+    IRRewriter::visit(op);
+  }
+
+  void visit(const AssignStmt *op) {
+    if (isa<TensorRead>(op->value) &&
+        isInterleavedElement(to<TensorRead>(op->value)->tensor) &&
+        op->var.getType().isTensor() &&
+        op->var.getType().toTensor()->order() > 0) {
+      const TensorRead *read = to<TensorRead>(op->value);
+      stmt = copyComponents(read, lowerRead(read), op->var, true, op->cop);
+      return;
+    }
+    IRRewriter::visit(op);
+  }
+
+  void visit(const TensorRead *op) {
+    uassert(!isInterleavedElement(op->tensor))
+        << "the elements of the " << getFieldLayout(op->tensor) << " field "
+        << quote(op->tensor) << " can only be read one component at a time, "
+        << "or assigned to a variable";
+    expr = lowerRead(op);
   }
 
   void visit(const TensorWrite *op) {
     iassert(op->tensor.type().isTensor());
-    Expr tensor = rewrite(op->tensor);
+    Expr tensor = rewriteTensor(op->tensor);
     Expr value = rewrite(op->value);
-    Expr index = flattenIndices(op->tensor, op->indices);
+    Expr index = flattenComponentIndices(op->tensor, op->indices);
+    if (isInterleavedElement(op->tensor)) {
+      uassert(isa<VarExpr>(value))
+          << "the elements of the " << getFieldLayout(op->tensor) << " field "
+          << quote(op->tensor) << " can only be written one component at a "
+          << "time, or from a variable";
+      Expr element = TensorRead::make(op->tensor, op->indices);
+      stmt = copyComponents(to<TensorRead>(element),
+                            createLoadExpr(tensor, index),
+                            to<VarExpr>(value)->var, false, op->cop);
+      return;
+    }
     stmt = createStoreStmt(tensor, index, value, op->cop);
   }
 };
 
-Func lowerTensorAccesses(Func func) {
-  return LowerTensorAccesses(func.getStorage()).rewrite(func);
+Func lowerTensorAccesses(Func func, const FieldLayouts& layouts) {
+  return LowerTensorAccesses(func.getStorage(), layouts).rewrite(func);
 }
 
 Func lowerFieldAccesses(Func func) {
@@ -2,13 +2,15 @@
 #define SIMIT_LOWER_ACCESSES_H
 
 #include "ir.h"
+#include "field_layout.h"
 
 namespace simit {
 namespace ir {
 
 /// Lower tensor reads and writes to loads and stores. Loads are lowered based
-/// on the storage scheme of the 
-Func lowerTensorAccesses(Func func);
+/// on the storage scheme of the tensors, and set field accesses on the field
+/// layouts of the program.
+Func lowerTensorAccesses(Func func, const FieldLayouts& layouts);
 
 Func lowerFieldAccesses(Func func);
 
@@ -0,0 +1,128 @@
+#include "memory_report.h"
+
+#include <iomanip>
+#include <map>
+
+using namespace std;
+
+namespace simit {
+
+// class MemoryReport
+void MemoryReport::add(const std::string& kind, const std::string& name,
+                       size_t bytes, size_t allocatedBytes,
+                       std::vector<size_t> pageNodes, size_t hugePageBytes) {
+  MemoryUsage usage;
+  usage.kind = kind;
+  usage.name = name;
+  usage.bytes = bytes;
+  usage.allocatedBytes = allocatedBytes;
+  usage.pageNodes = pageNodes;
+  usage.hugePageBytes = hugePageBytes;
+  usages.push_back(usage);
+}
+
+void MemoryReport::add(const MemoryReport& report) {
+  usages.insert(usages.end(), report.usages.begin(), report.usages.end());
+  peakHeapBytes = max(peakHeapBytes, report.peakHeapBytes);
+}
+
+size_t MemoryReport::getBytes() const {
+  size_t bytes = 0;
+  for (const MemoryUsage& usage : usages) {
+    bytes += usage.bytes;
+  }
+  return bytes;
+}
+
+size_t MemoryReport::getAllocatedBytes() const {
+  size_t bytes = 0;
+  for (const MemoryUsage& usage : usages) {
+    bytes += usage.allocatedBytes;
+  }
+  return bytes;
+}
+
+size_t MemoryReport::getAllocatedBytes(const std::string& kind) const {
+  size_t bytes = 0;
+  for (const MemoryUsage& usage : usages) {
+    if (usage.kind == kind) {
+      bytes += usage.allocatedBytes;
+    }
+  }
+  return bytes;
+}
+
+std::vector<size_t> MemoryReport::getPageNodes() const {
+  vector<size_t> pageNodes;
+  for (const MemoryUsage& usage : usages) {
+    if (usage.pageNodes.size() > pageNodes.size()) {
+      pageNodes.resize(usage.pageNodes.size(), 0);
+    }
+    for (size_t node = 0; node < usage.pageNodes.size(); ++node) {
+      pageNodes[node] += usage.pageNodes[node];
+    }
+  }
+  return pageNodes;
+}
+
+size_t MemoryReport::getHugePageBytes() const {
+  size_t bytes = 0;
+  for (const MemoryUsage& usage : usages) {
+    bytes += usage.hugePageBytes;
+  }
+  return bytes;
+}
+
+// Print the pages on each node as "node:pages" pairs
+static void printPageNodes(std::ostream& os, const vector<size_t>& pageNodes) {
+  for (size_t node = 0; node < pageNodes.size(); ++node) {
+    os << " " << node << ":" << pageNodes[node];
+  }
+}
+
+void MemoryReport::print(std::ostream& os) const {
+  os << left << setw(12) << "kind" << right << setw(14) << "bytes"
+     << setw(14) << "allocated" << "  " << "name" << endl;
+  map<string,size_t> kindBytes;
+  for (const MemoryUsage& usage : usages) {
+    os << left << setw(12) << usage.kind << right << setw(14) << usage.bytes
+       << setw(14) << usage.allocatedBytes << "  " << usage.name;
+    if (!usage.pageNodes.empty()) {
+      os << "  pages";
+      printPageNodes(os, usage.pageNodes);
+    }
+    if (usage.hugePageBytes > 0) {
+      os << "  huge pages " << usage.hugePageBytes;
+    }
+    os << endl;
+    kindBytes[usage.kind] += usage.allocatedBytes;
+  }
+  os << endl;
+  for (auto& kind : kindBytes) {
+    os << left << setw(12) << kind.first << right << setw(28) << kind.second
+       << endl;
+  }
+  os << left << setw(12) << "total" << right << setw(14) << getBytes()
+     << setw(14) << getAllocatedBytes() << endl;
+  vector<size_t> pageNodes = getPageNodes();
+  if (!pageNodes.empty()) {
+    os << left << setw(12) << "pages" << right;
+    printPageNodes(os, pageNodes);
+    os << endl;
+  }
+  if (getHugePageBytes() > 0) {
+    os << left << setw(12) << "huge pages" << right << setw(28)
+       << getHugePageBytes() << endl;
+  }
+  if (peakHeapBytes > 0) {
+    os << left << setw(12) << "peak heap" << right << setw(28)
+       << peakHeapBytes << endl;
+  }
+}
+
+std::ostream& operator<<(std::ostream& os, const MemoryReport& report) {
+  report.print(os);
+  return os;
+}
+
+}
@@ -0,0 +1,76 @@
+#ifndef SIMIT_MEMORY_REPORT_H
+#define SIMIT_MEMORY_REPORT_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// The memory used by one buffer of a set or function.
+struct MemoryUsage {
+  /// "field", "endpoints", "external field", "external endpoints", "path
+  /// index", "tensor", "temporary", "jit code" or "jit data".
+  std::string kind;
+  /// The buffer's name, prefixed by the name of the set it belongs to.
+  std::string name;
+
+  /// Bytes holding data.
+  size_t bytes = 0;
+  /// Bytes allocated, including capacity that is not in use yet.
+  size_t allocatedBytes = 0;
+  /// Resident pages on each NUMA node, indexed by node. Empty if unknown.
+  std::vector<size_t> pageNodes;
+  /// Bytes backed by huge pages (see Settings::hugePages).
+  size_t hugePageBytes = 0;
+};
+
+/// A breakdown of the memory used by a set (Set::memoryReport) or a function
+/// and the sets bound to it (Function::memoryReport).
+class MemoryReport {
+public:
+  MemoryReport() : peakHeapBytes(0) {}
+
+  const std::vector<MemoryUsage>& getUsages() const {return usages;}
+
+  void add(const std::string& kind, const std::string& name, size_t bytes,
+           size_t allocatedBytes,
+           std::vector<size_t> pageNodes=std::vector<size_t>(),
+           size_t hugePageBytes=0);
+  void add(const MemoryReport& report);
+
+  /// Total bytes holding data.
+  size_t getBytes() const;
+
+  /// Total bytes allocated.
+  size_t getAllocatedBytes() const;
+
+  /// Total bytes allocated for buffers of the given kind.
+  size_t getAllocatedBytes(const std::string& kind) const;
+
+  /// Total resident pages of the buffers on each NUMA node (see
+  /// Settings::memoryPlacement).
+  std::vector<size_t> getPageNodes() const;
+
+  /// Total bytes of the buffers backed by huge pages.
+  size_t getHugePageBytes() const;
+
+  /// The most memory Simit had allocated for function state (temporaries,
+  /// tensors and path indices) since the function was last initialized,
+  /// including memory allocated while it ran. Zero for sets.
+  size_t getPeakHeapBytes() const {return peakHeapBytes;}
+  void setPeakHeapBytes(size_t bytes) {peakHeapBytes = bytes;}
+
+  /// Print a table of the buffers, followed by totals per kind.
+  void print(std::ostream& os) const;
+
+private:
+  std::vector<MemoryUsage> usages;
+  size_t peakHeapBytes;
+};
+
+std::ostream& operator<<(std::ostream& os, const MemoryReport& report);
+
+}
+#endif
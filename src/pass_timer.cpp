@@ -0,0 +1,47 @@
+#include "pass_timer.h"
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+// class CompileStatsScope
+thread_local CompileStats* CompileStatsScope::currentStats = nullptr;
+
+CompileStatsScope::CompileStatsScope(CompileStats* stats)
+    : previousStats(currentStats) {
+  currentStats = stats;
+}
+
+CompileStatsScope::~CompileStatsScope() {
+  currentStats = previousStats;
+}
+
+// class PassTimer
+PassTimer::PassTimer(const std::string& name)
+    : stats(CompileStatsScope::current()), running(true) {
+  pass.name = name;
+  start = chrono::steady_clock::now();
+}
+
+PassTimer::~PassTimer() {
+  stop();
+  if (stats != nullptr) {
+    stats->addPass(pass);
+  }
+}
+
+void PassTimer::stop() {
+  if (running) {
+    chrono::duration<double> elapsed = chrono::steady_clock::now() - start;
+    pass.seconds = elapsed.count();
+    running = false;
+  }
+}
+
+void PassTimer::setSizes(size_t before, size_t after) {
+  pass.sizeBefore = before;
+  pass.sizeAfter = after;
+}
+
+}}
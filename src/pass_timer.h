@@ -0,0 +1,56 @@
+#ifndef SIMIT_PASS_TIMER_H
+#define SIMIT_PASS_TIMER_H
+
+#include <chrono>
+#include <string>
+
+#include "compile_stats.h"
+
+namespace simit {
+namespace internal {
+
+/// Records the compiler passes run on the calling thread into `stats` for the
+/// lifetime of the scope. Scopes nest, and a scope with null stats turns
+/// recording off.
+class CompileStatsScope {
+public:
+  explicit CompileStatsScope(CompileStats* stats);
+  ~CompileStatsScope();
+
+  /// The stats of the innermost scope on the calling thread, or nullptr.
+  static CompileStats* current() {return currentStats;}
+
+private:
+  CompileStats* previousStats;
+  static thread_local CompileStats* currentStats;
+
+  CompileStatsScope(const CompileStatsScope&) = delete;
+  void operator=(const CompileStatsScope&)    = delete;
+};
+
+/// Times a compiler pass from construction until stop() or destruction, and
+/// adds it to the current compile stats on destruction. Does nothing outside
+/// a CompileStatsScope.
+class PassTimer {
+public:
+  explicit PassTimer(const std::string& name);
+  ~PassTimer();
+
+  /// True if the pass is being recorded, so its IR sizes are worth computing.
+  bool isActive() const {return stats != nullptr;}
+
+  void stop();
+  void setSizes(size_t before, size_t after);
+
+private:
+  CompileStats* stats;
+  CompilePass pass;
+  std::chrono::steady_clock::time_point start;
+  bool running;
+
+  PassTimer(const PassTimer&)      = delete;
+  void operator=(const PassTimer&) = delete;
+};
+
+}}
+#endif
@@ -1,8 +1,11 @@
 #include "path_indices.h"
 
+#include <algorithm>
 #include <iostream>
+#include <limits>
 #include <stack>
 #include <map>
+#include <set>
 #include <vector>
 
 #include "path_expressions.h"
@@ -145,6 +148,42 @@ void SegmentedPathIndex::print(std::ostream &os) const {
 
 
 // class PathIndexBuilder
+static const Link* getLink(PathExpression pe) {
+  while (isa<RenamedPathExpression>(pe)) {
+    pe = to<RenamedPathExpression>(pe)->getPathExpression();
+  }
+  return isa<Link>(pe) ? to<Link>(pe) : nullptr;
+}
+
+/// True if pe is a path from the vertices of a set through an edge to the
+/// vertices (there exists e s.t. vi-e and e-vj), like the indices of assembled
+/// matrices.
+static bool isVertexEdgeVertex(const PathExpression &pe, string *vertexSet,
+                               string *edgeSet) {
+  if (!isa<And>(pe) || to<And>(pe)->getQuantifiedVars().size() != 1) {
+    return false;
+  }
+  const Link* lhs = getLink(to<And>(pe)->getLhs());
+  const Link* rhs = getLink(to<And>(pe)->getRhs());
+  if (lhs == nullptr || rhs == nullptr || lhs->getType() == Link::vv ||
+      rhs->getType() == Link::vv || lhs->getType() == rhs->getType() ||
+      lhs->getEdgeSet().getName() != rhs->getEdgeSet().getName() ||
+      lhs->getVertexSet().getName() != rhs->getVertexSet().getName()) {
+    return false;
+  }
+  *vertexSet = lhs->getVertexSet().getName();
+  *edgeSet = lhs->getEdgeSet().getName();
+  return true;
+}
+
+/// True if all the endpoints of an unstructured edge set are in vertexSet.
+static bool isUnstructuredEdgeSet(const simit::Set* edgeSet,
+                                  const simit::Set* vertexSet) {
+  return edgeSet->getKind() == simit::Set::Unstructured &&
+         edgeSet->getCardinality() > 0 && edgeSet->isHomogeneous() &&
+         edgeSet->getEndpointSet(0) == vertexSet;
+}
+
 PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
                                            unsigned sourceEndpoint){
   /// Interpret the path expression, starting at sourceEndpoint, over the graph.
@@ -177,8 +216,10 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
       }
 
       size_t numElements = pathNeighbors.size();
-      uint32_t* coordsData= (uint32_t*)malloc((numElements+1)*sizeof(uint32_t));
-      uint32_t* sinksData = (uint32_t*)malloc(numNeighbors*sizeof(uint32_t));
+      uint32_t* coordsData = (uint32_t*)internal::heapAllocate(
+          (numElements+1)*sizeof(uint32_t));
+      uint32_t* sinksData = (uint32_t*)internal::heapAllocate(
+          numNeighbors*sizeof(uint32_t));
 
       int currNbrsStart = 0;
       for (auto& p : pathNeighbors) {
@@ -217,8 +258,10 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
           size_t n   = edgeSet.getSize();
           size_t nnz = edgeSet.getSize() * cardinality;
 
-          uint32_t* ptr = (uint32_t*)malloc((n+1)*sizeof(uint32_t));
-          uint32_t* idx = (uint32_t*)malloc(nnz*sizeof(uint32_t));
+          uint32_t* ptr =
+              (uint32_t*)internal::heapAllocate((n+1)*sizeof(uint32_t));
+          uint32_t* idx =
+              (uint32_t*)internal::heapAllocate(nnz*sizeof(uint32_t));
 
           for (size_t i=0; i<=n; ++i) {
             ptr[i] = i*cardinality;
@@ -507,17 +550,241 @@ PathIndex PathIndexBuilder::buildSegmented(const PathExpression &pe,
 
   // Check if we have memoized the path index for this path expression, starting
   // at this sourceEndpoint, bound to these sets.
-  if (util::contains(pathIndices, {pe,sourceEndpoint})) {
-    return pathIndices.at({pe,sourceEndpoint});
+  auto key = make_pair(pe, sourceEndpoint);
+  auto memoized = pathIndices.find(key);
+  if (memoized != pathIndices.end() && isCurrent(memoized->second)) {
+    return memoized->second.index;
   }
 
-  PathIndex pi = PathNeighborVisitor(this).build(pe);
-  pathIndices.insert({{pe,sourceEndpoint}, pi});
+  MemoizedIndex memo;
+  string vertexSet, edgeSet;
+  if (isVertexEdgeVertex(pe, &vertexSet, &edgeSet) &&
+      isUnstructuredEdgeSet(bindings.at(edgeSet), bindings.at(vertexSet))) {
+    if (memoized != pathIndices.end()) {
+      memo = std::move(memoized->second);
+    }
+    if (!memo.index.defined() ||
+        !updateVertexEdgeVertex(vertexSet, edgeSet, &memo)) {
+      buildVertexEdgeVertex(vertexSet, edgeSet, &memo);
+    }
+  }
+  else {
+    memo.index = PathNeighborVisitor(this).build(pe);
+  }
+  recordVersions(pe, &memo);
+  PathIndex pi = memo.index;
+  pathIndices[key] = std::move(memo);
   return pi;
 }
 
+void PathIndexBuilder::recordVersions(const PathExpression &pe,
+                                      MemoizedIndex *memo) const {
+  class SetNames : public PathExpressionVisitor {
+  public:
+    set<string> names;
+    using PathExpressionVisitor::visit;
+    void visit(const Link *link) {
+      if (link->getType() == Link::vv) {
+        names.insert(link->getVertexSet(0).getName());
+        names.insert(link->getVertexSet(1).getName());
+        names.insert(link->getStencil().getLatticeSet().getName());
+      }
+      else {
+        names.insert(link->getVertexSet().getName());
+        names.insert(link->getEdgeSet().getName());
+      }
+    }
+  };
+  SetNames setNames;
+  pe.accept(&setNames);
+
+  memo->versions.clear();
+  memo->sizes.clear();
+  for (const string& name : setNames.names) {
+    const simit::Set* set = bindings.at(name);
+    memo->versions[name] = {set, set->getTopologyVersion()};
+    memo->sizes[name] = set->getSize();
+  }
+}
+
+bool PathIndexBuilder::isCurrent(const MemoizedIndex &memo) const {
+  for (auto& version : memo.versions) {
+    const simit::Set* set = bindings.at(version.first);
+    if (set != version.second.first ||
+        set->getTopologyVersion() != version.second.second) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/// Adds to nbrs the (row, sink) pairs each edge connects, in row-major order
+/// with the pairs of an edge in the same order as the endpoints.
+static void addEdgePairs(const int* endpoints, int cardinality,
+                         vector<pair<uint32_t,uint32_t>>* nbrs) {
+  for (int i=0; i < cardinality; ++i) {
+    for (int j=0; j < cardinality; ++j) {
+      nbrs->push_back({(uint32_t)endpoints[i], (uint32_t)endpoints[j]});
+    }
+  }
+}
+
+static vector<int> getEndpoints(const simit::Set &edgeSet) {
+  const int cardinality = edgeSet.getCardinality();
+  vector<int> endpoints(edgeSet.getSize() * cardinality);
+  for (auto e : edgeSet) {
+    for (int i=0; i < cardinality; ++i) {
+      endpoints[e.getIdent()*cardinality + i] =
+          edgeSet.getEndpoint(e, i).getIdent();
+    }
+  }
+  return endpoints;
+}
+
+void PathIndexBuilder::buildVertexEdgeVertex(const string &vertexSetName,
+                                             const string &edgeSetName,
+                                             MemoizedIndex *memo) {
+  const simit::Set& vertexSet = *bindings.at(vertexSetName);
+  const simit::Set& edgeSet = *bindings.at(edgeSetName);
+  const int cardinality = edgeSet.getCardinality();
+  memo->endpoints = getEndpoints(edgeSet);
+
+  // The neighbors of vi are the endpoints of the edges vi is an endpoint of,
+  // counted once for each edge that connects them
+  vector<pair<uint32_t,uint32_t>> pairs;
+  pairs.reserve(memo->endpoints.size() * cardinality);
+  for (size_t e=0; e < memo->endpoints.size(); e += cardinality) {
+    addEdgePairs(&memo->endpoints[e], cardinality, &pairs);
+  }
+  sort(pairs.begin(), pairs.end());
+
+  size_t numElements = vertexSet.getSize();
+  uint32_t* coordsData = (uint32_t*)internal::heapAllocate(
+      (numElements+1)*sizeof(uint32_t));
+  vector<uint32_t> sinks;
+  memo->multiplicities.clear();
+  size_t p = 0;
+  for (size_t elem=0; elem < numElements; ++elem) {
+    coordsData[elem] = sinks.size();
+    for (; p < pairs.size() && pairs[p].first == elem; ++p) {
+      if (sinks.size() > coordsData[elem] && sinks.back() == pairs[p].second) {
+        ++memo->multiplicities.back();
+      }
+      else {
+        sinks.push_back(pairs[p].second);
+        memo->multiplicities.push_back(1);
+      }
+    }
+  }
+  iassert(p == pairs.size()) << "edge endpoint outside the vertex set";
+  coordsData[numElements] = sinks.size();
+
+  uint32_t* sinksData = (uint32_t*)internal::heapAllocate(
+      sinks.size()*sizeof(uint32_t));
+  memcpy(sinksData, sinks.data(), sinks.size()*sizeof(uint32_t));
+  memo->index = new SegmentedPathIndex(numElements, coordsData, sinksData);
+}
+
+bool PathIndexBuilder::updateVertexEdgeVertex(const string &vertexSetName,
+                                              const string &edgeSetName,
+                                              MemoizedIndex *memo) {
+  const simit::Set* vertexSet = bindings.at(vertexSetName);
+  const simit::Set* edgeSet = bindings.at(edgeSetName);
+  auto vertexVersion = memo->versions.at(vertexSetName);
+  auto edgeVersion = memo->versions.at(edgeSetName);
+  if (vertexVersion.first != vertexSet ||
+      vertexVersion.second != vertexSet->getTopologyVersion() ||
+      edgeVersion.first != edgeSet) {
+    return false;
+  }
+
+  // Find the removed edges, that old edges no longer map to, and the added
+  // edges, that no old edge maps to
+  const int cardinality = edgeSet->getCardinality();
+  vector<int> remap;
+  if (!edgeSet->getRemapSince(edgeVersion.second, memo->sizes.at(edgeSetName),
+                              &remap)) {
+    return false;
+  }
+  vector<bool> isOld(edgeSet->getSize(), false);
+  vector<pair<uint32_t,uint32_t>> removed, added;
+  for (size_t e=0; e < remap.size(); ++e) {
+    if (remap[e] == -1) {
+      addEdgePairs(&memo->endpoints[e*cardinality], cardinality, &removed);
+    }
+    else {
+      isOld[remap[e]] = true;
+    }
+  }
+  vector<int> endpoints = getEndpoints(*edgeSet);
+  for (size_t e=0; e < isOld.size(); ++e) {
+    if (!isOld[e]) {
+      addEdgePairs(&endpoints[e*cardinality], cardinality, &added);
+    }
+  }
+
+  // Merging the changes into the index touches every neighbor once, so when
+  // most edges changed it is as cheap to rebuild the index
+  const SegmentedPathIndex* index = to<SegmentedPathIndex>(memo->index);
+  if (removed.size() + added.size() > index->numNeighbors()) {
+    return false;
+  }
+  sort(removed.begin(), removed.end());
+  sort(added.begin(), added.end());
+
+  // Merge the sorted changes with each neighbor segment, dropping the
+  // neighbors that are no longer connected by any edge
+  const size_t numElements = index->numElements();
+  const uint32_t* coords = index->getCoordData();
+  const uint32_t* sinks = index->getSinkData();
+  uint32_t* coordsData = (uint32_t*)internal::heapAllocate(
+      (numElements+1)*sizeof(uint32_t));
+  vector<uint32_t> newSinks, newMultiplicities;
+  newSinks.reserve(index->numNeighbors() + added.size());
+  newMultiplicities.reserve(index->numNeighbors() + added.size());
+  size_t r = 0, a = 0;
+  for (uint32_t elem=0; elem < numElements; ++elem) {
+    coordsData[elem] = newSinks.size();
+    uint32_t k = coords[elem];
+    while (k < coords[elem+1] ||
+           (a < added.size() && added[a].first == elem)) {
+      uint32_t sink = (k < coords[elem+1]) ? sinks[k]
+                                              : numeric_limits<uint32_t>::max();
+      if (a < added.size() && added[a].first == elem) {
+        sink = std::min(sink, added[a].second);
+      }
+      long multiplicity = 0;
+      if (k < coords[elem+1] && sinks[k] == sink) {
+        multiplicity = memo->multiplicities[k++];
+      }
+      for (; a < added.size() && added[a] == make_pair(elem,sink); ++a) {
+        ++multiplicity;
+      }
+      for (; r < removed.size() && removed[r] == make_pair(elem,sink); ++r) {
+        --multiplicity;
+      }
+      iassert(multiplicity >= 0) << "removed an edge that was not indexed";
+      if (multiplicity > 0) {
+        newSinks.push_back(sink);
+        newMultiplicities.push_back(multiplicity);
+      }
+    }
+  }
+  iassert(r == removed.size() && a == added.size())
+      << "changed edge endpoint outside the vertex set";
+  coordsData[numElements] = newSinks.size();
+
+  uint32_t* sinksData = (uint32_t*)internal::heapAllocate(
+      newSinks.size()*sizeof(uint32_t));
+  memcpy(sinksData, newSinks.data(), newSinks.size()*sizeof(uint32_t));
+  memo->index = new SegmentedPathIndex(numElements, coordsData, sinksData);
+  memo->endpoints = std::move(endpoints);
+  memo->multiplicities = std::move(newMultiplicities);
+  return true;
+}
+
 void PathIndexBuilder::bind(std::string name, const simit::Set* set) {
-  bindings.insert({name,set});
+  bindings[name] = set;
 }
 
 const simit::Set* PathIndexBuilder::getBinding(pe::Set pset) const {
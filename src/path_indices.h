@@ -4,9 +4,12 @@
 #include <ostream>
 #include <map>
 #include <memory>
+#include <string>
 #include <typeinfo>
+#include <vector>
 
 #include "graph.h"
+#include "heap.h"
 #include "path_expressions.h"
 #include "interfaces/printable.h"
 
@@ -175,8 +178,8 @@ private:
 class SegmentedPathIndex : public PathIndexImpl {
 public:
   ~SegmentedPathIndex() {
-    free(coordsData);
-    free(sinksData);
+    internal::heapFree(coordsData);
+    internal::heapFree(sinksData);
   }
 
   unsigned numElements() const {return numElems;}
@@ -207,8 +210,7 @@ private:
       : numElems(numElements), coordsData(nbrsStart), sinksData(nbrs) {}
 
   SegmentedPathIndex() : numElems(0), coordsData(nullptr), sinksData(nullptr) {
-    coordsData = new uint32_t[1];
-    coordsData[0] = 0;
+    coordsData = (uint32_t*)internal::heapAllocateZeroed(sizeof(uint32_t));
   }
 };
 
@@ -228,6 +230,11 @@ inline const PI* to(PathIndex pi) {
 /// The builder memoizes previously computed path indices, and uses these to
 /// accelerate subsequent path index construction (since path expressions can be
 /// recursively constructed from path expressions).
+///
+/// Memoized indices are rebuilt when the topology of the sets they were built
+/// from changes. Indices from vertices through an edge to vertices, such as
+/// the indices of assembled matrices, are instead updated from the edges that
+/// were added and removed, if the vertex set did not change.
 class PathIndexBuilder {
 public:
   PathIndexBuilder() {}
@@ -237,14 +244,47 @@ public:
   // Build a Segmented path index by evaluating the `pe` over the given graph.
   PathIndex buildSegmented(const PathExpression &pe, unsigned sourceEndpoint);
 
+  /// Bind a set, replacing the set that was bound to the name.
   void bind(std::string name, const simit::Set* set);
 
   const simit::Set* getBinding(pe::Set pset) const;
   const simit::Set* getBinding(ir::Var var) const;
 
 private:
-  std::map<std::pair<PathExpression,unsigned>, PathIndex> pathIndices;
+  /// A memoized path index, with the sets it was built from and their
+  /// topology versions and sizes.
+  struct MemoizedIndex {
+    PathIndex index;
+    std::map<std::string, std::pair<const simit::Set*,size_t>> versions;
+    std::map<std::string, int> sizes;
+
+    /// Vertex-edge-vertex indices keep the endpoints of the edges they were
+    /// built from, and how many edges connect each neighbor pair, so that
+    /// they can be updated when edges are added and removed.
+    std::vector<int> endpoints;
+    std::vector<uint32_t> multiplicities;
+  };
+
+  std::map<std::pair<PathExpression,unsigned>, MemoizedIndex> pathIndices;
   std::map<std::string, const simit::Set*> bindings;
+
+  /// Record the current versions of the sets `pe` is evaluated over.
+  void recordVersions(const PathExpression &pe, MemoizedIndex *memo) const;
+
+  /// True if none of the sets the index was built from changed.
+  bool isCurrent(const MemoizedIndex &memo) const;
+
+  /// Build the index from the vertices of a set, through the edges of another
+  /// set, to the vertices.
+  void buildVertexEdgeVertex(const std::string &vertexSet,
+                             const std::string &edgeSet, MemoizedIndex *memo);
+
+  /// Update a vertex-edge-vertex index with the edges that were added and
+  /// removed since it was built. Returns false if it must be rebuilt instead,
+  /// because the vertices changed, the edge changes were not logged, or there
+  /// are so many changes that rebuilding is cheaper.
+  bool updateVertexEdgeVertex(const std::string &vertexSet,
+                              const std::string &edgeSet, MemoizedIndex *memo);
 };
 
 }}
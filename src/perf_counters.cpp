@@ -0,0 +1,137 @@
+#include "perf_counters.h"
+
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+// struct PerfCounts
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other) {
+  cycles += other.cycles;
+  instructions += other.instructions;
+  llcMisses += other.llcMisses;
+  dtlbMisses += other.dtlbMisses;
+  return *this;
+}
+
+PerfCounts PerfCounts::operator-(const PerfCounts& other) const {
+  PerfCounts result;
+  result.cycles = cycles - other.cycles;
+  result.instructions = instructions - other.instructions;
+  result.llcMisses = llcMisses - other.llcMisses;
+  result.dtlbMisses = dtlbMisses - other.dtlbMisses;
+  return result;
+}
+
+// class PerfCounters
+#ifdef __linux__
+static int openCounter(uint32_t type, uint64_t config, int groupFd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = type;
+  attr.config = config;
+  attr.disabled = (groupFd == -1);
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP;
+  return syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0);
+}
+
+static uint64_t cacheMissConfig(uint64_t cache) {
+  return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+#endif
+
+PerfCounters::PerfCounters() : numOpen(0), available(false) {
+  for (int i = 0; i < NumCounters; ++i) {
+    fds[i] = -1;
+    positions[i] = -1;
+  }
+
+#ifdef __linux__
+  const uint32_t types[NumCounters] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+    PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE
+  };
+  const uint64_t configs[NumCounters] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    cacheMissConfig(PERF_COUNT_HW_CACHE_LL),
+    cacheMissConfig(PERF_COUNT_HW_CACHE_DTLB)
+  };
+  const char *names[NumCounters] = {"cycles", "instructions", "LLC misses",
+                                    "dTLB misses"};
+
+  // The cycle counter leads the group, so all counters cover the same span
+  fds[Cycles] = openCounter(types[Cycles], configs[Cycles], -1);
+  if (fds[Cycles] == -1) {
+    error = string("perf_event_open failed (") + strerror(errno) + "), " +
+            "check /proc/sys/kernel/perf_event_paranoid";
+    return;
+  }
+  positions[Cycles] = numOpen++;
+
+  for (int i = Instructions; i < NumCounters; ++i) {
+    fds[i] = openCounter(types[i], configs[i], fds[Cycles]);
+    if (fds[i] == -1) {
+      error += string(error.empty() ? "" : ", ") + names[i] + " unavailable";
+      continue;
+    }
+    positions[i] = numOpen++;
+  }
+
+  available = hasCounter(Instructions);
+  ioctl(fds[Cycles], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(fds[Cycles], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#else
+  error = "hardware counters are only supported on Linux";
+#endif
+}
+
+PerfCounters::~PerfCounters() {
+#ifdef __linux__
+  for (int i = NumCounters-1; i >= 0; --i) {
+    if (fds[i] != -1) {
+      close(fds[i]);
+    }
+  }
+#endif
+}
+
+PerfCounts PerfCounters::read() const {
+  PerfCounts counts;
+#ifdef __linux__
+  if (numOpen == 0) {
+    return counts;
+  }
+
+  // Group read format: the number of counters followed by their values
+  uint64_t values[1 + NumCounters];
+  ssize_t size = ::read(fds[Cycles], values, (1 + numOpen) * sizeof(uint64_t));
+  if (size != (ssize_t)((1 + numOpen) * sizeof(uint64_t))) {
+    return counts;
+  }
+  auto value = [&](Counter counter) -> uint64_t {
+    return (positions[counter] == -1) ? 0 : values[1 + positions[counter]];
+  };
+  counts.cycles = value(Cycles);
+  counts.instructions = value(Instructions);
+  counts.llcMisses = value(LLCMisses);
+  counts.dtlbMisses = value(DTLBMisses);
+#endif
+  return counts;
+}
+
+}}
@@ -0,0 +1,57 @@
+#ifndef SIMIT_PERF_COUNTERS_H
+#define SIMIT_PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+namespace simit {
+namespace internal {
+
+/// Hardware counter values, or differences between them.
+struct PerfCounts {
+  uint64_t cycles = 0;
+  uint64_t instructions = 0;
+  uint64_t llcMisses = 0;
+  uint64_t dtlbMisses = 0;
+
+  PerfCounts& operator+=(const PerfCounts& other);
+  PerfCounts operator-(const PerfCounts& other) const;
+};
+
+/// A group of Linux perf_event_open counters (cycles, instructions, last-level
+/// cache misses and data TLB misses) of the calling thread. Counters the
+/// kernel or hardware do not provide, e.g. in containers or VMs, are left out
+/// and read as zero.
+class PerfCounters {
+public:
+  enum Counter {Cycles, Instructions, LLCMisses, DTLBMisses, NumCounters};
+
+  PerfCounters();
+  ~PerfCounters();
+
+  /// True if at least the cycle and instruction counters could be opened.
+  bool isAvailable() const {return available;}
+
+  /// True if the given counter could be opened.
+  bool hasCounter(Counter counter) const {return fds[counter] != -1;}
+
+  /// Why the counters are unavailable, or which counters are missing.
+  const std::string& getError() const {return error;}
+
+  /// Read the current counter values.
+  PerfCounts read() const;
+
+private:
+  int fds[NumCounters];
+  /// Position of each counter in a group read, or -1 if it is missing.
+  int positions[NumCounters];
+  int numOpen;
+  bool available;
+  std::string error;
+
+  PerfCounters(const PerfCounters&)   = delete;
+  void operator=(const PerfCounters&) = delete;
+};
+
+}}
+#endif
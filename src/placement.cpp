@@ -0,0 +1,159 @@
+#include "placement.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <thread>
+
+#include "init.h"
+
+#ifdef __linux__
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace simit {
+namespace internal {
+
+// Smaller buffers are zeroed by the calling thread, since starting the threads
+// costs more than the remote accesses it avoids
+static const size_t kMinPlacedBytes = 1 << 20;
+
+bool isPlaced(size_t size) {
+  return size >= kMinPlacedBytes && kMemoryPlacement != "default";
+}
+
+#ifdef __linux__
+// The mbind policy that interleaves pages over nodes (MPOL_INTERLEAVE)
+static const int kInterleavePolicy = 3;
+
+static uintptr_t pageSize() {
+  static const uintptr_t size = sysconf(_SC_PAGESIZE);
+  return size;
+}
+
+// The CPUs the process may run on
+static vector<int> getCPUs() {
+  vector<int> cpus;
+  cpu_set_t mask;
+  if (sched_getaffinity(0, sizeof(mask), &mask) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &mask)) {
+        cpus.push_back(cpu);
+      }
+    }
+  }
+  return cpus;
+}
+
+// Pin the calling thread to a CPU, so that the pages it touches are placed on
+// the CPU's node
+static void pinToCPU(int cpu) {
+  cpu_set_t mask;
+  CPU_ZERO(&mask);
+  CPU_SET(cpu, &mask);
+  sched_setaffinity(0, sizeof(mask), &mask);
+}
+
+static void interleaveZeroed(char* data, size_t size) {
+  // Pages the buffer shares with other buffers keep their policy
+  uintptr_t begin = ((uintptr_t)data + pageSize()-1) & ~(pageSize()-1);
+  uintptr_t end = ((uintptr_t)data + size) & ~(pageSize()-1);
+  if (begin < end) {
+    // The kernel ignores the nodes of the mask that have no memory
+    unsigned long nodes = ~0UL;
+    syscall(__NR_mbind, begin, end-begin, kInterleavePolicy, &nodes,
+            sizeof(nodes)*8, 0);
+  }
+  memset(data, 0, size);
+}
+
+static void firstTouchZeroed(char* data, size_t size) {
+  const vector<int> cpus = getCPUs();
+  size_t numThreads = (kPlacementThreads > 0) ? kPlacementThreads
+                                              : cpus.size();
+  numThreads = min(numThreads, size / pageSize());
+  if (numThreads <= 1 || cpus.empty()) {
+    memset(data, 0, size);
+    return;
+  }
+
+  // Thread t zeroes the t-th of numThreads equal blocks, with the block
+  // boundaries rounded up to pages so that each page is touched by one thread
+  char* end = data + size;
+  auto blockBegin = [=](size_t t) -> char* {
+    if (t == numThreads) {
+      return end;
+    }
+    uintptr_t begin = (uintptr_t)(data + t*(size/numThreads));
+    begin = (t == 0) ? begin : (begin + pageSize()-1) & ~(pageSize()-1);
+    return min((char*)begin, end);
+  };
+  vector<thread> threads;
+  for (size_t t = 0; t < numThreads; ++t) {
+    threads.emplace_back([=]() {
+      pinToCPU(cpus[t * cpus.size() / numThreads]);
+      char* begin = blockBegin(t);
+      memset(begin, 0, blockBegin(t+1) - begin);
+    });
+  }
+  for (thread& t : threads) {
+    t.join();
+  }
+}
+#endif
+
+void placeZeroed(void* data, size_t size) {
+  if (!isPlaced(size)) {
+    memset(data, 0, size);
+    return;
+  }
+#ifdef __linux__
+  if (kMemoryPlacement == "interleave") {
+    interleaveZeroed((char*)data, size);
+  }
+  else {
+    firstTouchZeroed((char*)data, size);
+  }
+#else
+  memset(data, 0, size);
+#endif
+}
+
+void countPageNodes(const void* data, size_t size, vector<size_t>* nodes) {
+#ifdef __linux__
+  if (data == nullptr || size == 0) {
+    return;
+  }
+  const uintptr_t end = (uintptr_t)data + size;
+  const size_t batchSize = 4096;
+  vector<void*> pages;
+  vector<int> status(batchSize);
+  uintptr_t page = (uintptr_t)data & ~(pageSize()-1);
+  while (page < end) {
+    pages.clear();
+    for (; page < end && pages.size() < batchSize; page += pageSize()) {
+      pages.push_back((void*)page);
+    }
+    // Without target nodes move_pages reports the node of each page, or a
+    // negative error for pages that are not resident
+    if (syscall(__NR_move_pages, 0, pages.size(), pages.data(), nullptr,
+                status.data(), 0) != 0) {
+      return;
+    }
+    for (size_t i = 0; i < pages.size(); ++i) {
+      if (status[i] >= 0) {
+        if ((size_t)status[i] >= nodes->size()) {
+          nodes->resize(status[i]+1, 0);
+        }
+        ++(*nodes)[status[i]];
+      }
+    }
+  }
+#endif
+}
+
+}}
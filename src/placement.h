@@ -0,0 +1,29 @@
+#ifndef SIMIT_PLACEMENT_H
+#define SIMIT_PLACEMENT_H
+
+#include <cstddef>
+#include <vector>
+
+namespace simit {
+namespace internal {
+
+/// Zero a newly allocated buffer, placing its pages on NUMA nodes with the
+/// policy of Settings::memoryPlacement. Linux places a page on the node of the
+/// thread that first writes it, so "firsttouch" zeroes the buffer with
+/// Settings::placementThreads threads, each pinned to a CPU and writing one
+/// contiguous block of the buffer like a statically scheduled parallel loop
+/// over its elements. "interleave" spreads the pages round-robin over the
+/// nodes instead. Pages that were written before keep their nodes.
+void placeZeroed(void* data, size_t size);
+
+/// True if buffers of size bytes are placed by placeZeroed, rather than
+/// zeroed by the calling thread.
+bool isPlaced(size_t size);
+
+/// Add the number of resident pages of a buffer on each NUMA node to nodes,
+/// that is indexed by node. Does nothing if placement is unknown (e.g. on
+/// systems without NUMA support).
+void countPageNodes(const void* data, size_t size, std::vector<size_t>* nodes);
+
+}}
+#endif
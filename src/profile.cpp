@@ -0,0 +1,131 @@
+#include "profile.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+
+namespace simit {
+
+/// Escape str for use in a JSON string.
+static string jsonEscape(const string& str) {
+  stringstream ss;
+  for (char c : str) {
+    switch (c) {
+      case '"':  ss << "\\\""; break;
+      case '\\': ss << "\\\\"; break;
+      case '\n': ss << "\\n"; break;
+      case '\t': ss << "\\t"; break;
+      default:
+        if ((unsigned char)c < 0x20) {
+          ss << "\\u" << hex << setw(4) << setfill('0') << (int)c << dec;
+        }
+        else {
+          ss << c;
+        }
+    }
+  }
+  return ss.str();
+}
+
+// class Profile
+Profile::Profile(const vector<ProfileRegion>& regions,
+                 const vector<ProfileEvent>& events,
+                 double cyclesPerSecond, uint64_t droppedEvents,
+                 const vector<ProfileLoop>& loops)
+    : regions(regions), events(events), loops(loops),
+      cyclesPerSecond(cyclesPerSecond), droppedEvents(droppedEvents) {
+}
+
+void Profile::print(std::ostream& os) const {
+  vector<const ProfileRegion*> sorted;
+  double totalSeconds = 0.0;
+  for (const ProfileRegion& region : regions) {
+    sorted.push_back(&region);
+    totalSeconds += region.seconds;
+  }
+  stable_sort(sorted.begin(), sorted.end(),
+              [](const ProfileRegion* a, const ProfileRegion* b) {
+                return a->seconds > b->seconds;
+              });
+
+  os << left << setw(10) << "kind" << right << setw(12) << "time (ms)"
+     << setw(8) << "%" << setw(10) << "count" << setw(14) << "cycles/run"
+     << "  " << "region" << endl;
+  for (const ProfileRegion* region : sorted) {
+    double percentage = (totalSeconds > 0.0)
+                        ? region->seconds * 100.0 / totalSeconds : 0.0;
+    uint64_t cyclesPerRun = (region->count > 0)
+                            ? region->cycles / region->count : 0;
+    os << left << setw(10) << region->kind << right << fixed
+       << setprecision(3) << setw(12) << region->seconds * 1e3
+       << setprecision(1) << setw(8) << percentage
+       << setw(10) << region->count << setw(14) << cyclesPerRun
+       << "  " << region->function << ": " << region->name << endl;
+  }
+  if (droppedEvents > 0) {
+    os << droppedEvents << " events did not fit in the trace buffers" << endl;
+  }
+}
+
+void Profile::printRoofline(std::ostream& os) const {
+  os << left << setw(10) << "kind" << right << setw(12) << "time (ms)"
+     << setw(10) << "GB/s" << setw(10) << "GFLOP/s" << setw(10) << "flop/B"
+     << "  " << "region" << endl;
+  for (size_t i = 0; i < regions.size(); ++i) {
+    const ProfileRegion& region = regions[i];
+    if (region.bytes == 0.0 && region.flops == 0.0) {
+      continue;
+    }
+    double seconds = (region.seconds > 0.0) ? region.seconds : 1.0;
+    os << left << setw(10) << region.kind << right << fixed
+       << setprecision(3) << setw(12) << region.seconds * 1e3
+       << setprecision(2) << setw(10) << region.bytes / seconds * 1e-9
+       << setw(10) << region.flops / seconds * 1e-9
+       << setw(10) << ((region.bytes > 0.0) ? region.flops / region.bytes : 0.0)
+       << "  " << region.function << ": " << region.name << endl;
+
+    for (const ProfileLoop& loop : loops) {
+      if (loop.region != i) {
+        continue;
+      }
+      double bytes = loop.loadedBytes + loop.storedBytes;
+      os << setw(14 + 2*loop.depth) << "" << "loop " << loop.name << endl
+         << setw(16 + 2*loop.depth) << "" << "iterations " << loop.tripCount;
+      if (loop.iterations >= 0.0) {
+        os << " = " << setprecision(0) << loop.iterations;
+      }
+      os << setprecision(1) << ", bytes/iteration " << loop.loadedBytes
+         << " loaded + " << loop.storedBytes << " stored"
+         << ", flops/iteration " << loop.flops << setprecision(2)
+         << ", flop/B " << ((bytes > 0.0) ? loop.flops / bytes : 0.0) << endl;
+    }
+  }
+}
+
+void Profile::writeChromeTrace(std::ostream& os) const {
+  os << "{\"traceEvents\":[";
+  for (size_t i = 0; i < events.size(); ++i) {
+    const ProfileEvent& event = events[i];
+    const ProfileRegion& region = regions[event.region];
+    os << (i > 0 ? ",\n" : "\n")
+       << "{\"name\":\"" << jsonEscape(region.name) << "\","
+       << "\"cat\":\"" << region.kind << "\","
+       << "\"ph\":\"X\","
+       << "\"ts\":" << fixed << setprecision(3) << event.start << ","
+       << "\"dur\":" << event.duration << ","
+       << "\"pid\":0,"
+       << "\"tid\":" << event.thread << ","
+       << "\"args\":{\"function\":\"" << jsonEscape(region.function)
+       << "\"}}";
+  }
+  os << "\n],\"displayTimeUnit\":\"ns\"}" << endl;
+}
+
+std::ostream& operator<<(std::ostream& os, const Profile& profile) {
+  profile.print(os);
+  return os;
+}
+
+}
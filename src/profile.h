@@ -0,0 +1,112 @@
+#ifndef SIMIT_PROFILE_H
+#define SIMIT_PROFILE_H
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace simit {
+
+/// The accumulated timings of one instrumented region of a function compiled
+/// with Program::compileWithProfiling. Regions are maps, loops, tensor
+/// expressions and solver or extern calls.
+struct ProfileRegion {
+  /// Name of the Simit function the region is in.
+  std::string function;
+  /// "map", "loop", "tensor", "solve" or "extern".
+  std::string kind;
+  /// The region's statement (first line of its IR).
+  std::string name;
+
+  uint64_t count = 0;
+  uint64_t cycles = 0;
+  uint64_t minCycles = 0;
+  uint64_t maxCycles = 0;
+  /// Total time spent in the region in seconds.
+  double seconds = 0.0;
+
+  /// Estimated bytes moved to and from memory and floating-point operations
+  /// of all executions of the region, including nested regions. Loops whose
+  /// iteration counts are unknown, such as while loops, are not included.
+  double bytes = 0.0;
+  double flops = 0.0;
+};
+
+/// A loop in a profiled region, with estimates of its memory traffic and
+/// floating-point work from the lowered code (see loop_traffic.h).
+struct ProfileLoop {
+  /// Index of the innermost region the loop is in, in Profile::getRegions().
+  size_t region;
+  /// The loop statement (first line of its IR).
+  std::string name;
+  /// Nesting depth of the loop in the region.
+  int depth = 0;
+  /// Symbolic iteration count per execution of the region, e.g. "3*points".
+  std::string tripCount;
+  /// Iterations per execution of the region given the sizes of the bound
+  /// sets, or -1 if unknown.
+  double iterations = -1.0;
+
+  /// Estimates per iteration.
+  double loadedBytes = 0.0;
+  double storedBytes = 0.0;
+  double flops = 0.0;
+};
+
+/// One execution of a region.
+struct ProfileEvent {
+  /// Index of the region in Profile::getRegions().
+  size_t region;
+  /// Index of the thread that ran the region, in order of first recording.
+  unsigned thread;
+  /// Start time in microseconds, relative to the first event in the profile.
+  double start;
+  /// Duration in microseconds.
+  double duration;
+};
+
+/// The profile of a function, as returned by Function::getProfile.
+class Profile {
+public:
+  Profile() : cyclesPerSecond(0.0), droppedEvents(0) {}
+  Profile(const std::vector<ProfileRegion>& regions,
+          const std::vector<ProfileEvent>& events,
+          double cyclesPerSecond, uint64_t droppedEvents,
+          const std::vector<ProfileLoop>& loops={});
+
+  const std::vector<ProfileRegion>& getRegions() const {return regions;}
+  const std::vector<ProfileEvent>& getEvents() const {return events;}
+  const std::vector<ProfileLoop>& getLoops() const {return loops;}
+
+  /// Frequency of the timestamp counter the cycle counts are measured with.
+  double getCyclesPerSecond() const {return cyclesPerSecond;}
+
+  /// Number of events that did not fit in the per-thread trace buffers. The
+  /// region totals include them.
+  uint64_t getDroppedEvents() const {return droppedEvents;}
+
+  /// Print a table of the regions, sorted by total time.
+  void print(std::ostream& os) const;
+
+  /// Print a roofline summary: the achieved bandwidth (GB/s), floating-point
+  /// throughput (GFLOP/s) and arithmetic intensity (flops per byte) of each
+  /// region, followed by the per-iteration estimates of its loops.
+  void printRoofline(std::ostream& os) const;
+
+  /// Write the events in the Chrome trace-event JSON format, that can be
+  /// loaded in chrome://tracing or Perfetto.
+  void writeChromeTrace(std::ostream& os) const;
+
+private:
+  std::vector<ProfileRegion> regions;
+  std::vector<ProfileEvent> events;
+  std::vector<ProfileLoop> loops;
+  double cyclesPerSecond;
+  uint64_t droppedEvents;
+};
+
+std::ostream& operator<<(std::ostream& os, const Profile& profile);
+
+}
+#endif
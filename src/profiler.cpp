@@ -0,0 +1,268 @@
+#include "profiler.h"
+
+#include <chrono>
+#include <map>
+#include <set>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "ir.h"
+#include "ir_rewriter.h"
+#include "intrinsics.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+namespace ir {
+
+class InsertProfiling : public IRRewriter {
+public:
+  InsertProfiling(const string& function) : function(function) {}
+
+private:
+  string function;
+
+  using IRRewriter::visit;
+
+  void visit(const Map *op) {
+    IRRewriter::visit(op);
+    profile("map", op);
+  }
+
+  void visit(const ForRange *op) {
+    IRRewriter::visit(op);
+    profile("loop", op);
+  }
+
+  void visit(const For *op) {
+    IRRewriter::visit(op);
+    profile("loop", op);
+  }
+
+  void visit(const While *op) {
+    IRRewriter::visit(op);
+    profile("loop", op);
+  }
+
+  void visit(const AssignStmt *op) {
+    IRRewriter::visit(op);
+    if (isa<IndexExpr>(op->value)) {
+      profile("tensor", op);
+    }
+  }
+
+  void visit(const FieldWrite *op) {
+    IRRewriter::visit(op);
+    if (isa<IndexExpr>(op->value)) {
+      profile("tensor", op);
+    }
+  }
+
+  void visit(const TensorWrite *op) {
+    IRRewriter::visit(op);
+    if (isa<IndexExpr>(op->value)) {
+      profile("tensor", op);
+    }
+  }
+
+  void visit(const CallStmt *op) {
+    IRRewriter::visit(op);
+    if (op->callee.getKind() == Func::External) {
+      profile("extern", op);
+    }
+    else if (op->callee == intrinsics::solve() ||
+             op->callee == intrinsics::chol() ||
+             op->callee == intrinsics::lltsolve() ||
+             op->callee == intrinsics::lltmatsolve()) {
+      profile("solve", op);
+    }
+  }
+
+  /// Wrap the rewritten statement in profileBegin/profileEnd calls for a new
+  /// region named by the first line of the original statement.
+  void profile(const string& kind, const Stmt& original) {
+    string name = util::toString(original);
+    name = name.substr(0, name.find('\n'));
+    name = util::trim(name);
+
+    int id = internal::Profiler::getInstance().addRegion(function, kind, name);
+    stmt = Block::make({CallStmt::make({}, intrinsics::profileBegin(),
+                                       {Literal::make(id)}),
+                        stmt,
+                        CallStmt::make({}, intrinsics::profileEnd(),
+                                       {Literal::make(id)})});
+  }
+};
+
+Func insertProfiling(Func func) {
+  return InsertProfiling(func.getName()).rewrite(func);
+}
+
+}
+
+namespace internal {
+
+// Maximum number of events kept per thread for the trace. Region totals are
+// accumulated regardless.
+static const size_t TRACE_CAPACITY = 1 << 16;
+
+thread_local Profiler::ThreadBuffer* Profiler::threadBuffer = nullptr;
+
+int Profiler::addRegion(const string& function, const string& kind,
+                        const string& name) {
+  lock_guard<std::mutex> lock(mutex);
+  regions.push_back({function, kind, name});
+  return (int)regions.size() - 1;
+}
+
+Profiler::ThreadBuffer* Profiler::getThreadBuffer() {
+  if (threadBuffer == nullptr) {
+    lock_guard<std::mutex> lock(mutex);
+    ThreadBuffer* buffer = new ThreadBuffer;
+    buffer->thread = buffers.size();
+    buffer->events.reserve(TRACE_CAPACITY);
+    buffers.push_back(unique_ptr<ThreadBuffer>(buffer));
+    threadBuffer = buffer;
+  }
+  return threadBuffer;
+}
+
+void Profiler::reserveThreadBuffer() {
+  ThreadBuffer* buffer = getThreadBuffer();
+  lock_guard<std::mutex> lock(mutex);
+  if (buffer->counters.size() < regions.size()) {
+    buffer->counters.resize(regions.size());
+  }
+}
+
+void Profiler::record(int id, uint64_t start, uint64_t end) {
+  ThreadBuffer* buffer = getThreadBuffer();
+  if ((size_t)id >= buffer->counters.size()) {
+    reserveThreadBuffer();
+  }
+
+  uint64_t cycles = end - start;
+  Counter& counter = buffer->counters[id];
+  counter.count += 1;
+  counter.cycles += cycles;
+  counter.minCycles = min(counter.minCycles, cycles);
+  counter.maxCycles = max(counter.maxCycles, cycles);
+
+  if (buffer->events.size() < TRACE_CAPACITY) {
+    buffer->events.push_back({id, start, end});
+  }
+  else {
+    buffer->droppedEvents += 1;
+  }
+}
+
+Profile Profiler::getProfile(const vector<int>& ids) {
+  double cyclesPerSecond = getCyclesPerSecond();
+  lock_guard<std::mutex> lock(mutex);
+
+  // Regions in the order of ids, and the index of each id in that order
+  vector<ProfileRegion> profileRegions;
+  map<int,size_t> regionIndices;
+  for (int id : ids) {
+    iassert((size_t)id < regions.size());
+    ProfileRegion region;
+    region.function = regions[id].function;
+    region.kind = regions[id].kind;
+    region.name = regions[id].name;
+    regionIndices[id] = profileRegions.size();
+    profileRegions.push_back(region);
+  }
+
+  vector<ProfileEvent> events;
+  uint64_t droppedEvents = 0;
+  uint64_t firstStart = UINT64_MAX;
+  for (auto& buffer : buffers) {
+    for (int id : ids) {
+      if ((size_t)id >= buffer->counters.size()) continue;
+      const Counter& counter = buffer->counters[id];
+      if (counter.count == 0) continue;
+      ProfileRegion& region = profileRegions[regionIndices.at(id)];
+      region.minCycles = (region.count == 0)
+                         ? counter.minCycles
+                         : min(region.minCycles, counter.minCycles);
+      region.maxCycles = max(region.maxCycles, counter.maxCycles);
+      region.count += counter.count;
+      region.cycles += counter.cycles;
+    }
+    for (const Event& event : buffer->events) {
+      if (util::contains(regionIndices, event.id)) {
+        firstStart = min(firstStart, event.start);
+      }
+    }
+    droppedEvents += buffer->droppedEvents;
+  }
+  for (auto& buffer : buffers) {
+    for (const Event& event : buffer->events) {
+      if (!util::contains(regionIndices, event.id)) continue;
+      double start = (event.start - firstStart) * 1e6 / cyclesPerSecond;
+      double duration = (event.end - event.start) * 1e6 / cyclesPerSecond;
+      events.push_back({regionIndices.at(event.id), buffer->thread,
+                        start, duration});
+    }
+  }
+  for (ProfileRegion& region : profileRegions) {
+    region.seconds = region.cycles / cyclesPerSecond;
+  }
+  return Profile(profileRegions, events, cyclesPerSecond, droppedEvents);
+}
+
+void Profiler::reset(const vector<int>& ids) {
+  lock_guard<std::mutex> lock(mutex);
+  set<int> resetIds(ids.begin(), ids.end());
+  for (auto& buffer : buffers) {
+    for (int id : ids) {
+      if ((size_t)id < buffer->counters.size()) {
+        buffer->counters[id] = Counter();
+      }
+    }
+    vector<Event> events;
+    events.reserve(TRACE_CAPACITY);
+    for (const Event& event : buffer->events) {
+      if (!util::contains(resetIds, event.id)) {
+        events.push_back(event);
+      }
+    }
+    buffer->events.swap(events);
+    buffer->droppedEvents = 0;
+  }
+}
+
+uint64_t Profiler::timestamp() {
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  using namespace std::chrono;
+  return duration_cast<nanoseconds>(
+      steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+double Profiler::getCyclesPerSecond() {
+  if (cyclesPerSecond == 0.0) {
+#if defined(__x86_64__) || defined(__i386__)
+    // Measure the timestamp counter against the steady clock for 10ms
+    using namespace std::chrono;
+    auto clockStart = steady_clock::now();
+    uint64_t start = timestamp();
+    this_thread::sleep_for(milliseconds(10));
+    uint64_t end = timestamp();
+    auto clockEnd = steady_clock::now();
+    double seconds = duration<double>(clockEnd - clockStart).count();
+    cyclesPerSecond = (end - start) / seconds;
+#else
+    cyclesPerSecond = 1e9;
+#endif
+  }
+  return cyclesPerSecond;
+}
+
+}}
@@ -0,0 +1,100 @@
+#ifndef SIMIT_PROFILER_H
+#define SIMIT_PROFILER_H
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "ir.h"
+#include "profile.h"
+
+namespace simit {
+namespace ir {
+
+/// Instrument the maps, loops, tensor expressions and solver and extern calls
+/// of func with profileBegin/profileEnd intrinsics. Each region is registered
+/// with the Profiler, whose id is passed to the intrinsics as a literal.
+Func insertProfiling(Func func);
+
+}
+
+namespace internal {
+
+/// Registry of the regions instrumented by insertProfiling, and owner of the
+/// thread-local buffers that generated code records region executions into.
+/// Region ids are assigned at compile time, so recording is an indexed update
+/// of the calling thread's counters.
+class Profiler {
+public:
+  static Profiler& getInstance() {
+    static Profiler instance;
+    return instance;
+  }
+
+  /// Register a region and return its id.
+  int addRegion(const std::string& function, const std::string& kind,
+                const std::string& name);
+
+  /// Size the calling thread's buffer for all registered regions, so that
+  /// recording does not allocate.
+  void reserveThreadBuffer();
+
+  /// Record an execution of region id between the start and end timestamps.
+  void record(int id, uint64_t start, uint64_t end);
+
+  /// Collect the counters and events of the given regions from all threads.
+  Profile getProfile(const std::vector<int>& ids);
+
+  /// Clear the counters and events of the given regions.
+  void reset(const std::vector<int>& ids);
+
+  /// Read the timestamp counter generated code measures regions with.
+  static uint64_t timestamp();
+
+  /// Frequency of the timestamp counter, calibrated on first use.
+  double getCyclesPerSecond();
+
+private:
+  struct Counter {
+    uint64_t count = 0;
+    uint64_t cycles = 0;
+    uint64_t minCycles = UINT64_MAX;
+    uint64_t maxCycles = 0;
+  };
+  struct Event {
+    int id;
+    uint64_t start;
+    uint64_t end;
+  };
+  struct ThreadBuffer {
+    unsigned thread;
+    std::vector<Counter> counters;
+    std::vector<Event> events;
+    uint64_t droppedEvents = 0;
+  };
+
+  struct Region {
+    std::string function;
+    std::string kind;
+    std::string name;
+  };
+
+  static thread_local ThreadBuffer* threadBuffer;
+
+  std::mutex mutex;
+  std::vector<Region> regions;
+  std::vector<std::unique_ptr<ThreadBuffer>> buffers;
+  double cyclesPerSecond;
+
+  ThreadBuffer* getThreadBuffer();
+
+  Profiler() : cyclesPerSecond(0.0) {}
+  Profiler(Profiler const&)         = delete;
+  void operator=(Profiler const&)   = delete;
+};
+
+}}
+
+#endif
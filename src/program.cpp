@@ -11,6 +11,7 @@
 #include "storage.h"
 #include "lower/lower.h"
 #include "timers.h"
+#include "pass_timer.h"
 
 #include "backend/backend.h"
 
@@ -27,12 +28,19 @@ const std::vector<std::string> VALID_BACKENDS = {
 std::string kBackend;
 
 static
-Function compile(ir::Func func, backend::Backend *backend, bool addTimers) {
+Function compile(ir::Func func, backend::Backend *backend, bool addTimers,
+                 bool profile=false, CompileStats *stats=nullptr,
+                 const FieldLayouts& layouts=FieldLayouts()) {
+  if (stats) {
+    stats->clear();
+  }
+  internal::CompileStatsScope statsScope(stats);
+
   ir::Storage storage;
   // Fill in storage path expressions, etc.
   /// map<Var,pe::PathExpressions> pes = assignPathExpressions(func);
   /// storage.addPathExpressions(pes);
-  func = lower(func, nullptr, addTimers);
+  func = lower(func, nullptr, addTimers, profile, layouts);
   return Function(backend->compile(func, storage));
 }
 
@@ -46,6 +54,8 @@ struct Program::ProgramContent {
   internal::Frontend *frontend;
   backend::Backend   *backend;
   Diagnostics diags;
+  CompileStats compileStats;
+  FieldLayouts fieldLayouts;
 };
 
 // class Program
@@ -89,6 +99,17 @@ int Program::loadFile(const std::string &filename) {
   return status;
 }
 
+void Program::setFieldLayout(const std::string &elementType,
+                             const std::string &field, FieldLayout layout) {
+  uassert(content->ctx.containsElementType(elementType))
+      << "Unknown element type " << elementType;
+  const ir::ElementType *type =
+      content->ctx.getElementType(elementType).toElement();
+  uassert(type->hasField(field))
+      << "Element type " << elementType << " has no field " << field;
+  content->fieldLayouts.set(elementType, field, layout);
+}
+
 std::vector<std::string> Program::getFunctionNames() const {
   vector<string> functionNames;
   for (auto &func : content->ctx.getFunctions()) {
@@ -101,14 +122,24 @@ Function Program::compile(const std::string &function) {
   ir::Func simitFunc = content->ctx.getFunction(function);
   uassert(simitFunc.defined()) << "Attempting to compile an unknown function "
                                << "(" << function << ")";
-  return simit::compile(simitFunc, content->backend);
+  return simit::compile(simitFunc, content->backend, false, false,
+                        &content->compileStats, content->fieldLayouts);
 }
 
 Function Program::compileWithTimers(const std::string &function) {
   ir::Func simitFunc = content->ctx.getFunction(function);
   uassert(simitFunc.defined()) << "Attempting to compile an unknown function "
                                << "(" << function << ")";
-  return simit::compile(simitFunc, content->backend, true);
+  return simit::compile(simitFunc, content->backend, true, false,
+                        &content->compileStats, content->fieldLayouts);
+}
+
+Function Program::compileWithProfiling(const std::string &function) {
+  ir::Func simitFunc = content->ctx.getFunction(function);
+  uassert(simitFunc.defined()) << "Attempting to compile an unknown function "
+                               << "(" << function << ")";
+  return simit::compile(simitFunc, content->backend, false, true,
+                        &content->compileStats, content->fieldLayouts);
 }
 
 int Program::verify() {
@@ -136,6 +167,10 @@ int Program::verify() {
   return 0;
 }
 
+const CompileStats& Program::getCompileStats() const {
+  return content->compileStats;
+}
+
 bool Program::hasErrors() const {
   return content->diags.hasErrors();
 }
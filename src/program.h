@@ -7,6 +7,8 @@
 #include <memory>
 
 #include "function.h"
+#include "compile_stats.h"
+#include "field_layout.h"
 #include "init.h"
 #include "interfaces/uncopyable.h"
 
@@ -40,6 +42,15 @@ public:
   ///         through the \ref getErrors and \ref getErrorString methods.
   int loadFile(const std::string &filename);
 
+  /// Set the memory layout of a field of an element type, in the functions
+  /// this program compiles afterwards. Other programs that use the same
+  /// element type are not affected. Sets of the element type bound to the
+  /// functions must have been given the same layout in Set::addField. Fields
+  /// with a layout other than AoS (and more than one component) may only be
+  /// accessed through their elements, not as whole-set vectors.
+  void setFieldLayout(const std::string &elementType,
+                      const std::string &field, FieldLayout layout);
+
   /// Returns the names of all the functions in the program.
   std::vector<std::string> getFunctionNames() const;
 
@@ -48,6 +59,14 @@ public:
   Function compile(const std::string &function);
   Function compileWithTimers(const std::string &function);
 
+  /// Compile a function with its maps, loops and solver calls instrumented
+  /// with cycle counters. See Function::getProfile.
+  Function compileWithProfiling(const std::string &function);
+
+  /// The time and IR size of each lowering and code generation pass of the
+  /// most recent compile.
+  const CompileStats& getCompileStats() const;
+
   /// Verify the program by executing in-code comment tests.
   int verify();
 
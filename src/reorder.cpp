@@ -168,6 +168,8 @@ namespace simit {
   void reorderFields(vector<Set::FieldData*>& fields, const vector<int>& 
       ordering) {
     for (auto f : fields) {
+      uassert(f->layout.isAoS(f->type->getSize()))
+          << "Cannot reorder field " << f->name << " with layout " << f->layout;
       switch (f->type->getComponentType()) {
         case ComponentType::Float: {
           float* data = static_cast<float *>(f->data);
@@ -222,6 +224,7 @@ namespace simit {
     free(newEndpoints);
     
     reorderFields(edgeSet.getFields(), edgeOrdering);
+    edgeSet.markTopologyChanged();
   }
 
   void reorderEdgeSetByVertexOrdering(Set& edgeSet, const vector<int>& 
@@ -229,6 +232,7 @@ namespace simit {
     for (int i=0; i < edgeSet.getSize() * edgeSet.getCardinality(); ++i) {
       edgeSet.getEndpointsPtr()[i] = 
         vertexOrdering[edgeSet.getEndpointsPtr()[i]]; }
+    edgeSet.markTopologyChanged();
   }
     
   void reorderVertexSet(Set& edgeSet, Set& vertexSet, vector<int>& 
@@ -244,6 +248,7 @@ namespace simit {
     iassert(vertexOrdering.size() == (unsigned int) vertexSet.getSize()) << 
       vertexOrdering.size() << ", " << vertexSet.getSize();
     reorderFields(vertexSet.getFields(), vertexOrdering);
+    vertexSet.markTopologyChanged();
   }
   
   void reorder(Set& edgeSet, Set& vertexSet, vector<int>& edgeOrdering, 
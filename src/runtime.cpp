@@ -6,6 +6,8 @@
 #include <vector>
 
 #include "timers.h"
+#include "profiler.h"
+#include "heap.h"
 #include "stdio.h"
 
 #ifdef EIGEN
@@ -16,136 +18,40 @@ using namespace Eigen;
 #endif
 
 extern "C" {
-int loc(int v0, int v1, int *neighbors_start, int *neighbors) {
-  int l = neighbors_start[v0];
-  while(neighbors[l] != v1) l++;
-  return l;
-}
-
-double atan2_f64(double y, double x) {
-  return atan2(y, x);
-}
-
-float atan2_f32(float y, float x) {
-  double d_y = y;
-  double d_x = x;
-  return (float)atan2(d_y, d_x);
-}
-
-double tan_f64(double x) {
-  return tan(x);
-}
-
-float tan_f32(float x) {
-  double d_x = x;
-  return (float)tan(d_x);
-}
-
-double asin_f64(double x) {
-  return asin(x);
-}
-
-float asin_f32(float x) {
-  double d_x = x;
-  return (float)asin(d_x);
-}
-
-double acos_f64(double x) {
-  return acos(x);
-}
-
-float acos_f32(float x) {
-  double d_x = x;
-  return (float)acos(d_x);
-}
-
-double det3_f64(double * a){
-  return a[0] * (a[4]*a[8]-a[5]*a[7])
-       - a[1] * (a[3]*a[8]-a[5]*a[6])
-       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+void simitStoreTime(int i, double value) {
+  simit::ir::TimerStorage::getInstance().storeTime(i, value);
 }
 
-float det3_f32(float * a){
-  return a[0] * (a[4]*a[8]-a[5]*a[7])
-       - a[1] * (a[3]*a[8]-a[5]*a[6])
-       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+double simitClock() {
+  // Microseconds since the first call, so that single-precision clock values
+  // in generated code keep their resolution
+  using namespace std::chrono;
+  static const steady_clock::time_point start = steady_clock::now();
+  return duration<double,std::micro>(steady_clock::now() - start).count();
 }
 
-void inv3_f64(double * a, double * inv){
-  double cof00 = a[4]*a[8]-a[5]*a[7];
-  double cof01 =-a[3]*a[8]+a[5]*a[6];
-  double cof02 = a[3]*a[7]-a[4]*a[6];
-
-  double cof10 =-a[1]*a[8]+a[2]*a[7];
-  double cof11 = a[0]*a[8]-a[2]*a[6];
-  double cof12 =-a[0]*a[7]+a[1]*a[6];
-
-  double cof20 = a[1]*a[5]-a[2]*a[4];
-  double cof21 =-a[0]*a[5]+a[2]*a[3];
-  double cof22 = a[0]*a[4]-a[1]*a[3];
-
-  double determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
-
-  determ = 1.0/determ;
-  inv[0] = cof00 * determ;
-  inv[1] = cof10 * determ;
-  inv[2] = cof20 * determ;
-
-  inv[3] = cof01 * determ;
-  inv[4] = cof11 * determ;
-  inv[5] = cof21 * determ;
-
-  inv[6] = cof02 * determ;
-  inv[7] = cof12 * determ;
-  inv[8] = cof22 * determ;
+void simitStartCounters(int i) {
+  simit::ir::TimerStorage::getInstance().startCounters(i);
 }
 
-void inv3_f32(float * a, float * inv){
-  float cof00 = a[4]*a[8]-a[5]*a[7];
-  float cof01 =-a[3]*a[8]+a[5]*a[6];
-  float cof02 = a[3]*a[7]-a[4]*a[6];
-
-  float cof10 =-a[1]*a[8]+a[2]*a[7];
-  float cof11 = a[0]*a[8]-a[2]*a[6];
-  float cof12 =-a[0]*a[7]+a[1]*a[6];
-
-  float cof20 = a[1]*a[5]-a[2]*a[4];
-  float cof21 =-a[0]*a[5]+a[2]*a[3];
-  float cof22 = a[0]*a[4]-a[1]*a[3];
-
-  float determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
-
-  determ = 1.0/determ;
-  inv[0] = cof00 * determ;
-  inv[1] = cof10 * determ;
-  inv[2] = cof20 * determ;
-
-  inv[3] = cof01 * determ;
-  inv[4] = cof11 * determ;
-  inv[5] = cof21 * determ;
-
-  inv[6] = cof02 * determ;
-  inv[7] = cof12 * determ;
-  inv[8] = cof22 * determ;
+void simitStoreCounters(int i) {
+  simit::ir::TimerStorage::getInstance().storeCounters(i);
 }
 
-double complexNorm_f64(double r, double i) {
-  return sqrt(r*r+i*i);
+void simitProfileRecord(int id, uint64_t start, uint64_t end) {
+  simit::internal::Profiler::getInstance().record(id, start, end);
 }
 
-float complexNorm_f32(float r, float i) {
-  return sqrt(r*r+i*i);
+uint64_t simitProfileTimestamp() {
+  return simit::internal::Profiler::timestamp();
 }
 
-void simitStoreTime(int i, double value) {
-  simit::ir::TimerStorage::getInstance().storeTime(i, value);
+void* simitMalloc(size_t size) {
+  return simit::internal::heapAllocate(size);
 }
 
-double simitClock() {
-  using namespace std::chrono;
-  auto t = high_resolution_clock::now();
-  time_point<high_resolution_clock,microseconds> usec = time_point_cast<microseconds>(t);
-  return (double)(usec.time_since_epoch().count());
+void simitFree(void* ptr) {
+  simit::internal::heapFree(ptr);
 }
 } // extern "C"
 
@@ -0,0 +1,167 @@
+#include <cmath>
+
+#include "runtime_math.h"
+
+// Runtime helpers that are called from generated code. These are compiled into
+// the Simit library, and also to LLVM bitcode that the LLVM backend links into
+// every module so that the helpers can be inlined and vectorized. They must
+// therefore not depend on anything but the C math library. The fast_ helpers
+// are the vectorizable approximations from runtime_math.h.
+
+extern "C" {
+int loc(int v0, int v1, int *neighbors_start, int *neighbors) {
+  int l = neighbors_start[v0];
+  while(neighbors[l] != v1) l++;
+  return l;
+}
+
+double atan2_f64(double y, double x) {
+  return atan2(y, x);
+}
+
+float atan2_f32(float y, float x) {
+  return atan2f(y, x);
+}
+
+double tan_f64(double x) {
+  return tan(x);
+}
+
+float tan_f32(float x) {
+  return tanf(x);
+}
+
+double asin_f64(double x) {
+  return asin(x);
+}
+
+float asin_f32(float x) {
+  return asinf(x);
+}
+
+double acos_f64(double x) {
+  return acos(x);
+}
+
+float acos_f32(float x) {
+  return acosf(x);
+}
+
+double det3_f64(double * a){
+  return a[0] * (a[4]*a[8]-a[5]*a[7])
+       - a[1] * (a[3]*a[8]-a[5]*a[6])
+       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+}
+
+float det3_f32(float * a){
+  return a[0] * (a[4]*a[8]-a[5]*a[7])
+       - a[1] * (a[3]*a[8]-a[5]*a[6])
+       + a[2] * (a[3]*a[7]-a[4]*a[6]);
+}
+
+void inv3_f64(double * a, double * inv){
+  double cof00 = a[4]*a[8]-a[5]*a[7];
+  double cof01 =-a[3]*a[8]+a[5]*a[6];
+  double cof02 = a[3]*a[7]-a[4]*a[6];
+
+  double cof10 =-a[1]*a[8]+a[2]*a[7];
+  double cof11 = a[0]*a[8]-a[2]*a[6];
+  double cof12 =-a[0]*a[7]+a[1]*a[6];
+
+  double cof20 = a[1]*a[5]-a[2]*a[4];
+  double cof21 =-a[0]*a[5]+a[2]*a[3];
+  double cof22 = a[0]*a[4]-a[1]*a[3];
+
+  double determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
+
+  determ = 1.0/determ;
+  inv[0] = cof00 * determ;
+  inv[1] = cof10 * determ;
+  inv[2] = cof20 * determ;
+
+  inv[3] = cof01 * determ;
+  inv[4] = cof11 * determ;
+  inv[5] = cof21 * determ;
+
+  inv[6] = cof02 * determ;
+  inv[7] = cof12 * determ;
+  inv[8] = cof22 * determ;
+}
+
+void inv3_f32(float * a, float * inv){
+  float cof00 = a[4]*a[8]-a[5]*a[7];
+  float cof01 =-a[3]*a[8]+a[5]*a[6];
+  float cof02 = a[3]*a[7]-a[4]*a[6];
+
+  float cof10 =-a[1]*a[8]+a[2]*a[7];
+  float cof11 = a[0]*a[8]-a[2]*a[6];
+  float cof12 =-a[0]*a[7]+a[1]*a[6];
+
+  float cof20 = a[1]*a[5]-a[2]*a[4];
+  float cof21 =-a[0]*a[5]+a[2]*a[3];
+  float cof22 = a[0]*a[4]-a[1]*a[3];
+
+  float determ = a[0] * cof00 + a[1] * cof01 + a[2]*cof02;
+
+  determ = 1.0/determ;
+  inv[0] = cof00 * determ;
+  inv[1] = cof10 * determ;
+  inv[2] = cof20 * determ;
+
+  inv[3] = cof01 * determ;
+  inv[4] = cof11 * determ;
+  inv[5] = cof21 * determ;
+
+  inv[6] = cof02 * determ;
+  inv[7] = cof12 * determ;
+  inv[8] = cof22 * determ;
+}
+
+double complexNorm_f64(double r, double i) {
+  return sqrt(r*r+i*i);
+}
+
+float complexNorm_f32(float r, float i) {
+  return sqrt(r*r+i*i);
+}
+
+float fast_sin_f32(float x) {
+  return simit::math::sin(x);
+}
+
+double fast_sin_f64(double x) {
+  return simit::math::sin(x);
+}
+
+float fast_cos_f32(float x) {
+  return simit::math::cos(x);
+}
+
+double fast_cos_f64(double x) {
+  return simit::math::cos(x);
+}
+
+float fast_exp_f32(float x) {
+  return simit::math::exp(x);
+}
+
+double fast_exp_f64(double x) {
+  return simit::math::exp(x);
+}
+
+float fast_log_f32(float x) {
+  return simit::math::log(x);
+}
+
+double fast_log_f64(double x) {
+  return simit::math::log(x);
+}
+
+float fast_atan2_f32(float y, float x) {
+  return simit::math::atan2(y, x);
+}
+
+float fast_pow_f32(float x, float y) {
+  return simit::math::pow(x, y);
+}
+} // extern "C"
@@ -0,0 +1,283 @@
+#ifndef SIMIT_RUNTIME_MATH_H
+#define SIMIT_RUNTIME_MATH_H
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+// Vectorizable approximations of transcendental functions. Generated code calls
+// them instead of libm when Settings::mathAccuracy is "fast". They are
+// branch-free polynomial approximations (after Cephes), so that once inlined
+// into a loop the loop can be vectorized. Maximum errors measured against long
+// double libm (test/runtime_math-tests.cpp, tools/simit-mathbench.cpp):
+//
+//   function  float                    double
+//   exp       1 ulp                    2 ulp
+//   log       1 ulp   (x >= 0)         1 ulp   (x >= 0)
+//   sin, cos  2 ulp   (|x| <= 8192)    2 ulp   (|x| <= 1e6)
+//   atan2     2 ulp
+//   pow       1 ulp   (x >= 0)
+//
+// Outside these domains sin and cos lose accuracy, and pow of negative x is NaN.
+// The double precision atan2 and pow, and tan, asin and acos, have no
+// approximation and always use libm.
+
+namespace simit {
+namespace math {
+
+namespace internal {
+inline int32_t asInt(float x) {int32_t i; std::memcpy(&i, &x, 4); return i;}
+inline float asFloat(int32_t i) {float x; std::memcpy(&x, &i, 4); return x;}
+inline int64_t asInt(double x) {int64_t i; std::memcpy(&i, &x, 8); return i;}
+inline double asDouble(int64_t i) {double x; std::memcpy(&x, &i, 8); return x;}
+
+/// Scales x by 2^n, for n in [-252,254], in two steps to reach denormals.
+inline float scale(float x, int32_t n) {
+  int32_t n0 = n / 2;
+  x *= asFloat((n0 + 127) << 23);
+  return x * asFloat((n - n0 + 127) << 23);
+}
+
+/// Scales x by 2^n, for n in [-2044,2046], in two steps to reach denormals.
+inline double scale(double x, int64_t n) {
+  int64_t n0 = n / 2;
+  x *= asDouble((n0 + 1023) << 52);
+  return x * asDouble((n - n0 + 1023) << 52);
+}
+
+/// Rounds x, which must be at least -offset, to the nearest integer. The offset
+/// makes the truncating conversion round down without calling libm floor.
+inline int32_t roundToInt(float x, int32_t offset) {
+  return (int32_t)(x + ((float)offset + 0.5f)) - offset;
+}
+inline int64_t roundToInt(double x, int64_t offset) {
+  return (int64_t)(x + ((double)offset + 0.5)) - offset;
+}
+}
+
+inline float exp(float x) {
+  const float hi = 88.7228391f;
+  const float lo = -103.972084f;
+  float xc = (x > hi) ? hi : ((x < lo) ? lo : x);
+  int32_t n = internal::roundToInt(xc * 1.44269504088896341f, 150);
+  float fn = (float)n;
+  float r = (xc - fn*0.693359375f) - fn*-2.12194440e-4f;
+  float p = ((((1.9875691500e-4f*r + 1.3981999507e-3f)*r + 8.3334519073e-3f)*r
+             + 4.1665795894e-2f)*r + 1.6666665459e-1f)*r + 5.0000001201e-1f;
+  p = p*(r*r) + r + 1.0f;
+  float result = internal::scale(p, n);
+  result = (x > hi) ? std::numeric_limits<float>::infinity() : result;
+  result = (x < lo) ? 0.0f : result;
+  return (x != x) ? x : result;
+}
+
+inline double exp(double x) {
+  const double hi = 709.782712893383973;
+  const double lo = -745.133219101941108;
+  double xc = (x > hi) ? hi : ((x < lo) ? lo : x);
+  int64_t n = internal::roundToInt(xc * 1.4426950408889634073599,
+                                   INT64_C(1075));
+  double fn = (double)n;
+  double r = (xc - fn*6.93145751953125e-1) - fn*1.42860682030941723212e-6;
+  double rr = r*r;
+  double px = r*((1.26177193074810590878e-4*rr + 3.02994407707441961300e-2)*rr
+                 + 9.99999999999999999910e-1);
+  double q = ((3.00198505138664455042e-6*rr + 2.52448340349684104192e-3)*rr
+              + 2.27265548208155028766e-1)*rr + 2.00000000000000000009e0;
+  double result = internal::scale(1.0 + 2.0*px/(q - px), n);
+  result = (x > hi) ? std::numeric_limits<double>::infinity() : result;
+  result = (x < lo) ? 0.0 : result;
+  return (x != x) ? x : result;
+}
+
+inline float log(float x) {
+  bool denormal = x < std::numeric_limits<float>::min();
+  int32_t bits = internal::asInt(denormal ? x*8388608.0f : x);
+  int32_t e = ((bits >> 23) & 0xff) - (denormal ? 126+23 : 126);
+  float m = internal::asFloat((bits & 0x807fffff) | 0x3f000000);
+  bool small = m < 0.707106781186547524f;
+  float fe = (float)(small ? e - 1 : e);
+  float t = small ? m + m - 1.0f : m - 1.0f;
+  float z = t*t;
+  float y = ((((((((7.0376836292e-2f*t - 1.1514610310e-1f)*t
+                   + 1.1676998740e-1f)*t - 1.2420140846e-1f)*t
+                 + 1.4249322787e-1f)*t - 1.6668057665e-1f)*t
+               + 2.0000714765e-1f)*t - 2.4999993993e-1f)*t
+             + 3.3333331174e-1f)*t*z;
+  y += -2.12194440e-4f*fe;
+  y += -0.5f*z;
+  float result = (t + y) + 0.693359375f*fe;
+  result = (x == std::numeric_limits<float>::infinity()) ? x : result;
+  result = (x == 0.0f) ? -std::numeric_limits<float>::infinity() : result;
+  return (x < 0.0f || x != x) ? std::numeric_limits<float>::quiet_NaN()
+                              : result;
+}
+
+namespace internal {
+/// Returns log(x) for positive finite x.
+inline double logKernel(double x) {
+  bool denormal = x < std::numeric_limits<double>::min();
+  int64_t bits = internal::asInt(denormal ? x*4503599627370496.0 : x);
+  int64_t e = ((bits >> 52) & 0x7ff) - (denormal ? 1022+52 : 1022);
+  double m = internal::asDouble((bits & INT64_C(0x800fffffffffffff)) |
+                                INT64_C(0x3fe0000000000000));
+  bool small = m < 0.70710678118654752440;
+  double fe = (double)(small ? e - 1 : e);
+  double t = small ? m + m - 1.0 : m - 1.0;
+  double z = t*t;
+  double p = ((((1.01875663804580931796e-4*t + 4.97494994976747001425e-1)*t
+                + 4.70579119878881725854e0)*t + 1.44989225341610930846e1)*t
+              + 1.79368678507819816313e1)*t + 7.70838733755885391666e0;
+  double q = ((((t + 1.12873587189167450590e1)*t + 4.52279145837532221105e1)*t
+               + 8.29875266912776603211e1)*t + 7.11544750618563894466e1)*t
+             + 2.31251620126765340583e1;
+  double y = t*(z*p/q);
+  y -= fe*2.121944400546905827679e-4;
+  y -= 0.5*z;
+  return (t + y) + fe*0.693359375;
+}
+}
+
+inline double log(double x) {
+  double result = internal::logKernel(x);
+  result = (x == std::numeric_limits<double>::infinity()) ? x : result;
+  result = (x == 0.0) ? -std::numeric_limits<double>::infinity() : result;
+  return (x < 0.0 || x != x) ? std::numeric_limits<double>::quiet_NaN()
+                             : result;
+}
+
+namespace internal {
+/// Reduces |x| to t in [-pi/4,pi/4] and returns the octant j (0, 2, 4 or 6)
+/// such that |x| = j*pi/4 + t. Float arguments are reduced in double. The
+/// octant count is clamped so that its conversion is defined for infinite,
+/// NaN and huge arguments, far outside the domains above.
+inline int32_t reduce(float ax, float *t) {
+  float octants = ax * 1.27323954473516268615f;
+  int32_t j = (int32_t)((octants < 1073741824.0f) ? octants : 1073741824.0f);
+  j += j & 1;
+  double y = (double)j;
+  *t = (float)(((ax - y*7.85398125648498535156e-1)
+                - y*3.77489470793079817668e-8) - y*2.69515142907905952645e-15);
+  return j & 7;
+}
+
+inline int64_t reduce(double ax, double *t) {
+  double octants = ax * 1.27323954473516268615;
+  int64_t j = (int64_t)((octants < 4611686018427387904.0)
+                        ? octants : 4611686018427387904.0);
+  j += j & 1;
+  double y = (double)j;
+  *t = ((ax - y*7.85398125648498535156e-1) - y*3.77489470793079817668e-8)
+       - y*2.69515142907905952645e-15;
+  return j & 7;
+}
+
+inline float sinPoly(float t, float z) {
+  return ((-1.9515295891e-4f*z + 8.3321608736e-3f)*z - 1.6666654611e-1f)*z*t
+         + t;
+}
+
+inline float cosPoly(float z) {
+  return ((2.443315711809948e-5f*z - 1.388731625493765e-3f)*z
+          + 4.166664568298827e-2f)*z*z - 0.5f*z + 1.0f;
+}
+
+inline double sinPoly(double t, double z) {
+  return t + t*z*(((((1.58962301576546568060e-10*z
+                      - 2.50507477628578072866e-8)*z
+                     + 2.75573136213857245213e-6)*z
+                    - 1.98412698295895385996e-4)*z
+                   + 8.33333333332211858878e-3)*z
+                  - 1.66666666666666307295e-1);
+}
+
+inline double cosPoly(double z) {
+  return 1.0 - 0.5*z + z*z*(((((-1.13585365213876817300e-11*z
+                                + 2.08757008419747316778e-9)*z
+                               - 2.75573141792967388112e-7)*z
+                              + 2.48015872888517045348e-5)*z
+                             - 1.38888888888730564116e-3)*z
+                            + 4.16666666666665929218e-2);
+}
+}
+
+inline float sin(float x) {
+  float ax = (x < 0.0f) ? -x : x;
+  float t;
+  int32_t j = internal::reduce(ax, &t);
+  float z = t*t;
+  float result = (j & 2) ? internal::cosPoly(z) : internal::sinPoly(t, z);
+  bool negative = (x < 0.0f) != ((j & 4) != 0);
+  result = negative ? -result : result;
+  return (ax == std::numeric_limits<float>::infinity() || x != x)
+         ? std::numeric_limits<float>::quiet_NaN() : result;
+}
+
+inline double sin(double x) {
+  double ax = (x < 0.0) ? -x : x;
+  double t;
+  int64_t j = internal::reduce(ax, &t);
+  double z = t*t;
+  double result = (j & 2) ? internal::cosPoly(z) : internal::sinPoly(t, z);
+  bool negative = (x < 0.0) != ((j & 4) != 0);
+  result = negative ? -result : result;
+  return (ax == std::numeric_limits<double>::infinity() || x != x)
+         ? std::numeric_limits<double>::quiet_NaN() : result;
+}
+
+inline float cos(float x) {
+  float ax = (x < 0.0f) ? -x : x;
+  float t;
+  int32_t j = internal::reduce(ax, &t);
+  float z = t*t;
+  float result = (j & 2) ? internal::sinPoly(t, z) : internal::cosPoly(z);
+  bool negative = ((j & 4) != 0) != ((j & 2) != 0);
+  result = negative ? -result : result;
+  return (ax == std::numeric_limits<float>::infinity() || x != x)
+         ? std::numeric_limits<float>::quiet_NaN() : result;
+}
+
+inline double cos(double x) {
+  double ax = (x < 0.0) ? -x : x;
+  double t;
+  int64_t j = internal::reduce(ax, &t);
+  double z = t*t;
+  double result = (j & 2) ? internal::sinPoly(t, z) : internal::cosPoly(z);
+  bool negative = ((j & 4) != 0) != ((j & 2) != 0);
+  result = negative ? -result : result;
+  return (ax == std::numeric_limits<double>::infinity() || x != x)
+         ? std::numeric_limits<double>::quiet_NaN() : result;
+}
+
+inline float atan2(float y, float x) {
+  double ax = (x < 0.0f) ? -x : x;
+  double ay = (y < 0.0f) ? -y : y;
+  double mx = (ax > ay) ? ax : ay;
+  double mn = (ax > ay) ? ay : ax;
+  double a = (mx == 0.0) ? 0.0 : mn/mx;
+  bool big = a > 0.414213562373095048;
+  double t = big ? (a - 1.0)/(a + 1.0) : a;
+  double z = t*t;
+  double result = (big ? 0.785398163397448310 : 0.0) +
+      ((((8.05374449538e-2*z - 1.38776856032e-1)*z + 1.99777106478e-1)*z
+        - 3.33329491539e-1)*z*t + t);
+  result = (ay > ax) ? 1.57079632679489662 - result : result;
+  result = (internal::asInt(x) < 0) ? 3.14159265358979324 - result : result;
+  result = (internal::asInt(y) < 0) ? -result : result;
+  return (x != x || y != y) ? std::numeric_limits<float>::quiet_NaN()
+                            : (float)result;
+}
+
+inline float pow(float x, float y) {
+  float result = (float)math::exp((double)y * internal::logKernel((double)x));
+  result = (x == 0.0f) ? ((y < 0.0f) ? std::numeric_limits<float>::infinity()
+                                     : 0.0f)
+                       : result;
+  result = (x < 0.0f || x != x || y != y)
+           ? std::numeric_limits<float>::quiet_NaN() : result;
+  return (y == 0.0f) ? 1.0f : result;
+}
+
+}}
+
+#endif
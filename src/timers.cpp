@@ -57,6 +57,51 @@ void printTimes() {
 
   printf("Total Time: %f (seconds)\n",
          simit::ir::TimerStorage::getInstance().getTotalTime() / 1000000.0);
+
+  const internal::PerfCounters* perfCounters =
+      TimerStorage::getInstance().getPerfCounters();
+  if (perfCounters == nullptr) {
+    return;
+  }
+  if (!perfCounters->isAvailable()) {
+    printf("Hardware counters unavailable: %s\n",
+           perfCounters->getError().c_str());
+    return;
+  }
+
+  // Per-line IPC and misses per thousand instructions
+  printf("\n%-*s %8s %12s %12s\n", LINE_LIMIT, "Hardware counters", "IPC",
+         "LLC MPKI", "dTLB MPKI");
+  size_t numLines = TimerStorage::getInstance().getNumTimedLines();
+  for (size_t i = 0; i < numLines; ++i) {
+    internal::PerfCounts counts = TimerStorage::getInstance().getCounts(i);
+    if (counts.cycles == 0 || counts.instructions == 0) {
+      continue;
+    }
+    string line = TimerStorage::getInstance().getTimedLine(i);
+    line = line.substr(0, line.find('\n'));
+    if (line.length() > LINE_LIMIT) {
+      line = line.substr(0, LINE_LIMIT);
+    }
+    double kiloInstructions = counts.instructions / 1000.0;
+    printf("%-*s %8.2f", LINE_LIMIT, line.c_str(),
+           (double)counts.instructions / counts.cycles);
+    if (perfCounters->hasCounter(internal::PerfCounters::LLCMisses)) {
+      printf(" %12.3f", counts.llcMisses / kiloInstructions);
+    } else {
+      printf(" %12s", "-");
+    }
+    if (perfCounters->hasCounter(internal::PerfCounters::DTLBMisses)) {
+      printf(" %12.3f", counts.dtlbMisses / kiloInstructions);
+    } else {
+      printf(" %12s", "-");
+    }
+    printf("\n");
+  }
+}
+
+bool enablePerfCounters() {
+  return TimerStorage::getInstance().enablePerfCounters();
 }
 
 // Singleton
@@ -69,43 +114,31 @@ class InsertTimers : public IRRewriter {
     }
     
     void visit(const TensorWrite *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+      stmt = time(util::toString(*op), op);
     }
 
     void visit(const FieldWrite *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+      stmt = time(util::toString(*op), op);
     }
     
     void visit(const Map *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+      stmt = time(util::toString(*op), op);
     }
     
     void visit(const Store *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+      stmt = time(util::toString(*op), op);
     }
     
     void visit(const CallStmt *op) {
       if (op->callee.getKind() == Func::Intrinsic) { 
-        Var timeStartVar = initTimer(util::toString(*op),stmt);
-        stmt = Block::make(stmt,op);
-        storeTimer(stmt, timeStartVar);
+        stmt = time(util::toString(*op), op);
       } else {
-        stmt = Block::make(stmt, op);
+        stmt = op;
       }
     }
     
     void visit(const AssignStmt *op) {
-      Var timeStartVar = initTimer(util::toString(*op),stmt);
-      stmt = Block::make(stmt,op);
-      storeTimer(stmt, timeStartVar);
+      stmt = time(util::toString(*op), op);
     }
     
     void visit(const IfThenElse *op) {
@@ -140,23 +173,31 @@ class InsertTimers : public IRRewriter {
     InsertTimers(InsertTimers const&)    = delete;
     void operator=(InsertTimers const&)  = delete;
 
-    Var initTimer(string line, Stmt& stmt) {
+    /// Surround op with clock calls, and hardware counter reads if they are
+    /// enabled, and store the elapsed time under the next timer index.
+    Stmt time(string line, Stmt op) {
       TimerStorage::getInstance().addTimedLine(line);
-      Stmt timeStartStmt =
-          CallStmt::make({getTimeVar()}, intrinsics::clock(), {});
-      stmt = Block::make(timeStartStmt, stmt);
-      return timeStartVar;
-    }
+      bool counters = TimerStorage::getInstance().perfCountersEnabled();
 
-    void storeTimer(Stmt& stmt, Var& timeStartVar) {
+      vector<Stmt> stmts;
+      stmts.push_back(CallStmt::make({getTimeVar()}, intrinsics::clock(), {}));
+      if (counters) {
+        stmts.push_back(CallStmt::make({}, intrinsics::startCounters(),
+                                       {counter}));
+      }
+      stmts.push_back(op);
+      if (counters) {
+        stmts.push_back(CallStmt::make({}, intrinsics::storeCounters(),
+                                       {counter}));
+      }
       Var clock("clock", Float);
-      Stmt clockDecl = VarDecl::make(clock);
-      Stmt clockStmt = CallStmt::make({clock}, intrinsics::clock(), {});
+      stmts.push_back(VarDecl::make(clock));
+      stmts.push_back(CallStmt::make({clock}, intrinsics::clock(), {}));
       Expr subtraction = Sub::make(clock, VarExpr::make(timeStartVar));
-      Stmt store = CallStmt::make({}, intrinsics::storeTime(),
-          {counter, subtraction});
-      stmt = Block::make({clockDecl, clockStmt, stmt, store});
+      stmts.push_back(CallStmt::make({}, intrinsics::storeTime(),
+                                     {counter, subtraction}));
       counter++;
+      return Block::make(stmts);
     }
 };
 
@@ -1,7 +1,10 @@
 #ifndef SIMIT_TIMERS_H
 #define SIMIT_TIMERS_H
 
+#include <memory>
+
 #include "ir.h"
+#include "perf_counters.h"
 
 namespace simit {
 namespace ir {
@@ -9,6 +12,11 @@ namespace ir {
 void printTimes();
 Func insertTimers(Func func);
 
+/// Also measure cycles, instructions, LLC misses and dTLB misses of timed
+/// statements, reported by printTimes. Returns false, and keeps timing only,
+/// if the hardware counters are unavailable.
+bool enablePerfCounters();
+
 // Singleton
 class TimerStorage {
 public:
@@ -29,6 +37,14 @@ public:
     timedLines.push_back(line);
   }
 
+  inline size_t getNumTimedLines() {
+    return timedLines.size();
+  }
+
+  inline const std::string& getTimedLine(size_t index) {
+    return timedLines[index];
+  }
+
   inline int getTimedLineIndex(std::string line) {
     size_t pos = find(timedLines.begin(), timedLines.end(),
         line.c_str()) - timedLines.begin();
@@ -47,6 +63,43 @@ public:
     timerSums[index] += time;
   }
 
+  inline bool enablePerfCounters() {
+    if (!perfCounters) {
+      perfCounters.reset(new internal::PerfCounters());
+    }
+    return perfCounters->isAvailable();
+  }
+
+  inline const internal::PerfCounters* getPerfCounters() {
+    return perfCounters.get();
+  }
+
+  inline bool perfCountersEnabled() {
+    return perfCounters && perfCounters->isAvailable();
+  }
+
+  inline void startCounters(size_t index) {
+    if (!perfCountersEnabled()) return;
+    if (counterStarts.size() < index + 1) {
+      counterStarts.resize(index + 1);
+    }
+    counterStarts[index] = perfCounters->read();
+  }
+
+  inline void storeCounters(size_t index) {
+    if (!perfCountersEnabled()) return;
+    internal::PerfCounts counts = perfCounters->read();
+    if (counterSums.size() < index + 1) {
+      counterSums.resize(index + 1);
+    }
+    counterSums[index] += counts - counterStarts[index];
+  }
+
+  inline internal::PerfCounts getCounts(size_t index) {
+    return (index < counterSums.size()) ? counterSums[index]
+                                        : internal::PerfCounts();
+  }
+
   inline double getTime(int index) {
     return timerSums[index];
   }
@@ -72,6 +125,9 @@ public:
     std::vector<std::string> timedLines;
     std::vector<double> timerSums;
     std::vector<unsigned long long int> timerCount;
+    std::unique_ptr<internal::PerfCounters> perfCounters;
+    std::vector<internal::PerfCounts> counterStarts;
+    std::vector<internal::PerfCounts> counterSums;
 
     TimerStorage() {};
     TimerStorage(TimerStorage const&)    = delete;
@@ -0,0 +1,437 @@
+#include "tune.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <sstream>
+
+#include "error.h"
+#include "graph.h"
+#include "program.h"
+#include "reorder.h"
+#include "util/collections.h"
+#include "util/util.h"
+
+using namespace std;
+
+namespace simit {
+
+typedef chrono::steady_clock Clock;
+
+/// Number of timed runs of each candidate, after a warm-up run.
+static const int kTunedRuns = 5;
+
+// Built-in knobs
+
+/// Hilbert reordering of an edge set and the vertex set of its endpoints. It
+/// applies to edge sets whose vertex set is bound, has a spatial field of
+/// doubles, and is not the endpoint set of other bound edge sets (whose
+/// endpoints reorder would not update).
+class ReorderKnob : public TuningKnob {
+public:
+  string getName() const {return "reorder";}
+
+  vector<string> getValues(const map<string,Set*>& sets) const {
+    Set *edges, *vertices;
+    if (findSets(sets, &edges, &vertices)) {
+      return {"none", "hilbert"};
+    }
+    return {"none"};
+  }
+
+  void apply(const string& value, Settings*, const map<string,Set*>& sets) {
+    if (value != "hilbert") {
+      return;
+    }
+    Set *edges, *vertices;
+    bool found = findSets(sets, &edges, &vertices);
+    iassert(found);
+    reorder(*edges, *vertices, edgeOrdering, vertexOrdering);
+  }
+
+  void revert(const string& value, const map<string,Set*>& sets) {
+    if (value != "hilbert") {
+      return;
+    }
+    Set *edges, *vertices;
+    bool found = findSets(sets, &edges, &vertices);
+    iassert(found);
+
+    // The edge ordering maps new to old edges and the vertex ordering maps old
+    // to new vertices, so each is undone by its inverse.
+    vector<int> edgeInverse(edgeOrdering.size());
+    for (size_t i = 0; i < edgeOrdering.size(); ++i) {
+      edgeInverse[edgeOrdering[i]] = i;
+    }
+    reorderEdgeSet(*edges, edgeInverse);
+
+    vector<int> vertexInverse(vertexOrdering.size());
+    for (size_t i = 0; i < vertexOrdering.size(); ++i) {
+      vertexInverse[vertexOrdering[i]] = i;
+    }
+    reorderVertexSet(*edges, *vertices, vertexInverse);
+  }
+
+private:
+  vector<int> edgeOrdering;
+  vector<int> vertexOrdering;
+
+  static bool findSets(const map<string,Set*>& sets, Set** edges,
+                       Set** vertices) {
+    for (auto& edgePair : sets) {
+      Set* edgeSet = edgePair.second;
+      if (edgeSet->getKind() != Set::Unstructured ||
+          edgeSet->getCardinality() == 0 || !edgeSet->isHomogeneous()) {
+        continue;
+      }
+      const Set* endpointSet = edgeSet->getEndpointSet(0);
+      Set* vertexSet = nullptr;
+      int edgeSets = 0;
+      for (auto& pair : sets) {
+        Set* set = pair.second;
+        if (set == endpointSet) {
+          vertexSet = set;
+        }
+        for (int i = 0; i < set->getCardinality(); ++i) {
+          if (set->getEndpointSet(i) == endpointSet) {
+            edgeSets++;
+            break;
+          }
+        }
+      }
+      if (vertexSet == nullptr || edgeSets != 1 ||
+          !vertexSet->hasSpatialField()) {
+        continue;
+      }
+      int spatialField =
+          vertexSet->getFieldIndex(vertexSet->getSpatialFieldName());
+      if (vertexSet->getFields()[spatialField]->type->getComponentType() !=
+          ComponentType::Double) {
+        continue;
+      }
+      *edges = edgeSet;
+      *vertices = vertexSet;
+      return true;
+    }
+    return false;
+  }
+};
+
+/// A boolean setting, that applies if the sets satisfy a predicate.
+class BoolSettingKnob : public TuningKnob {
+public:
+  typedef function<bool(const map<string,Set*>&)> Predicate;
+
+  BoolSettingKnob(const string& name, bool Settings::*setting,
+                  Predicate applies)
+      : name(name), setting(setting), applies(applies) {}
+
+  string getName() const {return name;}
+
+  vector<string> getValues(const map<string,Set*>& sets) const {
+    if (applies(sets)) {
+      return {"false", "true"};
+    }
+    return {"false"};
+  }
+
+  void apply(const string& value, Settings* settings,
+             const map<string,Set*>& sets) {
+    settings->*setting = (value == "true");
+  }
+
+private:
+  string name;
+  bool Settings::*setting;
+  Predicate applies;
+};
+
+static bool hasLatticeLinkSet(const map<string,Set*>& sets) {
+  for (auto& pair : sets) {
+    if (pair.second->getKind() == Set::LatticeLink) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static vector<shared_ptr<TuningKnob>>& knobRegistry() {
+  static vector<shared_ptr<TuningKnob>> knobs = {
+    make_shared<ReorderKnob>(),
+    make_shared<BoolSettingKnob>("indexlessStencils",
+                                 &Settings::indexlessStencils,
+                                 hasLatticeLinkSet),
+    make_shared<BoolSettingKnob>("specialize", &Settings::specialize,
+                                 [](const map<string,Set*>&) {return true;}),
+  };
+  return knobs;
+}
+
+void registerTuningKnob(std::shared_ptr<TuningKnob> knob) {
+  uassert(knob != nullptr) << "undefined tuning knob";
+  string name = knob->getName();
+  uassert(name != "" && name.find_first_of(" =\t\n") == string::npos)
+      << "invalid tuning knob name " << util::quote(name);
+  for (auto& registered : knobRegistry()) {
+    uassert(registered->getName() != name)
+        << "a tuning knob named " << util::quote(name)
+        << " is already registered";
+  }
+  knobRegistry().push_back(knob);
+}
+
+void unregisterTuningKnob(const std::string& name) {
+  vector<shared_ptr<TuningKnob>>& knobs = knobRegistry();
+  auto knob = find_if(knobs.begin(), knobs.end(),
+                      [&](const shared_ptr<TuningKnob>& registered) {
+                        return registered->getName() == name;
+                      });
+  uassert(knob != knobs.end())
+      << "no tuning knob named " << util::quote(name) << " is registered";
+  knobs.erase(knob);
+}
+
+std::vector<std::shared_ptr<TuningKnob>> getTuningKnobs() {
+  return knobRegistry();
+}
+
+// Tuning
+
+/// A copy of the fields of the sets, that restores them after a candidate has
+/// run.
+class FieldSnapshot {
+public:
+  FieldSnapshot(const map<string,Set*>& sets) {
+    for (auto& pair : sets) {
+      Set* set = pair.second;
+      for (Set::FieldData* field : set->getFields()) {
+        size_t bytes = field->getBytes(set->getSize());
+        const char* data = static_cast<const char*>(field->data);
+        fields.push_back({field, vector<char>(data, data + bytes)});
+      }
+    }
+  }
+
+  void restore() const {
+    for (auto& field : fields) {
+      if (!field.second.empty()) {
+        memcpy(field.first->data, field.second.data(), field.second.size());
+      }
+    }
+  }
+
+private:
+  vector<pair<Set::FieldData*, vector<char>>> fields;
+};
+
+/// Apply the knob values, and compile the function with the resulting
+/// settings and bind the sets to it. Returns an undefined function if the
+/// function does not compile.
+static Function prepare(Program& program, const string& function,
+                        const map<string,Set*>& sets,
+                        const vector<shared_ptr<TuningKnob>>& knobs,
+                        const map<string,string>& values,
+                        Settings settings) {
+  for (auto& knob : knobs) {
+    knob->apply(values.at(knob->getName()), &settings, sets);
+  }
+  init(settings);
+  Function compiled = program.compile(function);
+  if (compiled.defined()) {
+    for (auto& pair : sets) {
+      compiled.bind(pair.first, pair.second);
+    }
+  }
+  return compiled;
+}
+
+/// Returns the mean run time of the function with the knob values, or -1 if it
+/// fails to compile, bind or run. The sets are restored afterwards.
+static double measure(Program& program, const string& function,
+                      const map<string,Set*>& sets,
+                      const vector<shared_ptr<TuningKnob>>& knobs,
+                      const map<string,string>& values,
+                      const Settings& settings, const FieldSnapshot& snapshot,
+                      Clock::time_point deadline) {
+  double seconds = -1.0;
+  try {
+    Function compiled = prepare(program, function, sets, knobs, values,
+                                settings);
+    if (compiled.defined()) {
+      compiled.init();
+      compiled.unmapArgs();
+      compiled.run();
+      int runs = 0;
+      auto start = Clock::now();
+      do {
+        compiled.run();
+        ++runs;
+      } while (runs < kTunedRuns && Clock::now() < deadline);
+      seconds = chrono::duration<double>(Clock::now() - start).count() / runs;
+      compiled.mapArgs();
+    }
+  }
+  catch (SimitException&) {
+    seconds = -1.0;
+  }
+
+  for (auto it = knobs.rbegin(); it != knobs.rend(); ++it) {
+    (*it)->revert(values.at((*it)->getName()), sets);
+  }
+  snapshot.restore();
+  return seconds;
+}
+
+/// Hash of the program, function and the settings that change the generated
+/// code, and the size class of each set, that tuning results are cached under.
+static string cacheKey(const Program& program, const string& function,
+                       const map<string,Set*>& sets,
+                       const Settings& settings) {
+  stringstream text;
+  text << program << "\n" << function << "\n"
+       << settings.backend << " " << settings.floatSize << " "
+       << settings.indexlessStencils << " " << settings.targetCPU << " "
+       << settings.targetFeatures << " " << settings.optLevel << " "
+       << settings.fastMath << " " << settings.fpContract << " "
+       << settings.mathAccuracy << " " << settings.specialize << " "
+       << settings.fieldAlignment;
+  // 64-bit FNV-1a, which is stable across runs and platforms
+  uint64_t hash = 14695981039346656037ull;
+  for (char c : text.str()) {
+    hash = (hash ^ (unsigned char)c) * 1099511628211ull;
+  }
+
+  stringstream key;
+  key << hex << setw(16) << setfill('0') << hash << dec << " ";
+  for (auto it = sets.begin(); it != sets.end(); ++it) {
+    // Number of bits of the size, so sizes within a factor of two match
+    int sizeClass = 0;
+    for (int size = it->second->getSize(); size > 0; size >>= 1) {
+      sizeClass++;
+    }
+    key << (it != sets.begin() ? "," : "") << it->first << ":" << sizeClass;
+  }
+  return key.str();
+}
+
+/// Read the last values stored under the key in the cache file.
+static bool readCache(const string& cacheFile, const string& key,
+                      map<string,string>* values) {
+  ifstream cache(cacheFile);
+  bool found = false;
+  string line;
+  while (getline(cache, line)) {
+    if (line.compare(0, key.size() + 1, key + " ") != 0) {
+      continue;
+    }
+    values->clear();
+    for (const string& token : util::split(line.substr(key.size() + 1), " ")) {
+      vector<string> keyVal = util::split(token, "=");
+      if (keyVal.size() == 2) {
+        (*values)[keyVal[0]] = keyVal[1];
+      }
+    }
+    found = true;
+  }
+  return found;
+}
+
+static void writeCache(const string& cacheFile, const string& key,
+                       const map<string,string>& values) {
+  ofstream cache(cacheFile, ios::app);
+  if (!cache.good()) {
+    return;
+  }
+  cache << key;
+  for (auto& value : values) {
+    cache << " " << value.first << "=" << value.second;
+  }
+  cache << endl;
+}
+
+TuningResult tune(Program& program, const std::string& function,
+                  const std::map<std::string,Set*>& sets,
+                  double budgetSeconds, const std::string& cacheFile) {
+  uassert(budgetSeconds >= 0.0) << "negative tuning budget";
+  Settings settings = getSettings();
+  vector<shared_ptr<TuningKnob>> knobs = getTuningKnobs();
+  string key = cacheKey(program, function, sets, settings);
+
+  TuningResult result;
+  map<string,string> values;
+  for (auto& knob : knobs) {
+    values[knob->getName()] = knob->getValues(sets)[0];
+  }
+
+  // Use cached values if they are valid values of the registered knobs
+  map<string,string> cached;
+  if (cacheFile != "" && readCache(cacheFile, key, &cached)) {
+    result.cached = true;
+    for (auto& knob : knobs) {
+      vector<string> knobValues = knob->getValues(sets);
+      auto value = cached.find(knob->getName());
+      if (value == cached.end() ||
+          find(knobValues.begin(), knobValues.end(), value->second) ==
+              knobValues.end()) {
+        result.cached = false;
+        break;
+      }
+    }
+    if (result.cached) {
+      for (auto& knob : knobs) {
+        values[knob->getName()] = cached.at(knob->getName());
+      }
+    }
+  }
+
+  if (!result.cached) {
+    FieldSnapshot snapshot(sets);
+    Clock::time_point deadline = Clock::now() +
+        chrono::duration_cast<Clock::duration>(
+            chrono::duration<double>(budgetSeconds));
+
+    double best = measure(program, function, sets, knobs, values, settings,
+                          snapshot, deadline);
+    if (best < 0.0) {
+      init(settings);
+      uerror << "could not compile and run " << util::quote(function)
+             << " with the default tuning values";
+    }
+    result.defaultSeconds = best;
+
+    for (auto& knob : knobs) {
+      vector<string> knobValues = knob->getValues(sets);
+      for (size_t i = 1; i < knobValues.size(); ++i) {
+        if (Clock::now() >= deadline) {
+          break;
+        }
+        map<string,string> candidate = values;
+        candidate[knob->getName()] = knobValues[i];
+        double seconds = measure(program, function, sets, knobs, candidate,
+                                 settings, snapshot, deadline);
+        if (seconds >= 0.0 && seconds < best) {
+          best = seconds;
+          values = candidate;
+        }
+      }
+    }
+    result.seconds = best;
+
+    if (cacheFile != "") {
+      writeCache(cacheFile, key, values);
+    }
+  }
+
+  result.function = prepare(program, function, sets, knobs, values, settings);
+  uassert(result.function.defined())
+      << "could not compile " << util::quote(function);
+  result.values = values;
+  result.settings = getSettings();
+  return result;
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef SIMIT_TUNE_H
+#define SIMIT_TUNE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "function.h"
+#include "init.h"
+
+namespace simit {
+class Program;
+class Set;
+
+/// A performance choice that simit::tune can make, such as a compiler setting
+/// or a transformation of the bound sets. New knobs are added with
+/// registerTuningKnob.
+class TuningKnob {
+public:
+  virtual ~TuningKnob() {}
+
+  /// The name the knob's value is stored under.
+  virtual std::string getName() const = 0;
+
+  /// The values to try for a function bound to the sets. The first value is
+  /// the default, that is measured first. Knobs that do not apply to the sets
+  /// return only the default.
+  virtual std::vector<std::string>
+  getValues(const std::map<std::string,Set*>& sets) const = 0;
+
+  /// Apply a value before the function is compiled, by changing the settings
+  /// or the sets.
+  virtual void apply(const std::string& value, Settings* settings,
+                     const std::map<std::string,Set*>& sets) = 0;
+
+  /// Undo the changes the last apply of the value made to the sets.
+  virtual void revert(const std::string& value,
+                      const std::map<std::string,Set*>& sets) {}
+};
+
+/// Register a knob for simit::tune to choose. The built-in knobs are Hilbert
+/// reordering of an edge set and its vertex set ("reorder"), indexless
+/// stencils for lattice link sets ("indexlessStencils") and specialization to
+/// the set sizes ("specialize").
+void registerTuningKnob(std::shared_ptr<TuningKnob> knob);
+
+/// Remove the registered knob with the given name, e.g. a knob registered by
+/// a component that is being unloaded.
+void unregisterTuningKnob(const std::string& name);
+
+/// The registered knobs, in the order they are tuned.
+std::vector<std::shared_ptr<TuningKnob>> getTuningKnobs();
+
+/// The configuration simit::tune chose.
+struct TuningResult {
+  /// The chosen value of each knob.
+  std::map<std::string,std::string> values;
+  /// The settings the function was compiled with.
+  Settings settings;
+  /// Mean run time with the chosen values, and with the default values of all
+  /// knobs. Both are zero if the values were read from the cache.
+  double seconds = 0.0;
+  double defaultSeconds = 0.0;
+  /// True if the values were read from the cache.
+  bool cached = false;
+  /// The function compiled with the chosen values, bound to the sets.
+  Function function;
+};
+
+/// Choose the values of the registered knobs that minimize the run time of a
+/// function on the sets, that are bound to the function's arguments and
+/// externs by name. Knobs are tuned one at a time, keeping the best values of
+/// the previous knobs. Each candidate is compiled and run on the sets, and
+/// candidates that fail to compile or bind are skipped. Candidates are tried
+/// until the budget (in seconds) is spent. The fields of the sets are restored
+/// after each candidate runs.
+///
+/// The chosen values are stored in cacheFile, keyed by a hash of the program,
+/// the function and the active settings that change the generated code, and
+/// by the size class (power of two) of each set, so tuning the function on
+/// sets of similar sizes again reads them instead. An empty cacheFile
+/// disables the cache.
+///
+/// On return the sets are transformed by the chosen values (e.g. reordered)
+/// and the chosen settings are active, since they also affect how sets are
+/// bound to the function.
+TuningResult tune(Program& program, const std::string& function,
+                  const std::map<std::string,Set*>& sets,
+                  double budgetSeconds=10.0,
+                  const std::string& cacheFile="simit-tune.cache");
+
+}
+#endif
@@ -78,3 +78,109 @@ TEST(apply, edges_binary_gather) {
   ASSERT_EQ(3.0, (int)b(e0));
   ASSERT_EQ(5.0, (int)b(e1));
 }
+
+static const char* kLayoutProgram =
+    "element Vertex\n"
+    "  a : vector[3](float);\n"
+    "  b : vector[3](float);\n"
+    "  s : float;\n"
+    "end\n"
+    "extern V : set{Vertex};\n"
+    "func f(inout v : Vertex)\n"
+    "  x = v.a;\n"
+    "  v.a = 2.0 * v.a + v.s * v.b;\n"
+    "  v.b = x;\n"
+    "end\n"
+    "export func main()\n"
+    "  apply f to V;\n"
+    "end\n";
+
+/// Apply f to n vertices whose fields a and b have the given layout, and
+/// return the resulting values of a and b.
+static vector<double> applyWithLayout(FieldLayout layout, int n) {
+  Program program;
+  program.loadString(kLayoutProgram);
+  program.setFieldLayout("Vertex", "a", layout);
+  program.setFieldLayout("Vertex", "b", layout);
+
+  Set V;
+  FieldRef<simit_float,3> a = V.addField<simit_float,3>("a", layout);
+  FieldRef<simit_float,3> b = V.addField<simit_float,3>("b", layout);
+  FieldRef<simit_float> s = V.addField<simit_float>("s");
+  vector<ElementRef> vertices;
+  for (int i = 0; i < n; ++i) {
+    ElementRef v = V.add();
+    a.set(v, {1.0*i, 1.0*i + 0.25, 1.0*i + 0.5});
+    b.set(v, {-1.0*i, 2.0, 3.0*i});
+    s.set(v, 0.5*i);
+    vertices.push_back(v);
+  }
+
+  Function func = program.compile("main");
+  if (!func.defined()) return {};
+  func.bind("V", &V);
+  func.runSafe();
+
+  vector<double> values;
+  for (ElementRef v : vertices) {
+    for (int j = 0; j < 3; ++j) {
+      values.push_back(a(v)(j));
+      values.push_back(b(v)(j));
+    }
+  }
+  return values;
+}
+
+TEST(apply, fieldLayouts) {
+  vector<double> aos = applyWithLayout(FieldLayout::aos(), 11);
+  ASSERT_EQ(66u, aos.size());
+  ASSERT_EQ(2.0 * 3 + 1.5 * -3, aos[6*3]);
+  ASSERT_EQ(3.25, aos[6*3 + 3]);
+
+  ASSERT_EQ(aos, applyWithLayout(FieldLayout::soa(), 11));
+  // 11 vertices leave a partial last tile
+  ASSERT_EQ(aos, applyWithLayout(FieldLayout::aosoa(4), 11));
+  ASSERT_EQ(aos, applyWithLayout(FieldLayout::aosoa(16), 11));
+}
+
+TEST(apply, fieldLayoutsPerProgram) {
+  Program soa;
+  soa.loadString(kLayoutProgram);
+  soa.setFieldLayout("Vertex", "a", FieldLayout::soa());
+  ASSERT_THROW(soa.setFieldLayout("Vertex", "c", FieldLayout::soa()),
+               SimitException);
+
+  // Layouts are not shared by programs with the same element types
+  Program aos;
+  aos.loadString(kLayoutProgram);
+  Set V;
+  FieldRef<simit_float,3> a = V.addField<simit_float,3>("a");
+  V.addField<simit_float,3>("b");
+  V.addField<simit_float>("s");
+  ElementRef v = V.add();
+  a.set(v, {1.0, 2.0, 3.0});
+  Function func = aos.compile("main");
+  if (!func.defined()) FAIL();
+  func.bind("V", &V);
+  func.runSafe();
+  ASSERT_EQ(4.0, (double)a(v)(1));
+
+  // Sets must have the layout the function was compiled for
+  Function soaFunc = soa.compile("main");
+  if (!soaFunc.defined()) FAIL();
+  ASSERT_THROW(soaFunc.bind("V", &V), SimitException);
+}
+
+TEST(apply, fieldLayoutsWholeField) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  a : vector[3](float);\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "export func main()\n"
+      "  V.a = 2.0 * V.a;\n"
+      "end\n");
+  program.setFieldLayout("Vertex", "a", FieldLayout::aosoa(4));
+  ASSERT_THROW(program.compile("main"), SimitException);
+}
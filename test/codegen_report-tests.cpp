@@ -0,0 +1,126 @@
+#include "simit-test.h"
+
+#include <sstream>
+
+#include "graph.h"
+#include "program.h"
+#include "codegen_report.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(CodegenReport, print) {
+  CodegenReport report;
+  FunctionCodegen function;
+  function.name = "main";
+  function.instructions = 40;
+  function.spills = 2;
+  function.calls["loc"] = 3;
+  report.add(function);
+
+  LoopCodegen loop;
+  loop.function = "main";
+  loop.loop = "e";
+  loop.instructions = 30;
+  loop.vectorWidth = 4;
+  report.add(loop);
+  report.add(CodegenRemark{"passed", "loop-vectorize", "main",
+                           "vectorized loop"});
+
+  ASSERT_EQ(1u, report.getLoops("main", "e").size());
+  ASSERT_EQ(0u, report.getLoops("main", "v").size());
+
+  stringstream ss;
+  report.print(ss);
+  string table = ss.str();
+  ASSERT_NE(string::npos, table.find("loc (3)"));
+  ASSERT_NE(string::npos, table.find("main: e"));
+  ASSERT_NE(string::npos, table.find("vectorized loop"));
+}
+
+TEST(CodegenReport, function) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  a : float;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func f(inout v : Vertex)\n"
+      "  v.a = 2.0 * v.a;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply f to V;\n"
+      "end\n");
+  Function func = program.compile("main");
+  if (!func.defined()) FAIL();
+
+  CodegenReport report = func.getCodegenReport();
+  const FunctionCodegen* main = nullptr;
+  for (const FunctionCodegen& function : report.getFunctions()) {
+    if (function.name == "main") {
+      main = &function;
+    }
+  }
+  ASSERT_NE(nullptr, main);
+  ASSERT_LT(0u, main->instructions);
+
+  size_t loops = 0;
+  for (const LoopCodegen& loop : report.getLoops()) {
+    if (loop.function == "main") {
+      ASSERT_LT(0u, loop.instructions);
+      ASSERT_LE(1, loop.vectorWidth);
+      ++loops;
+    }
+  }
+  ASSERT_EQ(1u, loops);
+}
+
+// The springs time step updates the point fields in place (x = x + h*v). The
+// alias metadata of field accesses lets these loops vectorize without runtime
+// alias checks. The loop that assembles the spring forces scatters into the
+// points through the endpoints, and is not required to vectorize.
+TEST(CodegenReport, springsVectorize) {
+  Program program;
+  program.loadString(
+      "element Point\n"
+      "  x : vector[3](float);\n"
+      "  v : vector[3](float);\n"
+      "  m : float;\n"
+      "end\n"
+      "element Spring\n"
+      "  k  : float;\n"
+      "  l0 : float;\n"
+      "end\n"
+      "extern points  : set{Point};\n"
+      "extern springs : set{Spring}(points,points);\n"
+      "const h = 1e-6;\n"
+      "func compute_a(s : Spring, p : (Point*2))\n"
+      "    -> (a : vector[points](vector[3](float)))\n"
+      "  dx = p(1).x - p(0).x;\n"
+      "  l = norm(dx);\n"
+      "  fe0 = (s.k * (l-s.l0)) * (dx/l);\n"
+      "  a(p(0)) =  (1.0/p(0).m) * fe0;\n"
+      "  a(p(1)) = -(1.0/p(1).m) * fe0;\n"
+      "end\n"
+      "export func timestep()\n"
+      "  a = map compute_a to springs reduce +;\n"
+      "  points.v = points.v + h*a;\n"
+      "  points.x = points.x + points.v;\n"
+      "end\n");
+  Function func = program.compile("timestep");
+  if (!func.defined()) FAIL();
+
+  CodegenReport report = func.getCodegenReport();
+  size_t loops = 0;
+  size_t vectorized = 0;
+  for (const LoopCodegen& loop : report.getLoops()) {
+    if (loop.function == "timestep") {
+      ++loops;
+      if (loop.vectorWidth > 1) {
+        ++vectorized;
+      }
+    }
+  }
+  ASSERT_LT(0u, loops);
+  ASSERT_LT(0u, vectorized) << report;
+}
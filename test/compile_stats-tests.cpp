@@ -0,0 +1,73 @@
+#include "simit-test.h"
+
+#include <sstream>
+
+#include "graph.h"
+#include "program.h"
+#include "compile_stats.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(CompileStats, print) {
+  CompilePass lowerMaps;
+  lowerMaps.name = "Lower Maps";
+  lowerMaps.seconds = 1e-3;
+  lowerMaps.sizeBefore = 40;
+  lowerMaps.sizeAfter = 55;
+
+  CompilePass codegen;
+  codegen.name = "Generate Machine Code";
+  codegen.seconds = 3e-3;
+
+  CompileStats stats;
+  stats.addPass(lowerMaps);
+  stats.addPass(codegen);
+  ASSERT_DOUBLE_EQ(4e-3, stats.getTotalSeconds());
+
+  stringstream ss;
+  stats.print(ss);
+  string table = ss.str();
+
+  // Passes are listed in the order they ran, followed by the total
+  ASSERT_LT(table.find("Lower Maps"), table.find("Generate Machine Code"));
+  ASSERT_LT(table.find("Generate Machine Code"), table.find("Total"));
+  ASSERT_NE(string::npos, table.find("55"));
+  ASSERT_NE(string::npos, table.find("25.0"));
+}
+
+TEST(CompileStats, program) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  a : int;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func f(inout v : Vertex)\n"
+      "  v.a = 2 * v.a;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply f to V;\n"
+      "end\n");
+  Function func = program.compile("main");
+  if (!func.defined()) FAIL();
+
+  const vector<CompilePass>& passes = program.getCompileStats().getPasses();
+  map<string,CompilePass> passesByName;
+  for (const CompilePass& pass : passes) {
+    passesByName[pass.name] = pass;
+  }
+  ASSERT_TRUE(passesByName.find("Lower Maps") != passesByName.end());
+  ASSERT_TRUE(passesByName.find("Emit LLVM IR") != passesByName.end());
+  ASSERT_TRUE(passesByName.find("Optimize LLVM IR") != passesByName.end());
+  ASSERT_TRUE(passesByName.find("Generate Machine Code") !=
+              passesByName.end());
+  ASSERT_GT(passesByName["Lower Maps"].sizeBefore, 0u);
+  ASSERT_GT(passesByName["Emit LLVM IR"].sizeAfter, 0u);
+  ASSERT_GT(program.getCompileStats().getTotalSeconds(), 0.0);
+
+  // Stats are replaced by the next compile
+  size_t numPasses = passes.size();
+  program.compile("main");
+  ASSERT_EQ(numPasses, program.getCompileStats().getPasses().size());
+}
@@ -1,10 +1,16 @@
 #include "simit-test.h"
 
+#include "init.h"
 #include "tensor.h"
 #include "tensor_data.h"
 #include "graph.h"
 #include "ir.h"
+#include "ir_queries.h"
+#include "frontend/frontend.h"
+#include "program_context.h"
+#include "lower/lower.h"
 #include "lower/index_expressions/lower_scatter_workspace.h"
+#include "lower/lower_accesses.h"
 
 using namespace simit::ir;
 
@@ -41,6 +47,312 @@ TEST(Function, bindSet) {
   SIMIT_ASSERT_FLOAT_EQ(-44, field(p2));
 }
 
+TEST(Function, specializeSetSizes) {
+  Type vertexType = ElementType::make("Vertex", {Field("field", Int)});
+  Type vertexSetType = UnstructuredSetType::make(vertexType, {});
+  Var V("V", vertexSetType);
+  Var i("i", Int);
+  Stmt neg =
+      ForRange::make(i, 0, Length::make(IndexSet(V)),
+                     Store::make(FieldRead::make(V, "field"), i,
+                                 -Load::make(FieldRead::make(V, "field"), i)));
+
+  // Create environment and compile with specialization enabled
+  Environment env;
+  env.addExtern(V);
+  bool specialize = simit::kSpecialize;
+  simit::kSpecialize = true;
+  simit::Function function = getTestBackend()->compile(neg, env);
+  simit::kSpecialize = specialize;
+
+  // Run on a set with three elements
+  simit::Set VArg;
+  auto field = VArg.addField<int>("field");
+  simit::ElementRef p0 = VArg.add();
+  simit::ElementRef p1 = VArg.add();
+  simit::ElementRef p2 = VArg.add();
+  field(p0) = 42;
+  field(p1) = 43;
+  field(p2) = 44;
+  function.bind("V", &VArg);
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-42, field(p0));
+  SIMIT_ASSERT_FLOAT_EQ(-43, field(p1));
+  SIMIT_ASSERT_FLOAT_EQ(-44, field(p2));
+
+  // Rebinding a set of another size must not reuse the specialized code
+  simit::Set UArg;
+  auto ufield = UArg.addField<int>("field");
+  simit::ElementRef q0 = UArg.add();
+  simit::ElementRef q1 = UArg.add();
+  ufield(q0) = 1;
+  ufield(q1) = 2;
+  function.bind("V", &UArg);
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-1, ufield(q0));
+  SIMIT_ASSERT_FLOAT_EQ(-2, ufield(q1));
+}
+
+TEST(Function, specializationsEvicted) {
+  Type vertexType = ElementType::make("Vertex", {Field("field", Int)});
+  Type vertexSetType = UnstructuredSetType::make(vertexType, {});
+  Var V("V", vertexSetType);
+  Var i("i", Int);
+  Stmt neg =
+      ForRange::make(i, 0, Length::make(IndexSet(V)),
+                     Store::make(FieldRead::make(V, "field"), i,
+                                 -Load::make(FieldRead::make(V, "field"), i)));
+  Environment env;
+  env.addExtern(V);
+
+  // Bind the set to an extern, and to an argument, which the harness passes
+  // to the specialization of each init
+  bool specialize = simit::kSpecialize;
+  simit::kSpecialize = true;
+  std::vector<simit::Function> functions;
+  functions.push_back(getTestBackend()->compile(neg, env));
+  functions.push_back(getTestBackend()->compile(Func("neg", {V}, {}, neg)));
+  simit::kSpecialize = specialize;
+
+  for (simit::Function& function : functions) {
+    // Run on sets of many sizes, so that old specializations are evicted
+    std::vector<size_t> jitBytes;
+    for (int size = 1; size <= 16; ++size) {
+      simit::Set VArg;
+      auto field = VArg.addField<int>("field");
+      std::vector<simit::ElementRef> elements;
+      for (int j = 0; j < size; ++j) {
+        elements.push_back(VArg.add());
+        field(elements.back()) = j;
+      }
+      function.bind("V", &VArg);
+      function.runSafe();
+      for (int j = 0; j < size; ++j) {
+        ASSERT_EQ(-j, (int)field(elements[j]));
+      }
+      jitBytes.push_back(
+          function.memoryReport().getAllocatedBytes("jit code"));
+    }
+
+    // The code of the evicted specializations is freed
+    ASSERT_LT(jitBytes.back(), 2 * jitBytes[3]);
+  }
+}
+
+TEST(Function, copyInterleavedElements) {
+  // x = V.a(v); V.b(v) = x; copies elements between fields whose components
+  // are not contiguous
+  Type vec3 = TensorType::make(ScalarType::Int, {IndexDomain(3)});
+  Type vertexType = ElementType::make("Vertex", {Field("a", vec3),
+                                                 Field("b", vec3)});
+  Var V("V", UnstructuredSetType::make(vertexType, {}));
+  Var v("v", Int);
+  Var x("x", vec3);
+  Stmt body = Block::make({
+      VarDecl::make(x),
+      AssignStmt::make(x, TensorRead::make(FieldRead::make(V, "a"), {v})),
+      TensorWrite::make(FieldRead::make(V, "b"), {v}, x)});
+  // The function checks the layouts of bound sets against its environment's
+  simit::FieldLayouts layouts;
+  layouts.set("Vertex", "a", simit::FieldLayout::aosoa(4));
+  layouts.set("Vertex", "b", simit::FieldLayout::soa());
+  Environment env;
+  env.addExtern(V);
+  env.setFieldLayouts(layouts);
+  Func func("copy", {}, {},
+            ForRange::make(v, 0, Length::make(IndexSet(V)), body), env);
+  Storage storage;
+  storage.add(x, TensorStorage::Kind::Dense);
+  func.setStorage(storage);
+
+  simit::Function function =
+      getTestBackend()->compile(lowerTensorAccesses(func, layouts), storage);
+
+  simit::Set VArg;
+  auto a = VArg.addField<int,3>("a", simit::FieldLayout::aosoa(4));
+  auto b = VArg.addField<int,3>("b", simit::FieldLayout::soa());
+  simit::Set::ElementRange elements = VArg.addMany(5);
+  for (int i = 0; i < 5; ++i) {
+    a.set(elements[i], {i, 10*i, 100*i});
+  }
+  function.bind("V", &VArg);
+  function.runSafe();
+  for (int i = 0; i < 5; ++i) {
+    for (int j = 0; j < 3; ++j) {
+      ASSERT_EQ((int)a(elements[i])(j), (int)b(elements[i])(j));
+    }
+  }
+  ASSERT_EQ(400, (int)b(elements[4])(2));
+
+  // Other uses of a whole element are rejected
+  Stmt add = ForRange::make(v, 0, Length::make(IndexSet(V)),
+      TensorWrite::make(FieldRead::make(V, "b"), {v},
+                        TensorRead::make(FieldRead::make(V, "a"), {v})));
+  ASSERT_THROW(lowerTensorAccesses(Func("add", {}, {}, add, env), layouts),
+               simit::SimitException);
+}
+
+TEST(Function, runSafeTracksChanges) {
+  Type vertexType = ElementType::make("Vertex", {Field("a", Int),
+                                                 Field("b", Int)});
+  Type vertexSetType = UnstructuredSetType::make(vertexType, {});
+  Var V("V", vertexSetType);
+  Var i("i", Int);
+  Stmt neg =
+      ForRange::make(i, 0, Length::make(IndexSet(V)),
+                     Store::make(FieldRead::make(V, "b"), i,
+                                 -Load::make(FieldRead::make(V, "a"), i)));
+  Environment env;
+  env.addExtern(V);
+
+  // The function only writes b
+  auto written = getWrittenFields(Func("neg", {}, {}, neg, env));
+  ASSERT_EQ(1u, written.size());
+  ASSERT_EQ(std::set<std::string>({"b"}), written["V"]);
+
+  // ... also when a function it calls writes it
+  Func callee("neg", {}, {}, neg, env);
+  written = getWrittenFields(Func("main", {}, {},
+                                  CallStmt::make({}, callee, {}), env));
+  ASSERT_EQ(std::set<std::string>({"b"}), written["V"]);
+
+  simit::Function function = getTestBackend()->compile(neg, env);
+  simit::Set VArg;
+  auto a = VArg.addField<int>("a");
+  auto b = VArg.addField<int>("b");
+  simit::ElementRef p0 = VArg.add();
+  simit::ElementRef p1 = VArg.add();
+  a(p0) = 1;
+  a(p1) = 2;
+  function.bind("V", &VArg);
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-2, b(p1));
+
+  // Adding elements makes runSafe initialize the function again
+  size_t topologyVersion = VArg.getTopologyVersion();
+  simit::ElementRef p2 = VArg.add();
+  ASSERT_LT(topologyVersion, VArg.getTopologyVersion());
+  a(p2) = 3;
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-3, b(p2));
+
+  // Runs mark the fields they write as written
+  const auto& fields = VArg.getFields();
+  size_t aVersion = fields[VArg.getFieldIndex("a")]->version;
+  size_t bVersion = fields[VArg.getFieldIndex("b")]->version;
+  function.runSafe();
+  ASSERT_EQ(aVersion, fields[VArg.getFieldIndex("a")]->version);
+  ASSERT_LT(bVersion, fields[VArg.getFieldIndex("b")]->version);
+}
+
+TEST(Function, argumentSetGrows) {
+  Type vertexType = ElementType::make("Vertex", {Field("a", Int),
+                                                 Field("b", Int)});
+  Type vertexSetType = UnstructuredSetType::make(vertexType, {});
+  Var V("V", vertexSetType);
+  Var i("i", Int);
+  Stmt neg =
+      ForRange::make(i, 0, Length::make(IndexSet(V)),
+                     Store::make(FieldRead::make(V, "b"), i,
+                                 -Load::make(FieldRead::make(V, "a"), i)));
+  simit::Function function =
+      getTestBackend()->compile(Func("neg", {V}, {}, neg));
+
+  simit::Set VArg;
+  auto a = VArg.addField<int>("a");
+  auto b = VArg.addField<int>("b");
+  simit::ElementRef p0 = VArg.add();
+  a(p0) = 1;
+  function.bind("V", &VArg);
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-1, b(p0));
+
+  // Growing the set past its capacity moves its fields, so the function must
+  // be called with the new set
+  simit::Set::ElementRange elements = VArg.addMany(1000);
+  for (int j = 0; j < 1000; ++j) {
+    a(elements[j]) = j;
+  }
+  function.runSafe();
+  SIMIT_ASSERT_FLOAT_EQ(-1, b(p0));
+  for (int j = 0; j < 1000; ++j) {
+    ASSERT_EQ(-j, (int)b(elements[j]));
+  }
+}
+
+TEST(Function, argumentEdgesAdded) {
+  std::string source =
+      "element Vertex                                       \n"
+      "  a : float;                                         \n"
+      "  b : float;                                         \n"
+      "end                                                  \n"
+      "element Edge                                         \n"
+      "  w : float;                                         \n"
+      "end                                                  \n"
+      "extern V : set{Vertex};                              \n"
+      "extern E : set{Edge}(V,V);                           \n"
+      "func asm(e : Edge, v : (Vertex*2))                   \n"
+      "    -> (K : tensor[V,V](float))                      \n"
+      "  K(v(0),v(0)) = e.w;                                \n"
+      "  K(v(0),v(1)) = e.w;                                \n"
+      "  K(v(1),v(0)) = e.w;                                \n"
+      "  K(v(1),v(1)) = e.w;                                \n"
+      "end                                                  \n"
+      "export func main()                                   \n"
+      "  K = map asm to E reduce +;                         \n"
+      "  V.b = K * V.a;                                     \n"
+      "end                                                  \n";
+  simit::internal::Frontend frontend;
+  simit::internal::ProgramContext ctx;
+  std::vector<simit::ParseError> errors;
+  ASSERT_EQ(0, frontend.parseString(source, &ctx, &errors));
+
+  // Pass the sets to main as arguments
+  Func main = ctx.getFunctions().at("main");
+  std::vector<Var> sets;
+  for (const VarMapping& ext : main.getEnvironment().getExterns()) {
+    sets.push_back(ext.getVar());
+  }
+  Func func = lower(Func("main", sets, {}, main.getBody()));
+
+  simit::Set V;
+  simit::Set E(V,V);
+  simit::FieldRef<simit_float> a = V.addField<simit_float>("a");
+  simit::FieldRef<simit_float> b = V.addField<simit_float>("b");
+  simit::FieldRef<simit_float> w = E.addField<simit_float>("w");
+  std::vector<simit::ElementRef> vertices;
+  for (int i = 0; i < 4; ++i) {
+    vertices.push_back(V.add());
+    a(vertices[i]) = i+1;
+  }
+  for (int i = 0; i < 3; ++i) {
+    w(E.add(vertices[i], vertices[i+1])) = 1.0;
+  }
+  simit::Function function = getTestBackend()->compile(func);
+  function.bind("V", &V);
+  function.bind("E", &E);
+  function.runSafe();
+
+  // Added edges are merged into the index of the assembled matrix, which
+  // must match the matrix of a function that builds its index from scratch
+  w(E.add(vertices[0], vertices[3])) = 2.0;
+  w(E.add(vertices[1], vertices[0])) = 3.0;
+  function.runSafe();
+  std::vector<simit_float> updated;
+  for (const simit::ElementRef& v : vertices) {
+    updated.push_back(b(v));
+  }
+
+  simit::Function fresh = getTestBackend()->compile(func);
+  fresh.bind("V", &V);
+  fresh.bind("E", &E);
+  fresh.runSafe();
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    SIMIT_ASSERT_FLOAT_EQ(b(vertices[i]), updated[i]);
+  }
+  SIMIT_ASSERT_FLOAT_EQ(6*1 + 4*2 + 2*4, updated[0]);
+}
+
 TEST(Function, bindScalar) {
   Var a("a", Int);
   Var b("b", Int);
@@ -1,8 +1,10 @@
 #include "simit-test.h"
 
+#include <algorithm>
 #include <vector>
 
 #include "graph.h"
+#include "init.h"
 
 using namespace std;
 using namespace simit;
@@ -61,6 +63,244 @@ TEST(Set, IncreaseCapacity) {
   ASSERT_EQ(count, 1029);
 }
 
+TEST(Set, AddMany) {
+  Set myset;
+  auto fld = myset.addField<int>("foo");
+  ElementRef first = myset.add();
+  fld.set(first, 42);
+
+  FieldRef<int> ref = fld;
+  myset.reserve(5000);
+  Set::ElementRange range = myset.addMany(4000);
+  ASSERT_EQ(4000, range.getSize());
+  ASSERT_EQ(4001, myset.getSize());
+  ASSERT_EQ(1, range[0].getIdent());
+  ASSERT_EQ(4000, range[3999].getIdent());
+
+  int count = 0;
+  for (ElementRef elem : range) {
+    ASSERT_EQ(0, fld.get(elem));
+    fld.set(elem, count++);
+  }
+  ASSERT_EQ(4000, count);
+
+  // Geometric growth past the reserved capacity keeps the field data
+  myset.addMany(10000);
+  ASSERT_EQ(14001, myset.getSize());
+  ASSERT_EQ(42, ref.get(first));
+  ASSERT_EQ(3999, ref.get(range[3999]));
+  ASSERT_EQ(0, myset.addMany(0).getSize());
+}
+
+TEST(Set, Alignment) {
+  Settings settings = getSettings();
+  settings.fieldAlignment = 128;
+  init(settings);
+  Set points;
+  Set edges(points, points);
+  settings.fieldAlignment = 64;
+  init(settings);
+  ASSERT_EQ(128u, points.getAlignment());
+
+  points.addField<double,3>("x");
+  edges.addField<float>("w");
+  Set::ElementRange p = points.addMany(3000);
+  ElementRef last;
+  for (int i = 0; i < 3000; ++i) {
+    last = edges.add(p[i], p[(i+1) % 3000]);
+  }
+  ASSERT_EQ(0u, (uintptr_t)points.getFieldData("x") % 128);
+  ASSERT_EQ(0u, (uintptr_t)edges.getFieldData("w") % 128);
+  ASSERT_EQ(0u, (uintptr_t)edges.getEndpointsData() % 128);
+  ASSERT_EQ(p[0], edges.getEndpoint(last, 1));
+
+  settings.fieldAlignment = 24;
+  ASSERT_THROW(init(settings), SimitException);
+  ASSERT_EQ(64, getSettings().fieldAlignment);
+}
+
+TEST(Set, Versions) {
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x");
+  Set::FieldData* field = points.getFields()[0];
+
+  size_t topologyVersion = points.getTopologyVersion();
+  ElementRef p = points.add();
+  ASSERT_LT(topologyVersion, points.getTopologyVersion());
+  topologyVersion = points.getTopologyVersion();
+  points.addMany(10);
+  ASSERT_LT(topologyVersion, points.getTopologyVersion());
+
+  size_t version = field->version;
+  const FieldRef<double,3>& constX = x;
+  ASSERT_EQ(0.0, constX(p)(0));
+  ASSERT_EQ(version, field->version);
+  x.set(p, {1.0, 2.0, 3.0});
+  ASSERT_LT(version, field->version);
+  version = field->version;
+  x(p)(1) = 4.0;
+  ASSERT_LT(version, field->version);
+  version = field->version;
+  points.getFieldData("x");
+  ASSERT_LT(version, field->version);
+}
+
+TEST(Set, Remove) {
+  Set points;
+  Set edges(points, points);
+  FieldRef<int,2> x = points.addField<int,2>("x");
+  FieldRef<int> w = edges.addField<int>("w");
+  Set::ElementRange p = points.addMany(4);
+  for (int i = 0; i < 4; ++i) {
+    x.set(p[i], {i, 10*i});
+  }
+  ElementRef e01 = edges.add(p[0], p[1]);
+  ElementRef e13 = edges.add(p[1], p[3]);
+  ElementRef e32 = edges.add(p[3], p[2]);
+  w(e01) = 1;
+  w(e13) = 2;
+  w(e32) = 3;
+
+  // The last point takes the place of the removed point, and the edge that
+  // connected the removed point is removed
+  points.remove(p[1]);
+  ASSERT_EQ(3, points.getSize());
+  ASSERT_EQ(3, x(p[1])(0));
+  ASSERT_EQ(30, x(p[1])(1));
+  ASSERT_EQ(1, edges.getSize());
+  ASSERT_EQ(3, (int)w(e01));
+  ASSERT_EQ(p[1], edges.getEndpoint(e01, 0));
+  ASSERT_EQ(p[2], edges.getEndpoint(e01, 1));
+}
+
+TEST(Set, RemoveSwap) {
+  // Without edge sets the last element is moved into the removed one's place
+  Set points;
+  FieldRef<double,3> x = points.addField<double,3>("x", FieldLayout::soa());
+  FieldRef<int,2> y = points.addField<int,2>("y", FieldLayout::aosoa(4));
+  Set::ElementRange p = points.addMany(6);
+  for (int i = 0; i < 6; ++i) {
+    x.set(p[i], {1.0*i, 2.0*i, 3.0*i});
+    y.set(p[i], {i, -i});
+  }
+  size_t version = points.getTopologyVersion();
+  points.remove(p[1]);
+  points.add();
+  points.remove(p[5]);
+  points.remove(p[0]);
+  ASSERT_EQ(4, points.getSize());
+  ASSERT_EQ(4.0, x(p[0])(0));
+  ASSERT_EQ(15.0, x(p[1])(2));
+  ASSERT_EQ(-4, y(p[0])(1));
+  ASSERT_EQ(5, y(p[1])(0));
+  ASSERT_EQ(3, y(p[3])(0));
+
+  vector<int> remap;
+  ASSERT_TRUE(points.getRemapSince(version, 6, &remap));
+  ASSERT_EQ(vector<int>({-1, -1, 2, 3, 0, 1}), remap);
+
+  // Vacated slots are zeroed
+  ElementRef q = points.add();
+  ASSERT_EQ(0.0, x(q)(1));
+  ASSERT_EQ(0, y(q)(1));
+}
+
+TEST(Set, RemoveMany) {
+  Set points;
+  Set edges(points, points);
+  FieldRef<double,3> x = points.addField<double,3>("x", FieldLayout::soa());
+  FieldRef<int,2> y = points.addField<int,2>("y", FieldLayout::aosoa(4));
+  FieldRef<int> w = edges.addField<int>("w");
+  Set::ElementRange p = points.addMany(10);
+  for (int i = 0; i < 10; ++i) {
+    x.set(p[i], {1.0*i, 2.0*i, 3.0*i});
+    y.set(p[i], {i, -i});
+  }
+  for (int i = 0; i < 9; ++i) {
+    w(edges.add(p[i], p[i+1])) = i;
+  }
+
+  size_t topologyVersion = edges.getTopologyVersion();
+  vector<int> remap = points.removeMany({p[2], p[7], p[2]});
+  ASSERT_EQ(8, points.getSize());
+  ASSERT_EQ(vector<int>({0, 1, -1, 2, 3, 4, 5, -1, 6, 7}), remap);
+  for (int i = 0; i < 10; ++i) {
+    if (remap[i] != -1) {
+      ElementRef q = p[remap[i]];
+      ASSERT_EQ(1.0*i, x(q)(0));
+      ASSERT_EQ(2.0*i, x(q)(1));
+      ASSERT_EQ(3.0*i, x(q)(2));
+      ASSERT_EQ(i, y(q)(0));
+      ASSERT_EQ(-i, y(q)(1));
+    }
+  }
+
+  // Edges 1-2, 2-3, 6-7 and 7-8 connected removed points
+  ASSERT_LT(topologyVersion, edges.getTopologyVersion());
+  ASSERT_EQ(5, edges.getSize());
+  vector<int> weights = {0, 3, 4, 5, 8};
+  int e = 0;
+  for (ElementRef edge : edges) {
+    int i = weights[e++];
+    ASSERT_EQ(i, (int)w(edge));
+    ASSERT_EQ(p[remap[i]], edges.getEndpoint(edge, 0));
+    ASSERT_EQ(p[remap[i+1]], edges.getEndpoint(edge, 1));
+  }
+
+  // Added elements start out zeroed
+  ElementRef q = points.add();
+  ASSERT_EQ(0.0, x(q)(2));
+  ASSERT_EQ(0, y(q)(1));
+
+  ASSERT_THROW(points.removeMany({p[9]}), SimitException);
+  Set latticePoints;
+  Set lattice(latticePoints, {2, 2});
+  ASSERT_THROW(latticePoints.remove(p[0]), SimitException);
+}
+
+TEST(Set, ExternalField) {
+  Set points;
+  Set edges(points, points);
+  Set::ElementRange p = points.addMany(3);
+  FieldRef<int> a = points.addField<int>("a");
+
+  // The fields and endpoints read and write the caller's arrays
+  alignas(64) double x[4][2] = {{1, 2}, {3, 4}, {5, 6}, {0, 0}};
+  FieldRef<double,2> xref =
+      points.addExternalField<double,2>("x", &x[0][0], 4);
+  ASSERT_EQ(3.0, xref(p[1])(0));
+  xref.set(p[2], {7.0, 8.0});
+  ASSERT_EQ(8.0, x[2][1]);
+  int eps[6] = {0, 1, 1, 2, 0, 0};
+  Set::ElementRange e = edges.addExternalEdges(eps, 2, 3);
+  ASSERT_EQ(2, edges.getSize());
+  ASSERT_EQ(p[2], edges.getEndpoint(e[1], 1));
+  edges.add(p[2], p[0]);
+  ASSERT_EQ(2, eps[4]);
+
+  // Elements are added up to the capacity of the arrays, and removed in them
+  ElementRef q = points.add();
+  a(q) = 4;
+  ASSERT_THROW(points.add(), SimitException);
+  ASSERT_THROW(edges.add(p[0], p[0]), SimitException);
+  points.remove(p[0]);
+  ASSERT_EQ(0.0, x[0][0]);
+  ASSERT_EQ(4, (int)a(p[0]));
+  ASSERT_EQ(1, edges.getSize());
+  ASSERT_EQ(1, eps[0]);
+  ASSERT_EQ(2, eps[1]);
+
+  MemoryReport report = points.memoryReport();
+  ASSERT_EQ(0u, report.getAllocatedBytes("external field"));
+  ASSERT_THROW(points.addExternalField<double>("y", &x[0][0], 2),
+               SimitException);
+  ASSERT_THROW(points.addExternalField<double>("y", &x[0][1], 4),
+               SimitException);
+  ASSERT_THROW((points.addExternalField<double,2>("y", &x[0][0], 4,
+                                                  FieldLayout::soa())),
+               SimitException);
+}
+
 TEST(Set, FieldAccessByName) {
   Set myset;
   
@@ -228,6 +468,78 @@ TEST(Field, boolean) {
   ASSERT_TRUE(b(p1));
 }
 
+TEST(Field, SoA) {
+  Set points;
+  FieldRef<int,3> x = points.addField<int,3>("x", FieldLayout::soa());
+  FieldRef<int> i = points.addField<int>("i", FieldLayout::soa());
+  ASSERT_EQ(FieldLayout::soa(), x.getLayout());
+
+  // Grow past the initial capacity
+  Set::ElementRange p = points.addMany(2000);
+  for (int e = 0; e < 2000; ++e) {
+    x.set(p[e], {e, 2*e, 3*e});
+    i.set(p[e], e);
+  }
+  x(p[1])(2) = -1;
+  for (int e = 0; e < 2000; ++e) {
+    ASSERT_EQ(e, x(p[e])(0));
+    ASSERT_EQ(2*e, x(p[e])(1));
+    ASSERT_EQ((e == 1) ? -1 : 3*e, x(p[e])(2));
+    ASSERT_EQ(e, (int)i(p[e]));
+  }
+
+  // Packed components are getSize() apart
+  points.packFields();
+  const int* data = static_cast<const int*>(points.getFieldData("x"));
+  ASSERT_EQ(7, data[7]);
+  ASSERT_EQ(14, data[2000 + 7]);
+  ASSERT_EQ(21, data[4000 + 7]);
+  ASSERT_EQ(-1, data[4000 + 1]);
+  ASSERT_EQ(6000*sizeof(int), points.getFields()[0]->getBytes(2000));
+
+  ElementRef last = points.add();
+  x.set(last, {1, 2, 3});
+  ASSERT_EQ(1999, x(p[1999])(0));
+  ASSERT_EQ(2*1999, x(p[1999])(1));
+  ASSERT_EQ(3*1999, x(p[1999])(2));
+  ASSERT_EQ(3, x(last)(2));
+}
+
+TEST(Field, AoSoA) {
+  Set points;
+  FieldRef<double,2,2> m =
+      points.addField<double,2,2>("m", FieldLayout::aosoa(4));
+
+  Set::ElementRange p = points.addMany(1030);
+  for (int e = 0; e < 1030; ++e) {
+    m.set(p[e], {1.0*e, 2.0*e, 3.0*e, 4.0*e});
+  }
+  for (int e = 0; e < 1030; ++e) {
+    ASSERT_EQ(1.0*e, m(p[e])(0,0));
+    ASSERT_EQ(2.0*e, m(p[e])(0,1));
+    ASSERT_EQ(3.0*e, m(p[e])(1,0));
+    ASSERT_EQ(4.0*e, m(p[e])(1,1));
+  }
+
+  // Tiles of 4 elements store each component together
+  const double* data = static_cast<const double*>(points.getFieldData("m"));
+  ASSERT_EQ(5.0, data[16 + 1]);
+  ASSERT_EQ(10.0, data[16 + 4 + 1]);
+  ASSERT_EQ(20.0, data[16 + 12 + 1]);
+  ASSERT_EQ(1032*4*sizeof(double), points.getFields()[0]->getBytes(1030));
+}
+
+TEST(FieldLayout, ElementOffset) {
+  ASSERT_EQ(15u, FieldLayout::aos().getElementOffset(5, 3));
+  ASSERT_EQ(5u, FieldLayout::soa().getElementOffset(5, 3));
+  ASSERT_EQ(13u, FieldLayout::aosoa(4).getElementOffset(5, 3));
+  ASSERT_EQ(4u, FieldLayout::aosoa(4).getComponentStride(100));
+  ASSERT_EQ(100u, FieldLayout::soa().getComponentStride(100));
+  ASSERT_EQ(8u, FieldLayout::aosoa(4).getAllocatedElements(5));
+  ASSERT_TRUE(FieldLayout::soa().isAoS(1));
+  ASSERT_THROW(FieldLayout::aosoa(0), SimitException);
+}
+
 TEST(EdgeSet, CreateAndGetEdge) {
   Set points;
 
@@ -287,6 +599,84 @@ TEST(EdgeSet, EdgeIteratorTest) {
   ASSERT_EQ(count, 4);
 }
 
+TEST(EdgeSet, AddEdges) {
+  Set points;
+  Set::ElementRange p = points.addMany(3);
+  Set edges(points, points);
+  FieldRef<int> y = edges.addField<int>("y");
+  ElementRef e0 = edges.add(p[0], p[1]);
+  y.set(e0, 7);
+
+  vector<int> endpoints;
+  for (int i = 0; i < 2000; ++i) {
+    endpoints.push_back(i % 3);
+    endpoints.push_back((i+1) % 3);
+  }
+  Set::ElementRange range = edges.addEdges(endpoints.data(), 2000);
+  ASSERT_EQ(2000, range.getSize());
+  ASSERT_EQ(2001, edges.getSize());
+  ASSERT_EQ(7, y.get(e0));
+  ASSERT_EQ(p[1], edges.getEndpoint(e0, 1));
+  for (int i = 0; i < 2000; ++i) {
+    ASSERT_EQ(i % 3, edges.getEndpoint(range[i], 0).getIdent());
+    ASSERT_EQ((i+1) % 3, edges.getEndpoint(range[i], 1).getIdent());
+    ASSERT_EQ(0, y.get(range[i]));
+  }
+
+  int invalid[2] = {0, 3};
+  ASSERT_THROW(edges.addEdges(invalid, 1), SimitException);
+  ASSERT_EQ(2001, edges.getSize());
+  ASSERT_THROW(points.addEdges(invalid, 1), SimitException);
+  ASSERT_THROW(edges.addMany(1), SimitException);
+}
+
+TEST(EdgeSet, Lattice) {
+  Set points;
+  Set links(points, {3, 2});
+  FieldRef<int> w = links.addField<int>("w");
+  ASSERT_EQ(6, points.getSize());
+  ASSERT_EQ(12, links.getSize());
+
+  // Points and links are numbered by their coordinates, with the direction
+  // of a link innermost
+  ASSERT_EQ(4, links.getLatticePoint({1,1}).getIdent());
+  ElementRef l200 = links.getLatticeLink({2,0}, 0);
+  ElementRef l111 = links.getLatticeLink({1,1}, 1);
+  ASSERT_EQ(4, l200.getIdent());
+  ASSERT_EQ(9, l111.getIdent());
+
+  // A link connects its point to the next point in its direction, with
+  // periodic boundaries
+  ASSERT_EQ(links.getLatticePoint({2,0}), links.getEndpoint(l200, 0));
+  ASSERT_EQ(links.getLatticePoint({0,0}), links.getEndpoint(l200, 1));
+  ASSERT_EQ(links.getLatticePoint({1,1}), links.getEndpoint(l111, 0));
+  ASSERT_EQ(links.getLatticePoint({1,0}), links.getEndpoint(l111, 1));
+  ElementRef l000 = links.getLatticeLink({0,0}, 0);
+  ASSERT_EQ(links.getLatticePoint({1,0}), links.getEndpoint(l000, 1));
+  vector<ElementRef> eps;
+  for (ElementRef ep : links.getEndpoints(l111)) {
+    eps.push_back(ep);
+  }
+  ASSERT_EQ(2u, eps.size());
+  ASSERT_EQ(links.getEndpoint(l111, 1), eps[1]);
+
+  // The endpoints are only stored when their array is requested
+  w.set(l111, 3);
+  ASSERT_EQ(3, w.get(l111));
+  ASSERT_EQ(0u, links.memoryReport().getAllocatedBytes("endpoints"));
+  const int* endpoints = links.getEndpointsData();
+  for (ElementRef link : links) {
+    ASSERT_EQ(links.getEndpoint(link, 0).getIdent(),
+              endpoints[link.getIdent()*2]);
+    ASSERT_EQ(links.getEndpoint(link, 1).getIdent(),
+              endpoints[link.getIdent()*2 + 1]);
+  }
+  ASSERT_EQ(12*2*sizeof(int),
+            links.memoryReport().getAllocatedBytes("endpoints"));
+  ASSERT_THROW(links.add(links.getEndpoint(l000, 0),
+                         links.getEndpoint(l000, 1)), SimitException);
+}
+
 TEST(GraphGenerator, createBox) {
   Set points;
   Set edges(points, points);
@@ -322,3 +712,138 @@ TEST(GraphGenerator, createBox) {
 
   ASSERT_EQ(box.getEdges().size(), 54u);
 }
+
+TEST(GraphGenerator, createBoxNonCubic) {
+  Set points;
+  Set edges(points, points);
+  Box box = createBox(&points, &edges, 2, 3, 4);
+  ASSERT_EQ(24, points.getSize());
+  ASSERT_EQ(12u + 16u + 18u, box.getEdges().size());
+  ASSERT_TRUE(box.getEdge(box(0,2,3), box(1,2,3)).defined());
+  ASSERT_TRUE(box.getEdge(box(1,1,3), box(1,2,3)).defined());
+  ASSERT_TRUE(box.getEdge(box(1,2,2), box(1,2,3)).defined());
+  ASSERT_FALSE(box.getEdge(box(1,2,3), box(1,2,2)).defined());
+  ASSERT_FALSE(box.getEdge(box(0,0,0), box(1,1,0)).defined());
+}
+
+TEST(GraphGenerator, createTetGrid) {
+  Set verts;
+  Set tets(verts, verts, verts, verts);
+  FieldRef<double,3> x = verts.addField<double,3>("x");
+
+  vector<ElementRef> refs = createTetGrid(&verts, &tets, 3, 4, 5);
+  setGridPositions(refs, 3, 4, 5, x);
+  ASSERT_EQ(60, verts.getSize());
+  ASSERT_EQ(6*2*3*4, tets.getSize());
+
+  // Every tetrahedron is positively oriented and fills a sixth of a cell
+  for (ElementRef tet : tets) {
+    ElementRef p[4];
+    for (int i = 0; i < 4; ++i) {
+      p[i] = tets.getEndpoint(tet, i);
+    }
+    double d[3][3];
+    for (int i = 0; i < 3; ++i) {
+      for (int j = 0; j < 3; ++j) {
+        d[i][j] = x.get(p[i+1])(j) - x.get(p[0])(j);
+      }
+    }
+    double det = d[0][0]*(d[1][1]*d[2][2] - d[1][2]*d[2][1])
+               - d[0][1]*(d[1][0]*d[2][2] - d[1][2]*d[2][0])
+               + d[0][2]*(d[1][0]*d[2][1] - d[1][1]*d[2][0]);
+    ASSERT_DOUBLE_EQ(1.0, det);
+  }
+}
+
+TEST(GraphGenerator, createSpringNetwork) {
+  Set points;
+  Set springs(points, points);
+  FieldRef<double,3> x = points.addField<double,3>("x");
+
+  vector<ElementRef> refs = createSpringNetwork(&points, &springs, 2, 3, 4);
+  ASSERT_EQ(24, points.getSize());
+  // Axis, face-diagonal and cell-diagonal springs
+  ASSERT_EQ((1*3*4 + 2*2*4 + 2*3*3) + (1*2*4 + 1*3*3 + 2*2*3) + 1*2*3,
+            springs.getSize());
+
+  // Perturbed positions only depend on the seed
+  setGridPositions(refs, 2, 3, 4, x, 0.5, 0.25, 7);
+  vector<double> first;
+  for (ElementRef p : points) {
+    for (int i = 0; i < 3; ++i) {
+      first.push_back(x.get(p)(i));
+    }
+  }
+  setGridPositions(refs, 2, 3, 4, x, 0.5, 0.25, 7);
+  size_t i = 0;
+  for (ElementRef p : points) {
+    for (int j = 0; j < 3; ++j) {
+      ASSERT_EQ(first[i++], x.get(p)(j));
+    }
+  }
+  ASSERT_NEAR(1.5, x.get(refs[23])(2), 0.125);
+  ASSERT_NE(1.5, x.get(refs[23])(2));
+}
+
+TEST(GraphGenerator, createRMATGraph) {
+  Set vertices;
+  Set edges(vertices, vertices);
+  createRMATGraph(&vertices, &edges, 10, 8000);
+  ASSERT_EQ(1024, vertices.getSize());
+  ASSERT_EQ(8000, edges.getSize());
+
+  vector<int> degrees(1024, 0);
+  for (ElementRef edge : edges) {
+    ElementRef source = edges.getEndpoint(edge, 0);
+    ElementRef sink = edges.getEndpoint(edge, 1);
+    ASSERT_NE(source, sink);
+    degrees[source.getIdent()]++;
+  }
+  // The degree distribution is skewed
+  ASSERT_GT(*max_element(degrees.begin(), degrees.end()), 8*8);
+
+  // The graph only depends on the seed
+  Set vertices2;
+  Set edges2(vertices2, vertices2);
+  createRMATGraph(&vertices2, &edges2, 10, 8000);
+  for (ElementRef edge : edges) {
+    ASSERT_EQ(edges.getEndpoint(edge, 0), edges2.getEndpoint(edge, 0));
+    ASSERT_EQ(edges.getEndpoint(edge, 1), edges2.getEndpoint(edge, 1));
+  }
+
+  // ... and not on the standard library
+  Set vertices3;
+  Set edges3(vertices3, vertices3);
+  createRMATGraph(&vertices3, &edges3, 4, 6);
+  vector<pair<int,int>> expected = {{13,4}, {4,1}, {4,7}, {6,4}, {4,6}, {6,7}};
+  vector<pair<int,int>> endpoints;
+  for (ElementRef edge : edges3) {
+    endpoints.push_back({edges3.getEndpoint(edge, 0).getIdent(),
+                         edges3.getEndpoint(edge, 1).getIdent()});
+  }
+  ASSERT_EQ(expected, endpoints);
+}
+
+TEST(GraphGenerator, createRMATGraphSelfLoops) {
+  // Probabilities that only draw diagonal quadrants only draw self-loops
+  Set vertices;
+  Set edges(vertices, vertices);
+  ASSERT_THROW(createRMATGraph(&vertices, &edges, 4, 10, 1.0, 0.0, 0.0),
+               SimitException);
+  ASSERT_THROW(createRMATGraph(&vertices, &edges, 1, 10, 0.5, 0.0, 0.0),
+               SimitException);
+  ASSERT_EQ(0, edges.getSize());
+
+  // Probabilities that rarely leave the diagonal give up on redrawing
+  ASSERT_THROW(createRMATGraph(&vertices, &edges, 1, 10, 0.5, 1e-9, 0.0),
+               SimitException);
+
+  // A single level with some off-diagonal probability has no self-loops
+  Set vertices2;
+  Set edges2(vertices2, vertices2);
+  createRMATGraph(&vertices2, &edges2, 1, 100, 0.4, 0.1, 0.1);
+  ASSERT_EQ(100, edges2.getSize());
+  for (ElementRef edge : edges2) {
+    ASSERT_NE(edges2.getEndpoint(edge, 0), edges2.getEndpoint(edge, 1));
+  }
+}
@@ -0,0 +1,30 @@
+#include "simit-test.h"
+
+#include "loop_traffic.h"
+#include "util/util.h"
+
+using namespace std;
+using namespace simit;
+using namespace simit::ir;
+
+TEST(LoopTraffic, tripCount) {
+  TripCount unknown;
+  ASSERT_FALSE(unknown.isKnown());
+  ASSERT_FALSE((unknown * TripCount(3)).isKnown());
+  ASSERT_EQ("?", util::toString(unknown));
+
+  TripCount block(3);
+  ASSERT_TRUE(block.isConstant());
+  ASSERT_EQ("3", util::toString(block));
+
+  TripCount rows = TripCount::size("V");
+  TripCount row = TripCount::size("A_index") / rows;
+  ASSERT_FALSE(row.isConstant());
+  ASSERT_EQ("A_index/V", util::toString(row));
+  ASSERT_EQ("3*A_index", util::toString(block * rows * row));
+
+  map<string,size_t> sizes = {{"V", 4}, {"A_index", 10}};
+  ASSERT_DOUBLE_EQ(2.5, row.evaluate(sizes));
+  ASSERT_DOUBLE_EQ(30.0, (block * rows * row).evaluate(sizes));
+  ASSERT_DOUBLE_EQ(-1.0, TripCount::size("E").evaluate(sizes));
+}
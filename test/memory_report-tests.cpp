@@ -0,0 +1,174 @@
+#include "simit-test.h"
+
+#include <fstream>
+#include <sstream>
+
+#include "graph.h"
+#include "heap.h"
+#include "program.h"
+#include "memory_report.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(MemoryReport, print) {
+  MemoryReport report;
+  report.add("field", "V.x", 96, 1024);
+  report.add("temporary", "tmp", 200, 200);
+  report.setPeakHeapBytes(4096);
+  ASSERT_EQ(296u, report.getBytes());
+  ASSERT_EQ(1224u, report.getAllocatedBytes());
+  ASSERT_EQ(1024u, report.getAllocatedBytes("field"));
+  ASSERT_EQ(0u, report.getAllocatedBytes("tensor"));
+
+  stringstream ss;
+  report.print(ss);
+  string table = ss.str();
+  ASSERT_NE(string::npos, table.find("V.x"));
+  ASSERT_NE(string::npos, table.find("temporary"));
+  ASSERT_NE(string::npos, table.find("4096"));
+}
+
+TEST(MemoryReport, heap) {
+  size_t before = internal::heapBytes();
+  internal::resetHeapPeak();
+  void* a = internal::heapAllocate(100);
+  void* b = internal::heapAllocateZeroed(50);
+  ASSERT_EQ(100u, internal::heapAllocationSize(a));
+  ASSERT_EQ(0, ((char*)b)[49]);
+  ASSERT_EQ(before + 150, internal::heapBytes());
+  internal::heapFree(a);
+  internal::heapFree(b);
+  internal::heapFree(nullptr);
+  ASSERT_EQ(before, internal::heapBytes());
+  ASSERT_EQ(before + 150, internal::heapPeakBytes());
+}
+
+TEST(MemoryReport, set) {
+  Set V;
+  V.setName("V");
+  FieldRef<double,3> x = V.addField<double,3>("x");
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  x.set(v0, {1.0, 2.0, 3.0});
+
+  Set E(V,V);
+  E.setName("E");
+  E.add(v0, v1);
+
+  MemoryReport vreport = V.memoryReport();
+  ASSERT_EQ(1u, vreport.getUsages().size());
+  const MemoryUsage& usage = vreport.getUsages()[0];
+  ASSERT_EQ("field", usage.kind);
+  ASSERT_EQ("V.x", usage.name);
+  ASSERT_EQ(2*3*sizeof(double), usage.bytes);
+  ASSERT_LE(usage.bytes, usage.allocatedBytes);
+
+  MemoryReport ereport = E.memoryReport();
+  ASSERT_EQ(1u, ereport.getUsages().size());
+  ASSERT_EQ("endpoints", ereport.getUsages()[0].kind);
+  ASSERT_EQ(2*sizeof(int), ereport.getUsages()[0].bytes);
+}
+
+TEST(MemoryReport, placement) {
+  Settings settings = getSettings();
+  for (string placement : {"firsttouch", "interleave"}) {
+    settings.memoryPlacement = placement;
+    settings.placementThreads = 3;
+    init(settings);
+
+    // Placed buffers are zeroed, and the report counts their resident pages
+    Set V;
+    FieldRef<double> x = V.addField<double>("x");
+    Set::ElementRange v = V.addMany(1 << 18);
+    ASSERT_EQ(0.0, (double)x(v[(1 << 18) - 1]));
+    void* tmp = internal::heapAllocate(3 << 20);
+    ASSERT_EQ(0, ((char*)tmp)[(3 << 20) - 1]);
+    internal::heapFree(tmp);
+
+    MemoryReport report = V.memoryReport();
+    vector<size_t> pageNodes = report.getUsages()[0].pageNodes;
+    ASSERT_EQ(pageNodes, report.getPageNodes());
+    size_t pages = 0;
+    for (size_t nodePages : pageNodes) {
+      pages += nodePages;
+    }
+    ASSERT_EQ(pageNodes.empty(), pages == 0);
+  }
+  settings.memoryPlacement = "default";
+  settings.placementThreads = 0;
+  init(settings);
+
+  settings.memoryPlacement = "local";
+  ASSERT_THROW(init(settings), SimitException);
+  ASSERT_EQ("default", getSettings().memoryPlacement);
+}
+
+TEST(MemoryReport, hugePages) {
+  // Transparent huge pages back the large buffers (also when the huge page
+  // pool is empty), unless they are disabled
+  ifstream thpFile("/sys/kernel/mm/transparent_hugepage/enabled");
+  string thpModes;
+  getline(thpFile, thpModes);
+  bool thpEnabled = thpModes.find("[always]") != string::npos ||
+                    thpModes.find("[madvise]") != string::npos;
+
+  Settings settings = getSettings();
+  for (string hugePages : {"transparent", "hugetlbfs"}) {
+    settings.hugePages = hugePages;
+    settings.hugePageThreshold = 1 << 20;
+    init(settings);
+
+    // Large buffers are aligned to huge pages
+    Set V;
+    FieldRef<double> x = V.addField<double>("x");
+    Set::ElementRange v = V.addMany(1 << 19);
+    x(v[(1 << 19) - 1]) = 1.0;
+    ASSERT_EQ(0u, (uintptr_t)V.getFieldData("x") % (2 << 20));
+    void* tmp = internal::heapAllocateZeroed(3 << 20);
+    ASSERT_EQ(0, ((char*)tmp)[(3 << 20) - 1]);
+    internal::heapFree(tmp);
+
+    if (thpEnabled) {
+      ASSERT_LT(0u, V.memoryReport().getHugePageBytes());
+    }
+  }
+  settings.hugePages = "transparent";
+  settings.hugePageThreshold = 4 << 20;
+  init(settings);
+
+  settings.hugePages = "always";
+  ASSERT_THROW(init(settings), SimitException);
+  settings.hugePages = "none";
+  settings.hugePageThreshold = 0;
+  ASSERT_THROW(init(settings), SimitException);
+  ASSERT_EQ("transparent", getSettings().hugePages);
+}
+
+TEST(MemoryReport, function) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  a : float;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func f(inout v : Vertex)\n"
+      "  v.a = 2.0 * v.a;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply f to V;\n"
+      "end\n");
+  Function func = program.compile("main");
+  if (!func.defined()) FAIL();
+
+  Set V;
+  V.setName("V");
+  FieldRef<simit_float> a = V.addField<simit_float>("a");
+  a.set(V.add(), 1.0);
+  func.bind("V", &V);
+  func.runSafe();
+
+  MemoryReport report = func.memoryReport();
+  ASSERT_LT(0u, report.getAllocatedBytes("jit code"));
+  ASSERT_EQ(sizeof(simit_float), report.getUsages()[0].bytes);
+}
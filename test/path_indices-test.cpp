@@ -367,3 +367,54 @@ TEST(pathindex, hypergraph) {
   PathIndex pidx = builder.buildSegmented(vevORvfv, 0);
   VERIFY_INDEX(pidx, nbrs({{0,1,2}, {0,1,2,3}, {0,1,2,3}, {1,2,3}}));
 }
+
+TEST(pathindex, update) {
+  Var vi("vi");
+  Var e("e");
+  Var vj("vj");
+  PathExpression ve = makeVE();
+  PathExpression ev = makeEV();
+  PathExpression vev = And::make({vi,vj}, {{QuantifiedVar::Exist,e}},
+                                 ve(vi, e), ev(e, vj));
+
+  simit::Set V;
+  simit::Set E(V,V);
+  Box box = createBox(&V, &E, 4, 1, 1);  // v-e-v-e-v-e-v
+  auto edge = [&E](int i) {
+    for (ElementRef e : E) {
+      if (i-- == 0) {
+        return e;
+      }
+    }
+    return ElementRef();
+  };
+
+  PathIndexBuilder builder;
+  builder.bind("V", &V);
+  builder.bind("E", &E);
+  PathIndex index = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(index, nbrs({{0,1}, {0,1,2}, {1,2,3}, {2,3}}));
+
+  // The index is kept while the sets do not change
+  ASSERT_EQ(index, builder.buildSegmented(vev, 0));
+
+  // Added edges are merged into the index, and a second edge between the same
+  // vertices does not add neighbors
+  ElementRef e03 = E.add(box(0,0,0), box(3,0,0));
+  E.add(box(0,0,0), box(1,0,0));
+  index = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(index, nbrs({{0,1,3}, {0,1,2}, {1,2,3}, {0,2,3}}));
+
+  // Vertices stay neighbors until all the edges between them are removed
+  E.removeMany({edge(0), e03});
+  index = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(index, nbrs({{0,1}, {0,1,2}, {1,2,3}, {2,3}}));
+  E.remove(edge(1));
+  index = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(index, nbrs({{0,1}, {0,1,2}, {1,2}, {}}));
+
+  // Changing the vertices rebuilds the index
+  V.remove(box(3,0,0));
+  index = builder.buildSegmented(vev, 0);
+  VERIFY_INDEX(index, nbrs({{0,1}, {0,1,2}, {1,2}}));
+}
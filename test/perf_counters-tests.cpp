@@ -0,0 +1,43 @@
+#include "simit-test.h"
+
+#include "perf_counters.h"
+
+using namespace std;
+using namespace simit::internal;
+
+TEST(PerfCounters, arithmetic) {
+  PerfCounts a;
+  a.cycles = 10;
+  a.instructions = 20;
+  a.llcMisses = 3;
+  a.dtlbMisses = 4;
+
+  PerfCounts sum;
+  sum += a;
+  sum += a;
+  PerfCounts difference = sum - a;
+  ASSERT_EQ(20u, sum.cycles);
+  ASSERT_EQ(8u, sum.dtlbMisses);
+  ASSERT_EQ(10u, difference.cycles);
+  ASSERT_EQ(20u, difference.instructions);
+  ASSERT_EQ(3u, difference.llcMisses);
+}
+
+TEST(PerfCounters, read) {
+  PerfCounters counters;
+  if (!counters.isAvailable()) {
+    // Containers and VMs commonly deny perf_event_open
+    ASSERT_FALSE(counters.getError().empty());
+    ASSERT_EQ(0u, counters.read().instructions);
+    return;
+  }
+
+  PerfCounts start = counters.read();
+  volatile double sum = 0.0;
+  for (int i = 0; i < 100000; ++i) {
+    sum += i;
+  }
+  PerfCounts counts = counters.read() - start;
+  ASSERT_GT(counts.cycles, 0u);
+  ASSERT_GT(counts.instructions, 100000u);
+}
@@ -0,0 +1,185 @@
+#include "simit-test.h"
+
+#include <sstream>
+
+#include "graph.h"
+#include "program.h"
+#include "profile.h"
+
+using namespace std;
+using namespace simit;
+
+TEST(Profile, print) {
+  ProfileRegion map;
+  map.function = "main";
+  map.kind = "map";
+  map.name = "map f to V;";
+  map.count = 2;
+  map.cycles = 3000;
+  map.seconds = 3e-6;
+
+  ProfileRegion solve;
+  solve.function = "main";
+  solve.kind = "solve";
+  solve.name = "x = solve(A, b);";
+  solve.count = 1;
+  solve.cycles = 9000;
+  solve.seconds = 9e-6;
+
+  Profile profile({map, solve}, {}, 1e9, 0);
+  stringstream ss;
+  profile.print(ss);
+  string table = ss.str();
+
+  // Regions are sorted by time
+  ASSERT_NE(string::npos, table.find("solve"));
+  ASSERT_LT(table.find("x = solve(A, b);"), table.find("map f to V;"));
+  ASSERT_NE(string::npos, table.find("1500"));  // cycles per run of the map
+}
+
+TEST(Profile, chromeTrace) {
+  ProfileRegion region;
+  region.function = "main";
+  region.kind = "map";
+  region.name = "map f to V reduce +;";
+  region.count = 2;
+
+  Profile profile({region}, {{0, 0, 0.0, 1.5}, {0, 1, 2.0, 0.25}}, 1e9, 0);
+  stringstream ss;
+  profile.writeChromeTrace(ss);
+  string trace = ss.str();
+
+  ASSERT_EQ(0u, trace.find("{\"traceEvents\":["));
+  ASSERT_NE(string::npos, trace.find("\"name\":\"map f to V reduce +;\""));
+  ASSERT_NE(string::npos, trace.find("\"ph\":\"X\""));
+  ASSERT_NE(string::npos, trace.find("\"ts\":2.000,\"dur\":0.250"));
+  ASSERT_NE(string::npos, trace.find("\"tid\":1"));
+}
+
+TEST(Profile, map) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  a : int;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func f(inout v : Vertex)\n"
+      "  v.a = 2 * v.a;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply f to V;\n"
+      "end\n");
+  Function func = program.compileWithProfiling("main");
+  if (!func.defined()) FAIL();
+
+  Set V;
+  FieldRef<int> a = V.addField<int>("a");
+  ElementRef v0 = V.add();
+  a.set(v0, 1);
+  func.bind("V", &V);
+  func.runSafe();
+  func.runSafe();
+  ASSERT_EQ(4, (int)a.get(v0));
+
+  Profile profile = func.getProfile();
+  ASSERT_EQ(1u, profile.getRegions().size());
+  const ProfileRegion& region = profile.getRegions()[0];
+  ASSERT_EQ("main", region.function);
+  ASSERT_EQ("map", region.kind);
+  ASSERT_EQ(2u, region.count);
+  ASSERT_LE(region.minCycles, region.maxCycles);
+  ASSERT_EQ(2u, profile.getEvents().size());
+
+  func.resetProfile();
+  ASSERT_EQ(0u, func.getProfile().getRegions()[0].count);
+  ASSERT_EQ(0u, func.getProfile().getEvents().size());
+}
+
+TEST(Profile, roofline) {
+  ProfileRegion region;
+  region.function = "main";
+  region.kind = "map";
+  region.name = "A = map assemble to E reduce +;";
+  region.count = 1;
+  region.seconds = 1e-3;
+  region.bytes = 2e6;
+  region.flops = 1e6;
+
+  ProfileLoop loop;
+  loop.region = 0;
+  loop.name = "for e in E";
+  loop.tripCount = "E";
+  loop.iterations = 1000;
+  loop.loadedBytes = 1500;
+  loop.storedBytes = 500;
+  loop.flops = 1000;
+
+  Profile profile({region}, {}, 1e9, 0, {loop});
+  stringstream ss;
+  profile.printRoofline(ss);
+  string table = ss.str();
+  ASSERT_NE(string::npos, table.find("2.00"));  // GB/s
+  ASSERT_NE(string::npos, table.find("0.50"));  // flop/B
+  ASSERT_NE(string::npos, table.find("for e in E"));
+  ASSERT_NE(string::npos, table.find("iterations E = 1000"));
+}
+
+TEST(Profile, loopTraffic) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  x : float;\n"
+      "  y : float;\n"
+      "end\n"
+      "element Edge\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "extern E : set{Edge}(V,V);\n"
+      "func assemble(e : Edge, v : (Vertex*2)) -> (A : tensor[V,V](float))\n"
+      "  A(v(0),v(0)) = 1.0;\n"
+      "  A(v(0),v(1)) = -1.0;\n"
+      "  A(v(1),v(0)) = -1.0;\n"
+      "  A(v(1),v(1)) = 1.0;\n"
+      "end\n"
+      "export func main()\n"
+      "  A = map assemble to E reduce +;\n"
+      "  V.y = A * V.x;\n"
+      "end\n");
+  Function func = program.compileWithProfiling("main");
+  if (!func.defined()) FAIL();
+
+  Set V;
+  FieldRef<simit_float> x = V.addField<simit_float>("x");
+  V.addField<simit_float>("y");
+  ElementRef v0 = V.add();
+  ElementRef v1 = V.add();
+  ElementRef v2 = V.add();
+  x.set(v0, 1.0);
+  Set E(V,V);
+  E.add(v0, v1);
+  E.add(v1, v2);
+  func.bind("V", &V);
+  func.bind("E", &E);
+  func.runSafe();
+
+  // The edge loop, the row loop and the nonzero loop of A = 2+3+2 nonzeros
+  Profile profile = func.getProfile();
+  ASSERT_EQ(3u, profile.getLoops().size());
+  ASSERT_EQ("for e in E", profile.getLoops()[0].name);
+  ASSERT_DOUBLE_EQ(2, profile.getLoops()[0].iterations);
+  ASSERT_DOUBLE_EQ(3, profile.getLoops()[1].iterations);
+  ASSERT_DOUBLE_EQ(7, profile.getLoops()[2].iterations);
+  ASSERT_EQ("A_index", profile.getLoops()[2].tripCount);
+
+  // Each nonzero reads a column index, a value of A and an element of x, and
+  // multiplies and adds
+  const double floatBytes = sizeof(simit_float);
+  ASSERT_DOUBLE_EQ(4 + 2*floatBytes, profile.getLoops()[2].loadedBytes);
+  ASSERT_DOUBLE_EQ(2, profile.getLoops()[2].flops);
+
+  const ProfileRegion& multiply =
+      profile.getRegions()[profile.getLoops()[2].region];
+  ASSERT_EQ(1u, multiply.count);
+  ASSERT_DOUBLE_EQ(3*(8 + floatBytes) + 7*(4 + 2*floatBytes), multiply.bytes);
+  ASSERT_DOUBLE_EQ(14, multiply.flops);
+}
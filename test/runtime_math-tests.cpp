@@ -0,0 +1,100 @@
+#include "gtest/gtest.h"
+
+#include <cmath>
+#include <random>
+
+#include "runtime_math.h"
+
+using namespace std;
+
+/// Returns the error of result in units of the last place of the exact value.
+template <typename Float>
+static long double ulpError(Float result, long double exact) {
+  if (std::isnan(exact)) {
+    return std::isnan(result) ? 0.0L : INFINITY;
+  }
+  if (std::isinf(exact)) {
+    return (result == exact) ? 0.0L : INFINITY;
+  }
+  Float rounded = (Float)exact;
+  Float next = nextafter(rounded, numeric_limits<Float>::infinity());
+  long double ulp = (long double)next - (long double)rounded;
+  if (ulp == 0.0L || std::isinf(ulp)) {
+    ulp = (long double)rounded -
+          (long double)nextafter(rounded, -numeric_limits<Float>::infinity());
+  }
+  return fabsl((long double)result - exact) / ulp;
+}
+
+/// Returns the maximum error of f compared to exact on samples from [lo,hi],
+/// logarithmically distributed if logScale is set.
+template <typename Float, typename F, typename Exact>
+static long double maxUlpError(F f, Exact exact, double lo, double hi,
+                               bool logScale=false) {
+  mt19937 rng(0);
+  uniform_real_distribution<double> dist(logScale ? std::log(lo) : lo,
+                                         logScale ? std::log(hi) : hi);
+  long double maxError = 0.0L;
+  for (int i = 0; i < 100000; ++i) {
+    Float x = (Float)(logScale ? std::exp(dist(rng)) : dist(rng));
+    maxError = max(maxError, ulpError<Float>(f(x), exact((long double)x)));
+  }
+  return maxError;
+}
+
+#define ASSERT_ULP(Float, f, exact, lo, hi, bound, ...)                      \
+  ASSERT_LE((maxUlpError<Float>([](Float x) {return f;},                     \
+                                [](long double x) {return exact;},           \
+                                lo, hi, ##__VA_ARGS__)), bound)
+
+TEST(RuntimeMath, exp) {
+  ASSERT_ULP(float,  simit::math::exp(x), expl(x), -103.9, 88.7, 1.0);
+  ASSERT_ULP(double, simit::math::exp(x), expl(x), -745.0, 709.7, 2.0);
+  ASSERT_EQ(simit::math::exp(100.0f), INFINITY);
+  ASSERT_EQ(simit::math::exp(-1000.0), 0.0);
+  ASSERT_TRUE(std::isnan(simit::math::exp(NAN)));
+}
+
+TEST(RuntimeMath, log) {
+  ASSERT_ULP(float,  simit::math::log(x), logl(x), 1e-45, 3e38, 1.0, true);
+  ASSERT_ULP(double, simit::math::log(x), logl(x), 5e-324, 1e308, 1.0, true);
+  ASSERT_ULP(double, simit::math::log(x), logl(x), 0.5, 2.0, 1.0);
+  ASSERT_EQ(simit::math::log(0.0f), -INFINITY);
+  ASSERT_EQ(simit::math::log(INFINITY), INFINITY);
+  ASSERT_TRUE(std::isnan(simit::math::log(-1.0)));
+}
+
+TEST(RuntimeMath, sincos) {
+  ASSERT_ULP(float,  simit::math::sin(x), sinl(x), -8192.0, 8192.0, 2.0);
+  ASSERT_ULP(float,  simit::math::cos(x), cosl(x), -8192.0, 8192.0, 2.0);
+  ASSERT_ULP(double, simit::math::sin(x), sinl(x), -1e6, 1e6, 2.0);
+  ASSERT_ULP(double, simit::math::cos(x), cosl(x), -1e6, 1e6, 2.0);
+  ASSERT_ULP(double, simit::math::sin(x), sinl(x), -10.0, 10.0, 2.0);
+  ASSERT_ULP(double, simit::math::cos(x), cosl(x), -10.0, 10.0, 2.0);
+  ASSERT_EQ(simit::math::sin(0.0), 0.0);
+  ASSERT_EQ(simit::math::cos(0.0f), 1.0f);
+  ASSERT_TRUE(std::isnan(simit::math::sin(INFINITY)));
+  ASSERT_TRUE(std::isnan(simit::math::cos(-INFINITY)));
+  ASSERT_TRUE(std::isnan(simit::math::sin((float)NAN)));
+  ASSERT_TRUE(std::isnan(simit::math::cos((double)NAN)));
+  ASSERT_TRUE(std::isnan(simit::math::sin((float)INFINITY)));
+  ASSERT_TRUE(std::isnan(simit::math::cos(-(float)INFINITY)));
+}
+
+TEST(RuntimeMath, atan2) {
+  ASSERT_ULP(float, simit::math::atan2(x, 0.7f), atan2l(x, 0.7f),
+             -100.0, 100.0, 2.0);
+  ASSERT_ULP(float, simit::math::atan2(-0.3f, x), atan2l(-0.3f, x),
+             -100.0, 100.0, 2.0);
+  ASSERT_FLOAT_EQ(simit::math::atan2(0.0f, -1.0f), (float)M_PI);
+  ASSERT_EQ(simit::math::atan2(0.0f, 0.0f), 0.0f);
+}
+
+TEST(RuntimeMath, pow) {
+  ASSERT_ULP(float, simit::math::pow(x, 2.7f), powl(x, 2.7f),
+             1e-10, 1e12, 1.0, true);
+  ASSERT_ULP(float, simit::math::pow(1.7f, x), powl(1.7f, x),
+             -150.0, 160.0, 1.0);
+  ASSERT_EQ(simit::math::pow(0.0f, 2.0f), 0.0f);
+  ASSERT_EQ(simit::math::pow(0.0f, 0.0f), 1.0f);
+}
@@ -58,7 +58,8 @@ int main(int argc, char **argv) {
       (lastArgLen == 1 ||
        (lastArgLen >= 2 && 
         (std::string(argv[argc-1]).substr(0,2) != "--" ||
-         simit::util::split(argv[argc-1],"=")[0] == "--profile")))) {
+         simit::util::split(argv[argc-1],"=")[0] == "--profile" ||
+         simit::util::split(argv[argc-1],"=")[0] == "--perf")))) {
       filter = std::string(argv[1]);
 
       char *dotPtr = strchr(argv[1], '.');
@@ -85,6 +86,14 @@ int main(int argc, char **argv) {
         if (keyValPair[0] == "--profile") {
           PROFILE = true;
         }
+        else if (keyValPair[0] == "--perf") {
+          // Timers with hardware counters
+          PROFILE = true;
+          if (!simit::ir::enablePerfCounters()) {
+            std::cerr << "Hardware counters unavailable, timing only"
+                      << std::endl;
+          }
+        }
         else {
           std::cerr << "Unrecognized arg: " << arg << std::endl;
           return 1;
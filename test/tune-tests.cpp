@@ -0,0 +1,173 @@
+#include "simit-test.h"
+
+#include <cstdio>
+
+#include "graph.h"
+#include "program.h"
+#include "tune.h"
+
+using namespace std;
+using namespace simit;
+
+class CountingKnob : public TuningKnob {
+public:
+  int applied = 0;
+  int reverted = 0;
+
+  string getName() const {return "test-counting";}
+
+  vector<string> getValues(const map<string,Set*>& sets) const {
+    return {"off", "on"};
+  }
+
+  void apply(const string& value, Settings*, const map<string,Set*>&) {
+    applied++;
+  }
+
+  void revert(const string& value, const map<string,Set*>&) {
+    reverted++;
+  }
+};
+
+/// Registers a knob for the duration of a test, including tests that stop at
+/// a failed assertion.
+class ScopedKnob {
+public:
+  ScopedKnob(shared_ptr<TuningKnob> knob) : name(knob->getName()) {
+    registerTuningKnob(knob);
+  }
+  ~ScopedKnob() {unregisterTuningKnob(name);}
+private:
+  string name;
+};
+
+TEST(Tune, registerKnob) {
+  size_t numKnobs = getTuningKnobs().size();
+  auto knob = make_shared<CountingKnob>();
+  registerTuningKnob(knob);
+  ASSERT_EQ(numKnobs + 1, getTuningKnobs().size());
+  ASSERT_EQ("test-counting", getTuningKnobs().back()->getName());
+  ASSERT_THROW(registerTuningKnob(make_shared<CountingKnob>()),
+               SimitException);
+
+  unregisterTuningKnob("test-counting");
+  ASSERT_EQ(numKnobs, getTuningKnobs().size());
+  ASSERT_THROW(unregisterTuningKnob("test-counting"), SimitException);
+}
+
+TEST(Tune, function) {
+  Program program;
+  program.loadString(
+      "element Vertex\n"
+      "  a : float;\n"
+      "end\n"
+      "extern V : set{Vertex};\n"
+      "func f(inout v : Vertex)\n"
+      "  v.a = 2.0 * v.a;\n"
+      "end\n"
+      "export func main()\n"
+      "  apply f to V;\n"
+      "end\n");
+
+  Set V;
+  FieldRef<simit_float> a = V.addField<simit_float>("a");
+  ElementRef v0 = V.add();
+  a.set(v0, 1.0);
+  V.add();
+
+  auto knob = make_shared<CountingKnob>();
+  ScopedKnob registered(knob);
+
+  Settings settings = getSettings();
+  string cacheFile = "simit-tune-test.cache";
+  remove(cacheFile.c_str());
+  TuningResult result = tune(program, "main", {{"V", &V}}, 1.0, cacheFile);
+  ASSERT_FALSE(result.cached);
+  ASSERT_TRUE(result.function.defined());
+  ASSERT_EQ("none", result.values.at("reorder"));
+  ASSERT_TRUE(util::contains(result.values, string("specialize")));
+  ASSERT_LT(0.0, result.defaultSeconds);
+  ASSERT_TRUE(util::contains(result.values, string("test-counting")));
+
+  // Every measured candidate reverts the values it applied, and only the
+  // chosen values stay applied
+  ASSERT_LT(1, knob->applied);
+  ASSERT_EQ(knob->applied, knob->reverted + 1);
+
+  // Tuning runs the function, but restores the fields
+  ASSERT_EQ(1.0, (double)a.get(v0));
+  result.function.runSafe();
+  ASSERT_EQ(2.0, (double)a.get(v0));
+
+  // The chosen settings are active, so go back to the settings tune was
+  // called with
+  init(settings);
+  TuningResult cached = tune(program, "main", {{"V", &V}}, 1.0, cacheFile);
+  ASSERT_TRUE(cached.cached);
+  ASSERT_EQ(result.values, cached.values);
+  ASSERT_EQ(knob->applied, knob->reverted + 2);
+
+  // Values tuned with other code generation settings are not used
+  Settings fastMath = settings;
+  fastMath.fastMath = !settings.fastMath;
+  init(fastMath);
+  TuningResult retuned = tune(program, "main", {{"V", &V}}, 1.0, cacheFile);
+  ASSERT_FALSE(retuned.cached);
+
+  remove(cacheFile.c_str());
+  init(settings);
+}
+
+TEST(Tune, reorderKnob) {
+  Set V;
+  Set E(V,V);
+  FieldRef<double,3> x = V.addField<double,3>("x");
+  FieldRef<int> vertexId = V.addField<int>("id");
+  FieldRef<int> edgeId = E.addField<int>("id");
+  vector<ElementRef> vertices = createSpringNetwork(&V, &E, 4, 4, 4);
+  setGridPositions(vertices, 4, 4, 4, x);
+  V.setSpatialField("x");
+  int id = 0;
+  for (ElementRef v : V) {
+    vertexId(v) = id++;
+  }
+  id = 0;
+  for (ElementRef e : E) {
+    edgeId(e) = id++;
+  }
+
+  // The ids of the vertices, and of the edges and their endpoints, in order
+  auto order = [&]() {
+    vector<int> ids;
+    for (ElementRef v : V) {
+      ids.push_back(vertexId(v));
+    }
+    for (ElementRef e : E) {
+      ids.push_back(edgeId(e));
+      ids.push_back(vertexId(E.getEndpoint(e, 0)));
+      ids.push_back(vertexId(E.getEndpoint(e, 1)));
+    }
+    return ids;
+  };
+  vector<int> original = order();
+
+  shared_ptr<TuningKnob> knob;
+  for (auto& registered : getTuningKnobs()) {
+    if (registered->getName() == "reorder") {
+      knob = registered;
+    }
+  }
+  ASSERT_TRUE(knob != nullptr);
+  map<string,Set*> sets = {{"V", &V}, {"E", &E}};
+  ASSERT_EQ(vector<string>({"none", "hilbert"}), knob->getValues(sets));
+
+  // Reverting the reordering restores the order of the elements
+  Settings settings = getSettings();
+  knob->apply("hilbert", &settings, sets);
+  ASSERT_NE(original, order());
+  knob->revert("hilbert", sets);
+  ASSERT_EQ(original, order());
+
+  // Edges whose vertex set is not tuned are not reordered
+  ASSERT_EQ(vector<string>({"none"}), knob->getValues({{"E", &E}}));
+}
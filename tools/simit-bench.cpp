@@ -0,0 +1,1162 @@
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "graph.h"
+#include "init.h"
+#include "memory_report.h"
+#include "mesh.h"
+#include "program.h"
+#include "util/util.h"
+
+using namespace std;
+using namespace simit;
+
+// Benchmarks of canonical Simit workloads. Each workload builds its sets,
+// compiles its Simit function, initializes it and then times repeated runs
+// after a number of warmup runs. The mesh workloads run on the tetrahedral
+// meshes in apps/data, the synthetic workloads at the given sizes. Results
+// are printed as a table and optionally written as JSON, so that builds and
+// settings can be compared.
+//
+// With -baseline the results are compared with a JSON file written by an
+// earlier run, and the compile, init and run phases and the memory use of each
+// workload are flagged as regressions if they are slower or larger by more
+// than a threshold. Timings are compared with a confidence interval of the
+// relative difference of the means, so noisy timings are not reported as
+// regressions. The simit-bench-regression CTest test runs this comparison,
+// with -require-baseline so that it is reported as not run, rather than
+// recording a baseline and passing, if there is no baseline yet.
+
+#ifndef SIMIT_APPS_DIR
+#define SIMIT_APPS_DIR "apps"
+#endif
+
+/// Exit status if -require-baseline is given and there is no baseline, that
+/// CTest reports as a skipped test.
+static const int kNoBaseline = 77;
+
+static void printUsage() {
+  cerr << "Usage: simit-bench [options]" << endl
+       << "  -workloads=<w,...>  esprings, isprings, fem-linear, "
+       << "fem-neohookean," << endl
+       << "                      cg, pagerank, stencil (default: all)" << endl
+       << "  -meshes=<m,...>     bunny, dragon (default: bunny)" << endl
+       << "  -sizes=<n,...>      elements of the synthetic workloads "
+       << "(default: 10000,100000)" << endl
+       << "  -warmup=<n>         untimed runs before timing (default: 2)"
+       << endl
+       << "  -reps=<n>           timed runs (default: 10)" << endl
+       << "  -rounds=<n>         times each workload is compiled, initialized "
+       << "and run" << endl
+       << "                      (default: 1)" << endl
+       << "  -json=<file>        write the results as JSON ('-' for stdout)"
+       << endl
+       << "  -baseline=<file>    compare with results written by -json, or "
+       << "record them" << endl
+       << "                      if the file does not exist" << endl
+       << "  -require-baseline   exit with status " << kNoBaseline
+       << " without running if the" << endl
+       << "                      baseline does not exist" << endl
+       << "  -threshold=<pct>    slowdown or growth that is a regression "
+       << "(default: 10)" << endl
+       << "  -apps=<dir>         directory with the apps and their data"
+       << endl
+       << "  -opt=<0-3>  -cpu=<cpu>  -fast-math  -math=fast  -specialize"
+       << endl;
+}
+
+typedef chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point start) {
+  return chrono::duration<double>(Clock::now() - start).count();
+}
+
+/// Sets built for a workload, and the Simit function that runs on them.
+struct Workload {
+  /// Sets in construction order. Edge sets follow their endpoint sets.
+  vector<unique_ptr<Set>> sets;
+  /// The externs of the Simit function and the sets bound to them.
+  vector<pair<string,Set*>> bindings;
+
+  /// Simit source code, or a file if sourceFile is set.
+  string source;
+  bool sourceFile = false;
+
+  /// Function that is timed, and an optional function that is run once before
+  /// it to precompute data.
+  string function;
+  string setupFunction;
+
+  Set* addSet(Set* set, const string& name) {
+    sets.push_back(unique_ptr<Set>(set));
+    set->setName(name);
+    bindings.push_back({name, set});
+    return set;
+  }
+
+  size_t numElements() const {
+    size_t result = 0;
+    for (auto& set : sets) {
+      result += set->getSize();
+    }
+    return result;
+  }
+};
+
+struct Result {
+  string workload;
+  string input;
+  size_t elements = 0;
+  /// Samples of each phase, one compile and init sample per round.
+  vector<double> compileSeconds;
+  vector<double> initSeconds;
+  vector<double> runSeconds;
+  /// Bytes allocated for the function and the sets bound to it, and the most
+  /// heap memory the function used (see Function::memoryReport).
+  size_t memoryBytes = 0;
+  size_t peakHeapBytes = 0;
+  string error;
+};
+
+struct Statistics {
+  size_t samples = 0;
+  double min = 0.0;
+  double median = 0.0;
+  double mean = 0.0;
+  double stddev = 0.0;
+  double max = 0.0;
+};
+
+/// The 97.5th percentile of Student's t-distribution with df degrees of
+/// freedom, for two-sided 95% confidence intervals.
+static double tQuantile(double df) {
+  static const double table[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+  };
+  if (df < 1.0) {
+    return table[0];
+  }
+  if (df <= 30.0) {
+    return table[(int)df - 1];
+  }
+  return 1.960 + 2.4 / df;
+}
+
+static Statistics statistics(vector<double> samples) {
+  Statistics stats;
+  if (samples.empty()) {
+    return stats;
+  }
+  sort(samples.begin(), samples.end());
+  size_t n = samples.size();
+  stats.samples = n;
+  stats.min = samples.front();
+  stats.max = samples.back();
+  stats.median = (n % 2 == 1) ? samples[n/2]
+                              : 0.5 * (samples[n/2 - 1] + samples[n/2]);
+  for (double sample : samples) {
+    stats.mean += sample;
+  }
+  stats.mean /= n;
+  for (double sample : samples) {
+    stats.stddev += (sample - stats.mean) * (sample - stats.mean);
+  }
+  stats.stddev = (n > 1) ? sqrt(stats.stddev / (n - 1)) : 0.0;
+  return stats;
+}
+
+
+// Mesh workloads
+static bool loadMesh(const string& appsDir, const string& name,
+                     MeshVol* mesh) {
+  string prefix;
+  if (name == "bunny") {
+    prefix = appsDir + "/data/tet-bunny/bunny.1";
+  }
+  else if (name == "dragon") {
+    prefix = appsDir + "/data/tet-dragon/dragon40k";
+  }
+  else {
+    return false;
+  }
+  if (mesh->loadTet(prefix + ".node", prefix + ".ele") < 0 ||
+      mesh->v.empty()) {
+    return false;
+  }
+
+  // Scale the mesh to the unit cube
+  array<double,3> lo = mesh->v[0], hi = mesh->v[0];
+  for (auto& vertex : mesh->v) {
+    for (int i = 0; i < 3; ++i) {
+      lo[i] = min(lo[i], vertex[i]);
+      hi[i] = max(hi[i], vertex[i]);
+    }
+  }
+  for (auto& vertex : mesh->v) {
+    for (int i = 0; i < 3; ++i) {
+      vertex[i] = (vertex[i] - lo[i]) / max(hi[i] - lo[i], 1e-12);
+    }
+  }
+
+  // The edges of the tetrahedra (not every mesh comes with an edge file)
+  vector<pair<int,int>> edges;
+  for (auto& tet : mesh->e) {
+    for (size_t i = 0; i < tet.size(); ++i) {
+      for (size_t j = i+1; j < tet.size(); ++j) {
+        edges.push_back({min(tet[i], tet[j]), max(tet[i], tet[j])});
+      }
+    }
+  }
+  sort(edges.begin(), edges.end());
+  edges.erase(unique(edges.begin(), edges.end()), edges.end());
+  mesh->edges.clear();
+  for (auto& edge : edges) {
+    mesh->edges.push_back({{edge.first, edge.second}});
+  }
+  return true;
+}
+
+static void buildSprings(Workload* workload, const MeshVol& mesh,
+                         const string& appsDir, const string& file) {
+  const double stiffness = 1e4;
+  const double density = 1e3;
+  const double radius = 0.01;
+  const double zfloor = 0.1;
+
+  Set* points = workload->addSet(new Set(), "points");
+  Set* springs = workload->addSet(new Set(*points, *points), "springs");
+  FieldRef<double,3> x = points->addField<double,3>("x");
+  FieldRef<double,3> v = points->addField<double,3>("v");
+  FieldRef<double> m = points->addField<double>("m");
+  FieldRef<bool> fixed = points->addField<bool>("fixed");
+  FieldRef<double> k = springs->addField<double>("k");
+  FieldRef<double> l0 = springs->addField<double>("l0");
+
+  vector<ElementRef> pointRefs;
+  for (auto& vertex : mesh.v) {
+    ElementRef point = points->add();
+    x.set(point, vertex);
+    v.set(point, {0.0, 0.0, 0.0});
+    fixed.set(point, vertex[2] < zfloor);
+    pointRefs.push_back(point);
+  }
+
+  vector<double> masses(mesh.v.size(), 0.0);
+  for (auto& edge : mesh.edges) {
+    double length = 0.0;
+    for (int i = 0; i < 3; ++i) {
+      double d = mesh.v[edge[1]][i] - mesh.v[edge[0]][i];
+      length += d*d;
+    }
+    length = sqrt(length);
+    double mass = M_PI * radius * radius * length * density;
+    masses[edge[0]] += 0.5 * mass;
+    masses[edge[1]] += 0.5 * mass;
+
+    ElementRef spring = springs->add(pointRefs[edge[0]], pointRefs[edge[1]]);
+    k.set(spring, stiffness);
+    l0.set(spring, length);
+  }
+  for (size_t i = 0; i < pointRefs.size(); ++i) {
+    m.set(pointRefs[i], masses[i]);
+  }
+
+  workload->source = appsDir + "/springs/" + file;
+  workload->sourceFile = true;
+  workload->function = "timestep";
+}
+
+static void buildFEM(Workload* workload, const MeshVol& mesh,
+                     const string& appsDir, const string& file) {
+  const double E = 5e3;
+  const double nu = 0.45;
+  const double eps = 1e-4;
+
+  Set* verts = workload->addSet(new Set(), "verts");
+  Set* tets = workload->addSet(new Set(*verts, *verts, *verts, *verts),
+                               "tets");
+  FieldRef<double,3> x = verts->addField<double,3>("x");
+  FieldRef<double,3> v = verts->addField<double,3>("v");
+  FieldRef<double,3> fe = verts->addField<double,3>("fe");
+  FieldRef<int> c = verts->addField<int>("c");
+  FieldRef<double> m = verts->addField<double>("m");
+  FieldRef<double> u = tets->addField<double>("u");
+  FieldRef<double> l = tets->addField<double>("l");
+  tets->addField<double>("W");
+  tets->addField<double,3,3>("B");
+
+  vector<ElementRef> vertRefs;
+  for (auto& vertex : mesh.v) {
+    ElementRef vert = verts->add();
+    bool constrained = vertex[1] < eps;
+    x.set(vert, vertex);
+    v.set(vert, {constrained ? 0.0 : 0.1, 0.0, constrained ? 0.0 : 0.1});
+    fe.set(vert, {0.0, 0.0, 0.0});
+    c.set(vert, constrained ? 1 : 0);
+    m.set(vert, 0.0);
+    vertRefs.push_back(vert);
+  }
+  for (auto& tet : mesh.e) {
+    ElementRef t = tets->add(vertRefs[tet[0]], vertRefs[tet[1]],
+                             vertRefs[tet[2]], vertRefs[tet[3]]);
+    u.set(t, 0.5 * E / nu);
+    l.set(t, E * nu / ((1 + nu) * (1 - 2*nu)));
+  }
+
+  workload->source = appsDir + "/fem/" + file;
+  workload->sourceFile = true;
+  workload->function = "main";
+  workload->setupFunction = "initializeTet";
+}
+
+
+// Synthetic workloads
+static const char* cgSource =
+  "element Point\n"
+  "  b : float;\n"
+  "  c : float;\n"
+  "end\n"
+  "element Spring\n"
+  "  a : float;\n"
+  "end\n"
+  "extern points  : set{Point};\n"
+  "extern springs : set{Spring}(points,points);\n"
+  "func f(s : Spring, p : (Point*2)) -> (A : tensor[points,points](float))\n"
+  "  A(p(0),p(0)) =  s.a;\n"
+  "  A(p(0),p(1)) = -s.a;\n"
+  "  A(p(1),p(0)) = -s.a;\n"
+  "  A(p(1),p(1)) =  s.a;\n"
+  "end\n"
+  "func eye(p : Point) -> (I : tensor[points,points](float))\n"
+  "  I(p,p) = 1.0;\n"
+  "end\n"
+  "export func main()\n"
+  "  I = map eye to points reduce +;\n"
+  "  A = I + 0.01 * (map f to springs reduce +);\n"
+  "  var x : tensor[points](float) = 0.0;\n"
+  "  var r = points.b;\n"
+  "  var p = r;\n"
+  "  var iter = 0;\n"
+  "  var rsq = dot(r, r);\n"
+  "  while (rsq > 1e-12) and (iter < 50)\n"
+  "    Ap = A * p;\n"
+  "    alpha = rsq / dot(p, Ap);\n"
+  "    x = x + alpha * p;\n"
+  "    r = r - alpha * Ap;\n"
+  "    newrsq = dot(r, r);\n"
+  "    p = r + (newrsq / rsq) * p;\n"
+  "    rsq = newrsq;\n"
+  "    iter = iter + 1;\n"
+  "  end\n"
+  "  points.c = x;\n"
+  "end\n";
+
+static const char* pagerankSource =
+  "element Page\n"
+  "  outlinks : float;\n"
+  "  pr       : float;\n"
+  "end\n"
+  "element Link\n"
+  "end\n"
+  "extern pages : set{Page};\n"
+  "extern links : set{Link}(pages,pages);\n"
+  "func pagerank_matrix(link : Link, p : (Page*2))\n"
+  "    -> (A : tensor[pages,pages](float))\n"
+  "  A(p(1),p(0)) = 0.85 / p(0).outlinks;\n"
+  "end\n"
+  "export func main()\n"
+  "  A = map pagerank_matrix to links reduce +;\n"
+  "  pages.pr = 1.0;\n"
+  "  for i in 0:10\n"
+  "    pages.pr = A * pages.pr + (1.0 - 0.85);\n"
+  "  end\n"
+  "end\n";
+
+static const char* stencilSource =
+  "element Point\n"
+  "  b : float;\n"
+  "  c : float;\n"
+  "end\n"
+  "element Link\n"
+  "  a : float;\n"
+  "end\n"
+  "extern points : set{Point};\n"
+  "extern links : lattice[2]{Link}(points);\n"
+  "func vonNeumann(orig : Point, l : lattice[2]{Link}(points))\n"
+  "    -> (A : tensor[points,points](float))\n"
+  "  A(orig,orig) = l[0,0;0,1].a + l[0,0;0,-1].a +\n"
+  "                 l[0,0;1,0].a + l[0,0;-1,0].a;\n"
+  "  A(orig,points[0,1]) = -l[0,0;0,1].a;\n"
+  "  A(orig,points[0,-1]) = -l[0,0;0,-1].a;\n"
+  "  A(orig,points[1,0]) = -l[0,0;1,0].a;\n"
+  "  A(orig,points[-1,0]) = -l[0,0;-1,0].a;\n"
+  "end\n"
+  "export func main()\n"
+  "  A = map vonNeumann to points through links;\n"
+  "  points.c = A * points.b;\n"
+  "end\n";
+
+/// A chain of n points connected by springs, solved with conjugate gradient.
+static void buildCG(Workload* workload, size_t n) {
+  Set* points = workload->addSet(new Set(), "points");
+  Set* springs = workload->addSet(new Set(*points, *points), "springs");
+  FieldRef<double> b = points->addField<double>("b");
+  points->addField<double>("c");
+  FieldRef<double> a = springs->addField<double>("a");
+
+  vector<ElementRef> pointRefs;
+  for (size_t i = 0; i < n; ++i) {
+    ElementRef point = points->add();
+    b.set(point, 1.0 + (i % 7));
+    pointRefs.push_back(point);
+  }
+  for (size_t i = 0; i+1 < n; ++i) {
+    a.set(springs->add(pointRefs[i], pointRefs[i+1]), 1.0 + (i % 3));
+  }
+
+  workload->source = cgSource;
+  workload->function = "main";
+}
+
+/// An R-MAT graph with the power of two nearest n pages and eight links per
+/// page on average.
+static void buildPagerank(Workload* workload, size_t n) {
+  const int linksPerPage = 8;
+  unsigned scale = max(1, (int)round(log2((double)n)));
+
+  Set* pages = workload->addSet(new Set(), "pages");
+  Set* links = workload->addSet(new Set(*pages, *pages), "links");
+  FieldRef<double> outlinks = pages->addField<double>("outlinks");
+  pages->addField<double>("pr");
+
+  createRMATGraph(pages, links, scale, (size_t)linksPerPage << scale);
+  for (ElementRef link : *links) {
+    ElementRef page = links->getEndpoint(link, 0);
+    outlinks.set(page, outlinks.get(page) + 1.0);
+  }
+
+  workload->source = pagerankSource;
+  workload->function = "main";
+}
+
+/// A matrix-vector product with a five-point stencil on a square lattice of
+/// about n points.
+static void buildStencil(Workload* workload, size_t n) {
+  int side = max(3, (int)ceil(sqrt((double)n)));
+
+  Set* points = workload->addSet(new Set(), "points");
+  FieldRef<double> b = points->addField<double>("b");
+  points->addField<double>("c");
+  // The lattice link set adds the lattice points to the point set
+  Set* links = workload->addSet(new Set(*points, {side, side}), "links");
+  FieldRef<double> a = links->addField<double>("a");
+
+  int i = 0;
+  for (ElementRef point : *points) {
+    b.set(point, 1.0 + (i++ % 5));
+  }
+  for (ElementRef link : *links) {
+    a.set(link, 1.0);
+  }
+
+  workload->source = stencilSource;
+  workload->function = "main";
+}
+
+
+// Running workloads
+static Function compileFunction(Program& program, const Workload& workload,
+                                const string& name, string* error) {
+  Function function = program.compile(name);
+  if (!function.defined()) {
+    *error = "could not compile " + name + ": " +
+             util::toString(program.getDiagnostics());
+    return function;
+  }
+  for (auto& binding : workload.bindings) {
+    function.bind(binding.first, binding.second);
+  }
+  return function;
+}
+
+/// Compile, initialize and run the workload's function once per round. Each
+/// round loads the program anew, so that compilation is not cached.
+static void run(Workload& workload, int warmup, int reps, int rounds,
+                Result* result) {
+  result->elements = workload.numElements();
+
+  for (int round = 0; round < rounds; ++round) {
+    Program program;
+    int status = workload.sourceFile ? program.loadFile(workload.source)
+                                     : program.loadString(workload.source);
+    if (status != 0) {
+      result->error = "could not load " +
+                      (workload.sourceFile ? workload.source
+                                           : result->workload) +
+                      ": " + util::toString(program.getDiagnostics());
+      return;
+    }
+
+    if (workload.setupFunction != "") {
+      Function setup = compileFunction(program, workload,
+                                       workload.setupFunction, &result->error);
+      if (!setup.defined()) return;
+      setup.runSafe();
+    }
+
+    auto start = Clock::now();
+    Function function = compileFunction(program, workload, workload.function,
+                                        &result->error);
+    if (!function.defined()) return;
+    result->compileSeconds.push_back(secondsSince(start));
+
+    start = Clock::now();
+    function.init();
+    result->initSeconds.push_back(secondsSince(start));
+
+    function.unmapArgs();
+    for (int i = 0; i < warmup; ++i) {
+      function.run();
+    }
+    for (int i = 0; i < reps; ++i) {
+      start = Clock::now();
+      function.run();
+      result->runSeconds.push_back(secondsSince(start));
+    }
+    function.mapArgs();
+
+    MemoryReport report = function.memoryReport();
+    result->memoryBytes = report.getAllocatedBytes();
+    result->peakHeapBytes = report.getPeakHeapBytes();
+  }
+}
+
+static string jsonString(const string& str) {
+  string result = "\"";
+  for (char c : str) {
+    if (c == '"' || c == '\\') {
+      result += '\\';
+      result += c;
+    }
+    else if (c == '\n') {
+      result += "\\n";
+    }
+    else if ((unsigned char)c >= 0x20) {
+      result += c;
+    }
+  }
+  return result + "\"";
+}
+
+/// The settings that affect the timings, as a JSON object.
+static string settingsJSON(const Settings& settings) {
+  stringstream ss;
+  ss << "{"
+     << "\"backend\": " << jsonString(settings.backend) << ", "
+     << "\"floatBytes\": " << settings.floatSize << ", "
+     << "\"optLevel\": " << settings.optLevel << ", "
+     << "\"targetCPU\": " << jsonString(settings.targetCPU) << ", "
+     << "\"fastMath\": " << (settings.fastMath ? "true" : "false") << ", "
+     << "\"mathAccuracy\": " << jsonString(settings.mathAccuracy) << ", "
+     << "\"specialize\": " << (settings.specialize ? "true" : "false") << "}";
+  return ss.str();
+}
+
+static void writeStatistics(ostream& os, const string& phase,
+                            const vector<double>& samples) {
+  Statistics stats = statistics(samples);
+  os << "\"" << phase << "\": {\"min\": " << stats.min << ", "
+     << "\"median\": " << stats.median << ", "
+     << "\"mean\": " << stats.mean << ", "
+     << "\"stddev\": " << stats.stddev << ", "
+     << "\"max\": " << stats.max << ", "
+     << "\"samples\": [" << util::join(samples, ", ") << "]}";
+}
+
+static void writeJSON(ostream& os, const vector<Result>& results,
+                      const Settings& settings, int warmup, int reps,
+                      int rounds) {
+  os << "{" << endl
+     << "  \"settings\": " << settingsJSON(settings) << "," << endl
+     << "  \"warmup\": " << warmup << "," << endl
+     << "  \"reps\": " << reps << "," << endl
+     << "  \"rounds\": " << rounds << "," << endl
+     << "  \"results\": [";
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Result& result = results[i];
+    os << (i > 0 ? "," : "") << endl
+       << "    {\"workload\": " << jsonString(result.workload) << ", "
+       << "\"input\": " << jsonString(result.input) << ", "
+       << "\"elements\": " << result.elements << ", ";
+    if (result.error != "") {
+      os << "\"error\": " << jsonString(result.error) << "}";
+      continue;
+    }
+    os << setprecision(9);
+    writeStatistics(os, "compile", result.compileSeconds);
+    os << "," << endl << "     ";
+    writeStatistics(os, "init", result.initSeconds);
+    os << "," << endl << "     ";
+    writeStatistics(os, "run", result.runSeconds);
+    os << "," << endl << "     "
+       << "\"memory\": {\"allocatedBytes\": " << result.memoryBytes << ", "
+       << "\"peakHeapBytes\": " << result.peakHeapBytes << "}}";
+  }
+  os << endl << "  ]" << endl << "}" << endl;
+}
+
+static void printResult(const Result& result) {
+  cout << left << setw(16) << result.workload << setw(10) << result.input
+       << right << setw(10) << result.elements;
+  if (result.error != "") {
+    cout << "  error: " << result.error << endl;
+    return;
+  }
+  Statistics stats = statistics(result.runSeconds);
+  cout << fixed << setprecision(1)
+       << setw(12) << statistics(result.compileSeconds).median * 1e3
+       << setw(10) << statistics(result.initSeconds).median * 1e3
+       << setprecision(3)
+       << setw(11) << stats.min * 1e3 << setw(11) << stats.median * 1e3
+       << setw(11) << stats.mean * 1e3 << setw(11) << stats.stddev * 1e3
+       << endl;
+}
+
+/// A parsed JSON value, used to read baselines.
+struct JSON {
+  enum Kind {Null, Bool, Number, String, Array, Object};
+  Kind kind = Null;
+  bool boolean = false;
+  double number = 0.0;
+  string str;
+  vector<JSON> array;
+  map<string,JSON> object;
+
+  /// Returns the member with the given key, or null if there is none.
+  const JSON& operator[](const string& key) const {
+    static const JSON null;
+    auto it = object.find(key);
+    return (it != object.end()) ? it->second : null;
+  }
+
+  vector<double> numbers() const {
+    vector<double> result;
+    for (const JSON& element : array) {
+      result.push_back(element.number);
+    }
+    return result;
+  }
+};
+
+class JSONParser {
+public:
+  JSONParser(const string& text) : text(text), pos(0) {}
+
+  bool parse(JSON* value) {
+    if (!parseValue(value)) return false;
+    skipSpace();
+    return pos == text.size();
+  }
+
+private:
+  const string& text;
+  size_t pos;
+
+  void skipSpace() {
+    while (pos < text.size() && isspace((unsigned char)text[pos])) {
+      ++pos;
+    }
+  }
+
+  bool consume(const string& token) {
+    skipSpace();
+    if (text.compare(pos, token.size(), token) != 0) return false;
+    pos += token.size();
+    return true;
+  }
+
+  bool parseString(string* str) {
+    if (!consume("\"")) return false;
+    while (pos < text.size() && text[pos] != '"') {
+      char c = text[pos++];
+      if (c == '\\') {
+        if (pos >= text.size()) return false;
+        c = text[pos++];
+        switch (c) {
+          case 'n': c = '\n'; break;
+          case 't': c = '\t'; break;
+          case 'r': c = '\r'; break;
+          case 'b': c = '\b'; break;
+          case 'f': c = '\f'; break;
+          case 'u': {
+            if (pos + 4 > text.size()) return false;
+            long code = strtol(text.substr(pos, 4).c_str(), nullptr, 16);
+            c = (code < 0x80) ? (char)code : '?';
+            pos += 4;
+            break;
+          }
+          default: break;
+        }
+      }
+      *str += c;
+    }
+    return consume("\"");
+  }
+
+  bool parseValue(JSON* value) {
+    skipSpace();
+    if (pos >= text.size()) return false;
+    char c = text[pos];
+    if (c == '{') {
+      ++pos;
+      value->kind = JSON::Object;
+      if (consume("}")) return true;
+      do {
+        string key;
+        if (!parseString(&key) || !consume(":") ||
+            !parseValue(&value->object[key])) {
+          return false;
+        }
+      } while (consume(","));
+      return consume("}");
+    }
+    else if (c == '[') {
+      ++pos;
+      value->kind = JSON::Array;
+      if (consume("]")) return true;
+      do {
+        value->array.push_back(JSON());
+        if (!parseValue(&value->array.back())) return false;
+      } while (consume(","));
+      return consume("]");
+    }
+    else if (c == '"') {
+      value->kind = JSON::String;
+      return parseString(&value->str);
+    }
+    else if (consume("true")) {
+      value->kind = JSON::Bool;
+      value->boolean = true;
+      return true;
+    }
+    else if (consume("false")) {
+      value->kind = JSON::Bool;
+      return true;
+    }
+    else if (consume("null")) {
+      value->kind = JSON::Null;
+      return true;
+    }
+    const char* begin = text.c_str() + pos;
+    char* end;
+    value->kind = JSON::Number;
+    value->number = strtod(begin, &end);
+    pos += end - begin;
+    return end != begin;
+  }
+};
+
+/// Read the results and settings of a file written by writeJSON.
+static bool readBaseline(const string& file, vector<Result>* results,
+                         JSON* settings, string* error) {
+  ifstream in(file);
+  if (!in.good()) {
+    *error = "could not read " + file;
+    return false;
+  }
+  stringstream ss;
+  ss << in.rdbuf();
+  string text = ss.str();
+  JSON json;
+  if (!JSONParser(text).parse(&json) || json.kind != JSON::Object) {
+    *error = file + " is not valid JSON";
+    return false;
+  }
+  *settings = json["settings"];
+  for (const JSON& element : json["results"].array) {
+    Result result;
+    result.workload = element["workload"].str;
+    result.input = element["input"].str;
+    result.elements = (size_t)element["elements"].number;
+    result.error = element["error"].str;
+    result.compileSeconds = element["compile"]["samples"].numbers();
+    result.initSeconds = element["init"]["samples"].numbers();
+    result.runSeconds = element["run"]["samples"].numbers();
+    result.memoryBytes = (size_t)element["memory"]["allocatedBytes"].number;
+    result.peakHeapBytes = (size_t)element["memory"]["peakHeapBytes"].number;
+    results->push_back(result);
+  }
+  return true;
+}
+
+/// The change of a phase or memory measure relative to the baseline, with a
+/// 95% confidence interval of the change.
+struct Comparison {
+  double baseline = 0.0;
+  double current = 0.0;
+  double change = 0.0;
+  double low = 0.0;
+  double high = 0.0;
+};
+
+/// Compare the means of two sets of timings. The confidence interval is
+/// Welch's interval of the difference of the means, relative to the baseline
+/// mean. With fewer than two samples on either side there is no interval.
+static Comparison compareSamples(const vector<double>& baseline,
+                                 const vector<double>& current) {
+  Statistics base = statistics(baseline);
+  Statistics cur = statistics(current);
+  Comparison comparison;
+  comparison.baseline = base.mean;
+  comparison.current = cur.mean;
+  if (base.mean <= 0.0) {
+    return comparison;
+  }
+  double diff = cur.mean - base.mean;
+  comparison.change = diff / base.mean;
+  comparison.low = comparison.high = comparison.change;
+  if (base.samples < 2 || cur.samples < 2) {
+    return comparison;
+  }
+  double vb = base.stddev * base.stddev / base.samples;
+  double vc = cur.stddev * cur.stddev / cur.samples;
+  if (vb + vc == 0.0) {
+    return comparison;
+  }
+  double df = (vb + vc) * (vb + vc) /
+              (vb * vb / (base.samples - 1) + vc * vc / (cur.samples - 1));
+  double halfWidth = tQuantile(df) * sqrt(vb + vc);
+  comparison.low = (diff - halfWidth) / base.mean;
+  comparison.high = (diff + halfWidth) / base.mean;
+  return comparison;
+}
+
+static Comparison compareBytes(size_t baseline, size_t current) {
+  Comparison comparison;
+  comparison.baseline = baseline;
+  comparison.current = current;
+  if (baseline > 0) {
+    comparison.change = ((double)current - baseline) / baseline;
+  }
+  comparison.low = comparison.high = comparison.change;
+  return comparison;
+}
+
+/// Print the comparison of one measure, and return whether it regressed. A
+/// measure regresses if the whole confidence interval is above the
+/// threshold, and improves if it is below minus the threshold.
+static bool printComparison(const Result& result, const string& measure,
+                            const Comparison& comparison, double scale,
+                            const string& unit, double threshold) {
+  string status = "ok";
+  if (comparison.low > threshold) {
+    status = "REGRESSION";
+  }
+  else if (comparison.high < -threshold) {
+    status = "improved";
+  }
+  else if (comparison.change > threshold) {
+    status = "noisy";
+  }
+  cout << left << setw(16) << result.workload << setw(10) << result.input
+       << setw(9) << measure << right << fixed << setprecision(3)
+       << setw(12) << comparison.baseline * scale << " " << left << setw(3)
+       << unit << right << setw(13) << comparison.current * scale << " "
+       << left << setw(3) << unit << right
+       << showpos << setprecision(1)
+       << setw(9) << comparison.change * 100 << "%"
+       << "  [" << comparison.low * 100 << "%, "
+       << comparison.high * 100 << "%]" << noshowpos
+       << "  " << status << endl;
+  return status == "REGRESSION";
+}
+
+/// Compare results with a baseline and return the number of regressions.
+static int compareWithBaseline(const vector<Result>& results,
+                               const vector<Result>& baseline,
+                               double threshold) {
+  int regressions = 0;
+  cout << endl << left << setw(16) << "workload" << setw(10) << "input"
+       << setw(9) << "phase" << right << setw(17) << "baseline"
+       << setw(17) << "current" << setw(10) << "change"
+       << "  95% CI" << endl;
+  for (const Result& result : results) {
+    const Result* base = nullptr;
+    for (const Result& candidate : baseline) {
+      if (candidate.workload == result.workload &&
+          candidate.input == result.input) {
+        base = &candidate;
+      }
+    }
+    if (base == nullptr || base->error != "" || result.error != "") {
+      cout << left << setw(16) << result.workload << setw(10) << result.input
+           << (base == nullptr ? "not in baseline" : "not compared (error)")
+           << endl;
+      continue;
+    }
+    if (base->elements != result.elements) {
+      cout << left << setw(16) << result.workload << setw(10) << result.input
+           << "not compared (" << base->elements << " elements in baseline)"
+           << endl;
+      continue;
+    }
+    regressions += printComparison(result, "compile",
+        compareSamples(base->compileSeconds, result.compileSeconds),
+        1e3, "ms", threshold);
+    regressions += printComparison(result, "init",
+        compareSamples(base->initSeconds, result.initSeconds),
+        1e3, "ms", threshold);
+    regressions += printComparison(result, "run",
+        compareSamples(base->runSeconds, result.runSeconds),
+        1e3, "ms", threshold);
+    regressions += printComparison(result, "memory",
+        compareBytes(base->memoryBytes, result.memoryBytes),
+        1.0/1024, "KB", threshold);
+    regressions += printComparison(result, "peak",
+        compareBytes(base->peakHeapBytes, result.peakHeapBytes),
+        1.0/1024, "KB", threshold);
+  }
+  return regressions;
+}
+
+int main(int argc, const char* argv[]) {
+  vector<string> workloads = {"esprings", "isprings", "fem-linear",
+                              "fem-neohookean", "cg", "pagerank", "stencil"};
+  vector<string> meshes = {"bunny"};
+  vector<size_t> sizes = {10000, 100000};
+  int warmup = 2;
+  int reps = 10;
+  int rounds = 1;
+  double threshold = 10.0;
+  string jsonFile;
+  string baselineFile;
+  bool requireBaseline = false;
+  string appsDir = SIMIT_APPS_DIR;
+  Settings settings;
+
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    vector<string> keyVal = util::split(arg, "=");
+    string key = keyVal[0];
+    string val = (keyVal.size() == 2) ? keyVal[1] : "";
+    if (keyVal.size() == 1 && key == "-fast-math") {
+      settings.fastMath = true;
+    }
+    else if (keyVal.size() == 1 && key == "-specialize") {
+      settings.specialize = true;
+    }
+    else if (keyVal.size() == 1 && key == "-require-baseline") {
+      requireBaseline = true;
+    }
+    else if (keyVal.size() != 2) {
+      printUsage();
+      return 3;
+    }
+    else if (key == "-workloads") {
+      workloads = util::split(val, ",");
+    }
+    else if (key == "-meshes") {
+      meshes = util::split(val, ",");
+    }
+    else if (key == "-sizes") {
+      sizes.clear();
+      for (const string& size : util::split(val, ",")) {
+        sizes.push_back(strtoul(size.c_str(), nullptr, 10));
+      }
+    }
+    else if (key == "-warmup") {
+      warmup = atoi(val.c_str());
+    }
+    else if (key == "-reps") {
+      reps = atoi(val.c_str());
+    }
+    else if (key == "-rounds") {
+      rounds = atoi(val.c_str());
+    }
+    else if (key == "-json") {
+      jsonFile = val;
+    }
+    else if (key == "-baseline") {
+      baselineFile = val;
+    }
+    else if (key == "-threshold") {
+      threshold = atof(val.c_str());
+    }
+    else if (key == "-apps") {
+      appsDir = val;
+    }
+    else if (key == "-opt") {
+      settings.optLevel = atoi(val.c_str());
+    }
+    else if (key == "-cpu") {
+      settings.targetCPU = val;
+    }
+    else if (key == "-math") {
+      settings.mathAccuracy = val;
+    }
+    else {
+      printUsage();
+      return 3;
+    }
+  }
+  if (warmup < 0 || reps <= 0 || rounds <= 0 || threshold < 0.0 ||
+      find(sizes.begin(), sizes.end(), 0u) != sizes.end()) {
+    printUsage();
+    return 3;
+  }
+  if (requireBaseline && !ifstream(baselineFile).good()) {
+    cerr << "No baseline " << (baselineFile != "" ? baselineFile : "given")
+         << "; not run. Record one with -json or the simit-bench-baseline "
+         << "target." << endl;
+    return kNoBaseline;
+  }
+  simit::init(settings);
+
+  // Workloads on meshes, and synthetic workloads at each size
+  map<string, function<void(Workload*,const MeshVol&)>> meshBuilders = {
+    {"esprings", [&](Workload* w, const MeshVol& mesh) {
+      buildSprings(w, mesh, appsDir, "esprings.sim");}},
+    {"isprings", [&](Workload* w, const MeshVol& mesh) {
+      buildSprings(w, mesh, appsDir, "isprings.sim");}},
+    {"fem-linear", [&](Workload* w, const MeshVol& mesh) {
+      buildFEM(w, mesh, appsDir, "fem_linear.sim");}},
+    {"fem-neohookean", [&](Workload* w, const MeshVol& mesh) {
+      buildFEM(w, mesh, appsDir, "fem_neohookean.sim");}},
+  };
+  map<string, function<void(Workload*,size_t)>> sizeBuilders = {
+    {"cg", buildCG},
+    {"pagerank", buildPagerank},
+    {"stencil", buildStencil},
+  };
+
+  map<string,MeshVol> loadedMeshes;
+  vector<Result> results;
+  cout << left << setw(16) << "workload" << setw(10) << "input" << right
+       << setw(10) << "elements" << setw(12) << "compile ms" << setw(10)
+       << "init ms" << setw(11) << "min ms" << setw(11) << "median ms"
+       << setw(11) << "mean ms" << setw(11) << "stddev ms" << endl;
+  for (const string& name : workloads) {
+    vector<pair<string,function<void(Workload*)>>> inputs;
+    if (util::contains(meshBuilders, name)) {
+      for (const string& mesh : meshes) {
+        if (!util::contains(loadedMeshes, mesh)) {
+          if (!loadMesh(appsDir, mesh, &loadedMeshes[mesh])) {
+            cerr << "Could not load mesh " << mesh << " from " << appsDir
+                 << "/data" << endl;
+            return 1;
+          }
+        }
+        auto build = meshBuilders.at(name);
+        const MeshVol& meshVol = loadedMeshes.at(mesh);
+        inputs.push_back({mesh, [build,&meshVol](Workload* w) {
+          build(w, meshVol);
+        }});
+      }
+    }
+    else if (util::contains(sizeBuilders, name)) {
+      for (size_t size : sizes) {
+        auto build = sizeBuilders.at(name);
+        inputs.push_back({to_string(size), [build,size](Workload* w) {
+          build(w, size);
+        }});
+      }
+    }
+    else {
+      cerr << "Unknown workload " << name << endl;
+      printUsage();
+      return 3;
+    }
+
+    for (auto& input : inputs) {
+      Result result;
+      result.workload = name;
+      result.input = input.first;
+      try {
+        Workload workload;
+        input.second(&workload);
+        run(workload, warmup, reps, rounds, &result);
+      }
+      catch (SimitException& e) {
+        result.error = e.what();
+      }
+      printResult(result);
+      results.push_back(result);
+    }
+  }
+
+  if (jsonFile == "-") {
+    writeJSON(cout, results, settings, warmup, reps, rounds);
+  }
+  else if (jsonFile != "") {
+    ofstream json(jsonFile);
+    if (!json.good()) {
+      cerr << "Could not write " << jsonFile << endl;
+      return 1;
+    }
+    writeJSON(json, results, settings, warmup, reps, rounds);
+  }
+
+  int status = 0;
+  for (const Result& result : results) {
+    if (result.error != "") {
+      status = 1;
+    }
+  }
+
+  if (baselineFile != "") {
+    if (!ifstream(baselineFile).good()) {
+      ofstream json(baselineFile);
+      if (!json.good()) {
+        cerr << "Could not write " << baselineFile << endl;
+        return 1;
+      }
+      writeJSON(json, results, settings, warmup, reps, rounds);
+      cout << endl << "Recorded baseline " << baselineFile << endl;
+      return status;
+    }
+
+    vector<Result> baseline;
+    JSON baselineSettings;
+    string error;
+    if (!readBaseline(baselineFile, &baseline, &baselineSettings, &error)) {
+      cerr << "Could not read baseline: " << error << endl;
+      return 1;
+    }
+    JSON currentSettings;
+    string settingsText = settingsJSON(settings);
+    JSONParser(settingsText).parse(&currentSettings);
+    for (auto& setting : currentSettings.object) {
+      const JSON& recorded = baselineSettings[setting.first];
+      if (recorded.str != setting.second.str ||
+          recorded.number != setting.second.number ||
+          recorded.boolean != setting.second.boolean) {
+        cerr << "Warning: the baseline was recorded with a different "
+             << setting.first << " setting" << endl;
+      }
+    }
+
+    int regressions = compareWithBaseline(results, baseline, threshold/100);
+    if (regressions > 0) {
+      cout << endl << regressions << " regression(s) above "
+           << setprecision(1) << threshold << "% compared with "
+           << baselineFile << endl;
+      status = 1;
+    }
+  }
+  return status;
+}
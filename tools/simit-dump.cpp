@@ -1,4 +1,5 @@
 #include <iostream>
+#include <iomanip>
 #include <fstream>
 #include <memory>
 
@@ -14,6 +15,8 @@
 #include "error.h"
 #include "util/util.h"
 #include "storage.h"
+#include "pass_timer.h"
+#include "loop_traffic.h"
 
 #include "backend/backend.h"
 #include "backend/backend_function.h"
@@ -28,6 +31,10 @@ static void printUsage() {
        << "-emit-simit"         << endl
        << "-emit-llvm"          << endl
        << "-emit-asm"           << endl
+       << "-time-passes"        << endl
+       << "-roofline"           << endl
+       << "-peak-gflops=<n>"    << endl
+       << "-peak-gbs=<n>"       << endl
        << "-files"              << endl
        << "-compile=<function>" << endl
        << "-section=<section>"  << endl
@@ -40,6 +47,39 @@ unique_ptr<ostream> irOutputStream(string sourceFile, string suffix="") {
   return unique_ptr<ostream>(new ofstream(filename, outputMode));
 }
 
+/// Print the estimated traffic per iteration, arithmetic intensity and average
+/// trip count of each loop. Given the machine's peak floating-point throughput
+/// and memory bandwidth, also print whether the loop is memory or compute
+/// bound and its attainable GFLOP/s, min(peak GFLOP/s, intensity * peak GB/s).
+static void printRoofline(const ir::Func& func, double peakGflops,
+                          double peakGbs, ostream& os) {
+  os << "%% Roofline" << endl;
+  string function;
+  for (const ir::LoopTraffic& loop : ir::analyzeLoopTraffic(func)) {
+    if (loop.function != function) {
+      function = loop.function;
+      os << "func " << function << ":" << endl;
+    }
+    const ir::Traffic& traffic = loop.perIteration;
+    double intensity = (traffic.bytes() > 0.0)
+                       ? traffic.flops / traffic.bytes() : 0.0;
+    string indent(2 + 2*loop.depth, ' ');
+    os << indent << loop.name << endl
+       << indent << "  trip count " << loop.trips << fixed
+       << setprecision(1) << ", bytes " << traffic.loadedBytes << " loaded + "
+       << traffic.storedBytes << " stored, flops " << traffic.flops
+       << setprecision(3) << ", flop/B " << intensity;
+    if (peakGflops > 0.0 && peakGbs > 0.0 && traffic.bytes() > 0.0) {
+      bool memoryBound = intensity < peakGflops / peakGbs;
+      os << setprecision(1) << " (" << (memoryBound ? "memory" : "compute")
+         << " bound, " << min(peakGflops, intensity * peakGbs)
+         << " GFLOP/s attainable)";
+    }
+    os << defaultfloat << endl;
+  }
+  os << endl;
+}
+
 int main(int argc, const char* argv[]) {
   if (argc < 2) {
     printUsage();
@@ -49,6 +89,10 @@ int main(int argc, const char* argv[]) {
   bool compile = false;
   bool fileoutput = false;
   bool gpu = false;
+  bool timePasses = false;
+  bool roofline = false;
+  double peakGflops = 0.0;
+  double peakGbs = 0.0;
 
   ostream* simitos = nullptr;
   ostream* llvmos  = nullptr;
@@ -91,6 +135,14 @@ int main(int argc, const char* argv[]) {
         else if (arg == "-gpu") {
           gpu = true;
         }
+        else if (arg == "-time-passes") {
+          compile = true;
+          timePasses = true;
+        }
+        else if (arg == "-roofline") {
+          compile = true;
+          roofline = true;
+        }
         else {
           printUsage();
           return 3;
@@ -104,6 +156,12 @@ int main(int argc, const char* argv[]) {
           compile = true;
           function = keyValPair[1];
         }
+        else if (keyValPair[0] == "-peak-gflops") {
+          peakGflops = atof(keyValPair[1].c_str());
+        }
+        else if (keyValPair[0] == "-peak-gbs") {
+          peakGbs = atof(keyValPair[1].c_str());
+        }
         else {
           printUsage();
           return 3;
@@ -248,11 +306,19 @@ int main(int argc, const char* argv[]) {
       *simitos << "% Compile " << function << endl;
     }
 
+    CompileStats compileStats;
+    internal::CompileStatsScope statsScope(timePasses ? &compileStats
+                                                      : nullptr);
+
     func = lower(func, simitos);
 
+    if (roofline) {
+      printRoofline(func, peakGflops, peakGbs, cout);
+    }
+
     // Emit and print llvm code
     // NB: The LLVM code gets further optimized at init time (OSR, etc.)
-    if (llvmos || asmos) {
+    if (llvmos || asmos || (timePasses && !gpu)) {
       backend::Backend backend("cpu");
       simit::Function  llvmFunc(backend.compile(func));
 
@@ -279,6 +345,10 @@ int main(int argc, const char* argv[]) {
       }
       cout << util::trim(util::toString(llvmFunc)) << endl;
     }
+
+    if (timePasses) {
+      compileStats.print(cerr);
+    }
   }
 
   return 0;
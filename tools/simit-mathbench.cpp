@@ -0,0 +1,142 @@
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "runtime_math.h"
+
+using namespace std;
+
+// Microbenchmarks of the vectorizable math approximations in runtime_math.h
+// against libm. Each function is applied to an array of inputs, so the
+// compiler can vectorize the approximations the way generated code does once
+// the runtime bitcode is inlined.
+
+static void printUsage() {
+  cerr << "Usage: simit-mathbench [-n=<elements>] [-reps=<repetitions>]"
+       << endl;
+}
+
+/// Returns the error of result in units of the last place of the exact value.
+template <typename Float>
+static long double ulpError(Float result, long double exact) {
+  if (std::isnan(exact) || std::isinf(exact)) {
+    return (result == exact || (std::isnan(result) && std::isnan(exact)))
+           ? 0.0L : INFINITY;
+  }
+  Float rounded = (Float)exact;
+  Float next = nextafter(rounded, numeric_limits<Float>::infinity());
+  long double ulp = (long double)next - (long double)rounded;
+  if (ulp == 0.0L || std::isinf(ulp)) {
+    ulp = (long double)rounded -
+          (long double)nextafter(rounded, -numeric_limits<Float>::infinity());
+  }
+  return fabsl((long double)result - exact) / ulp;
+}
+
+/// Returns the fastest time, in nanoseconds per element, of applying f to xs.
+template <typename Float, typename F>
+static double time(F f, const vector<Float>& xs, vector<Float>& ys, int reps) {
+  double best = INFINITY;
+  for (int r = 0; r < reps; ++r) {
+    auto start = chrono::high_resolution_clock::now();
+    f(xs.data(), ys.data(), xs.size());
+    auto end = chrono::high_resolution_clock::now();
+    double ns = chrono::duration<double, nano>(end - start).count();
+    best = min(best, ns / xs.size());
+  }
+  return best;
+}
+
+template <typename Float, typename Libm, typename Simit, typename Exact>
+static void bench(string name, Libm libm, Simit simit, Exact exact,
+                  double lo, double hi, size_t n, int reps) {
+  mt19937 rng(0);
+  uniform_real_distribution<double> dist(lo, hi);
+  vector<Float> xs(n);
+  for (auto& x : xs) {
+    x = (Float)dist(rng);
+  }
+  vector<Float> ys(n);
+
+  double libmTime = time<Float>([&](const Float* x, Float* y, size_t n) {
+    for (size_t i = 0; i < n; ++i) y[i] = libm(x[i]);
+  }, xs, ys, reps);
+  double simitTime = time<Float>([&](const Float* x, Float* y, size_t n) {
+    for (size_t i = 0; i < n; ++i) y[i] = simit(x[i]);
+  }, xs, ys, reps);
+
+  long double maxError = 0.0L;
+  for (size_t i = 0; i < n; ++i) {
+    maxError = max(maxError, ulpError<Float>(ys[i], exact((long double)xs[i])));
+  }
+
+  cout << left << setw(12) << name << right << fixed
+       << setprecision(2) << setw(10) << libmTime
+       << setprecision(2) << setw(10) << simitTime
+       << setprecision(1) << setw(9) << libmTime / simitTime << "x"
+       << setprecision(2) << setw(10) << (double)maxError << endl;
+}
+
+int main(int argc, const char* argv[]) {
+  size_t n = 1 << 20;
+  int reps = 10;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg.compare(0, 3, "-n=") == 0) {
+      n = strtoul(arg.substr(3).c_str(), nullptr, 10);
+    }
+    else if (arg.compare(0, 6, "-reps=") == 0) {
+      reps = atoi(arg.substr(6).c_str());
+    }
+    else {
+      printUsage();
+      return 1;
+    }
+  }
+  if (n == 0 || reps <= 0) {
+    printUsage();
+    return 1;
+  }
+
+  cout << left << setw(12) << "function" << right << setw(10) << "libm ns"
+       << setw(10) << "simit ns" << setw(10) << "speedup"
+       << setw(10) << "max ulp" << endl;
+
+  bench<float>("exp_f32", [](float x) {return expf(x);},
+               [](float x) {return simit::math::exp(x);},
+               [](long double x) {return expl(x);}, -80.0, 80.0, n, reps);
+  bench<double>("exp_f64", [](double x) {return exp(x);},
+                [](double x) {return simit::math::exp(x);},
+                [](long double x) {return expl(x);}, -700.0, 700.0, n, reps);
+  bench<float>("log_f32", [](float x) {return logf(x);},
+               [](float x) {return simit::math::log(x);},
+               [](long double x) {return logl(x);}, 1e-3, 1e6, n, reps);
+  bench<double>("log_f64", [](double x) {return log(x);},
+                [](double x) {return simit::math::log(x);},
+                [](long double x) {return logl(x);}, 1e-3, 1e6, n, reps);
+  bench<float>("sin_f32", [](float x) {return sinf(x);},
+               [](float x) {return simit::math::sin(x);},
+               [](long double x) {return sinl(x);}, -100.0, 100.0, n, reps);
+  bench<double>("sin_f64", [](double x) {return sin(x);},
+                [](double x) {return simit::math::sin(x);},
+                [](long double x) {return sinl(x);}, -100.0, 100.0, n, reps);
+  bench<float>("cos_f32", [](float x) {return cosf(x);},
+               [](float x) {return simit::math::cos(x);},
+               [](long double x) {return cosl(x);}, -100.0, 100.0, n, reps);
+  bench<double>("cos_f64", [](double x) {return cos(x);},
+                [](double x) {return simit::math::cos(x);},
+                [](long double x) {return cosl(x);}, -100.0, 100.0, n, reps);
+  bench<float>("atan2_f32", [](float x) {return atan2f(x, 0.5f);},
+               [](float x) {return simit::math::atan2(x, 0.5f);},
+               [](long double x) {return atan2l(x, 0.5L);},
+               -100.0, 100.0, n, reps);
+  bench<float>("pow_f32", [](float x) {return powf(x, 2.5f);},
+               [](float x) {return simit::math::pow(x, 2.5f);},
+               [](long double x) {return powl(x, 2.5L);}, 0.0, 1e4, n, reps);
+  return 0;
+}